@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef BOUNDEDQUEUE_H_
+#define BOUNDEDQUEUE_H_
+
+#include <algorithm>
+#include <deque>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace fts3
+{
+namespace common
+{
+
+/**
+ * FIFO queue connecting two threads (or groups of threads).
+ * The producers block while the queue is full, so a slow consumer slows the producers down
+ * instead of letting the queue grow.
+ * push and pop are boost::thread interruption points.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    /// @param capacity Maximum number of elements waiting in the queue
+    explicit BoundedQueue(size_t capacity): capacity(std::max<size_t>(capacity, 1)), highWatermark(0)
+    {
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator = (const BoundedQueue&) = delete;
+
+    /// Push an element, waiting for room if the queue is full
+    void push(T value)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.size() >= capacity) {
+                notFull.wait(lock);
+            }
+            queue.push_back(std::move(value));
+            highWatermark = std::max(highWatermark, queue.size());
+        }
+        notEmpty.notify_one();
+    }
+
+    /// Pop the oldest element, waiting for one if the queue is empty
+    T pop()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (queue.empty()) {
+            notEmpty.wait(lock);
+        }
+        T value(std::move(queue.front()));
+        queue.pop_front();
+        lock.unlock();
+
+        notFull.notify_one();
+        return value;
+    }
+
+    /// Number of elements waiting
+    size_t size() const
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        return queue.size();
+    }
+
+    /// Highest number of elements waiting since the previous call
+    size_t collectHighWatermark()
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        size_t collected = highWatermark;
+        highWatermark = queue.size();
+        return collected;
+    }
+
+private:
+    const size_t capacity;
+    std::deque<T> queue;
+    size_t highWatermark;
+
+    mutable boost::mutex mutex;
+    boost::condition_variable notEmpty;
+    boost::condition_variable notFull;
+};
+
+} /* namespace common */
+} /* namespace fts3 */
+
+#endif /* BOUNDEDQUEUE_H_ */
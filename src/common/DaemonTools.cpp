@@ -79,35 +79,42 @@ uid_t getGroupGid(const std::string& name)
 
 int countProcessesWithName(const std::string& name)
 {
-    int count = 0;
-
     try {
-        const std::filesystem::path proc{"/proc"};
-        for (auto const& proc_entry : std::filesystem::directory_iterator{proc}) {
-            std::filesystem::path pid = proc_entry.path();
-            int result;
-            auto [ptr, ec] = std::from_chars(pid.filename().c_str(), pid.filename().c_str() + pid.filename().string().size(), result);
-            if (ec != std::errc())
-                continue;
-
-            const std::filesystem::path cmdline{pid.string() + "/cmdline"};
-            try {
-                std::ifstream cmdlineStream(cmdline.c_str(), std::ios_base::in);
-                std::string cmdName;
-
-                std::getline(cmdlineStream, cmdName, '\0');
-                if (cmdName.ends_with(name)) {
-                    ++count;
-                }
-            } catch (...) {
-                // pass
-            }
-       }
+        return static_cast<int>(getProcessesWithName(name).size());
     } catch (...) {
         return -1;
     }
+}
+
+
+std::vector<pid_t> getProcessesWithName(const std::string& name)
+{
+    std::vector<pid_t> pids;
+
+    const std::filesystem::path proc{"/proc"};
+    for (auto const& proc_entry : std::filesystem::directory_iterator{proc}) {
+        std::filesystem::path pid = proc_entry.path();
+        const std::string filename = pid.filename().string();
+        pid_t result = 0;
+        auto [ptr, ec] = std::from_chars(filename.data(), filename.data() + filename.size(), result);
+        if (ec != std::errc() || ptr != filename.data() + filename.size())
+            continue;
+
+        const std::filesystem::path cmdline{pid.string() + "/cmdline"};
+        try {
+            std::ifstream cmdlineStream(cmdline.c_str(), std::ios_base::in);
+            std::string cmdName;
+
+            std::getline(cmdlineStream, cmdName, '\0');
+            if (cmdName.ends_with(name)) {
+                pids.push_back(result);
+            }
+        } catch (...) {
+            // pass
+        }
+    }
 
-    return count;
+    return pids;
 }
 
 
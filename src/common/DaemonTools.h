@@ -24,6 +24,7 @@
 
 #include <sys/types.h>
 #include <string>
+#include <vector>
 
 namespace fts3 {
 namespace common {
@@ -40,6 +41,10 @@ gid_t getGroupGid(const std::string& name);
 /// @return < 0 on error, number of processes with the given name otherwise
 int countProcessesWithName(const std::string& name);
 
+/// Returns the pids of the processes with the given name
+/// Throws exception if /proc can not be read
+std::vector<pid_t> getProcessesWithName(const std::string& name);
+
 /// Checks if there is a binary 'name' in the PATH, and it is executable
 /// @param fullPath Stores here the full path, if found.
 bool binaryExists(const std::string& name, std::string* fullPath);
@@ -24,7 +24,11 @@
 #include "Exceptions.h"
 
 #include <fcntl.h>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
 #include <boost/algorithm/string.hpp>
 
 
@@ -38,13 +42,19 @@ Logger& theLogger()
     return *logger;
 }
 
-LoggerEntry::LoggerEntry(bool writeable): writeable(writeable)
+LoggerEntry::LoggerEntry(bool writeable)
 {
+    if (writeable) {
+        stream.reset(new std::ostringstream());
+    }
 }
 
 
-LoggerEntry::LoggerEntry(const LoggerEntry& le): stream(le.stream.str()), writeable(le.writeable)
+LoggerEntry::LoggerEntry(const LoggerEntry& le)
 {
+    if (le.stream) {
+        stream.reset(new std::ostringstream(le.stream->str(), std::ios_base::ate));
+    }
 }
 
 
@@ -88,8 +98,217 @@ Logger::LogLevel Logger::getLogLevel(const std::string& repr)
 }
 
 
+Logger::OverflowPolicy Logger::getOverflowPolicy(const std::string& repr)
+{
+    if (boost::iequals(repr, "block")) {
+        return BLOCK;
+    }
+    else if (boost::iequals(repr, "drop")) {
+        return DROP;
+    }
+    throw SystemError(std::string("Unknown logging overflow policy ") + repr);
+}
+
+
+/// Writes from a background thread the lines queued by the other threads.
+/// Each thread has its own single producer, single consumer ring, so queuing a line
+/// does not take any lock.
+class Logger::AsyncWriter
+{
+public:
+    AsyncWriter(Logger &logger, size_t queueSize, OverflowPolicy policy):
+        logger(logger), id(++lastId), queueSize(queueSize), policy(policy), pending(0), dropped(0),
+        running(true), sleeping(false)
+    {
+        thread = std::thread(&AsyncWriter::run, this);
+    }
+
+    /// Nobody must be pushing anymore
+    ~AsyncWriter()
+    {
+        stop();
+
+        // Lines pushed while stopping
+        std::vector<std::string> batch;
+        collect(batch);
+        if (!batch.empty()) {
+            logger.writeLines(batch);
+        }
+    }
+
+    void push(std::string &&line)
+    {
+        Ring &ring = getRing();
+        const size_t head = ring.head.load(std::memory_order_relaxed);
+
+        while (head - ring.tail.load(std::memory_order_acquire) >= ring.slots.size()) {
+            if (policy == DROP || !running) {
+                ++dropped;
+                return;
+            }
+            wake();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        ring.slots[head % ring.slots.size()] = std::move(line);
+        ++pending;
+        ring.head.store(head + 1, std::memory_order_release);
+
+        if (sleeping.load()) {
+            wake();
+        }
+    }
+
+    /// Wait until everything queued so far is written
+    void drain()
+    {
+        while (pending.load() > 0 && running) {
+            wake();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    /// Write whatever is left, and stop the background thread
+    void stop()
+    {
+        if (running.exchange(false)) {
+            wake();
+            thread.join();
+        }
+    }
+
+private:
+    struct Ring {
+        Ring(size_t capacity): slots(capacity), head(0), tail(0), closed(false) {}
+
+        std::vector<std::string> slots;
+        std::atomic<size_t> head;
+        std::atomic<size_t> tail;
+        /// The owner thread is gone
+        std::atomic<bool> closed;
+    };
+
+    /// Registers the calling thread ring the first time it logs
+    struct RingHolder {
+        /// Writer the ring belongs to. Not a pointer, as a new writer may reuse the address of a freed one.
+        uint64_t writerId;
+        std::shared_ptr<Ring> ring;
+
+        RingHolder(): writerId(0) {}
+        ~RingHolder() {
+            if (ring) {
+                ring->closed = true;
+            }
+        }
+    };
+
+    Ring &getRing()
+    {
+        static thread_local RingHolder holder;
+        if (holder.writerId != id) {
+            if (holder.ring) {
+                holder.ring->closed = true;
+            }
+            holder.writerId = id;
+            holder.ring = std::make_shared<Ring>(queueSize);
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(holder.ring);
+        }
+        return *holder.ring;
+    }
+
+    void wake()
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeUp.notify_one();
+    }
+
+    /// Move the queued lines into batch
+    /// @return how many were queued
+    size_t collect(std::vector<std::string> &batch)
+    {
+        size_t collected = 0;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+
+        for (auto i = rings.begin(); i != rings.end();) {
+            Ring &ring = **i;
+            const bool closed = ring.closed.load();
+            const size_t head = ring.head.load(std::memory_order_acquire);
+            size_t tail = ring.tail.load(std::memory_order_relaxed);
+
+            for (; tail != head; ++tail) {
+                batch.emplace_back(std::move(ring.slots[tail % ring.slots.size()]));
+                ++collected;
+            }
+            ring.tail.store(tail, std::memory_order_release);
+
+            if (closed && ring.head.load(std::memory_order_acquire) == tail) {
+                i = rings.erase(i);
+            }
+            else {
+                ++i;
+            }
+        }
+
+        const uint64_t nDropped = dropped.exchange(0);
+        if (nDropped > 0) {
+            batch.emplace_back(logLevelStringRepresentation(WARNING) + timestamp() + logger._separator +
+                std::to_string(nDropped) + " log lines dropped because the queue was full");
+        }
+        return collected;
+    }
+
+    void run()
+    {
+        std::vector<std::string> batch;
+
+        while (true) {
+            const size_t collected = collect(batch);
+
+            if (batch.empty()) {
+                if (!running) {
+                    break;
+                }
+                // A wake up may be missed between these two, which only delays the writing a bit
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                sleeping = true;
+                wakeUp.wait_for(lock, std::chrono::milliseconds(50));
+                sleeping = false;
+                continue;
+            }
+
+            logger.writeLines(batch);
+            batch.clear();
+            pending -= collected;
+        }
+    }
+
+    static std::atomic<uint64_t> lastId;
+
+    Logger &logger;
+    const uint64_t id;
+    const size_t queueSize;
+    const OverflowPolicy policy;
+
+    std::mutex ringsMutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    std::atomic<uint64_t> pending;
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> running;
+    std::atomic<bool> sleeping;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeUp;
+    std::thread thread;
+};
+
+
+std::atomic<uint64_t> Logger::AsyncWriter::lastId(0);
+
+
 Logger::Logger(): _logLevel(DEBUG), _profiling(false), _tokenRequests(false),
-                  _separator("; "), _nCommits(0)
+                  _separator("; "), asyncWriter(NULL), asyncUsers(0), _nCommits(0)
 {
     ostream = &std::cout;
     newLog(TRACE, __FILE__, __FUNCTION__, __LINE__) << "Logger created" << commit;
@@ -130,24 +349,126 @@ Logger & Logger::setLogTokenRequests(bool value)
 }
 
 
-void Logger::flush(const std::string &line)
+static void drainAtExit()
+{
+    theLogger().setAsync(false);
+}
+
+
+Logger & Logger::setAsync(bool enabled, size_t queueSize, OverflowPolicy policy)
+{
+    static bool handlersInstalled = false;
+
+    if (enabled && !asyncWriter.load()) {
+        if (!handlersInstalled) {
+            handlersInstalled = true;
+            atexit(drainAtExit);
+            // The child of a fork does not have the writer thread, so it can only write synchronously
+            pthread_atfork(NULL, NULL, []() {
+                theLogger().asyncWriter = NULL;
+                theLogger().asyncUsers = 0;
+            });
+        }
+        asyncWriter = new AsyncWriter(*this, std::max<size_t>(queueSize, 1), policy);
+        newLog(INFO, __FILE__, __FUNCTION__, __LINE__)
+            << "Logging asynchronously (queue size " << queueSize << ", "
+            << (policy == DROP ? "drop" : "block") << " on overflow)"
+            << commit;
+    }
+    else if (!enabled) {
+        AsyncWriter *writer = asyncWriter.exchange(NULL);
+        if (writer) {
+            // Once stopped, the threads still holding it do not wait for room in their queue
+            writer->stop();
+            while (asyncUsers.load() > 0) {
+                std::this_thread::yield();
+            }
+            delete writer;
+        }
+    }
+    return *this;
+}
+
+
+void Logger::drain()
+{
+    ++asyncUsers;
+    AsyncWriter *writer = asyncWriter.load();
+    if (writer) {
+        writer->drain();
+    }
+    --asyncUsers;
+}
+
+
+void Logger::writeLines(std::vector<std::string> &lines)
 {
     boost::mutex::scoped_lock lock(outMutex);
+    for (auto i = lines.begin(); i != lines.end(); ++i) {
+        writeLine(*i);
+    }
+    ostream->flush();
+}
+
+
+void Logger::writeLine(const std::string &line)
+{
     _nCommits++;
     if (_nCommits >= NB_COMMITS_BEFORE_CHECK) {
         _nCommits = 0;
         checkFd();
     }
-    *ostream << line << std::endl;
+    *ostream << line << '\n';
+}
+
+
+class Logger::ThreadOutput
+{
+public:
+    std::mutex mutex;
+    std::ofstream stream;
+
+    explicit ThreadOutput(const std::string &path): stream(path, std::ios_base::app)
+    {
+    }
+};
+
+
+/// Set for the threads that do not write into the shared output
+static thread_local std::shared_ptr<Logger::ThreadOutput> threadOutput;
+
+
+void Logger::flush(std::string &&line)
+{
+    if (threadOutput) {
+        std::lock_guard<std::mutex> lock(threadOutput->mutex);
+        if (threadOutput->stream.fail()) {
+            threadOutput->stream.clear();
+        }
+        threadOutput->stream << line << std::endl;
+        return;
+    }
+
+    ++asyncUsers;
+    AsyncWriter *writer = asyncWriter.load();
+    if (writer) {
+        writer->push(std::move(line));
+        --asyncUsers;
+        return;
+    }
+    --asyncUsers;
+
+    boost::mutex::scoped_lock lock(outMutex);
+    writeLine(line);
+    ostream->flush();
 }
 
 
 /// This method has to be thread safe!
 void LoggerEntry::_commit()
 {
-    if (writeable) {
-        std::string line = stream.str();
-        theLogger().flush(line);
+    if (stream) {
+        theLogger().flush(stream->str());
     }
 }
 
@@ -164,9 +485,11 @@ LoggerEntry Logger::newLog(LogLevel level, const char* aFile,
         can_write = (level >= this->_logLevel);
     }
     LoggerEntry entry(can_write);
-    entry << logLevelStringRepresentation(level) << timestamp() << _separator;
-    if (level >= ERR && this->_logLevel <= DEBUG) {
-        entry << aFile << _separator << aFunc << _separator << std::dec << aLineNo << _separator;
+    if (can_write) {
+        entry << logLevelStringRepresentation(level) << timestamp() << _separator;
+        if (level >= ERR && this->_logLevel <= DEBUG) {
+            entry << aFile << _separator << aFunc << _separator << std::dec << aLineNo << _separator;
+        }
     }
     return entry;
 }
@@ -187,6 +510,8 @@ static int createAndReopen(const std::string& path, FILE* stream)
 
 int Logger::redirect(const std::string& outPath, const std::string& errPath) throw()
 {
+    boost::mutex::scoped_lock lock(outMutex);
+
     if (ostream != &std::cout) {
         delete ostream;
     }
@@ -200,6 +525,39 @@ int Logger::redirect(const std::string& outPath, const std::string& errPath) thr
 }
 
 
+int Logger::redirectThread(const std::string& path) throw()
+{
+    if (path.empty()) {
+        threadOutput.reset();
+        return 0;
+    }
+
+    try {
+        auto output = std::make_shared<ThreadOutput>(path);
+        if (!output->stream.is_open()) {
+            return -1;
+        }
+        threadOutput = output;
+    }
+    catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+
+std::shared_ptr<Logger::ThreadOutput> Logger::getThreadOutput()
+{
+    return threadOutput;
+}
+
+
+void Logger::setThreadOutput(const std::shared_ptr<ThreadOutput>& output)
+{
+    threadOutput = output;
+}
+
+
 void Logger::checkFd(void)
 {
     if (ostream->fail()) {
@@ -24,7 +24,11 @@
 #ifndef LOGGER_H_
 #define LOGGER_H_
 
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
 #include <boost/thread/mutex.hpp>
 
 
@@ -39,8 +43,8 @@ private:
     friend class Logger;
     friend LoggerEntry& commit(LoggerEntry& entry);
 
-    std::stringstream stream;
-    bool writeable;
+    /// Only allocated when the entry is to be written
+    std::unique_ptr<std::ostringstream> stream;
 
     LoggerEntry(bool writeable);
     LoggerEntry(const LoggerEntry& le);
@@ -62,9 +66,9 @@ public:
     template <typename T>
     LoggerEntry& operator << (const T& aSrc)
     {
-        if (writeable)
+        if (stream)
         {
-            stream << aSrc;
+            *stream << aSrc;
         }
         return *this;
     }
@@ -88,11 +92,22 @@ public:
         CRIT
     } LogLevel;
 
+    /// What to do when a thread fills its queue in asynchronous mode
+    typedef enum
+    {
+        BLOCK,
+        DROP
+    } OverflowPolicy;
+
     /// Get the corresponding log level for the given string
     /// representation. Case insensitive. If repr is unknown, a SystemError
     /// exception is thrown
     static LogLevel getLogLevel(const std::string& repr);
 
+    /// Get the overflow policy for the given string representation ("block" or "drop").
+    /// Case insensitive. If repr is unknown, a SystemError exception is thrown
+    static OverflowPolicy getOverflowPolicy(const std::string& repr);
+
     /// Constructor
     Logger();
 
@@ -108,6 +123,14 @@ public:
     /// Set flag for token requests logs
     Logger& setLogTokenRequests(bool value);
 
+    /// Queue the log lines into per thread buffers, to be written by a background thread.
+    /// Each thread can have up to queueSize lines pending, after which policy applies.
+    /// Pending lines are written when disabled, and when the process exits.
+    Logger& setAsync(bool enabled, size_t queueSize = 1024, OverflowPolicy policy = BLOCK);
+
+    /// Wait until all the queued lines have been written
+    void drain();
+
     /// Start a new log message. But this is not the recommended way,
     /// use FTS3_COMMON_LOGGER_NEWLOG. It calls this method, but adds
     /// proper debug information. The integer LOGLEVEL template parameter
@@ -121,6 +144,20 @@ public:
     /// Return 0 on success
     int redirect(const std::string& stdout, const std::string& stderr) throw();
 
+    /// Output file private to some threads
+    class ThreadOutput;
+
+    /// Write the lines logged by the calling thread into path, instead of the shared output.
+    /// An empty path goes back to the shared output.
+    /// Return 0 on success
+    int redirectThread(const std::string& path) throw();
+
+    /// Output of the calling thread, null if it writes into the shared output
+    std::shared_ptr<ThreadOutput> getThreadOutput();
+
+    /// Make the calling thread write into output (i.e. the output of the thread that started it)
+    void setThreadOutput(const std::shared_ptr<ThreadOutput>& output);
+
 private:
     friend class LoggerEntry;
 
@@ -140,11 +177,23 @@ private:
     boost::mutex outMutex;
     std::ostream *ostream;
 
+    /// Set when writing asynchronously
+    class AsyncWriter;
+    std::atomic<AsyncWriter*> asyncWriter;
+    /// Threads that may be using asyncWriter, so it is not freed under their feet
+    std::atomic<unsigned> asyncUsers;
+
     /// Check file descriptor every X iterations
     static const unsigned NB_COMMITS_BEFORE_CHECK = 1000;
     unsigned _nCommits;
 
-    void flush(const std::string &line);
+    void flush(std::string &&line);
+
+    /// Write a batch of lines into the output, flushing once at the end
+    void writeLines(std::vector<std::string> &lines);
+
+    /// Write a line into the output. outMutex must be held.
+    void writeLine(const std::string &line);
 
     /// String representation of the timestamp
     static std::string timestamp();
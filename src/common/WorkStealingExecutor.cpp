@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "WorkStealingExecutor.h"
+#include "Logger.h"
+
+namespace fts3
+{
+namespace common
+{
+
+/// Executor and index of the worker running in this thread, if any
+static thread_local WorkStealingExecutor *currentExecutor = nullptr;
+static thread_local size_t currentWorker = 0;
+/// Group of the task running in this thread, if any
+static thread_local TaskGroup *currentGroup = nullptr;
+
+
+WorkStealingExecutor& WorkStealingExecutor::instance()
+{
+    static WorkStealingExecutor executor(std::max(boost::thread::hardware_concurrency(), 1u));
+    return executor;
+}
+
+
+WorkStealingExecutor::WorkStealingExecutor(size_t size):
+    workers(MAX_WORKERS), active(0), quotas(0), nextWorker(0), queued(0), sleeping(0)
+{
+    reserve(std::max<size_t>(size, 1));
+}
+
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+    // The owner may be being interrupted itself
+    boost::this_thread::disable_interruption disabled;
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+
+void WorkStealingExecutor::reserve(size_t n)
+{
+    n = std::min(n, MAX_WORKERS);
+    if (active.load() >= n) {
+        return;
+    }
+
+    boost::lock_guard<boost::mutex> lock(growMutex);
+    for (size_t index = active.load(); index < n; ++index) {
+        workers[index].reset(new Worker);
+        // Published before the thread starts, so the other workers can steal from it
+        active.store(index + 1);
+        threads.create_thread([this, index]() { run(index); });
+    }
+}
+
+
+void WorkStealingExecutor::acquireQuota(size_t n)
+{
+    if (n > 0) {
+        reserve(quotas += n);
+    }
+}
+
+
+void WorkStealingExecutor::releaseQuota(size_t n)
+{
+    // The workers are kept, the next groups will use them
+    quotas -= n;
+}
+
+
+size_t WorkStealingExecutor::size() const
+{
+    return active.load();
+}
+
+
+void WorkStealingExecutor::submit(Task task, Priority priority)
+{
+    const size_t index = (currentExecutor == this) ? currentWorker : (nextWorker++ % active.load());
+    {
+        Worker &worker = *workers[index];
+        boost::lock_guard<boost::mutex> lock(worker.mutex);
+        worker.queues[priority].push_back(std::move(task));
+    }
+    ++queued;
+
+    // A worker going to sleep registers itself before checking queued, so either it sees the task,
+    // or we see it. Taking the lock makes sure it is already waiting when notified.
+    if (sleeping.load() > 0) {
+        {
+            boost::lock_guard<boost::mutex> lock(sleepMutex);
+        }
+        wakeUp.notify_one();
+    }
+}
+
+
+bool WorkStealingExecutor::take(size_t index, Task &task)
+{
+    const size_t count = active.load();
+
+    for (int priority = 0; priority < PRIORITIES; ++priority) {
+        // The oldest of our own
+        {
+            Worker &own = *workers[index];
+            boost::lock_guard<boost::mutex> lock(own.mutex);
+            auto &queue = own.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.front());
+                queue.pop_front();
+                --queued;
+                return true;
+            }
+        }
+        // The newest of somebody else
+        for (size_t i = 1; i < count; ++i) {
+            Worker &victim = *workers[(index + i) % count];
+            boost::lock_guard<boost::mutex> lock(victim.mutex);
+            auto &queue = victim.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.back());
+                queue.pop_back();
+                --queued;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+void WorkStealingExecutor::run(size_t index)
+{
+    currentExecutor = this;
+    currentWorker = index;
+
+    try {
+        while (true) {
+            Task task;
+            if (take(index, task)) {
+                try {
+                    task();
+                }
+                catch (const boost::thread_interrupted&) {
+                    throw;
+                }
+                catch (const std::exception &e) {
+                    FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Exception in executor task: " << e.what() << commit;
+                }
+                catch (...) {
+                    FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Unknown exception in executor task" << commit;
+                }
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(sleepMutex);
+            ++sleeping;
+            try {
+                while (queued.load() == 0) {
+                    wakeUp.wait(lock);
+                }
+            }
+            catch (...) {
+                --sleeping;
+                throw;
+            }
+            --sleeping;
+        }
+    }
+    catch (const boost::thread_interrupted&) {
+        // Shutting down
+    }
+}
+
+
+TaskGroup::TaskGroup(WorkStealingExecutor &executor, size_t quota, WorkStealingExecutor::Priority priority):
+    executor(executor), quota(quota), priority(priority), running(0), outstanding(0), cancelled(false)
+{
+    executor.acquireQuota(quota);
+}
+
+
+TaskGroup::~TaskGroup()
+{
+    interrupt();
+
+    // The tasks running refer to this group
+    boost::this_thread::disable_interruption disabled;
+    join();
+    executor.releaseQuota(quota);
+}
+
+
+void TaskGroup::run(WorkStealingExecutor::Task task)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        if (cancelled) {
+            return;
+        }
+        ++outstanding;
+        if (quota > 0 && running >= quota) {
+            backlog.push_back(std::move(task));
+            return;
+        }
+        ++running;
+    }
+    executor.submit(wrap(std::move(task)), priority);
+}
+
+
+void TaskGroup::join()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (outstanding > 0) {
+        finished.wait(lock);
+    }
+}
+
+
+void TaskGroup::interrupt()
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    cancelled = true;
+    outstanding -= backlog.size();
+    backlog.clear();
+    if (outstanding == 0) {
+        finished.notify_all();
+    }
+}
+
+
+bool TaskGroup::interruptionRequested()
+{
+    if (currentGroup && currentGroup->cancelled.load()) {
+        return true;
+    }
+    return boost::this_thread::interruption_requested();
+}
+
+
+size_t TaskGroup::pending()
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    return outstanding;
+}
+
+
+WorkStealingExecutor::Task TaskGroup::wrap(WorkStealingExecutor::Task task)
+{
+    return [this, task = std::move(task)]() {
+        struct Done {
+            TaskGroup &group;
+            ~Done() { group.done(); }
+        } guard{*this};
+
+        if (cancelled.load()) {
+            return;
+        }
+
+        struct Current {
+            TaskGroup *previous;
+            explicit Current(TaskGroup *group): previous(currentGroup) { currentGroup = group; }
+            ~Current() { currentGroup = previous; }
+        } current(this);
+
+        task();
+    };
+}
+
+
+void TaskGroup::done()
+{
+    WorkStealingExecutor::Task next;
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        --outstanding;
+        if (!backlog.empty()) {
+            // Keep the slot in the quota for the next one
+            next = std::move(backlog.front());
+            backlog.pop_front();
+        }
+        else {
+            --running;
+        }
+        if (outstanding == 0) {
+            finished.notify_all();
+        }
+    }
+    // Still outstanding, so the group is alive
+    if (next) {
+        executor.submit(wrap(std::move(next)), priority);
+    }
+}
+
+} /* namespace common */
+} /* namespace fts3 */
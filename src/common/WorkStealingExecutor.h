@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef WORKSTEALINGEXECUTOR_H_
+#define WORKSTEALINGEXECUTOR_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/any.hpp>
+#include <boost/thread.hpp>
+
+namespace fts3
+{
+namespace common
+{
+
+/**
+ * Pool of worker threads shared by all the services of a process, so they do not need to
+ * create and join their own threads on every cycle.
+ *
+ * Each worker owns a deque of tasks per priority. Tasks submitted from outside are spread round robin
+ * between the workers, and tasks submitted from a worker go to its own deque. A worker runs the oldest
+ * task of its own deque, or steals the newest one from another worker, highest priority first.
+ * Only one sleeping worker is woken per task.
+ *
+ * The services do not use it directly, but through a TaskGroup.
+ */
+class WorkStealingExecutor
+{
+public:
+    enum Priority {
+        High = 0,
+        Normal,
+        Low
+    };
+    static constexpr int PRIORITIES = Low + 1;
+
+    /// Upper limit for reserve
+    static constexpr size_t MAX_WORKERS = 256;
+
+    typedef std::function<void ()> Task;
+
+    /// Executor shared by the whole process. Starts with as many workers as cores.
+    static WorkStealingExecutor& instance();
+
+    /// @param size Initial number of workers
+    explicit WorkStealingExecutor(size_t size);
+
+    /// Interrupt and join the workers. Tasks not started are dropped.
+    ~WorkStealingExecutor();
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator = (const WorkStealingExecutor&) = delete;
+
+    /// Start workers until there are at least n (up to MAX_WORKERS)
+    void reserve(size_t n);
+
+    /**
+     * Account for n more tasks that may be running at once, and grow the workers to the sum
+     * of the quotas still held. Used by TaskGroup, so groups do not wait for each other's slots.
+     */
+    void acquireQuota(size_t n);
+
+    /// Give back a quota taken with acquireQuota
+    void releaseQuota(size_t n);
+
+    /// Number of workers
+    size_t size() const;
+
+    /// Queue a task. Exceptions thrown by the task are logged and discarded.
+    void submit(Task task, Priority priority = Normal);
+
+private:
+    struct Worker {
+        boost::mutex mutex;
+        std::deque<Task> queues[PRIORITIES];
+    };
+
+    /// MAX_WORKERS slots, filled by reserve. Only the first 'active' are valid.
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> active;
+    boost::mutex growMutex;
+    boost::thread_group threads;
+    /// Sum of the quotas of the live groups
+    std::atomic<size_t> quotas;
+
+    /// Round robin for tasks submitted from outside the workers
+    std::atomic<size_t> nextWorker;
+    /// Tasks queued and not taken yet
+    std::atomic<size_t> queued;
+
+    boost::mutex sleepMutex;
+    boost::condition_variable wakeUp;
+    /// Workers waiting for tasks
+    std::atomic<size_t> sleeping;
+
+    void run(size_t index);
+
+    /// Take a task from the own deque, or steal one
+    bool take(size_t index, Task &task);
+};
+
+
+/**
+ * Tasks of one service cycle, run by a WorkStealingExecutor.
+ * It has the same interface as ThreadPool, so join waits for the tasks of this group only.
+ */
+class TaskGroup
+{
+public:
+    /**
+     * @param executor  Executor running the tasks
+     * @param quota     Maximum number of tasks of this group running at once, 0 for no limit.
+     *                  The executor is grown so it has a worker for each task of each live group.
+     * @param priority  Priority of the tasks of this group
+     */
+    explicit TaskGroup(WorkStealingExecutor &executor, size_t quota = 0,
+        WorkStealingExecutor::Priority priority = WorkStealingExecutor::Normal);
+
+    /// Drop the tasks not started, and wait for the running ones
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator = (const TaskGroup&) = delete;
+
+    /// Run a task
+    void run(WorkStealingExecutor::Task task);
+
+    /**
+     * Run a ThreadPool task, which is given its own context.
+     * The group takes ownership of the pointer.
+     */
+    template <typename TASK>
+    void start(TASK *t)
+    {
+        std::shared_ptr<TASK> task(t);
+        run([this, task]() {
+            boost::any context;
+            task->run(context);
+            if (!context.empty()) {
+                boost::lock_guard<boost::mutex> lock(mutex);
+                contexts.push_back(context);
+            }
+        });
+    }
+
+    /// Wait for all the tasks run so far. This is an interruption point.
+    void join();
+
+    /**
+     * Drop the tasks not started yet.
+     * The running ones are not stopped, but they see interruptionRequested.
+     */
+    void interrupt();
+
+    /**
+     * To be called from a task: true if its group was interrupted,
+     * or if the thread itself was (boost::this_thread::interruption_requested)
+     */
+    static bool interruptionRequested();
+
+    /// Tasks run and not finished yet
+    size_t pending();
+
+    /**
+     * Reduce the contexts of the tasks run with start (see ThreadPool::reduce)
+     * Must be called after join.
+     */
+    template<class RET, template<class> class OPERATION>
+    RET reduce(OPERATION<RET> op)
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        RET init = RET();
+        for (auto it = contexts.begin(); it != contexts.end(); ++it) {
+            init = op(init, boost::any_cast<RET>(*it));
+        }
+        return init;
+    }
+
+private:
+    WorkStealingExecutor &executor;
+    const size_t quota;
+    const WorkStealingExecutor::Priority priority;
+
+    boost::mutex mutex;
+    boost::condition_variable finished;
+    /// Tasks held back by the quota
+    std::deque<WorkStealingExecutor::Task> backlog;
+    /// Tasks submitted to the executor and not finished
+    size_t running;
+    /// Tasks run and not finished, backlog included
+    size_t outstanding;
+    std::atomic<bool> cancelled;
+    std::vector<boost::any> contexts;
+
+    /// Wrap the task so the group knows when it is done
+    WorkStealingExecutor::Task wrap(WorkStealingExecutor::Task task);
+    void done();
+};
+
+} /* namespace common */
+} /* namespace fts3 */
+
+#endif /* WORKSTEALINGEXECUTOR_H_ */
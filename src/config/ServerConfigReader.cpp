@@ -127,6 +127,11 @@ po::options_description ServerConfigReader::_defineConfigOptions()
         po::value<std::string>( &(_vars["MessagingDirectory"]) )->default_value(FTS3_CONFIG_SERVERCONFIG_MESSAGINGDIRECTORY_DEFAULT),
         "Directory where the internal FTS3 messages are written"
     )
+    (
+        "MessagingJournalQueues",
+        po::value<std::string>( &(_vars["MessagingJournalQueues"]) )->default_value(""),
+        "Comma separated list of messaging queues (status, logs, deletion, staging) to be written into a journal"
+    )
     (
         "SiteName",
         po::value<std::string>( &(_vars["SiteName"]) ),
@@ -145,7 +150,7 @@ po::options_description ServerConfigReader::_defineConfigOptions()
     (
         "InternalThreadPool",
         po::value<std::string>( &(_vars["InternalThreadPool"]) )->default_value("5"),
-        "Set the number of threads in the internal threadpool"
+        "Maximum number of tasks each service runs at once in the shared executor"
     )
     (
         "CleanBulkSize",
@@ -197,6 +202,21 @@ po::options_description ServerConfigReader::_defineConfigOptions()
         po::value<std::string>( &(_vars["Profiling"]) )->default_value("false"),
         "Enable or disable internal profiling logs"
     )
+    (
+        "LogAsync",
+        po::value<std::string>( &(_vars["LogAsync"]) )->default_value("false"),
+        "Write the log from a background thread"
+    )
+    (
+        "LogAsyncQueueSize",
+        po::value<std::string>( &(_vars["LogAsyncQueueSize"]) )->default_value("1024"),
+        "Number of log lines each thread can queue when logging asynchronously"
+    )
+    (
+        "LogAsyncOverflow",
+        po::value<std::string>( &(_vars["LogAsyncOverflow"]) )->default_value("block"),
+        "What to do when a thread fills its log queue: block or drop"
+    )
     (
         "LogTokenRequests",
         po::value<std::string>( &(_vars["LogTokenRequests"]) )->default_value("false"),
@@ -290,7 +310,7 @@ po::options_description ServerConfigReader::_defineConfigOptions()
     (
         "OptimizerThreadPool",
         po::value<std::string>( &(_vars["OptimizerThreadPool"]) )->default_value("10"),
-        "Set the number of threads for the Optimizer threadpool"
+        "Maximum number of pairs optimized at once in the shared executor"
     )
     (
         "OptimizerSteadyInterval",
@@ -307,11 +327,26 @@ po::options_description ServerConfigReader::_defineConfigOptions()
         po::value<std::string>( &(_vars["OptimizerMaxStreams"]) )->default_value("16"),
         "Maximum number of streams per file"
     )
+    (
+        "OptimizerStateFile",
+        po::value<std::string>( &(_vars["OptimizerStateFile"]) )->default_value(""),
+        "If set, the optimizer pair states are saved into this file after each run, and loaded on start"
+    )
     (
         "MaxUrlCopyProcesses",
         po::value<std::string>( &(_vars["MaxUrlCopyProcesses"]) )->default_value("400"),
         "Maximum number of url copy processes to run"
     )
+    (
+        "UrlCopyWorkers",
+        po::value<std::string>( &(_vars["UrlCopyWorkers"]) )->default_value("0"),
+        "Number of idle url copy workers to keep ready for new transfers (0 spawns a process per transfer)"
+    )
+    (
+        "UrlCopyWorkerMaxTransfers",
+        po::value<std::string>( &(_vars["UrlCopyWorkerMaxTransfers"]) )->default_value("100"),
+        "Number of transfers after which an url copy worker is replaced"
+    )
     (
         "PurgeMessagingDirectoryInterval",
         po::value<std::string>( &(_vars["PurgeMessagingDirectoryInterval"]) )->default_value("600"),
@@ -345,13 +380,38 @@ po::options_description ServerConfigReader::_defineConfigOptions()
     (
         "SchedulingInterval",
         po::value<std::string>( &(_vars["SchedulingInterval"]) )->default_value("2"),
-        "In seconds, how often to schedule new transfers"
+        "In seconds, maximum time between two scheduling runs"
+    )
+    (
+        "SchedulingDebounce",
+        po::value<std::string>( &(_vars["SchedulingDebounce"]) )->default_value("500"),
+        "In milliseconds, how long to wait for more slots to be freed before scheduling new transfers"
+    )
+    (
+        "ClaimTransfers",
+        po::value<std::string>( &(_vars["ClaimTransfers"]) )->default_value("false"),
+        "MySQL only. Claim the transfers to schedule with SELECT ... SKIP LOCKED instead of splitting the queues between the nodes"
+    )
+    (
+        "PipelinedScheduling",
+        po::value<std::string>( &(_vars["PipelinedScheduling"]) )->default_value("false"),
+        "MySQL only. Prepare and spawn the scheduled transfers in long lived worker threads, so the scheduler does not wait for them"
+    )
+    (
+        "SchedulingPipelineCapacity",
+        po::value<std::string>( &(_vars["SchedulingPipelineCapacity"]) )->default_value("1000"),
+        "Maximum number of transfers waiting for each stage of the scheduling pipeline"
     )
     (
         "MessagingConsumeInterval",
         po::value<std::string>( &(_vars["MessagingConsumeInterval"]) )->default_value("1"),
         "In seconds, how often to check for messages"
     )
+    (
+        "ProgressUpdateInterval",
+        po::value<std::string>( &(_vars["ProgressUpdateInterval"]) )->default_value("5"),
+        "In seconds, how often to write the transfer progress into the database"
+    )
     (
         "ForceStartTransfersCheckInterval",
         po::value<std::string>( &(_vars["ForceStartTransfersCheckInterval"]) )->default_value("30"),
@@ -477,6 +537,11 @@ po::options_description ServerConfigReader::_defineConfigOptions()
         po::value<std::string>( &(_vars["AllowSessionReuse"]) )->default_value("true"),
         "Enable or disable session reuse transfers (default true)"
     )
+    (
+        "SessionReuseConcurrentTransfers",
+        po::value<std::string>( &(_vars["SessionReuseConcurrentTransfers"]) )->default_value("1"),
+        "Number of transfers of a session reuse job run at the same time by its url copy process"
+    )
     (
         "AllowJobPriority",
         po::value<std::string>( &(_vars["AllowJobPriority"]) )->default_value("true"),
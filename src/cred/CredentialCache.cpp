@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "CredentialCache.h"
+#include "DelegCred.h"
+#include "common/Logger.h"
+
+using namespace fts3::common;
+
+
+bool CredentialCache::Entry::unchanged() const
+{
+    struct stat current;
+    if (stat(proxyFile.c_str(), &current) != 0) {
+        return false;
+    }
+    return current.st_dev == fileStat.st_dev && current.st_ino == fileStat.st_ino &&
+        current.st_size == fileStat.st_size &&
+        current.st_mtim.tv_sec == fileStat.st_mtim.tv_sec && current.st_mtim.tv_nsec == fileStat.st_mtim.tv_nsec;
+}
+
+
+CredentialCache& CredentialCache::instance()
+{
+    static CredentialCache cache;
+    return cache;
+}
+
+
+CredentialCache::CredentialCache(Resolver resolver):
+    resolver(resolver), entries(std::make_shared<const Entries>())
+{
+    if (!this->resolver) {
+        this->resolver = [](const std::string &userDn, const std::string &credId,
+                            unsigned long extraValidity, time_t *validUntil) {
+            return DelegCred::getProxyFile(userDn, credId, extraValidity, validUntil);
+        };
+    }
+}
+
+
+std::string CredentialCache::getProxyFile(const std::string &userDn, const std::string &credId)
+{
+    const auto key = std::make_pair(credId, userDn);
+    const time_t now = time(NULL);
+
+    // Hot path: no lock, no parsing
+    std::shared_ptr<const Entries> snapshot = std::atomic_load(&entries);
+    auto cached = snapshot->find(key);
+    if (cached != snapshot->end() && cached->second->validUntil > now && cached->second->unchanged()) {
+        cached->second->lastUsed = now;
+        return cached->second->proxyFile;
+    }
+
+    time_t validUntil = 0;
+    std::string proxyFile = resolver(userDn, credId, 0, &validUntil);
+
+    struct stat fileStat;
+    if (!proxyFile.empty() && validUntil > now && stat(proxyFile.c_str(), &fileStat) == 0) {
+        auto entry = std::make_shared<const Entry>(proxyFile, validUntil, fileStat, now);
+        update([&key, &entry](Entries &modified) {
+            modified[key] = entry;
+        });
+    }
+    else {
+        invalidate(userDn, credId);
+    }
+
+    return proxyFile;
+}
+
+
+size_t CredentialCache::refresh()
+{
+    const time_t now = time(NULL);
+    std::shared_ptr<const Entries> snapshot = std::atomic_load(&entries);
+
+    std::vector<Entries::key_type> expiring, idle;
+    for (auto &entry: *snapshot) {
+        if (now - entry.second->lastUsed > IDLE_TIMEOUT) {
+            idle.push_back(entry.first);
+        }
+        else if (entry.second->validUntil - now < REFRESH_MARGIN) {
+            expiring.push_back(entry.first);
+        }
+    }
+
+    // Resolve out of the lock, since it may need the database
+    std::map<Entries::key_type, std::shared_ptr<const Entry>> renewed;
+    for (auto &key: expiring) {
+        time_t validUntil = 0;
+        std::string proxyFile = resolver(key.second, key.first, REFRESH_MARGIN, &validUntil);
+        auto previous = snapshot->find(key);
+        struct stat fileStat;
+        if (!proxyFile.empty() && validUntil > previous->second->validUntil &&
+            stat(proxyFile.c_str(), &fileStat) == 0) {
+            renewed[key] = std::make_shared<const Entry>(proxyFile, validUntil, fileStat, previous->second->lastUsed);
+        }
+    }
+
+    if (!idle.empty() || !renewed.empty()) {
+        update([&idle, &renewed](Entries &modified) {
+            for (auto &key: idle) {
+                modified.erase(key);
+            }
+            for (auto &entry: renewed) {
+                // Keep the usage recorded meanwhile
+                auto current = modified.find(entry.first);
+                if (current != modified.end() && current->second->validUntil < entry.second->validUntil) {
+                    current->second = std::make_shared<const Entry>(entry.second->proxyFile,
+                        entry.second->validUntil, entry.second->fileStat,
+                        std::max<time_t>(current->second->lastUsed, entry.second->lastUsed));
+                }
+            }
+        });
+    }
+
+    if (!renewed.empty() || !idle.empty()) {
+        FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Credential cache: renewed=" << renewed.size()
+                                         << " expiring=" << expiring.size()
+                                         << " forgotten=" << idle.size() << commit;
+    }
+
+    return renewed.size();
+}
+
+
+void CredentialCache::invalidate(const std::string &userDn, const std::string &credId)
+{
+    const auto key = std::make_pair(credId, userDn);
+
+    if (std::atomic_load(&entries)->count(key) == 0) {
+        return;
+    }
+
+    update([&key](Entries &modified) {
+        modified.erase(key);
+    });
+}
+
+
+void CredentialCache::clear()
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::atomic_store(&entries, std::make_shared<const Entries>());
+}
+
+
+size_t CredentialCache::size() const
+{
+    return std::atomic_load(&entries)->size();
+}
+
+
+void CredentialCache::update(const std::function<void (Entries&)> &modify)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    auto modified = std::make_shared<Entries>(*std::atomic_load(&entries));
+    modify(*modified);
+    std::atomic_store(&entries, std::shared_ptr<const Entries>(std::move(modified)));
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef CREDENTIALCACHE_H_
+#define CREDENTIALCACHE_H_
+
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+
+/**
+ * Process wide cache of the proxy files generated by DelegCred, indexed by (delegation id, user DN).
+ * Lookups read an immutable snapshot of the cache, so they never wait for the writers,
+ * and do not parse the proxy again while it is known to be valid and the file has not changed.
+ */
+class CredentialCache
+{
+public:
+    /// Proxies are renewed this long before DelegCred would consider them invalid
+    static constexpr time_t REFRESH_MARGIN = 600;
+
+    /// Credentials not used for this long are forgotten by refresh
+    static constexpr time_t IDLE_TIMEOUT = 3600;
+
+    /**
+     * Obtain a proxy file for a credential
+     * @param userDn        The user DN
+     * @param credId        The delegation id
+     * @param extraValidity Lifetime required beyond the minimum validity, so it can be renewed ahead of time
+     * @param[out] validUntil   Until when the proxy file can be used
+     * @return The proxy file, empty on failure
+     */
+    typedef std::function<std::string (const std::string &userDn, const std::string &credId,
+        unsigned long extraValidity, time_t *validUntil)> Resolver;
+
+    static CredentialCache& instance();
+
+    /// @param resolver Obtains the proxy files. Defaults to DelegCred.
+    explicit CredentialCache(Resolver resolver = Resolver());
+
+    CredentialCache(const CredentialCache&) = delete;
+    CredentialCache& operator = (const CredentialCache&) = delete;
+
+    /// Proxy file for the credential. On a miss, once the cached proxy is not valid anymore,
+    /// or if the file was removed or replaced, the proxy is resolved again and cached.
+    /// @return The proxy file, empty on failure
+    std::string getProxyFile(const std::string &userDn, const std::string &credId);
+
+    /// Renew the cached proxies that expire within REFRESH_MARGIN,
+    /// and forget those not used for IDLE_TIMEOUT.
+    /// Meant to run periodically in the background.
+    /// @return How many proxies have been renewed
+    size_t refresh();
+
+    /// Forget a credential (i.e. the delegation has been updated)
+    void invalidate(const std::string &userDn, const std::string &credId);
+
+    /// Forget all credentials
+    void clear();
+
+    /// Number of cached credentials
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string proxyFile;
+        time_t validUntil;
+        /// The file when it was cached
+        struct stat fileStat;
+        /// Updated by the readers, so it is the only mutable field
+        mutable std::atomic<time_t> lastUsed;
+
+        Entry(const std::string &proxyFile, time_t validUntil, const struct stat &fileStat, time_t lastUsed):
+            proxyFile(proxyFile), validUntil(validUntil), fileStat(fileStat), lastUsed(lastUsed) {}
+
+        /// True if the file is still the one cached
+        bool unchanged() const;
+    };
+
+    /// (credId, userDn) -> entry
+    typedef std::map<std::pair<std::string, std::string>, std::shared_ptr<const Entry>> Entries;
+
+    Resolver resolver;
+
+    /// Replaced as a whole by the writers, and read with atomic_load
+    std::shared_ptr<const Entries> entries;
+    /// Serializes the writers
+    std::mutex writeMutex;
+
+    /// Copy the entries, apply update and publish the result
+    void update(const std::function<void (Entries&)> &modify);
+};
+
+#endif // CREDENTIALCACHE_H_
@@ -44,8 +44,13 @@ const char * const PROXY_NAME_PREFIX = "x509up_h";
 }
 
 
-std::string DelegCred::getProxyFile(const std::string& userDn, const std::string& id)
+std::string DelegCred::getProxyFile(const std::string& userDn, const std::string& id,
+    unsigned long extraValidity, time_t *validUntil)
 {
+    if (validUntil) {
+        *validUntil = 0;
+    }
+
     try {
         // Check Preconditions
         if (userDn.empty()) {
@@ -65,7 +70,7 @@ std::string DelegCred::getProxyFile(const std::string& userDn, const std::string
 
         // Check if the Proxy Certificate is already there and is valid
         std::string tmpMessage;
-        if (isValidProxy(proxy_filename, tmpMessage)) {
+        if (isValidProxy(proxy_filename, tmpMessage, extraValidity, validUntil)) {
             return proxy_filename;
         }
 
@@ -86,6 +91,10 @@ std::string DelegCred::getProxyFile(const std::string& userDn, const std::string
         // Rename the Temporary File
         tmp_proxy.rename(proxy_filename);
 
+        if (validUntil) {
+            isValidProxy(proxy_filename, tmpMessage, 0, validUntil);
+        }
+
         return proxy_filename;
     } catch(const std::exception& ex) {
         FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Can't get The proxy Certificate for the requested user: " << ex.what() << commit;
@@ -101,7 +110,8 @@ std::string DelegCred::getProxyFile(const std::string& userDn, const std::string
  *
  * Check if the Proxy Already Exists and is Valid.
  */
-bool DelegCred::isValidProxy(const std::string& filename, std::string& message)
+bool DelegCred::isValidProxy(const std::string& filename, std::string& message,
+    unsigned long extraValidity, time_t *validUntil)
 {
     //prevent ssl_library_init from getting called by multiple threads
     static boost::mutex qm_cred_service;
@@ -111,8 +121,18 @@ bool DelegCred::isValidProxy(const std::string& filename, std::string& message)
     time_t lifetime, voms_lifetime;
     get_proxy_lifetime(filename, &lifetime, &voms_lifetime);
 
+    if (validUntil) {
+        time_t remaining = lifetime;
+        if (voms_lifetime > 0 && voms_lifetime < remaining) {
+            remaining = voms_lifetime;
+        }
+        *validUntil = time(NULL) + remaining - static_cast<time_t>(minValidityTime());
+    }
+
+    const unsigned long minValidity = minValidityTime() + extraValidity;
+
     std::string time1 = boost::lexical_cast<std::string>(lifetime);
-    std::string time2 = boost::lexical_cast<std::string>(minValidityTime());
+    std::string time2 = boost::lexical_cast<std::string>(minValidity);
     std::string time3 = boost::lexical_cast<std::string>(voms_lifetime);
 
     if(lifetime < 0)
@@ -141,7 +161,7 @@ bool DelegCred::isValidProxy(const std::string& filename, std::string& message)
         }
 
     // casting to unsigned long is safe, condition lifetime < 0 already checked
-    if(minValidityTime() >= (unsigned long)lifetime)
+    if(minValidity >= (unsigned long)lifetime)
         {
             message = " Proxy Certificate ";
             message += filename;
@@ -153,7 +173,7 @@ bool DelegCred::isValidProxy(const std::string& filename, std::string& message)
             return false;
         }
 
-     else if( (voms_lifetime > 0) && (minValidityTime() >= (unsigned long)voms_lifetime))
+     else if( (voms_lifetime > 0) && (minValidity >= (unsigned long)voms_lifetime))
         {
             message = " VO extensions for certificate ";
             message += filename;
@@ -21,6 +21,9 @@
 #ifndef DELEGCRED_H_
 #define DELEGCRED_H_
 
+#include <ctime>
+#include <string>
+
 /**
  * DelegCred API.
  * Define the interface for retrieving the User Credentials for a given user DN
@@ -35,15 +38,22 @@ public:
      * @param id [IN] The credential id needed to retrieve the user's
      *        credentials (may be a password or an identifier, depending on the
      *        implementation)
+     * @param extraValidity [IN] lifetime required on top of the minimum validity time,
+     *        so the proxy file can be renewed ahead of time
+     * @param validUntil [OUT] if not NULL, set to the time when the proxy file stops being valid
      */
-    static std::string getProxyFile(const std::string &userDn, const std::string &id);
+    static std::string getProxyFile(const std::string &userDn, const std::string &id,
+        unsigned long extraValidity = 0, time_t *validUntil = NULL);
 
     /**
      * Returns true if the certificate in the given file name is still valid
      * @param filename [IN] the name of the file containing the proxy certificate
+     * @param extraValidity [IN] lifetime required on top of the minimum validity time
+     * @param validUntil [OUT] if not NULL, set to the time when the proxy stops being valid
      * @return true if the certificate in the given file name is still valid
      */
-    static bool isValidProxy(const std::string &filename, std::string &message);
+    static bool isValidProxy(const std::string &filename, std::string &message,
+        unsigned long extraValidity = 0, time_t *validUntil = NULL);
 
     /**
      * Generate a name for the file that should contain the proxy certificate.
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/regex.hpp>
+#include <boost/tokenizer.hpp>
+
+#include "ActivityShareTable.h"
+
+
+ActivityShareTable::ActivityShareTable(const std::string &config): config(config)
+{
+    if (config.size() < 2) {
+        return;
+    }
+
+    // remove the opening '[' and closing ']'
+    const std::string activityShareStr = config.substr(1, config.size() - 2);
+
+    // iterate over activity shares
+    boost::char_separator<char> sep(",");
+    boost::tokenizer< boost::char_separator<char> > tokens(activityShareStr, sep);
+
+    static const boost::regex re("^\\s*\\{\\s*\"([ a-zA-Z0-9\\._-]+)\"\\s*:\\s*((0\\.)?\\d+)\\s*\\}\\s*$");
+    static const int ACTIVITY_NAME = 1;
+    static const int ACTIVITY_SHARE = 2;
+
+    for (auto it = tokens.begin(); it != tokens.end(); ++it) {
+        // parse single activity share
+        boost::smatch what;
+        boost::regex_match(*it, what, re, boost::match_extra);
+
+        std::string activityName(what[ACTIVITY_NAME]);
+        boost::algorithm::to_lower(activityName);
+        shares[activityName] = boost::lexical_cast<double>(what[ACTIVITY_SHARE]);
+    }
+}
+
+
+double ActivityShareTable::getShare(const std::string &activity) const
+{
+    auto share = shares.find(activity);
+    if (share == shares.end()) {
+        return 0;
+    }
+    return share->second;
+}
+
+
+std::map<std::string, int> ActivityShareTable::allocate(const std::map<std::string, long long> &activitiesInQueue,
+    int filesNum, std::set<std::string> &defaultActivities, std::mt19937 &generator) const
+{
+    struct Group {
+        std::string name;
+        double share;
+        long long queued;
+    };
+
+    // Activities without a share compete together as "default"
+    std::vector<Group> groups;
+    long long queuedDefault = 0;
+
+    for (auto it = activitiesInQueue.begin(); it != activitiesInQueue.end(); ++it) {
+        auto share = shares.find(it->first);
+        if (share != shares.end() && it->first != "default") {
+            groups.push_back(Group{it->first, share->second, it->second});
+        }
+        else {
+            defaultActivities.insert(it->first);
+            queuedDefault += it->second;
+        }
+    }
+
+    if (!defaultActivities.empty()) {
+        groups.push_back(Group{"default", getShare("default"), queuedDefault});
+    }
+
+    std::map<std::string, int> activityFilesNum;
+    long long slots = filesNum;
+
+    // Each round is a multinomial draw of the free slots between the activities still queued.
+    // The slots drawn beyond the files queued go to the next round, so at most one round per activity.
+    while (slots > 0) {
+        double sum = 0;
+        for (auto &group: groups) {
+            if (group.queued > 0) {
+                sum += group.share;
+            }
+        }
+
+        // if sum <= 0 there is nothing to assign
+        if (sum <= 0) {
+            break;
+        }
+
+        long long toDraw = slots;
+        slots = 0;
+
+        for (auto &group: groups) {
+            if (group.queued <= 0 || group.share <= 0) {
+                continue;
+            }
+
+            // Conditional binomials, the last activity takes whatever is left
+            long long drawn = toDraw;
+            if (group.share < sum) {
+                std::binomial_distribution<long long> binomial(toDraw, std::min(1.0, group.share / sum));
+                drawn = binomial(generator);
+            }
+            toDraw -= drawn;
+            sum -= group.share;
+
+            const long long assigned = std::min(drawn, group.queued);
+            group.queued -= assigned;
+            slots += drawn - assigned;
+
+            if (assigned > 0) {
+                activityFilesNum[group.name] += static_cast<int>(assigned);
+            }
+        }
+
+        // Rounding errors
+        slots += toDraw;
+    }
+
+    return activityFilesNum;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef ACTIVITYSHARETABLE_H_
+#define ACTIVITYSHARETABLE_H_
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+/// Activity shares of a VO, parsed once from t_activity_share_config
+/// and reused until the configuration changes.
+class ActivityShareTable
+{
+public:
+    ActivityShareTable() {}
+
+    /// Parse the activity_share column (i.e. [{"express": 0.5}, {"default": 0.5}])
+    /// Activity names are case insensitive, and stored in lower case.
+    explicit ActivityShareTable(const std::string &config);
+
+    /// The configuration this table has been parsed from
+    const std::string& getConfig() const {
+        return config;
+    }
+
+    bool empty() const {
+        return shares.empty();
+    }
+
+    /// @return The share of the activity, 0 if not configured
+    double getShare(const std::string &activity) const;
+
+    /// Split filesNum slots between the activities in a queue, proportionally to their shares.
+    /// Queued activities without a configured share fall into "default", and are added to defaultActivities.
+    /// No activity gets more slots than files queued. The slots left by an activity that runs out
+    /// of files are split between the others.
+    /// The draw is multinomial, so it costs O(activities) instead of a random draw per slot.
+    /// @param activitiesInQueue    Files queued per activity
+    /// @param filesNum             Slots to assign
+    /// @param[out] defaultActivities   Queued activities without a share
+    /// @param generator            Source of randomness
+    /// @return Slots per activity
+    std::map<std::string, int> allocate(const std::map<std::string, long long> &activitiesInQueue, int filesNum,
+        std::set<std::string> &defaultActivities, std::mt19937 &generator) const;
+
+private:
+    std::string config;
+    std::map<std::string, double> shares;
+};
+
+#endif // ACTIVITYSHARETABLE_H_
@@ -38,6 +38,7 @@
 #include "ShareConfig.h"
 #include "CloudStorageAuth.h"
 #include "TransferState.h"
+#include "TransferStatusUpdate.h"
 
 #include <boost/tuple/tuple.hpp>
 #include <boost/optional.hpp>
@@ -107,6 +108,18 @@ public:
     virtual void getReadyTransfers(const std::vector<QueueId>& queues,
             std::map< std::string, std::list<TransferFile>>& files) = 0;
 
+    /// Claim a bounded batch of transfers ready to go for the given queues, with the same
+    /// limits and shares as getReadyTransfers. The claimed transfers are moved to SELECTED
+    /// and assigned to this host, so no other node can pick them.
+    /// The ones that do not start must be put back with recoverSelectedTransfers.
+    /// Each queue is claimed in its own transaction: if one fails after others committed,
+    /// the transfers claimed so far are returned instead of throwing.
+    /// @param queues       Queues for which to check (see getQueuesWithPending)
+    /// @param maxFiles     Maximum number of transfers to claim
+    /// @param[out] files   A map where the key is the VO. The value is a list of transfers belonging to that VO
+    virtual void claimReadyTransfers(const std::vector<QueueId>& queues, int maxFiles,
+            std::map< std::string, std::list<TransferFile>>& files) = 0;
+
     /// Update the status of a transfer
     /// @param jobId            The job ID
     /// @param fileId           The file ID
@@ -133,6 +146,15 @@ public:
     /// @note                   If jobId is empty, the pid will be used to decide which job to update
     virtual bool updateJobStatus(const std::string& jobId, const std::string& jobState) = 0;
 
+    /// Apply a set of status messages sent by fts_url_copy.
+    /// Equivalent to running the retry logic, updateTransferStatus and updateJobStatus for each message,
+    /// but the file changes are applied in one transaction per chunk of messages.
+    /// @param messages         Status messages, excluding UPDATE ones. Both job id and file id must be set.
+    /// @return                 The outcome of each message, in the same order
+    /// @throws TransferStatusBatchError if it failed once the file changes were committed
+    virtual std::vector<TransferStatusUpdate> updateTransferStatusBatch(
+        const std::vector<fts3::events::Message>& messages) = 0;
+
     /// Get the token associated with the given token ID
     /// @param tokenId          The token ID
     /// @return                 The <token, unmanaged flag> pair for the token ID, if any
@@ -200,6 +222,9 @@ public:
     /// Get the list of VO share configurations for the given link
     virtual std::vector<ShareConfig> getShareConfig(const std::string &source, const std::string &destination) = 0;
 
+    /// Get the VO share configurations of all the links
+    virtual std::vector<ShareConfig> getShareConfig() = 0;
+
     /// Returns how many retries there is configured for the given jobId
     virtual int getRetry(const std::string & jobId) = 0;
 
@@ -258,8 +283,9 @@ public:
     /// Update the state of a transfer inside a session reuse job
     virtual long updateFileStatusReuse(const TransferFile &file, const std::string &status) = 0;
 
-    /// Puts into requestIDs, jobs that have been cancelled, and for which the running fts_url_copy must be killed
-    virtual void getCancelJob(std::vector<int>& requestIDs) = 0;
+    /// Puts into requestIDs the pid and file id of the transfers that have been cancelled,
+    /// and for which the running fts_url_copy must be killed
+    virtual void getCancelJob(std::vector<std::pair<int, uint64_t>>& requestIDs) = 0;
 
     /// Returns list of transfers that need to be force started
     virtual std::list<TransferFile> getForceStartTransfers() = 0;
@@ -484,6 +510,9 @@ public:
 
     /// Put all the transfers assigned to this host that are in the SELECTED state back in the queue
     virtual void recoverSelectedTransfers() = 0;
+
+    /// Put the given transfers back in the queue, if they are still SELECTED and assigned to this host
+    virtual void recoverSelectedTransfers(const std::vector<uint64_t>& fileIds) = 0;
     };
 
 #endif // GENERICDBIFCE_H_
@@ -27,13 +27,26 @@
 class QueueId {
 public:
     QueueId(const std::string& sourceSe, const std::string& destSe, const std::string& voName, unsigned activeCount):
-        sourceSe(sourceSe), destSe(destSe), voName(voName), activeCount(activeCount)
+        sourceSe(sourceSe), destSe(destSe), voName(voName), activeCount(activeCount),
+        linkActiveCount(0), linkMaxActive(0), hasLinkState(false)
+    {}
+
+    /// Same as above, but also carrying the link state, so the scheduler does not need
+    /// to query it again for each queue
+    QueueId(const std::string& sourceSe, const std::string& destSe, const std::string& voName, unsigned activeCount,
+        unsigned linkActiveCount, int linkMaxActive):
+        sourceSe(sourceSe), destSe(destSe), voName(voName), activeCount(activeCount),
+        linkActiveCount(linkActiveCount), linkMaxActive(linkMaxActive), hasLinkState(true)
     {}
 
     std::string sourceSe;
     std::string destSe;
     std::string voName;
-    unsigned activeCount;
+    unsigned activeCount;       ///< Running transfers for this link and VO
+
+    unsigned linkActiveCount;   ///< Running transfers for this link, all VOs together
+    int linkMaxActive;          ///< Optimizer decision for this link, 0 if there is none
+    bool hasLinkState;          ///< True if linkActiveCount and linkMaxActive are filled
 };
 
 #endif // QUEUEID_H_
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ThroughputStats.h"
+
+
+ThroughputStats::ThroughputStats(double bytesInWindow, uint64_t count, double filesizeAvg, double filesizeVariance):
+    bytesInWindow(bytesInWindow), count(count), mean(0), m2(0)
+{
+    if (count > 0) {
+        mean = filesizeAvg;
+        // The variance can come slightly negative from the rounding errors of the database
+        m2 = std::max(0.0, filesizeVariance) * static_cast<double>(count);
+    }
+}
+
+
+void ThroughputStats::merge(const ThroughputStats &other)
+{
+    bytesInWindow += other.bytesInWindow;
+
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        count = other.count;
+        mean = other.mean;
+        m2 = other.m2;
+        return;
+    }
+
+    const double n = static_cast<double>(count) + static_cast<double>(other.count);
+    const double delta = other.mean - mean;
+
+    mean += delta * static_cast<double>(other.count) / n;
+    m2 += other.m2 + delta * delta * static_cast<double>(count) * static_cast<double>(other.count) / n;
+    count += other.count;
+}
+
+
+double ThroughputStats::getThroughput(long windowSeconds) const
+{
+    if (windowSeconds <= 0) {
+        return 0;
+    }
+    return bytesInWindow / static_cast<double>(windowSeconds);
+}
+
+
+double ThroughputStats::getFilesizeStdDev() const
+{
+    if (count == 0) {
+        return 0;
+    }
+    return sqrt(m2 / static_cast<double>(count));
+}
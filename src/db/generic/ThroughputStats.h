@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef THROUGHPUTSTATS_H_
+#define THROUGHPUTSTATS_H_
+
+#include <cstdint>
+
+/// Throughput and file size statistics of the transfers of a pair within a time window.
+/// They are built from partial aggregates computed by the database (count, average and
+/// population variance), which can be merged without going back to the individual transfers.
+class ThroughputStats
+{
+public:
+    ThroughputStats(): bytesInWindow(0), count(0), mean(0), m2(0) {}
+
+    /// Partial aggregate
+    /// @param bytesInWindow    Bytes transferred within the window
+    /// @param count            Number of file sizes aggregated
+    /// @param filesizeAvg      Average of the file sizes
+    /// @param filesizeVariance Population variance of the file sizes
+    ThroughputStats(double bytesInWindow, uint64_t count, double filesizeAvg, double filesizeVariance);
+
+    /// Combine with another partial aggregate (Chan et al.), as if
+    /// both sets of transfers had been aggregated together
+    void merge(const ThroughputStats &other);
+
+    /// @param windowSeconds    The length of the window
+    /// @return Bytes per second within the window
+    double getThroughput(long windowSeconds) const;
+
+    uint64_t getFilesizeCount() const {
+        return count;
+    }
+
+    double getFilesizeAvg() const {
+        return mean;
+    }
+
+    double getFilesizeStdDev() const;
+
+private:
+    double bytesInWindow;
+    uint64_t count;
+    double mean;
+    /// Sum of the squared deviations from the mean
+    double m2;
+};
+
+#endif // THROUGHPUTSTATS_H_
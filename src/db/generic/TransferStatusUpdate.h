@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRANSFERSTATUSUPDATE_H_
+#define TRANSFERSTATUSUPDATE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "common/Exceptions.h"
+#include "TransferState.h"
+
+
+/// Outcome of a status message applied by updateTransferStatusBatch
+struct TransferStatusUpdate {
+    TransferStatusUpdate(const std::string& jobId, uint64_t fileId, const std::string& state) :
+        jobId(jobId), fileId(fileId), state(state), updated(false), retried(false)
+    {
+    }
+
+    std::string jobId;
+    uint64_t fileId;
+    /// State requested by the message
+    std::string state;
+    /// True if the file row was modified
+    bool updated;
+    /// True if, instead, the transfer was queued again for a retry
+    bool retried;
+    /// State found in the database before applying the message
+    std::string storedState;
+    /// State of the transfer after the file and job changes, for the monitoring messages.
+    /// Only filled when the message is to be published.
+    std::vector<TransferState> states;
+};
+
+
+/// Thrown by updateTransferStatusBatch when the file changes were committed, but a follow-up
+/// change (replicas, hops, job state or monitoring state) failed.
+/// The messages must not be applied again.
+class TransferStatusBatchError: public fts3::common::UserError {
+public:
+    TransferStatusBatchError(const std::string& desc, const std::vector<TransferStatusUpdate>& results) :
+        fts3::common::UserError(desc), results(results)
+    {
+    }
+
+    virtual ~TransferStatusBatchError() throw ()
+    {
+    }
+
+    /// Outcome of the committed file changes
+    const std::vector<TransferStatusUpdate>& getResults() const
+    {
+        return results;
+    }
+
+private:
+    std::vector<TransferStatusUpdate> results;
+};
+
+
+#endif // TRANSFERSTATUSUPDATE_H_
@@ -22,57 +22,27 @@
 #include "sociConversions.h"
 
 #include "common/Exceptions.h"
+#include "common/Logger.h"
 
 #include <boost/logic/tribool.hpp>
-#include <boost/regex.hpp>
 
 using namespace fts3::common;
 
 
-std::map<std::string, double> MySqlAPI::getActivityShareConf(soci::session& sql, std::string vo)
+std::map<std::string, ActivityShareTable> MySqlAPI::getActivityShareTables(soci::session& sql)
 {
+    std::map<std::string, std::string> configs;
 
-    std::map<std::string, double> ret;
-
-    soci::indicator isNull = soci::i_ok;
-    std::string activity_share_str;
     try
     {
-
-        sql <<
-            " SELECT activity_share "
+        soci::rowset<soci::row> rs = (sql.prepare <<
+            " SELECT vo, activity_share "
                 " FROM t_activity_share_config "
-                " WHERE vo = :vo "
-                "   AND active = 'on'",
-            soci::use(vo),
-            soci::into(activity_share_str, isNull)
-            ;
-
-        if (isNull == soci::i_null || activity_share_str.empty()) return ret;
-
-        // remove the opening '[' and closing ']'
-        activity_share_str = activity_share_str.substr(1, activity_share_str.size() - 2);
-
-        // iterate over activity shares
-        boost::char_separator<char> sep(",");
-        boost::tokenizer< boost::char_separator<char> > tokens(activity_share_str, sep);
-        boost::tokenizer< boost::char_separator<char> >::iterator it;
-
-        static const boost::regex re("^\\s*\\{\\s*\"([ a-zA-Z0-9\\._-]+)\"\\s*:\\s*((0\\.)?\\d+)\\s*\\}\\s*$");
-        static const int ACTIVITY_NAME = 1;
-        static const int ACTIVITY_SHARE = 2;
-
-        for (it = tokens.begin(); it != tokens.end(); it++)
-        {
-            // parse single activity share
-            std::string str = *it;
-
-            boost::smatch what;
-            boost::regex_match(str, what, re, boost::match_extra);
+                " WHERE active = 'on'"
+        );
 
-            std::string activity_name(what[ACTIVITY_NAME]);
-            boost::algorithm::to_lower(activity_name);
-            ret[activity_name] = boost::lexical_cast<double>(what[ACTIVITY_SHARE]);
+        for (auto it = rs.begin(); it != rs.end(); ++it) {
+            configs[it->get<std::string>("vo")] = it->get<std::string>("activity_share", "");
         }
     }
     catch (std::exception& e)
@@ -83,7 +53,37 @@ std::map<std::string, double> MySqlAPI::getActivityShareConf(soci::session& sql,
     {
         throw UserError(std::string(__func__) + ": Caught exception " );
     }
-    return ret;
+
+    std::lock_guard<std::mutex> lock(activityShareMutex);
+    std::map<std::string, ActivityShareTable> tables;
+    std::map<std::string, std::string> invalid;
+
+    for (auto it = configs.begin(); it != configs.end(); ++it) {
+        auto cached = activityShareCache.find(it->first);
+        if (cached != activityShareCache.end() && cached->second.getConfig() == it->second) {
+            tables.insert(*cached);
+            continue;
+        }
+
+        try {
+            tables.emplace(it->first, ActivityShareTable(it->second));
+        }
+        catch (const std::exception& e) {
+            // A bad configuration must not stop the scheduling of the other VOs.
+            // This one is scheduled as if it had no activity shares.
+            auto reported = activityShareInvalid.find(it->first);
+            if (reported == activityShareInvalid.end() || reported->second != it->second) {
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Ignoring the activity shares of " << it->first
+                    << ": " << e.what() << commit;
+            }
+            invalid[it->first] = it->second;
+        }
+    }
+
+    // Forget the VOs that are not configured anymore
+    activityShareCache = tables;
+    activityShareInvalid = invalid;
+    return tables;
 }
 
 
@@ -173,48 +173,39 @@ std::vector<ShareConfig> MySqlAPI::getShareConfig(const std::string &source, con
 }
 
 
-int MySqlAPI::getRetry(const std::string & jobId)
+std::vector<ShareConfig> MySqlAPI::getShareConfig()
 {
     soci::session sql(*connectionPool);
 
-    int nRetries = 0;
-    soci::indicator isNull = soci::i_ok;
-    std::string vo_name;
-
+    std::vector<ShareConfig> cfg;
     try
     {
-        sql <<
-            " SELECT retry, vo_name "
-                " FROM t_job "
-                " WHERE job_id = :jobId ",
-            soci::use(jobId),
-            soci::into(nRetries, isNull),
-            soci::into(vo_name)
-            ;
-
-        if (isNull == soci::i_null || nRetries == 0)
-        {
-            sql <<
-                " SELECT retry "
-                " FROM t_server_config WHERE vo_name IN (:vo_name, '*') OR vo_name IS NULL "
-                " ORDER BY vo_name DESC LIMIT 1",
-                soci::use(vo_name), soci::into(nRetries);
-        }
-        else if (nRetries <= 0)
+        soci::rowset<ShareConfig> rs = (sql.prepare << "SELECT * FROM t_share_config");
+        for (soci::rowset<ShareConfig>::const_iterator i = rs.begin();
+             i != rs.end(); ++i)
         {
-            nRetries = -1;
+            cfg.push_back(*i);
         }
+    }
+    catch (std::exception& e)
+    {
+        throw UserError(std::string(__func__) + ": Caught exception " + e.what());
+    }
+    catch (...)
+    {
+        throw UserError(std::string(__func__) + ": Caught exception " );
+    }
+    return cfg;
+}
 
 
-        //do not retry multiple replica jobs
-        if(nRetries > 0)
-        {
-            Job::JobType mreplica;
-            sql << "select job_type from t_job where job_id=:job_id", soci::use(jobId), soci::into(mreplica);
-            if(mreplica == Job::kTypeMultipleReplica || mreplica == Job::kTypeMultiHop) {
-                nRetries = 0;
-            }
-        }
+int MySqlAPI::getRetry(const std::string & jobId)
+{
+    soci::session sql(*connectionPool);
+
+    try
+    {
+        return getRetryInternal(sql, jobId);
     }
     catch (std::exception& e)
     {
@@ -224,6 +215,48 @@ int MySqlAPI::getRetry(const std::string & jobId)
     {
         throw UserError(std::string(__func__) + ": Caught exception " );
     }
+}
+
+
+int MySqlAPI::getRetryInternal(soci::session& sql, const std::string & jobId)
+{
+    int nRetries = 0;
+    soci::indicator isNull = soci::i_ok;
+    std::string vo_name;
+
+    sql <<
+        " SELECT retry, vo_name "
+            " FROM t_job "
+            " WHERE job_id = :jobId ",
+        soci::use(jobId),
+        soci::into(nRetries, isNull),
+        soci::into(vo_name)
+        ;
+
+    if (isNull == soci::i_null || nRetries == 0)
+    {
+        sql <<
+            " SELECT retry "
+            " FROM t_server_config WHERE vo_name IN (:vo_name, '*') OR vo_name IS NULL "
+            " ORDER BY vo_name DESC LIMIT 1",
+            soci::use(vo_name), soci::into(nRetries);
+    }
+    else if (nRetries <= 0)
+    {
+        nRetries = -1;
+    }
+
+
+    //do not retry multiple replica jobs
+    if(nRetries > 0)
+    {
+        Job::JobType mreplica;
+        sql << "select job_type from t_job where job_id=:job_id", soci::use(jobId), soci::into(mreplica);
+        if(mreplica == Job::kTypeMultipleReplica || mreplica == Job::kTypeMultiHop) {
+            nRetries = 0;
+        }
+    }
+
     return nRetries;
 }
 
@@ -23,7 +23,11 @@
 #include <boost/range/algorithm/transform.hpp>
 
 #include <map>
+#include <set>
 #include <chrono>
+#include <cmath>
+#include <limits>
+#include <tuple>
 #include <soci/mysql/soci-mysql.h>
 #include "MySqlAPI.h"
 #include "sociConversions.h"
@@ -37,6 +41,9 @@
 using namespace fts3::common;
 using namespace db;
 
+/// Maximum number of files updated by a single progress UPDATE statement
+static const size_t PROGRESS_UPDATE_CHUNK_SIZE = 500;
+
 
 static int thread_random(void)
 {
@@ -118,7 +125,7 @@ static void getHostAndPort(const std::string& conn, std::string* host, int* port
 
 static void validateSchemaVersion(const std::string& dbtype, soci::connection_pool *connectionPool)
 {
-    static const unsigned expect_mysql[] = {10, 0};
+    static const unsigned expect_mysql[] = {10, 3};
     static const unsigned expect_posgresql[] = {0, 1};
     static const unsigned (&expect)[2] = dbtype == "mysql" ? expect_mysql : expect_posgresql;
     unsigned major, minor;
@@ -268,67 +275,50 @@ std::list<fts3::events::MessageUpdater> MySqlAPI::getActiveInHost(const std::str
 }
 
 
-std::map<std::string, long long> MySqlAPI::getActivitiesInQueue(soci::session& sql, std::string src, std::string dst, std::string vo)
+MySqlAPI::ActivitiesPerQueue MySqlAPI::getActivitiesInQueues(soci::session& sql, const std::string &vo,
+        const HashSegment &segment)
 {
-    std::map<std::string, long long> ret;
+    ActivitiesPerQueue ret;
 
     try
     {
-        std::string vo_exists;
-        soci::indicator isNull = soci::i_ok;
-
-        sql << "SELECT vo FROM t_activity_share_config where vo=:vo", soci::use(vo), soci::into(vo_exists, isNull);
-        if(isNull == soci::i_null)
-            return ret;
-
         const std::string query = sql.get_backend_name() == "mysql" ?
-                "SELECT activity, COUNT(DISTINCT f.job_id, f.file_index) AS count "
+                "SELECT f.source_se, f.dest_se, f.activity, COUNT(DISTINCT f.job_id, f.file_index) AS count "
                 "FROM"
                 "     t_file f USE INDEX(idx_link_state_vo) "
                 "INNER JOIN t_job j ON (f.job_id = j.job_id) "
                 "WHERE"
-                "    j.vo_name = f.vo_name AND "
                 "    f.file_state = 'SUBMITTED' AND "
-                "    f.source_se = :source AND "
-                "    f.dest_se = :dest AND "
                 "    f.vo_name = :vo_name AND"
                 "    j.vo_name = f.vo_name AND "
                 "    (f.hashed_id >= :hStart AND f.hashed_id <= :hEnd) AND "
                 "    (j.job_type = 'N' OR j.job_type = 'R' OR j.job_type IS NULL) "
-                "GROUP BY activity "
+                "GROUP BY f.source_se, f.dest_se, f.activity "
                 "ORDER BY NULL"
             :
-                "SELECT activity, count(*) "
+                "SELECT source_se, dest_se, activity, count(*) "
                 "FROM"
-                "   (SELECT f.activity, f.job_id, f.file_index "
+                "   (SELECT f.source_se, f.dest_se, f.activity, f.job_id, f.file_index "
                 "   FROM"
                 "       t_file AS f "
                 "   INNER JOIN t_job AS j ON (f.job_id = j.job_id)"
                 "   WHERE"
-                "       j.vo_name = f.vo_name AND "
                 "       f.file_state = 'SUBMITTED' AND "
-                "       f.source_se = :source AND "
-                "       f.dest_se = :dest AND "
                 "       f.vo_name = :vo_name AND"
                 "       j.vo_name = f.vo_name AND "
                 "       (f.hashed_id >= :hStart AND f.hashed_id <= :hEnd) AND "
                 "       (j.job_type = 'N' OR j.job_type = 'R' OR j.job_type IS NULL) "
-                "   GROUP BY f.activity, f.job_id, f.file_index) AS transfer "
-                "GROUP BY transfer.activity";
+                "   GROUP BY f.source_se, f.dest_se, f.activity, f.job_id, f.file_index) AS transfer "
+                "GROUP BY transfer.source_se, transfer.dest_se, transfer.activity";
 
         soci::rowset<soci::row> rs = (
             sql.prepare << query,
-            soci::use(src),
-            soci::use(dst),
             soci::use(vo),
-            soci::use(hashSegment.start),
-            soci::use(hashSegment.end)
+            soci::use(segment.start),
+            soci::use(segment.end)
         );
 
-        ret.clear();
-
-        soci::rowset<soci::row>::const_iterator it;
-        for (it = rs.begin(); it != rs.end(); it++)
+        for (auto it = rs.begin(); it != rs.end(); ++it)
         {
             std::string activity_name;
 
@@ -344,7 +334,10 @@ std::map<std::string, long long> MySqlAPI::getActivitiesInQueue(soci::session& s
 
             boost::algorithm::to_lower(activity_name);
             long long nFiles = it->get<long long>("count");
-            ret[activity_name] = nFiles;
+
+            auto queue = std::make_pair(it->get<std::string>("source_se", ""), it->get<std::string>("dest_se", ""));
+            // Activities differing only in case are the same
+            ret[queue][activity_name] += nFiles;
         }
     }
     catch (std::exception& e)
@@ -360,144 +353,97 @@ std::map<std::string, long long> MySqlAPI::getActivitiesInQueue(soci::session& s
 }
 
 
-//check if called by multiple threads
-
-std::map<std::string, int> MySqlAPI::getFilesNumPerActivity(soci::session& sql,
-        std::string src, std::string dst, std::string vo, int filesNum,
+std::map<std::string, int> MySqlAPI::getFilesNumPerActivity(const ActivityShareTable &activityShares,
+        const std::map<std::string, long long> &activitiesInQueue, int filesNum,
         std::set<std::string> & defaultActivities)
 {
-    std::map<std::string, int> activityFilesNum;
-
-    try
-    {
-        // get activity shares configuration for given VO
-        std::map<std::string, double> activityShares = getActivityShareConf(sql, vo);
-
-        // if there is no configuration no assigment can be made
-        if (activityShares.empty()) return activityFilesNum;
+    static thread_local std::mt19937 generator(std::random_device{}());
 
-        // get the activities in the queue
-        std::map<std::string, long long> activitiesInQueue = getActivitiesInQueue(sql, src, dst, vo);
+    std::map<std::string, int> activityFilesNum =
+        activityShares.allocate(activitiesInQueue, filesNum, defaultActivities, generator);
 
-        // sum of all activity shares in the queue (needed for normalization)
-        double sum = 0.0;
-
-        std::map<std::string, long long>::iterator it;
-        for (it = activitiesInQueue.begin(); it != activitiesInQueue.end(); it++)
-        {
-            std::map<std::string, double>::iterator pos = activityShares.find(it->first);
-            if (pos != activityShares.end() && it->first != "default")
-            {
-                sum += pos->second;
-            }
-            else
-            {
-                // if the activity has not been defined it falls to default
-                defaultActivities.insert(it->first);
-            }
-        }
-
-        // if default was used add it as well
-        if (!defaultActivities.empty())
-            sum += activityShares["default"];
-
-        // assign slots to activities
-        for (int i = 0; i < filesNum; i++)
-        {
-            // if sum <= 0 there is nothing to assign
-            if (sum <= 0) break;
-            // a random number from (0, 1)
-            double r = ((double) thread_random() / (double)RAND_MAX);
-
-            FTS3_COMMON_LOGGER_NEWLOG(TRACE) << __func__ << ": Dice result: " << r << commit;
-
-            // interval corresponding to given activity
-            double interval = 0;
-
-            for (it = activitiesInQueue.begin(); it != activitiesInQueue.end(); it++)
-            {
-                // if there are no more files for this activity continue
-                if (it->second <= 0) continue;
-                // get the activity name (if it was not defined use default)
-                std::string activity_name = defaultActivities.count(it->first) ? "default" : it->first;
+    // Debug output
+    std::map<std::string, int>::const_iterator j;
+    for (j = activityFilesNum.begin(); j != activityFilesNum.end(); ++j)
+    {
+        FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << __func__ << ": " << j->first << " assigned " << j->second << commit;
+    }
 
-                // calculate the interval (normalize)
-                interval += activityShares[activity_name] / sum;
+    return activityFilesNum;
+}
 
-                // if the slot has been assigned to the given activity ...
 
-                if (r < interval)
-                {
-                    ++activityFilesNum[activity_name];
+/// Count in one go the running transfers per link and VO, and per link
+/// @param[out] perQueue    Running transfers indexed by (source, destination, vo)
+/// @param[out] perLink     Running transfers indexed by (source, destination)
+static void getActiveCountPerQueue(soci::session& sql,
+    std::map<std::tuple<std::string, std::string, std::string>, unsigned>& perQueue,
+    std::map<std::pair<std::string, std::string>, unsigned>& perLink)
+{
+    // MySQL keeps the per queue counters in t_pair_counters, maintained by triggers on t_file
+    const std::string query = sql.get_backend_name() == "mysql" ?
+        "SELECT c.source_se, c.dest_se, c.vo_name, c.count AS active_count FROM t_pair_counters c "
+        "WHERE c.file_state = 'ACTIVE' AND c.count > 0" :
+        "SELECT f.source_se, f.dest_se, f.vo_name, COUNT(*) AS active_count FROM t_file f "
+        "WHERE f.file_state = 'ACTIVE' "
+        "GROUP BY f.source_se, f.dest_se, f.vo_name";
 
-                    --it->second;
-                    // if there are no more files for the given ativity remove it from the sum
-                    if (it->second == 0)
-                    {
-                        sum -= activityShares[activity_name];
-                    }
-                    break;
+    soci::rowset<soci::row> rs = (sql.prepare << query);
 
-                }
-            }
-        }
+    for (auto i = rs.begin(); i != rs.end(); ++i) {
+        const std::string sourceSe = i->get<std::string>("source_se", "");
+        const std::string destSe = i->get<std::string>("dest_se", "");
+        const std::string voName = i->get<std::string>("vo_name", "");
+        const unsigned count = static_cast<unsigned>(i->get<long long>("active_count"));
 
-        // Debug output
-        std::map<std::string, int>::const_iterator j;
-        for (j = activityFilesNum.begin(); j != activityFilesNum.end(); ++j)
-        {
-            FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << __func__ << ": " << j->first << " assigned " << j->second << commit;
-        }
-    }
-    catch (std::exception& e)
-    {
-        throw UserError(std::string(__func__) + ": Caught exception " + e.what());
-    }
-    catch (...)
-    {
-        throw UserError(std::string(__func__) + ": Caught exception " );
+        perQueue[std::make_tuple(sourceSe, destSe, voName)] = count;
+        perLink[std::make_pair(sourceSe, destSe)] += count;
     }
-
-    return activityFilesNum;
 }
 
 
 void MySqlAPI::getQueuesWithPending(std::vector<QueueId>& queues)
 {
     soci::session sql(*connectionPool);
-    unsigned activeCount;
-    std::string sourceSe;
-    std::string destSe;
-    std::string voName;
 
     try
     {
-        const std::string order_by_null = sql.get_backend_name() == "mysql" ? " ORDER BY null" : "";
-        soci::rowset<soci::row> rs1 = (sql.prepare <<
-            "SELECT f.vo_name, f.source_se, f.dest_se FROM t_file f "
-            "WHERE f.file_state = 'SUBMITTED' "
-            "GROUP BY f.source_se, f.dest_se, f.file_state, f.vo_name" <<
-            order_by_null);
-
-        soci::statement activeStmt = (sql.prepare <<
-            "SELECT COUNT(*) FROM t_file "
-            "WHERE source_se = :source_se AND dest_se = :dest_se AND vo_name = :vo_name "
-            "   AND file_state = 'ACTIVE'",
-            soci::use(sourceSe), soci::use(destSe), soci::use(voName), soci::into(activeCount));
+        std::map<std::tuple<std::string, std::string, std::string>, unsigned> activePerQueue;
+        std::map<std::pair<std::string, std::string>, unsigned> activePerLink;
+        getActiveCountPerQueue(sql, activePerQueue, activePerLink);
 
-        for (soci::rowset<soci::row>::const_iterator i1 = rs1.begin(); i1 != rs1.end(); ++i1)
+        // Queues with submitted transfers, together with the optimizer decision for the link.
+        // The counters include the transfers claimed (SELECTED) and not started yet.
+        const std::string query = sql.get_backend_name() == "mysql" ?
+            "SELECT q.vo_name, q.source_se, q.dest_se, o.active AS max_active FROM t_pair_counters q "
+            "LEFT JOIN t_optimizer o ON (o.source_se = q.source_se AND o.dest_se = q.dest_se) "
+            "WHERE q.file_state = 'SUBMITTED' AND q.count > 0" :
+            "SELECT q.vo_name, q.source_se, q.dest_se, o.active AS max_active FROM ("
+            "   SELECT f.vo_name, f.source_se, f.dest_se FROM t_file f "
+            "   WHERE f.file_state = 'SUBMITTED' "
+            "   GROUP BY f.source_se, f.dest_se, f.file_state, f.vo_name"
+            ") q "
+            "LEFT JOIN t_optimizer o ON (o.source_se = q.source_se AND o.dest_se = q.dest_se)";
+
+        soci::rowset<soci::row> rs = (sql.prepare << query);
+
+        for (auto i = rs.begin(); i != rs.end(); ++i)
         {
-            soci::row const& r1 = *i1;
-            voName = r1.get<std::string>("vo_name","");
-            sourceSe = r1.get<std::string>("source_se","");
-            destSe = r1.get<std::string>("dest_se","");
+            const std::string voName = i->get<std::string>("vo_name", "");
+            const std::string sourceSe = i->get<std::string>("source_se", "");
+            const std::string destSe = i->get<std::string>("dest_se", "");
+            const int maxActive = i->get<int>("max_active", 0);
+
+            auto queueActive = activePerQueue.find(std::make_tuple(sourceSe, destSe, voName));
+            auto linkActive = activePerLink.find(std::make_pair(sourceSe, destSe));
 
-            activeStmt.execute(true);
             queues.emplace_back(
-                 sourceSe,
-                 destSe,
-                 voName,
-                 activeCount
+                sourceSe,
+                destSe,
+                voName,
+                queueActive != activePerQueue.end() ? queueActive->second : 0,
+                linkActive != activePerLink.end() ? linkActive->second : 0,
+                maxActive
             );
         }
     }
@@ -519,40 +465,42 @@ void MySqlAPI::getQueuesWithSessionReusePending(std::vector<QueueId>& queues)
 
     try
     {
-        std::string sourceSe, destSe, voName;
-        unsigned activeCount;
+        std::map<std::tuple<std::string, std::string, std::string>, unsigned> activePerQueue;
+        std::map<std::pair<std::string, std::string>, unsigned> activePerLink;
+        getActiveCountPerQueue(sql, activePerQueue, activePerLink);
 
         soci::rowset<soci::row> rs2 = (sql.prepare <<
-           " SELECT DISTINCT t_file.vo_name, t_file.source_se, t_file.dest_se "
-           " FROM t_file "
-           " INNER JOIN t_job ON t_file.job_id = t_job.job_id "
-           " WHERE "
-           "      t_file.file_state = 'SUBMITTED' AND "
-           "      (t_file.hashed_id BETWEEN :hStart AND :hEnd) AND"
-           "      t_job.job_type = 'Y' ",
+           " SELECT q.vo_name, q.source_se, q.dest_se, o.active AS max_active FROM ("
+           "   SELECT DISTINCT t_file.vo_name, t_file.source_se, t_file.dest_se "
+           "   FROM t_file "
+           "   INNER JOIN t_job ON t_file.job_id = t_job.job_id "
+           "   WHERE "
+           "        t_file.file_state = 'SUBMITTED' AND "
+           "        (t_file.hashed_id BETWEEN :hStart AND :hEnd) AND"
+           "        t_job.job_type = 'Y' "
+           " ) q "
+           " LEFT JOIN t_optimizer o ON (o.source_se = q.source_se AND o.dest_se = q.dest_se)",
            soci::use(hashSegment.start), soci::use(hashSegment.end)
         );
 
-        soci::statement activeStmt = (sql.prepare <<
-            "SELECT COUNT(*) FROM t_file "
-            "WHERE source_se = :source_se AND dest_se = :dest_se AND vo_name = :vo_name "
-            "   AND file_state = 'ACTIVE'",
-            soci::use(sourceSe), soci::use(destSe), soci::use(voName), soci::into(activeCount));
-
         for (soci::rowset<soci::row>::const_iterator i2 = rs2.begin(); i2 != rs2.end(); ++i2)
         {
             soci::row const& r = *i2;
-            sourceSe = r.get<std::string>("source_se", "");
-            destSe = r.get<std::string>("dest_se", "");
-            voName = r.get<std::string>("vo_name", "");
+            const std::string sourceSe = r.get<std::string>("source_se", "");
+            const std::string destSe = r.get<std::string>("dest_se", "");
+            const std::string voName = r.get<std::string>("vo_name", "");
+            const int maxActive = r.get<int>("max_active", 0);
 
-            activeStmt.execute(true);
+            auto queueActive = activePerQueue.find(std::make_tuple(sourceSe, destSe, voName));
+            auto linkActive = activePerLink.find(std::make_pair(sourceSe, destSe));
 
             queues.emplace_back(
                 sourceSe,
                 destSe,
                 voName,
-                activeCount
+                queueActive != activePerQueue.end() ? queueActive->second : 0,
+                linkActive != activePerLink.end() ? linkActive->second : 0,
+                maxActive
             );
         }
     }
@@ -568,6 +516,18 @@ void MySqlAPI::getQueuesWithSessionReusePending(std::vector<QueueId>& queues)
     }
 }
 
+/// Columns computing lastReplica and lastHop of the files picked by getReadyTransfers.
+/// They are part of the main query, so multi replica and multi hop jobs do not cost
+/// an additional query per file. Both use the index on t_file.job_id.
+static const std::string READY_TRANSFERS_LAST_FLAGS =
+    "    CASE WHEN j.job_type = 'R' AND NOT EXISTS ("
+    "        SELECT 1 FROM t_file r WHERE r.job_id = f.job_id AND r.file_state = 'NOT_USED'"
+    "    ) THEN 1 ELSE 0 END AS last_replica,"
+    "    CASE WHEN j.job_type = 'H' AND NOT EXISTS ("
+    "        SELECT 1 FROM t_file h WHERE h.job_id = f.job_id AND h.file_index > f.file_index"
+    "    ) THEN 1 ELSE 0 END AS last_hop ";
+
+
 /// Count how many transfers are running for the given pair
 /// @param source Source storage
 /// @param dest Destination storage
@@ -576,6 +536,16 @@ static int getActiveCount(soci::session& sql, const std::string &source, const s
 {
     int activeCount = 0;
 
+    if (sql.get_backend_name() == "mysql") {
+        soci::indicator isNull = soci::i_ok;
+        sql << "SELECT SUM(count) FROM t_pair_counters "
+            " WHERE source_se = :source_se AND dest_se = :dest_se"
+            " AND file_state = 'ACTIVE'",
+            soci::use(source), soci::use(dest),
+            soci::into(activeCount, isNull);
+        return isNull == soci::i_null ? 0 : activeCount;
+    }
+
     // Running Transfers (R+N+Y+H job type)
     sql << "SELECT COUNT(*) FROM t_file f JOIN t_job j ON j.job_id = f.job_id "
         " WHERE f.source_se = :source_se AND f.dest_se = :dest_se"
@@ -587,27 +557,85 @@ static int getActiveCount(soci::session& sql, const std::string &source, const s
 }
 
 
+/// Move the transfers picked by the current transaction to SELECTED, assigned to this host.
+/// The rows must be locked already (SELECT ... FOR UPDATE).
+static void markSelected(soci::session& sql, const std::list<TransferFile>& picked,
+    const std::string& hostname, const struct tm& tTime)
+{
+    if (picked.empty()) {
+        return;
+    }
+
+    std::ostringstream fileIds;
+    for (auto i = picked.begin(); i != picked.end(); ++i) {
+        if (i != picked.begin()) {
+            fileIds << ",";
+        }
+        fileIds << i->fileId;
+    }
+
+    sql << "UPDATE t_file SET file_state = 'SELECTED', transfer_host = :hostname, start_time = :tTime "
+           "WHERE file_id IN (" << fileIds.str() << ") AND file_state = 'SUBMITTED'",
+        soci::use(hostname), soci::use(tTime);
+}
+
+
 void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
         std::map<std::string, std::list<TransferFile> >& files)
+{
+    getReadyTransfersInternal(queues, -1, files);
+}
+
+
+void MySqlAPI::claimReadyTransfers(const std::vector<QueueId>& queues, int maxFiles,
+        std::map<std::string, std::list<TransferFile> >& files)
+{
+    if (maxFiles > 0) {
+        getReadyTransfersInternal(queues, maxFiles, files);
+    }
+}
+
+
+void MySqlAPI::getReadyTransfersInternal(const std::vector<QueueId>& queues, int claimMax,
+        std::map<std::string, std::list<TransferFile> >& files)
 {
     soci::session sql(*connectionPool);
     time_t now = time(NULL);
 
+    // Claimed transfers are locked with SKIP LOCKED and moved to SELECTED, so the nodes can not
+    // pick the same file and there is no need to split the queues between them
+    const bool claim = (claimMax >= 0);
+    const HashSegment segment = claim ? HashSegment() : hashSegment;
+    const std::string lockClause = claim ? " FOR UPDATE OF f SKIP LOCKED" : "";
+    int claimLeft = claimMax;
+
     try {
+        // Activity shares are resolved once per call, and the queued activities once per VO
+        const std::map<std::string, ActivityShareTable> activityShareTables = getActivityShareTables(sql);
+        std::map<std::string, ActivitiesPerQueue> activitiesPerVo;
+
         // Iterate through queues, getting jobs IF the VO has not run out of credits
         // AND there are pending file transfers within the job
         for (auto it = queues.begin(); it != queues.end(); ++it) {
             int maxActive = 0;
             soci::indicator maxActiveNull = soci::i_ok;
             int filesNum = 10;
+            int activeCount = 0;
 
-            int activeCount = getActiveCount(sql, it->sourceSe, it->destSe);
+            if (it->hasLinkState) {
+                // Already resolved by getQueuesWithPending
+                activeCount = it->linkActiveCount;
+                maxActive = it->linkMaxActive;
+            }
+            else {
+                activeCount = getActiveCount(sql, it->sourceSe, it->destSe);
 
-            // How many can we run
-            sql << "SELECT active FROM t_optimizer WHERE source_se = :source_se AND dest_se = :dest_se",
-                   soci::use(it->sourceSe),
-                   soci::use(it->destSe),
-                   soci::into(maxActive, maxActiveNull);
+                // How many can we run
+                sql << "SELECT active FROM t_optimizer WHERE source_se = :source_se AND dest_se = :dest_se",
+                       soci::use(it->sourceSe),
+                       soci::use(it->destSe),
+                       soci::into(maxActive, maxActiveNull);
+            }
 
             // Calculate how many tops we should pick
             if (maxActiveNull != soci::i_null && maxActive > 0) {
@@ -618,6 +646,13 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                 }
             }
 
+            if (claim) {
+                if (claimLeft <= 0) {
+                    break;
+                }
+                filesNum = std::min(filesNum, claimLeft);
+            }
+
             bool allowPriority = ServerConfig::instance().get<bool>("AllowJobPriority");
             int fixedPriority = std::min(ServerConfig::instance().get<int>("UseFixedJobPriority"), 5);
             int schedulePriority = 3;
@@ -636,7 +671,7 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                    "    file_state = 'SUBMITTED' AND "
                    "    hashed_id BETWEEN :hStart AND :hEnd",
                    soci::use(it->voName), soci::use(it->sourceSe), soci::use(it->destSe),
-                   soci::use(hashSegment.start), soci::use(hashSegment.end),
+                   soci::use(segment.start), soci::use(segment.end),
                    soci::into(schedulePriority, isMaxPriorityNull);
 
                 if (isMaxPriorityNull == soci::i_null) {
@@ -651,8 +686,23 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
             }
 
             std::set<std::string> default_activities;
-            std::map<std::string, int> activityFilesNum =
-                getFilesNumPerActivity(sql, it->sourceSe, it->destSe, it->voName, filesNum, default_activities);
+            std::map<std::string, int> activityFilesNum;
+
+            // if there is no configuration no assigment can be made
+            auto activityShares = activityShareTables.find(it->voName);
+            if (activityShares != activityShareTables.end() && !activityShares->second.empty()) {
+                auto voActivities = activitiesPerVo.find(it->voName);
+                if (voActivities == activitiesPerVo.end()) {
+                    voActivities = activitiesPerVo.emplace(it->voName, getActivitiesInQueues(sql, it->voName, segment)).first;
+                }
+
+                static const std::map<std::string, long long> noActivities;
+                auto activitiesInQueue = voActivities->second.find(std::make_pair(it->sourceSe, it->destSe));
+
+                activityFilesNum = getFilesNumPerActivity(activityShares->second,
+                    activitiesInQueue != voActivities->second.end() ? activitiesInQueue->second : noActivities,
+                    filesNum, default_activities);
+            }
 
             struct tm tTime;
             gmtime_r(&now, &tTime);
@@ -696,7 +746,8 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                         "    f.dest_se,"
                         "    f.selection_strategy,"
                         "    j.internal_job_params,"
-                        "    j.job_type "
+                        "    j.job_type, "
+                        + READY_TRANSFERS_LAST_FLAGS +
                         "FROM t_file f" + use_index + ", t_job j "
                         "WHERE"
                         "    f.job_id = j.job_id AND"
@@ -709,7 +760,12 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                         "    (f.hashed_id >= :hStart AND f.hashed_id <= :hEnd) "
                         + use_priority +
                         "ORDER BY file_id ASC "
-                        "LIMIT :filesNum";
+                        "LIMIT :filesNum" + lockClause;
+
+                std::list<TransferFile> picked;
+                if (claim) {
+                    sql.begin();
+                }
 
                 soci::rowset<TransferFile> rs = (
                     sql.prepare << select,
@@ -717,35 +773,17 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                     soci::use(it->destSe),
                     soci::use(it->voName),
                     soci::use(tTime),
-                    soci::use(hashSegment.start), soci::use(hashSegment.end),
+                    soci::use(segment.start), soci::use(segment.end),
                     soci::use(filesNum));
+                picked.assign(rs.begin(), rs.end());
 
-                for (auto& tfile: rs) {
-                    if (tfile.jobType == Job::kTypeMultipleReplica) {
-                        int total = 0;
-                        int remain = 0;
-                        sql << " select count(*) as c1, "
-                            " (select count(*) from t_file where file_state<>'NOT_USED' and  job_id=:job_id)"
-                            " as c2 from t_file where job_id=:job_id",
-                            soci::use(tfile.jobId),
-                            soci::use(tfile.jobId),
-                            soci::into(total),
-                            soci::into(remain);
-
-                        tfile.lastReplica = (total == remain)? 1: 0;
-                    }
-
-                    if (tfile.jobType == Job::kTypeMultiHop) {
-                        int maxIndex = 0;
-                        sql << "SELECT MAX(file_index) "
-                               "FROM t_file "
-                               "WHERE job_id = :job_id ",
-                                soci::use(tfile.jobId),
-                                soci::into(maxIndex);
-
-                        tfile.lastHop = (maxIndex == tfile.fileIndex)? 1: 0;
-                    }
+                if (claim) {
+                    markSelected(sql, picked, hostname, tTime);
+                    sql.commit();
+                    claimLeft -= static_cast<int>(picked.size());
+                }
 
+                for (auto& tfile: picked) {
                     files[tfile.voName].push_back(tfile);
                 }
             } else {
@@ -774,6 +812,7 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
 
                 for (auto it_act = vActivityFilesNum.begin(); it_act != vActivityFilesNum.end(); ++it_act) {
                     if (it_act->second == 0) continue;
+                    if (claim && claimLeft <= 0) break;
 
                     const std::string use_index = sql.get_backend_name() == "mysql" ? " USE INDEX(idx_link_state_vo)" : "";
                     const std::string use_priority = allowPriority ? (std::string(" AND j.priority = ") + std::to_string(schedulePriority) + std::string(" ")) : "";
@@ -811,7 +850,8 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                         "    f.dest_se,"
                         "    f.selection_strategy,"
                         "    j.internal_job_params,"
-                        "    j.job_type "
+                        "    j.job_type, "
+                        + READY_TRANSFERS_LAST_FLAGS +
                         "FROM t_file f" + use_index + ", t_job j "
                         "WHERE"
                         "    f.job_id = j.job_id AND"
@@ -830,7 +870,14 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                         "   (f.hashed_id >= :hStart AND f.hashed_id <= :hEnd) "
                         + use_priority +
                         "   ORDER BY file_id ASC "
-                        "   LIMIT :filesNum";
+                        "   LIMIT :filesNum" + lockClause;
+
+                    const int toPick = claim ? std::min(it_act->second, claimLeft) : it_act->second;
+
+                    std::list<TransferFile> picked;
+                    if (claim) {
+                        sql.begin();
+                    }
 
                     soci::rowset<TransferFile> rs = (
                          sql.prepare <<
@@ -840,36 +887,18 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
                          soci::use(it->voName),
                          soci::use(tTime),
                          soci::use(it_act->first),
-                         soci::use(hashSegment.start), soci::use(hashSegment.end),
-                         soci::use(it_act->second)
+                         soci::use(segment.start), soci::use(segment.end),
+                         soci::use(toPick)
                     );
+                    picked.assign(rs.begin(), rs.end());
 
-                    for (auto& tfile: rs) {
-                        if (tfile.jobType == Job::kTypeMultipleReplica) {
-                            int total = 0;
-                            int remain = 0;
-                            sql << " select count(*) as c1, "
-                                " (select count(*) from t_file where file_state<>'NOT_USED' and  job_id=:job_id)"
-                                " as c2 from t_file where job_id=:job_id",
-                                soci::use(tfile.jobId),
-                                soci::use(tfile.jobId),
-                                soci::into(total),
-                                soci::into(remain);
-
-                            tfile.lastReplica = (total == remain)? 1: 0;
-                        }
-
-                        if (tfile.jobType == Job::kTypeMultiHop) {
-                            int maxIndex = 0;
-                            sql << "SELECT MAX(file_index) "
-                                   "FROM t_file "
-                                   "WHERE job_id = :job_id ",
-                                    soci::use(tfile.jobId),
-                                    soci::into(maxIndex);
-
-                            tfile.lastHop = (maxIndex == tfile.fileIndex)? 1: 0;
-                        }
+                    if (claim) {
+                        markSelected(sql, picked, hostname, tTime);
+                        sql.commit();
+                        claimLeft -= static_cast<int>(picked.size());
+                    }
 
+                    for (auto& tfile: picked) {
                         tfile.activity = it_act->first;
                         files[tfile.voName].push_back(tfile);
                     }
@@ -877,9 +906,22 @@ void MySqlAPI::getReadyTransfers(const std::vector<QueueId>& queues,
             }
         }
     } catch (std::exception& e) {
+        sql.rollback();
+        // The claims committed so far are SELECTED for this host: hand them over
+        // rather than leaving them behind until the reaper gets to them
+        if (claim && !files.empty()) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Claim interrupted, keeping the transfers claimed so far: "
+                << e.what() << commit;
+            return;
+        }
         files.clear();
         throw UserError(std::string(__func__) + ": Caught exception " + e.what());
     } catch (...) {
+        sql.rollback();
+        if (claim && !files.empty()) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Claim interrupted, keeping the transfers claimed so far" << commit;
+            return;
+        }
         files.clear();
         throw UserError(std::string(__func__) + ": Caught exception ");
     }
@@ -1158,17 +1200,25 @@ void MySqlAPI::getReadySessionReuseTransfers(const std::vector<QueueId>& queues,
         // AND there are pending file transfers within the job
         for (auto it = queues.begin(); it != queues.end(); ++it)
         {
-            int maxActive;
-            soci::indicator maxActiveNull;
+            int maxActive = 0;
+            soci::indicator maxActiveNull = soci::i_ok;
+            int activeCount = 0;
 
-            // How many already running
-            int activeCount = getActiveCount(sql, it->sourceSe, it->destSe);
+            if (it->hasLinkState) {
+                // Already resolved by getQueuesWithSessionReusePending
+                activeCount = it->linkActiveCount;
+                maxActive = it->linkMaxActive;
+            }
+            else {
+                // How many already running
+                activeCount = getActiveCount(sql, it->sourceSe, it->destSe);
 
-            // How many can we run
-            sql << "SELECT active FROM t_optimizer WHERE source_se = :source_se AND dest_se = :dest_se",
-                soci::use(it->sourceSe),
-                soci::use(it->destSe),
-                soci::into(maxActive, maxActiveNull);
+                // How many can we run
+                sql << "SELECT active FROM t_optimizer WHERE source_se = :source_se AND dest_se = :dest_se",
+                    soci::use(it->sourceSe),
+                    soci::use(it->destSe),
+                    soci::into(maxActive, maxActiveNull);
+            }
 
             // This is what is left
             int limit = maxActive - activeCount;
@@ -1599,55 +1649,75 @@ bool MySqlAPI::updateJobTransferStatusInternal(soci::session& sql, std::string j
             sql <<  " SELECT source_se FROM t_file WHERE job_id=:job_id AND file_state='FINISHED' LIMIT 1 ", soci::use(jobId), soci::into(sourceSe);
         }
 
-        sql << " SELECT COUNT(DISTINCT file_index) "
-            " FROM t_file "
-            " WHERE job_id = :job_id ",
-            soci::use(jobId),
-            soci::into(numberOfFilesInJob);
+        // Only one file per file_index outside multiple replica jobs, so the per job counters
+        // maintained by the triggers give the same numbers as counting distinct indexes
+        bool countersFound = false;
+        if (sql.get_backend_name() == "mysql" && jobType != Job::kTypeMultipleReplica) {
+            sql << " SELECT total, total - canceled, total - canceled - failed, finished, staging, archiving "
+                " FROM t_job_counters "
+                " WHERE job_id = :jobId ",
+                soci::use(jobId),
+                soci::into(numberOfFilesInJob), soci::into(numberOfFilesNotCanceled),
+                soci::into(numberOfFilesNotCanceledNorFailed), soci::into(numberOfFilesFinished),
+                soci::into(numberOfStaging), soci::into(numberOfFilesArchiving);
+            countersFound = sql.got_data();
 
-        sql << " SELECT COUNT(DISTINCT file_index) "
-            " FROM t_file "
-            " WHERE job_id = :jobId "
-            "   AND file_state <> 'CANCELED' ", // all the replicas have to be in CANCELED state in order to count a file as canceled
-            soci::use(jobId),                  // so if just one replica is in a different state it is enough to count it as not canceled
-            soci::into(numberOfFilesNotCanceled);
+            numberOfFilesCanceled = numberOfFilesInJob - numberOfFilesNotCanceled;
+        }
 
+        // Jobs not tracked by the counters (i.e. submitted before the upgrade)
+        if (!countersFound)
+        {
+            sql << " SELECT COUNT(DISTINCT file_index) "
+                " FROM t_file "
+                " WHERE job_id = :job_id ",
+                soci::use(jobId),
+                soci::into(numberOfFilesInJob);
 
-        // number of files that were canceled
-        numberOfFilesCanceled = numberOfFilesInJob - numberOfFilesNotCanceled;
+            sql << " SELECT COUNT(DISTINCT file_index) "
+                " FROM t_file "
+                " WHERE job_id = :jobId "
+                "   AND file_state <> 'CANCELED' ", // all the replicas have to be in CANCELED state in order to count a file as canceled
+                soci::use(jobId),                  // so if just one replica is in a different state it is enough to count it as not canceled
+                soci::into(numberOfFilesNotCanceled);
 
-        // number of files that were finished
-        sql << " SELECT COUNT(DISTINCT file_index) "
-            " FROM t_file "
-            " WHERE job_id = :jobId "
-            "   AND file_state = 'FINISHED' ", // at least one replica has to be in FINISH state in order to count the file as finished
-            soci::use(jobId),
-            soci::into(numberOfFilesFinished);
 
-        // number of files still staging
-        sql << " SELECT COUNT(DISTINCT file_index) "
-            " FROM t_file "
-            " WHERE job_id = :jobId "
-            "   AND file_state IN ('STAGING', 'STARTED') ",
-            soci::use(jobId),
-            soci::into(numberOfStaging);
+            // number of files that were canceled
+            numberOfFilesCanceled = numberOfFilesInJob - numberOfFilesNotCanceled;
 
-        // number of files archiving
-        sql << " SELECT COUNT(DISTINCT file_index) "
-            " FROM t_file "
-            " WHERE job_id = :jobId "
-            "   AND file_state = 'ARCHIVING' ",
-            soci::use(jobId),
-            soci::into(numberOfFilesArchiving);
+            // number of files that were finished
+            sql << " SELECT COUNT(DISTINCT file_index) "
+                " FROM t_file "
+                " WHERE job_id = :jobId "
+                "   AND file_state = 'FINISHED' ", // at least one replica has to be in FINISH state in order to count the file as finished
+                soci::use(jobId),
+                soci::into(numberOfFilesFinished);
 
-        // number of files that were not canceled nor failed
-        sql << " SELECT COUNT(DISTINCT file_index) "
-            " FROM t_file "
-            " WHERE job_id = :jobId "
-            "   AND file_state <> 'CANCELED' " // for not canceled files see above
-            "   AND file_state <> 'FAILED' ",  // all the replicas have to be either in CANCELED or FAILED state in order to count
-            soci::use(jobId),                 // a files as failed so if just one replica is not in CANCEL neither in FAILED state
-            soci::into(numberOfFilesNotCanceledNorFailed);
+            // number of files still staging
+            sql << " SELECT COUNT(DISTINCT file_index) "
+                " FROM t_file "
+                " WHERE job_id = :jobId "
+                "   AND file_state IN ('STAGING', 'STARTED') ",
+                soci::use(jobId),
+                soci::into(numberOfStaging);
+
+            // number of files archiving
+            sql << " SELECT COUNT(DISTINCT file_index) "
+                " FROM t_file "
+                " WHERE job_id = :jobId "
+                "   AND file_state = 'ARCHIVING' ",
+                soci::use(jobId),
+                soci::into(numberOfFilesArchiving);
+
+            // number of files that were not canceled nor failed
+            sql << " SELECT COUNT(DISTINCT file_index) "
+                " FROM t_file "
+                " WHERE job_id = :jobId "
+                "   AND file_state <> 'CANCELED' " // for not canceled files see above
+                "   AND file_state <> 'FAILED' ",  // all the replicas have to be either in CANCELED or FAILED state in order to count
+                soci::use(jobId),                 // a files as failed so if just one replica is not in CANCEL neither in FAILED state
+                soci::into(numberOfFilesNotCanceledNorFailed);
+        }
 
         // number of files that failed
         numberOfFilesFailed = numberOfFilesInJob - numberOfFilesNotCanceledNorFailed - numberOfFilesCanceled;
@@ -1814,42 +1884,447 @@ bool MySqlAPI::updateJobTransferStatusInternal(soci::session& sql, std::string j
 }
 
 
-void MySqlAPI::updateFileTransferProgressVector(const std::vector<fts3::events::MessageUpdater>& messages)
+/// Key of a row of t_pair_counters, without the state
+typedef std::tuple<std::string, std::string, std::string> PairCounterKey;
+
+
+/// Lock the t_pair_counters rows of the given pairs, every state included.
+/// A multi-row transaction would otherwise lock them from the triggers in the order of its files,
+/// and deadlock with another node touching the same pairs in a different order.
+/// The rows are read with a single range scan, so InnoDB locks them in primary key order,
+/// which is also the order followed by trg_pair_counters_update.
+/// Must be called after locking the t_file rows, like the single row updates do.
+static void lockPairCounters(soci::session& sql, const std::set<PairCounterKey>& pairs)
+{
+    if (pairs.empty() || sql.get_backend_name() != "mysql") {
+        return;
+    }
+
+    std::ostringstream query;
+    query << "SELECT count FROM t_pair_counters WHERE (source_se, dest_se, vo_name) IN (";
+
+    soci::statement stmt(sql);
+    int index = 0;
+    for (auto i = pairs.begin(); i != pairs.end(); ++i, ++index) {
+        if (index > 0) {
+            query << ", ";
+        }
+        query << "(:s" << index << ", :d" << index << ", :v" << index << ")";
+        stmt.exchange(soci::use(std::get<0>(*i), "s" + std::to_string(index)));
+        stmt.exchange(soci::use(std::get<1>(*i), "d" + std::to_string(index)));
+        stmt.exchange(soci::use(std::get<2>(*i), "v" + std::to_string(index)));
+    }
+    query << ") FOR UPDATE";
+
+    stmt.alloc();
+    stmt.prepare(query.str());
+    stmt.define_and_bind();
+    stmt.execute(false);
+}
+
+
+/// Lock the t_job_counters rows of the given jobs, in primary key order.
+/// The triggers update them after the pair counters, so this must be called after lockPairCounters.
+/// Without it, a batch would lock the row of each job in the order of its files.
+static void lockJobCounters(soci::session& sql, const std::set<std::string>& jobIds)
+{
+    if (jobIds.empty() || sql.get_backend_name() != "mysql") {
+        return;
+    }
+
+    std::ostringstream query;
+    query << "SELECT total FROM t_job_counters WHERE job_id IN (";
+
+    soci::statement stmt(sql);
+    int index = 0;
+    for (auto i = jobIds.begin(); i != jobIds.end(); ++i, ++index) {
+        if (index > 0) {
+            query << ", ";
+        }
+        query << ":j" << index;
+        stmt.exchange(soci::use(*i, "j" + std::to_string(index)));
+    }
+    query << ") FOR UPDATE";
+
+    stmt.alloc();
+    stmt.prepare(query.str());
+    stmt.define_and_bind();
+    stmt.execute(false);
+}
+
+
+/// File and job fields needed to apply a status message
+struct StoredFileState {
+    std::string jobId;
+    std::string state;
+    std::string destSurlUuid;
+    soci::indicator destSurlUuidInd;
+    int retryCounter;
+    Job::JobType jobType;
+    std::string jobState;
+    int archiveTimeout;
+};
+
+
+std::vector<TransferStatusUpdate>
+MySqlAPI::updateTransferStatusBatch(const std::vector<fts3::events::Message>& messages)
 {
     soci::session sql(*connectionPool);
+    std::vector<TransferStatusUpdate> results;
+
+    if (messages.empty()) {
+        return results;
+    }
+
+    std::map<uint64_t, StoredFileState> stored;
+    std::vector<size_t> updatedIndexes;
 
     try
     {
-        double throughput = 0.0;
-        uint64_t transferred = 0.0;
-        uint64_t fileId = 0;
-
-        soci::statement stmt = (
-                sql.prepare << "UPDATE t_file SET "
-                               "    throughput = :throughput, "
-                               "    transferred = :transferred "
-                               "WHERE file_id = :fileId",
-                        soci::use(throughput),
-                        soci::use(transferred),
-                        soci::use(fileId)
-        );
+        results.reserve(messages.size());
+
+        std::set<uint64_t> fileIds;
+        std::map<std::string, int> maxRetries;
+
+        for (auto msg = messages.begin(); msg != messages.end(); ++msg) {
+            results.emplace_back(msg->job_id(), msg->file_id(), msg->transfer_status());
+            if (msg->job_id().empty() || msg->file_id() == 0) {
+                continue;
+            }
+            fileIds.insert(msg->file_id());
+            // multiple replica files belonging to a job will not be retried
+            if (msg->transfer_status() == "FAILED" && msg->retry() &&
+                maxRetries.find(msg->job_id()) == maxRetries.end()) {
+                maxRetries[msg->job_id()] = getRetryInternal(sql, msg->job_id());
+            }
+        }
+
+        if (fileIds.empty()) {
+            return results;
+        }
+
+        std::ostringstream fileIdsStr;
+        for (auto i = fileIds.begin(); i != fileIds.end(); ++i) {
+            if (i != fileIds.begin()) {
+                fileIdsStr << ", ";
+            }
+            fileIdsStr << *i;
+        }
+
+        time_t now = time(NULL);
+        struct tm tTime;
+        gmtime_r(&now, &tTime);
 
         sql.begin();
 
-        for (const auto& message:  messages) {
-            if (message.file_id() > 0) {
-                const auto& fileState = message.transfer_status();
+        // Lock the rows in file_id order, so concurrent batches can not deadlock
+        const std::string enum_to_text_cast = sql.get_backend_name() == "mysql" ? "" : "::TEXT";
+        {
+            std::set<PairCounterKey> pairs;
+            std::set<std::string> jobIds;
+            soci::rowset<soci::row> rs = (sql.prepare <<
+                "SELECT "
+                "    f.file_id, f.job_id, f.file_state" << enum_to_text_cast << " AS file_state, "
+                "    f.source_se, f.dest_se, f.vo_name, "
+                "    f.dest_surl_uuid, f.retry AS retry_counter, "
+                "    j.job_type, j.job_state" << enum_to_text_cast << " AS job_state, j.archive_timeout "
+                "FROM t_file f INNER JOIN t_job j ON (f.job_id = j.job_id) "
+                "WHERE f.file_id IN (" << fileIdsStr.str() << ") "
+                "ORDER BY f.file_id "
+                "FOR UPDATE OF f");
+
+            for (auto i = rs.begin(); i != rs.end(); ++i) {
+                StoredFileState file;
+                file.jobId = i->get<std::string>("job_id");
+                file.state = i->get<std::string>("file_state");
+                file.destSurlUuidInd = i->get_indicator("dest_surl_uuid");
+                file.destSurlUuid = i->get<std::string>("dest_surl_uuid", "");
+                file.retryCounter = i->get<int>("retry_counter", 0);
+                file.jobType = i->get<Job::JobType>("job_type", Job::kTypeRegular);
+                file.jobState = i->get<std::string>("job_state");
+                file.archiveTimeout = i->get<int>("archive_timeout", -1);
+                stored[get_file_id_from_row(*i)] = file;
+                pairs.emplace(i->get<std::string>("source_se", ""), i->get<std::string>("dest_se", ""),
+                    i->get<std::string>("vo_name", ""));
+                jobIds.insert(file.jobId);
+            }
 
-                if (fileState == "ACTIVE") {
-                    fileId = message.file_id();
+            // The updates below only move these files, so the triggers only touch these counters.
+            // Locked in the order of the triggers: the pairs, then the jobs.
+            lockPairCounters(sql, pairs);
+            lockJobCounters(sql, jobIds);
+        }
 
-                    if (message.throughput() > 0.0 && fileId > 0 ) {
-                        throughput = message.throughput();
-                        transferred = message.transferred();
-                        stmt.execute(true);
+        // Same statement for every state, columns that do not apply are bound to NULL
+        std::string newState, reason, oldState, fileMetadata;
+        struct tm finishTime = tTime, startTime = tTime, stagingStart = tTime, stagingFinished = tTime;
+        soci::indicator finishTimeInd = soci::i_null, startTimeInd = soci::i_null;
+        soci::indicator stagingStartInd = soci::i_null, stagingFinishedInd = soci::i_null;
+        soci::indicator transferredInd = soci::i_null, fileMetadataInd = soci::i_null;
+        int clearDestSurlUuid = 0, processId = 0, currentFailures = 0;
+        long long transferred = 0;
+        uint64_t filesize = 0, fileId = 0;
+        double duration = 0, throughput = 0;
+
+        soci::statement updateStmt = (sql.prepare <<
+            "UPDATE t_file SET "
+            "    file_state = :state, reason = :reason, "
+            "    finish_time = COALESCE(:finishTime, finish_time), "
+            "    dest_surl_uuid = CASE WHEN :clearDestSurlUuid = 1 THEN NULL ELSE dest_surl_uuid END, "
+            "    start_time = COALESCE(:startTime, start_time), "
+            "    transfer_host = :hostname, "
+            "    transferred = COALESCE(:transferred, transferred), "
+            "    staging_start = COALESCE(:stagingStart, staging_start), "
+            "    staging_finished = COALESCE(:stagingFinished, staging_finished), "
+            "    file_metadata = COALESCE(:fileMetadata, file_metadata), "
+            "    pid = :pid, filesize = :filesize, tx_duration = :duration, throughput = :throughput, "
+            "    current_failures = :currentFailures "
+            "WHERE file_id = :fileId AND file_state = :oldState",
+            soci::use(newState, "state"), soci::use(reason, "reason"),
+            soci::use(finishTime, finishTimeInd, "finishTime"),
+            soci::use(clearDestSurlUuid, "clearDestSurlUuid"),
+            soci::use(startTime, startTimeInd, "startTime"),
+            soci::use(hostname, "hostname"),
+            soci::use(transferred, transferredInd, "transferred"),
+            soci::use(stagingStart, stagingStartInd, "stagingStart"),
+            soci::use(stagingFinished, stagingFinishedInd, "stagingFinished"),
+            soci::use(fileMetadata, fileMetadataInd, "fileMetadata"),
+            soci::use(processId, "pid"), soci::use(filesize, "filesize"),
+            soci::use(duration, "duration"), soci::use(throughput, "throughput"),
+            soci::use(currentFailures, "currentFailures"),
+            soci::use(fileId, "fileId"), soci::use(oldState, "oldState"));
+
+        for (size_t index = 0; index < messages.size(); ++index) {
+            const fts3::events::Message& msg = messages[index];
+            TransferStatusUpdate& result = results[index];
+
+            auto file = stored.find(msg.file_id());
+            if (msg.job_id().empty() || file == stored.end() || file->second.jobId != msg.job_id()) {
+                continue;
+            }
+            StoredFileState& current = file->second;
+            result.storedState = current.state;
+
+            if (msg.transfer_status() == "FAILED" && msg.retry()) {
+                auto retry = maxRetries.find(msg.job_id());
+                if (retry != maxRetries.end() && retry->second > 0 && current.retryCounter <= retry->second - 1) {
+                    const std::string retriedState = setRetryTransferInternal(sql, msg.job_id(), msg.file_id(),
+                        current.retryCounter + 1, msg.transfer_message(), msg.log_path(), msg.errcode());
+                    result.retried = true;
+                    // Only if the retry moved the file, which may go back to STAGING instead of SUBMITTED
+                    if (!retriedState.empty()) {
+                        current.retryCounter += 1;
+                        current.state = retriedState;
                     }
+                    continue;
+                }
+            }
+
+            // Same transitions allowed by updateFileTransferStatusInternal
+            newState = msg.transfer_status();
+            if (current.state == "FAILED" || current.state == "FINISHED" || current.state == "CANCELED") {
+                continue;
+            }
+            if (current.state == "ACTIVE" && newState == "READY") {
+                continue;
+            }
+            if (current.state == newState && !(newState == "READY" && msg.process_id() != 0)) {
+                continue;
+            }
+
+            const bool isTerminal = (newState == "FINISHED" || newState == "FAILED" || newState == "CANCELED");
+
+            finishTimeInd = isTerminal ? soci::i_ok : soci::i_null;
+            clearDestSurlUuid = isTerminal ? 1 : 0;
+            startTimeInd = (newState == "ACTIVE" || newState == "READY") ? soci::i_ok : soci::i_null;
+            stagingStartInd = (newState == "STAGING" && current.state != "STAGING") ? soci::i_ok : soci::i_null;
+            stagingFinishedInd = (newState == "STAGING" && current.state == "STAGING") ? soci::i_ok : soci::i_null;
+
+            transferredInd = soci::i_null;
+            if (newState == "FINISHED") {
+                transferred = static_cast<long long>(msg.filesize());
+                transferredInd = soci::i_ok;
+            }
+            else if (newState == "FAILED" || newState == "CANCELED") {
+                transferred = 0;
+                transferredInd = soci::i_ok;
+            }
+
+            // Move the new state to ARCHIVING if the transfer completed and the archive timeout is set
+            if (newState == "FINISHED" &&
+                isArchivingTransfer(sql, msg.job_id(), current.jobType, current.archiveTimeout)) {
+                FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Moving transfer " << msg.job_id() << " " << msg.file_id()
+                                                 << " to ARCHIVING state" << commit;
+                newState = "ARCHIVING";
+            }
+
+            reason = msg.transfer_message();
+            fileMetadata = msg.file_metadata();
+            fileMetadataInd = fileMetadata.empty() ? soci::i_null : soci::i_ok;
+            processId = msg.process_id();
+            filesize = msg.filesize();
+            duration = msg.time_in_secs();
+            throughput = msg.throughput();
+            currentFailures = static_cast<int>(msg.retry());
+            fileId = msg.file_id();
+            oldState = current.state;
+
+            updateStmt.execute(true);
+            if (updateStmt.get_affected_rows() == 0) {
+                continue;
+            }
+
+            result.updated = true;
+            current.state = newState;
+            updatedIndexes.push_back(index);
+        }
+
+        sql.commit();
+    }
+    catch (std::exception& e)
+    {
+        sql.rollback();
+        throw UserError(std::string(__func__) + ": Caught exception " + e.what());
+    }
+    catch (...)
+    {
+        sql.rollback();
+        throw UserError(std::string(__func__) + ": Caught exception ");
+    }
+
+    // The file changes are committed from here on, so failures are reported with
+    // TransferStatusBatchError and the caller must not apply the messages again
+    try
+    {
+        // Follow-up for multiple replica and multihop jobs.
+        // One transaction per file, so a failure does not leave the other jobs of the batch stuck.
+        for (auto i = updatedIndexes.begin(); i != updatedIndexes.end(); ++i) {
+            const TransferStatusUpdate& result = results[*i];
+            const StoredFileState& current = stored[result.fileId];
+
+            try
+            {
+                switch (current.jobType) {
+                    case Job::kTypeMultipleReplica:
+                        if ((current.jobState != "CANCELED" && current.jobState != "FAILED") &&
+                            (current.state == "FAILED" || current.state == "CANCELED")) {
+                            sql.begin();
+                            useFileReplica(sql, result.jobId, result.fileId, current.destSurlUuid, current.destSurlUuidInd);
+                            sql.commit();
+                        }
+                        break;
+                    case Job::kTypeMultiHop:
+                        sql.begin();
+                        if ((current.jobState != "CANCELED" && current.jobState != "FAILED") &&
+                            (current.state == "FINISHED")) {
+                            useNextHop(sql, result.jobId);
+                        }
+                        else {
+                            setNullDestSURLMultiHop(sql, result.jobId);
+                        }
+                        sql.commit();
+                        break;
+                    default:
+                        break;
                 }
             }
+            catch (std::exception& e)
+            {
+                sql.rollback();
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << __func__ << ": Follow-up of " << result.jobId << " "
+                                               << result.fileId << " failed: " << e.what() << commit;
+            }
+            catch (...)
+            {
+                sql.rollback();
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << __func__ << ": Follow-up of " << result.jobId << " "
+                                               << result.fileId << " failed" << commit;
+            }
+        }
+
+        // Job state, once per job and requested state
+        std::set<std::pair<std::string, std::string>> jobUpdates;
+        std::set<uint64_t> publishFileIds;
+        for (auto result = results.begin(); result != results.end(); ++result) {
+            if (result->retried || result->jobId.empty() || result->fileId == 0) {
+                continue;
+            }
+            if (jobUpdates.insert(std::make_pair(result->jobId, result->state)).second) {
+                updateJobTransferStatusInternal(sql, result->jobId, result->state);
+            }
+            if (result->updated || result->state == "CANCELED") {
+                publishFileIds.insert(result->fileId);
+            }
+        }
+
+        // State for the monitoring messages, read once the job has been updated as well
+        std::map<uint64_t, std::vector<TransferState>> states = getStateOfTransfersInternal(sql, publishFileIds);
+        for (auto result = results.begin(); result != results.end(); ++result) {
+            if (!result->retried && publishFileIds.count(result->fileId)) {
+                result->states = states[result->fileId];
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        sql.rollback();
+        throw TransferStatusBatchError(std::string(__func__) + ": Caught exception after commit " + e.what(), results);
+    }
+    catch (...)
+    {
+        sql.rollback();
+        throw TransferStatusBatchError(std::string(__func__) + ": Caught exception after commit ", results);
+    }
+
+    return results;
+}
+
+
+void MySqlAPI::updateFileTransferProgressVector(const std::vector<fts3::events::MessageUpdater>& messages)
+{
+    // Keep the last progress of each file. The map orders them by file_id, so
+    // concurrent updates lock the rows in the same order.
+    // A ping may be written a while after it was received, so files that left ACTIVE
+    // meanwhile (terminal, or back to SUBMITTED for a retry) are not touched.
+    std::map<uint64_t, const fts3::events::MessageUpdater*> progress;
+    for (const auto& message: messages) {
+        if (message.file_id() > 0 && message.transfer_status() == "ACTIVE" &&
+            message.throughput() > 0.0 && std::isfinite(message.throughput())) {
+            progress[message.file_id()] = &message;
+        }
+    }
+
+    if (progress.empty()) {
+        return;
+    }
+
+    soci::session sql(*connectionPool);
+
+    try
+    {
+        sql.begin();
+
+        // One multi-row UPDATE per chunk of files
+        auto chunkBegin = progress.begin();
+        while (chunkBegin != progress.end()) {
+            std::ostringstream throughputCase, transferredCase, fileIdsStr;
+            throughputCase.precision(std::numeric_limits<double>::max_digits10);
+
+            auto i = chunkBegin;
+            for (size_t count = 0; i != progress.end() && count < PROGRESS_UPDATE_CHUNK_SIZE; ++i, ++count) {
+                if (count > 0) {
+                    fileIdsStr << ", ";
+                }
+                fileIdsStr << i->first;
+                throughputCase << " WHEN " << i->first << " THEN " << i->second->throughput();
+                transferredCase << " WHEN " << i->first << " THEN " << i->second->transferred();
+            }
+            chunkBegin = i;
+
+            sql << "UPDATE t_file SET "
+                   "    throughput = CASE file_id" << throughputCase.str() << " END, "
+                   "    transferred = CASE file_id" << transferredCase.str() << " END "
+                   "WHERE file_id IN (" << fileIdsStr.str() << ") AND file_state = 'ACTIVE'";
         }
 
         sql.commit();
@@ -1867,7 +2342,7 @@ void MySqlAPI::updateFileTransferProgressVector(const std::vector<fts3::events::
 }
 
 
-void MySqlAPI::getCancelJob(std::vector<int>& requestIDs)
+void MySqlAPI::getCancelJob(std::vector<std::pair<int, uint64_t>>& requestIDs)
 {
     soci::session sql(*connectionPool);
     int pid = 0;
@@ -1897,7 +2372,7 @@ void MySqlAPI::getCancelJob(std::vector<int>& requestIDs)
             file_id = get_file_id_from_row(row);
 
             if(pid > 0)
-                requestIDs.push_back(pid);
+                requestIDs.emplace_back(pid, file_id);
 
             stmt1.execute(true);
         }
@@ -2624,41 +3099,110 @@ void MySqlAPI::transferLogFileVector(std::map<int, fts3::events::MessageLog>& me
 }
 
 
-std::vector<TransferState> MySqlAPI::getStateOfTransferInternal(soci::session& sql, const std::string& jobId, uint64_t fileId)
+/// Columns needed to build a TransferState
+static std::string getTransferStateQuery(soci::session& sql)
+{
+    const std::string enum_to_text_cast = sql.get_backend_name() == "mysql" ? "" : "::TEXT";
+    return
+        "SELECT "
+        "    j.user_dn,"
+        "    j.submit_time,"
+        "    j.job_id,"
+        "    j.job_state" + enum_to_text_cast + ","
+        "    j.vo_name, "
+        "    j.job_metadata,"
+        "    j.retry AS retry_max,"
+        "    f.file_id, "
+        "    f.file_state" + enum_to_text_cast + ","
+        "    f.retry AS retry_counter,"
+        "    f.user_filesize,"
+        "    f.file_metadata,"
+        "    f.reason, "
+        "    f.source_se,"
+        "    f.dest_se,"
+        "    f.start_time,"
+        "    f.source_surl,"
+        "    f.dest_surl,"
+        "    f.staging_start,"
+        "    f.staging_finished,"
+        "    f.archive_start_time,"
+        "    f.archive_finish_time "
+        "FROM"
+        "    t_file f INNER JOIN t_job j ON (f.job_id = j.job_id) ";
+}
+
+
+/// Build a TransferState out of a row returned by the query from getTransferStateQuery
+static TransferState getTransferStateFromRow(const soci::row& row, bool publishUserDn)
 {
     TransferState ret;
+
+    ret.job_id = row.get<std::string>("job_id");
+    ret.job_state = row.get<std::string>("job_state");
+    ret.vo_name = row.get<std::string>("vo_name");
+    ret.job_metadata = row.get<std::string>("job_metadata","");
+    ret.retry_max = row.get<int>("retry_max",0);
+    ret.user_filesize = row.get<long long>("user_filesize", 0);
+    ret.file_id = get_file_id_from_row(row);
+    ret.file_state = row.get<std::string>("file_state");
+    ret.reason = row.get<std::string>("reason", "");
+    ret.timestamp = millisecondsSinceEpoch();
+    auto aux_tm = row.get<struct tm>("submit_time");
+    ret.submit_time = (timegm(&aux_tm) * 1000);
+
+    if (row.get_indicator("staging_start") == soci::i_ok) {
+        aux_tm = row.get<struct tm>("staging_start");
+        ret.staging_start = (timegm(&aux_tm) * 1000);
+    }
+    if (row.get_indicator("staging_finished") == soci::i_ok) {
+        aux_tm = row.get<struct tm>("staging_finished");
+        ret.staging_finished = (timegm(&aux_tm) * 1000);
+    }
+
+    if (ret.staging_start != 0) {
+        ret.staging = true;
+    }
+
+    if (row.get_indicator("archive_start_time") == soci::i_ok) {
+        aux_tm = row.get<struct tm>("archive_start_time");
+        ret.archiving_start = (timegm(&aux_tm) * 1000);
+    }
+    if (row.get_indicator("archive_finish_time") == soci::i_ok) {
+        aux_tm = row.get<struct tm>("archive_finish_time");
+        ret.archiving_finished = (timegm(&aux_tm) * 1000);
+    }
+
+    if (ret.archiving_start != 0) {
+        ret.archiving = true;
+    }
+
+    ret.retry_counter = row.get<int>("retry_counter",0);
+    ret.file_metadata = row.get<std::string>("file_metadata","");
+    ret.source_se = row.get<std::string>("source_se");
+    ret.dest_se = row.get<std::string>("dest_se");
+
+    if (!publishUserDn) {
+        ret.user_dn = std::string("");
+    } else {
+        ret.user_dn = row.get<std::string>("user_dn", "");
+    }
+
+    ret.source_url = row.get<std::string>("source_surl","");
+    ret.dest_url = row.get<std::string>("dest_surl","");
+
+    return ret;
+}
+
+
+std::vector<TransferState> MySqlAPI::getStateOfTransferInternal(soci::session& sql, const std::string& jobId, uint64_t fileId)
+{
     std::vector<TransferState> temp;
 
     try
     {
-        const std::string enum_to_text_cast = sql.get_backend_name() == "mysql" ? "" : "::TEXT";
         soci::rowset<soci::row> rs = (
             sql.prepare <<
-                "SELECT "
-                "    j.user_dn,"
-                "    j.submit_time,"
-                "    j.job_id,"
-                "    j.job_state" << enum_to_text_cast << ","
-                "    j.vo_name, "
-                "    j.job_metadata,"
-                "    j.retry AS retry_max,"
-                "    f.file_id, "
-                "    f.file_state" << enum_to_text_cast << ","
-                "    f.retry AS retry_counter,"
-                "    f.user_filesize,"
-                "    f.file_metadata,"
-                "    f.reason, "
-                "    f.source_se,"
-                "    f.dest_se,"
-                "    f.start_time,"
-                "    f.source_surl,"
-                "    f.dest_surl,"
-                "    f.staging_start,"
-                "    f.staging_finished,"
-                "    f.archive_start_time,"
-                "    f.archive_finish_time "
-                "FROM"
-                "    t_file f INNER JOIN t_job j ON (f.job_id = j.job_id) "
+                getTransferStateQuery(sql) <<
                 "WHERE "
                 "    j.job_id = :jobId AND"
                 "    f.file_id = :fileId",
@@ -2669,61 +3213,8 @@ std::vector<TransferState> MySqlAPI::getStateOfTransferInternal(soci::session& s
 
         for (it = rs.begin(); it != rs.end(); ++it)
         {
-            ret.job_id = it->get<std::string>("job_id");
-            ret.job_state = it->get<std::string>("job_state");
-            ret.vo_name = it->get<std::string>("vo_name");
-            ret.job_metadata = it->get<std::string>("job_metadata","");
-            ret.retry_max = it->get<int>("retry_max",0);
-            ret.user_filesize = it->get<long long>("user_filesize", 0);
-            ret.file_id = get_file_id_from_row(*it);
-            ret.file_state = it->get<std::string>("file_state");
-            ret.reason = it->get<std::string>("reason", "");
-            ret.timestamp = millisecondsSinceEpoch();
-            auto aux_tm = it->get<struct tm>("submit_time");
-            ret.submit_time = (timegm(&aux_tm) * 1000);
-
-            if (it->get_indicator("staging_start") == soci::i_ok) {
-                aux_tm = it->get<struct tm>("staging_start");
-                ret.staging_start = (timegm(&aux_tm) * 1000);
-            }
-            if (it->get_indicator("staging_finished") == soci::i_ok) {
-                aux_tm = it->get<struct tm>("staging_finished");
-                ret.staging_finished = (timegm(&aux_tm) * 1000);
-            }
-
-            if (ret.staging_start != 0) {
-                ret.staging = true;
-            }
-
-            if (it->get_indicator("archive_start_time") == soci::i_ok) {
-                aux_tm = it->get<struct tm>("archive_start_time");
-                ret.archiving_start = (timegm(&aux_tm) * 1000);
-            }
-            if (it->get_indicator("archive_finish_time") == soci::i_ok) {
-                aux_tm = it->get<struct tm>("archive_finish_time");
-                ret.archiving_finished = (timegm(&aux_tm) * 1000);
-            }
-
-            if (ret.archiving_start != 0) {
-                ret.archiving = true;
-            }
-
-            ret.retry_counter = it->get<int>("retry_counter",0);
-            ret.file_metadata = it->get<std::string>("file_metadata","");
-            ret.source_se = it->get<std::string>("source_se");
-            ret.dest_se = it->get<std::string>("dest_se");
-
-            bool publishUserDn = publishUserDnInternal(sql, ret.vo_name);
-            if (!publishUserDn) {
-                ret.user_dn = std::string("");
-            } else {
-                ret.user_dn = it->get<std::string>("user_dn", "");
-            }
-
-            ret.source_url = it->get<std::string>("source_surl","");
-            ret.dest_url = it->get<std::string>("dest_surl","");
-
-            temp.push_back(ret);
+            bool publishUserDn = publishUserDnInternal(sql, it->get<std::string>("vo_name"));
+            temp.push_back(getTransferStateFromRow(*it, publishUserDn));
         }
     }
     catch (std::exception& e)
@@ -2738,6 +3229,44 @@ std::vector<TransferState> MySqlAPI::getStateOfTransferInternal(soci::session& s
     return temp;
 }
 
+
+std::map<uint64_t, std::vector<TransferState>> MySqlAPI::getStateOfTransfersInternal(soci::session& sql,
+    const std::set<uint64_t>& fileIds)
+{
+    std::map<uint64_t, std::vector<TransferState>> states;
+    if (fileIds.empty()) {
+        return states;
+    }
+
+    std::ostringstream fileIdsStr;
+    for (auto i = fileIds.begin(); i != fileIds.end(); ++i) {
+        if (i != fileIds.begin()) {
+            fileIdsStr << ", ";
+        }
+        fileIdsStr << *i;
+    }
+
+    soci::rowset<soci::row> rs = (
+        sql.prepare <<
+            getTransferStateQuery(sql) <<
+            "WHERE f.file_id IN (" << fileIdsStr.str() << ")");
+
+    std::map<std::string, bool> publishUserDnPerVo;
+    for (auto it = rs.begin(); it != rs.end(); ++it)
+    {
+        const std::string voName = it->get<std::string>("vo_name");
+        auto publish = publishUserDnPerVo.find(voName);
+        if (publish == publishUserDnPerVo.end()) {
+            publish = publishUserDnPerVo.emplace(voName, publishUserDnInternal(sql, voName)).first;
+        }
+
+        TransferState state = getTransferStateFromRow(*it, publish->second);
+        states[state.file_id].push_back(state);
+    }
+
+    return states;
+}
+
 std::vector<TransferState> MySqlAPI::getStateOfTransfer(const std::string& jobId, uint64_t fileId)
 {
     soci::session sql(*connectionPool);
@@ -2765,92 +3294,10 @@ void MySqlAPI::setRetryTransfer(const std::string& jobId, uint64_t fileId, int r
 {
     soci::session sql(*connectionPool);
 
-    // Expressed in secs, default delay
-    const int default_retry_delay = DEFAULT_RETRY_DELAY;
-    int retry_delay = 0;
-    std::string job_type;
-    auto ind = soci::i_ok;
-
     try
     {
-        sql << "SELECT retry_delay, job_type FROM t_job WHERE job_id = :jobId ",
-                soci::use(jobId),
-                soci::into(retry_delay),
-                soci::into(job_type, ind);
-
         sql.begin();
-
-        if ((ind == soci::i_ok) && (job_type == "Y"))
-        {
-            sql << "UPDATE t_job SET "
-                   "    job_state = 'ACTIVE' "
-                   "WHERE job_id = :jobId AND job_type = 'Y' AND "
-                   "      job_state NOT IN ('FINISHEDDIRTY', 'FAILED', 'CANCELED', 'FINISHED')",
-                    soci::use(jobId);
-        }
-
-        struct tm tTime;
-        if (retry_delay > 0)
-        {
-            // update
-            time_t now = getUTC(retry_delay);
-            gmtime_r(&now, &tTime);
-        }
-        else
-        {
-            // update
-            time_t now = getUTC(default_retry_delay);
-            gmtime_r(&now, &tTime);
-        }
-
-        int bring_online = -1;
-        int copy_pin_lifetime = -1;
-
-        // Query for the file state in DB
-        sql << "SELECT bring_online, copy_pin_lifetime FROM t_job WHERE job_id = :jobId",
-                soci::use(jobId),
-                soci::into(bring_online),
-                soci::into(copy_pin_lifetime);
-
-        // Staging exception: if file failed with timeout and was staged before, reset it
-        if ((bring_online > 0 || copy_pin_lifetime > 0) && (errcode == ETIMEDOUT))
-        {
-            sql << "UPDATE t_file SET "
-                   "    retry = :retryNo, current_failures = 0, file_state = 'STAGING', "
-                   "    filesize = 0, internal_file_params = NULL, transfer_host = NULL, pid = NULL, "
-                   "    start_time = NULL, staging_start = NULL, staging_finished = NULL "
-                   "WHERE file_id = :fileId AND job_id = :jobId AND "
-                   "      file_state NOT IN ('FINISHED', 'STAGING', 'SUBMITTED', 'FAILED', 'CANCELED')",
-                    soci::use(retryNo),
-                    soci::use(fileId),
-                    soci::use(jobId);
-        }
-        else
-        {
-            sql << "UPDATE t_file SET "
-                   "    retry = :retryNo, retry_timestamp = :tTime, file_state = 'SUBMITTED', "
-                   "    throughput = 0, current_failures = 1, start_time = NULL, "
-                   "    transfer_host = NULL, log_file = NULL, log_file_debug = NULL "
-                   "WHERE file_id = :fileId AND job_id = :jobId AND "
-                   "      file_state NOT IN ('FINISHED', 'SUBMITTED', 'FAILED', 'CANCELED')",
-                    soci::use(retryNo),
-                    soci::use(tTime),
-                    soci::use(fileId),
-                    soci::use(jobId);
-        }
-
-        // Keep transfer retry log
-        const std::string utc_timestamp = sql.get_backend_name() == "mysql" ? "UTC_TIMESTAMP()" : "NOW() AT TIME ZONE 'UTC'";
-        sql <<
-            "INSERT IGNORE INTO t_file_retry_errors "
-            "       (file_id, attempt, datetime, reason, transfer_host, log_file) "
-            "VALUES (:fileId, :retryNo, " << utc_timestamp << ", :reason, :hostname, :logFile)",
-            soci::use(fileId),
-            soci::use(retryNo),
-            soci::use(reason),
-            soci::use(hostname),
-            soci::use(logFile);
-
+        setRetryTransferInternal(sql, jobId, fileId, retryNo, reason, logFile, errcode);
         sql.commit();
     }
     catch (std::exception& e)
@@ -2866,6 +3313,107 @@ void MySqlAPI::setRetryTransfer(const std::string& jobId, uint64_t fileId, int r
 }
 
 
+std::string MySqlAPI::setRetryTransferInternal(soci::session& sql, const std::string& jobId, uint64_t fileId,
+                                               int retryNo, const std::string& reason, const std::string& logFile,
+                                               int errcode)
+{
+    // Expressed in secs, default delay
+    const int default_retry_delay = DEFAULT_RETRY_DELAY;
+    int retry_delay = 0;
+    std::string job_type;
+    auto ind = soci::i_ok;
+
+    sql << "SELECT retry_delay, job_type FROM t_job WHERE job_id = :jobId ",
+            soci::use(jobId),
+            soci::into(retry_delay),
+            soci::into(job_type, ind);
+
+    if ((ind == soci::i_ok) && (job_type == "Y"))
+    {
+        sql << "UPDATE t_job SET "
+               "    job_state = 'ACTIVE' "
+               "WHERE job_id = :jobId AND job_type = 'Y' AND "
+               "      job_state NOT IN ('FINISHEDDIRTY', 'FAILED', 'CANCELED', 'FINISHED')",
+                soci::use(jobId);
+    }
+
+    struct tm tTime;
+    if (retry_delay > 0)
+    {
+        // update
+        time_t now = getUTC(retry_delay);
+        gmtime_r(&now, &tTime);
+    }
+    else
+    {
+        // update
+        time_t now = getUTC(default_retry_delay);
+        gmtime_r(&now, &tTime);
+    }
+
+    int bring_online = -1;
+    int copy_pin_lifetime = -1;
+
+    // Query for the file state in DB
+    sql << "SELECT bring_online, copy_pin_lifetime FROM t_job WHERE job_id = :jobId",
+            soci::use(jobId),
+            soci::into(bring_online),
+            soci::into(copy_pin_lifetime);
+
+    std::string newState;
+    long long updated = 0;
+
+    // Staging exception: if file failed with timeout and was staged before, reset it
+    if ((bring_online > 0 || copy_pin_lifetime > 0) && (errcode == ETIMEDOUT))
+    {
+        soci::statement stmt = (sql.prepare <<
+               "UPDATE t_file SET "
+               "    retry = :retryNo, current_failures = 0, file_state = 'STAGING', "
+               "    filesize = 0, internal_file_params = NULL, transfer_host = NULL, pid = NULL, "
+               "    start_time = NULL, staging_start = NULL, staging_finished = NULL "
+               "WHERE file_id = :fileId AND job_id = :jobId AND "
+               "      file_state NOT IN ('FINISHED', 'STAGING', 'SUBMITTED', 'FAILED', 'CANCELED')",
+                soci::use(retryNo),
+                soci::use(fileId),
+                soci::use(jobId));
+        stmt.execute(true);
+        updated = stmt.get_affected_rows();
+        newState = "STAGING";
+    }
+    else
+    {
+        soci::statement stmt = (sql.prepare <<
+               "UPDATE t_file SET "
+               "    retry = :retryNo, retry_timestamp = :tTime, file_state = 'SUBMITTED', "
+               "    throughput = 0, current_failures = 1, start_time = NULL, "
+               "    transfer_host = NULL, log_file = NULL, log_file_debug = NULL "
+               "WHERE file_id = :fileId AND job_id = :jobId AND "
+               "      file_state NOT IN ('FINISHED', 'SUBMITTED', 'FAILED', 'CANCELED')",
+                soci::use(retryNo),
+                soci::use(tTime),
+                soci::use(fileId),
+                soci::use(jobId));
+        stmt.execute(true);
+        updated = stmt.get_affected_rows();
+        newState = "SUBMITTED";
+    }
+
+    // Keep transfer retry log
+    const std::string utc_timestamp = sql.get_backend_name() == "mysql" ? "UTC_TIMESTAMP()" : "NOW() AT TIME ZONE 'UTC'";
+    sql <<
+        "INSERT IGNORE INTO t_file_retry_errors "
+        "       (file_id, attempt, datetime, reason, transfer_host, log_file) "
+        "VALUES (:fileId, :retryNo, " << utc_timestamp << ", :reason, :hostname, :logFile)",
+        soci::use(fileId),
+        soci::use(retryNo),
+        soci::use(reason),
+        soci::use(hostname),
+        soci::use(logFile);
+
+    return updated > 0 ? newState : std::string();
+}
+
+
 void MySqlAPI::updateHeartBeat(unsigned* index, unsigned* count, unsigned* start, unsigned* end, std::string service_name)
 {
     soci::session sql(*connectionPool);
@@ -4643,6 +5191,53 @@ void MySqlAPI::recoverSelectedTransfers()
 }
 
 
+void MySqlAPI::recoverSelectedTransfers(const std::vector<uint64_t>& fileIds)
+{
+    if (fileIds.empty()) {
+        return;
+    }
+
+    // Sorted, so the rows are locked in the same order as the other bulk updates
+    std::set<uint64_t> sortedIds(fileIds.begin(), fileIds.end());
+    std::ostringstream fileIdsStr;
+    for (auto i = sortedIds.begin(); i != sortedIds.end(); ++i) {
+        if (i != sortedIds.begin()) {
+            fileIdsStr << ", ";
+        }
+        fileIdsStr << *i;
+    }
+
+    soci::session sql(*connectionPool);
+
+    try
+    {
+        sql.begin();
+
+        soci::statement stmt = (sql.prepare <<
+            "UPDATE t_file SET "
+            "   file_state = 'SUBMITTED', transfer_host = NULL, start_time = NULL "
+            "WHERE file_id IN (" << fileIdsStr.str() << ") "
+            "   AND file_state = 'SELECTED' AND transfer_host = :hostname",
+            soci::use(hostname));
+        stmt.execute(true);
+
+        sql.commit();
+
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << std::string(__func__) << ": Put " << stmt.get_affected_rows()
+            << " out of " << sortedIds.size() << " claimed transfers back in the queue" << commit;
+    }
+    catch (std::exception& e)
+    {
+        sql.rollback();
+        throw UserError(std::string(__func__) + ": Caught exception " + e.what());
+    }
+    catch (...)
+    {
+        sql.rollback();
+        throw UserError(std::string(__func__) + ": Caught exception");
+    }
+}
+
 // the class factories
 extern "C" GenericDbIfce* create()
 {
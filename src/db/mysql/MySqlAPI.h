@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include <mutex>
 #include <soci/soci.h>
+#include "db/generic/ActivityShareTable.h"
 #include "db/generic/GenericDbIfce.h"
 #include "db/generic/StoragePairState.h"
 #include "msg-bus/consumer.h"
@@ -65,6 +67,13 @@ public:
     virtual void getReadyTransfers(const std::vector<QueueId>& queues,
         std::map< std::string, std::list<TransferFile>>& files);
 
+    /// Claim a bounded batch of transfers ready to go for the given queues
+    /// @param queues       Queues for which to check (see getQueuesWithPending)
+    /// @param maxFiles     Maximum number of transfers to claim
+    /// @param[out] files   A map where the key is the VO. The value is a list of transfers belonging to that VO
+    virtual void claimReadyTransfers(const std::vector<QueueId>& queues, int maxFiles,
+        std::map< std::string, std::list<TransferFile>>& files);
+
     /// Update the status of a transfer
     /// @param jobId            The job ID
     /// @param fileId           The file ID
@@ -90,6 +99,10 @@ public:
     /// @param jobState         The job state
     virtual bool updateJobStatus(const std::string& jobId, const std::string& jobState);
 
+    /// Apply a set of status messages, one transaction for all the file changes
+    virtual std::vector<TransferStatusUpdate> updateTransferStatusBatch(
+        const std::vector<fts3::events::Message>& messages);
+
     /// Get the token associated with the given token ID
     /// @param tokenId          The token ID
     /// @return                 The <token, unmanaged flag> pair for the token ID, if any
@@ -157,6 +170,8 @@ public:
     /// Get the list of VO share configurations for the given link
     virtual std::vector<ShareConfig> getShareConfig(const std::string &source, const std::string &destination);
 
+    virtual std::vector<ShareConfig> getShareConfig();
+
     /// Returns how many retries there is configured for the given jobId
     virtual int getRetry(const std::string & jobId);
 
@@ -210,7 +225,7 @@ public:
     virtual long updateFileStatusReuse(const TransferFile &file, const std::string &status);
 
     /// Puts into requestIDs, jobs that have been cancelled, and for which the running fts_url_copy must be killed
-    virtual void getCancelJob(std::vector<int>& requestIDs);
+    virtual void getCancelJob(std::vector<std::pair<int, uint64_t>>& requestIDs);
 
     /// Returns list of transfers that need to be force started
     virtual std::list<TransferFile> getForceStartTransfers();
@@ -436,6 +451,9 @@ public:
     /// Put all the transfers assigned to this host that are in the SELECTED state back in the queue
     virtual void recoverSelectedTransfers();
 
+    /// Put the given transfers back in the queue, if they are still SELECTED and assigned to this host
+    virtual void recoverSelectedTransfers(const std::vector<uint64_t>& fileIds);
+
 private:
     size_t                poolSize;
     soci::connection_pool* connectionPool;
@@ -444,17 +462,35 @@ private:
     std::map<std::string, boost::posix_time::ptime> queuedStagingFiles;
     std::string m_dbtype;
 
+    std::mutex activityShareMutex;
+    std::map<std::string, ActivityShareTable> activityShareCache;
+    /// Activity share configurations that failed to parse, so they are reported once
+    std::map<std::string, std::string> activityShareInvalid;
+
     void updateHeartBeatInternal(soci::session& sql, unsigned* index, unsigned* count, unsigned* start, unsigned* end,
                                  const std::string& serviceName);
 
-    std::map<std::string, int> getFilesNumPerActivity(soci::session& sql,
-        std::string src, std::string dst, std::string vo, int filesNum,
+    /// Files queued per activity, indexed by (source, destination)
+    typedef std::map<std::pair<std::string, std::string>, std::map<std::string, long long>> ActivitiesPerQueue;
+
+    std::map<std::string, int> getFilesNumPerActivity(const ActivityShareTable &activityShares,
+        const std::map<std::string, long long> &activitiesInQueue, int filesNum,
         std::set<std::string> & defaultActivities);
 
-    std::map<std::string, long long> getActivitiesInQueue(soci::session& sql, std::string src,
-        std::string dst, std::string vo);
+    /// Pick the transfers ready to go for the given queues
+    /// @param claimMax Negative to only read them. Otherwise, claim at most this many
+    ///                 (see claimReadyTransfers)
+    void getReadyTransfersInternal(const std::vector<QueueId>& queues, int claimMax,
+        std::map<std::string, std::list<TransferFile>>& files);
+
+    /// Count the queued files per activity of all the queues of a VO in one go
+    /// @param segment  Hash slice the files are picked from (all of them when claiming)
+    ActivitiesPerQueue getActivitiesInQueues(soci::session& sql, const std::string &vo,
+        const HashSegment &segment);
 
-    std::map<std::string, double> getActivityShareConf(soci::session& sql, std::string vo);
+    /// Activity shares of all the VOs with an active configuration.
+    /// A VO configuration is parsed again only when it changed since the previous call.
+    std::map<std::string, ActivityShareTable> getActivityShareTables(soci::session& sql);
 
     void updateArchivingStateInternal(soci::session& sql, const std::vector<MinFileStatus> &archivingOpsStatus);
 
@@ -474,6 +510,15 @@ private:
 
     std::vector<TransferState> getStateOfTransferInternal(soci::session& sql, const std::string& jobId, uint64_t fileId);
 
+    std::map<uint64_t, std::vector<TransferState>> getStateOfTransfersInternal(soci::session& sql,
+        const std::set<uint64_t>& fileIds);
+
+    int getRetryInternal(soci::session& sql, const std::string & jobId);
+
+    /// @return The state the file was moved to (SUBMITTED or STAGING), empty if the file was not in a retriable state
+    std::string setRetryTransferInternal(soci::session& sql, const std::string& jobId, uint64_t fileId, int retryNo,
+                                         const std::string& reason, const std::string& logFile, int errcode);
+
     void useFileReplica(soci::session& sql, std::string jobId, uint64_t fileId, std::string destSurlUuid, soci::indicator destSurlUuidInd);
 
     uint64_t getNextHop(soci::session& sql, const std::string& jobId);
@@ -497,6 +542,8 @@ private:
     void recoverFromDeadHosts(soci::session &sql);
     void recoverStalledStaging(soci::session &sql);
     void recoverStalledArchiving(soci::session &sql);
+    void fixPairCounters(soci::session &sql);
+    void fixJobCounters(soci::session &sql);
 
     void fixEmptyJob(soci::session &sql, const std::string &jobId);
     void fixNonTerminalJob(soci::session &sql, const std::string &jobId,
@@ -21,6 +21,7 @@
 #include <numeric>
 #include "MySqlAPI.h"
 #include "db/generic/DbUtils.h"
+#include "db/generic/ThroughputStats.h"
 #include "common/Exceptions.h"
 #include "common/Logger.h"
 #include "sociConversions.h"
@@ -127,14 +128,15 @@ std::list<Pair> MySqlAPI::getActivePairs()
 
         std::list<Pair> result;
 
-        const std::string order_by_null = sql.get_backend_name() == "mysql" ? " ORDER BY null" : "";
-        soci::rowset<soci::row> rs = (sql.prepare <<
+        const std::string query = sql.get_backend_name() == "mysql" ?
+                "SELECT DISTINCT source_se, dest_se "
+                "FROM t_pair_counters "
+                "WHERE file_state IN ('ACTIVE', 'SUBMITTED') AND count > 0" :
                 "SELECT DISTINCT source_se, dest_se "
                 "FROM t_file "
                 "WHERE file_state IN ('ACTIVE', 'SUBMITTED') "
-                "GROUP BY source_se, dest_se, file_state " <<
-                order_by_null
-                );
+                "GROUP BY source_se, dest_se, file_state ";
+        soci::rowset<soci::row> rs = (sql.prepare << query);
 
         for (auto i = rs.begin(); i != rs.end(); ++i) {
             result.push_back(Pair(i->get<std::string>("source_se"), i->get<std::string>("dest_se")));
@@ -256,106 +258,91 @@ int MySqlAPI::getOptimizerValue(const Pair &pair)
     }
 }
 
+// Aggregate of the transfers matching condition: bytes transferred within the window,
+// and count, average and population variance of the file sizes.
+// The bytes within the window are weighted as the transfers were progressing at a constant rate.
+static std::string throughputAggregate(const std::string &backend, const std::string &condition)
+{
+    std::string end, duration, period, div;
+    if (backend == "mysql") {
+        end = "COALESCE(finish_time, CAST(:now AS DATETIME))";
+        duration = "TIMESTAMPDIFF(SECOND, start_time, " + end + ")";
+        period = "TIMESTAMPDIFF(SECOND, GREATEST(start_time, CAST(:windowStart AS DATETIME)), " + end + ")";
+        div = " DIV ";
+    }
+    else {
+        // The timestamps keep the microseconds, while the CAST rounds: truncate them first to the
+        // second, so the differences are the same as those of the whole seconds MySQL stores
+        const std::string start = "DATE_TRUNC('second', start_time)";
+        end = "COALESCE(DATE_TRUNC('second', finish_time), CAST(:now AS TIMESTAMP))";
+        duration = "CAST(EXTRACT(EPOCH FROM (" + end + " - " + start + ")) AS BIGINT)";
+        period = "CAST(EXTRACT(EPOCH FROM (" + end + " - GREATEST(" + start + ", CAST(:windowStart AS TIMESTAMP)))) AS BIGINT)";
+        div = " / ";
+    }
+
+    return
+        "SELECT "
+        "   COALESCE(SUM("
+        "       CASE"
+        "           WHEN finish_time IS NULL AND " + duration + " > 0 THEN"
+        "               (COALESCE(transferred, 0)" + div + duration + ") * " + period +
+        "           WHEN finish_time IS NULL THEN 0"
+        "           WHEN " + duration + " <= 0 THEN COALESCE(filesize, 0)"
+        "           WHEN filesize > 0 THEN (filesize" + div + duration + ") * " + period +
+        "           ELSE 0"
+        "       END), 0) AS bytes_in_window,"
+        "   COUNT(CASE WHEN filesize > 0 THEN filesize END) AS filesize_count,"
+        "   COALESCE(AVG(CASE WHEN filesize > 0 THEN filesize END), 0) AS filesize_avg,"
+        "   COALESCE(VAR_POP(CASE WHEN filesize > 0 THEN filesize END), 0) AS filesize_var "
+        "FROM t_file "
+        "WHERE " + condition;
+}
+
 void MySqlAPI::getThroughputInfo(const Pair &pair, const boost::posix_time::time_duration &interval,
                                 double *throughput, double *filesizeAvg, double *filesizeStdDev)
 {
     try {
         soci::session sql(*connectionPool);
 
-        static struct tm nulltm = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-
         *throughput = *filesizeAvg = *filesizeStdDev = 0;
 
         time_t now = time(NULL);
         time_t windowStart = now - interval.total_seconds();
 
-        const std::string qry = sql.get_backend_name() == "mysql" ?
-                "SELECT start_time, finish_time, transferred, filesize "
-                " FROM t_file "
-                " WHERE "
-                "   source_se = :sourceSe AND dest_se = :destSe AND file_state = 'ACTIVE' "
-                "UNION ALL "
-                "SELECT start_time, finish_time, transferred, filesize "
-                " FROM t_file "
-                " WHERE "
-                "   source_se = :sourceSe AND dest_se = :destSe "
-                "   AND file_state IN ('FINISHED', 'ARCHIVING')"
-                "   AND finish_time >= (UTC_TIMESTAMP() - INTERVAL :interval SECOND)"
-            :
-                "SELECT start_time, finish_time, transferred, filesize "
-                " FROM t_file "
-                " WHERE "
-                "   source_se = :sourceSe AND dest_se = :destSe AND file_state = 'ACTIVE' "
-                "UNION ALL "
-                "SELECT start_time, finish_time, transferred, filesize "
-                " FROM t_file"
-                " WHERE "
-                "   source_se = :sourceSe AND dest_se = :destSe "
+        struct tm nowTm, windowStartTm;
+        gmtime_r(&now, &nowTm);
+        gmtime_r(&windowStart, &windowStartTm);
+
+        // Aggregate the active and the recently finished transfers separately, so each part
+        // can use the indexes, and merge both in a single row. Only two rows of partial
+        // statistics are sent back, instead of every transfer of the pair.
+        const std::string backend = sql.get_backend_name();
+        const std::string qry =
+            "SELECT a.bytes_in_window, a.filesize_count, a.filesize_avg, a.filesize_var,"
+            "   f.bytes_in_window, f.filesize_count, f.filesize_avg, f.filesize_var "
+            "FROM (" + throughputAggregate(backend,
+                "source_se = :sourceSe AND dest_se = :destSe AND file_state = 'ACTIVE'") + ") a, "
+            "(" + throughputAggregate(backend,
+                "source_se = :sourceSe AND dest_se = :destSe"
                 "   AND file_state IN ('FINISHED', 'ARCHIVING')"
-                "   AND finish_time >= (NOW() AT TIME ZONE 'UTC' - MAKE_INTERVAL(SECS => :interval))";
-        soci::rowset<soci::row> transfers = (
-            sql.prepare << qry,
-            soci::use(pair.source, "sourceSe"), soci::use(pair.destination, "destSe"),
-            soci::use(interval.total_seconds(), "interval")
-        );
-
-        double totalBytes = 0;
-        std::vector<int64_t> filesizes;
-
-        for (auto j = transfers.begin(); j != transfers.end(); ++j) {
-            auto transferred = j->get<long long>("transferred", 0.0);
-            auto filesize = j->get<long long>("filesize", 0.0);
-            auto starttm = j->get<struct tm>("start_time");
-            auto endtm = j->get<struct tm>("finish_time", nulltm);
-
-            time_t start = timegm(&starttm);
-            time_t end = timegm(&endtm);
-            time_t periodInWindow = 0;
-            double bytesInWindow = 0;
-
-            // Note: the calculations here disregard the variable types and
-            //       resort to using double in most places
-
-            // Not finish information
-            if (endtm.tm_year <= 0) {
-                periodInWindow = now - std::max(start, windowStart);
-                long duration = now - start;
-                if (duration > 0) {
-                    bytesInWindow = double(transferred / duration) * (double) periodInWindow;
-                }
-            }
-                // Finished
-            else {
-                periodInWindow = end - std::max(start, windowStart);
-                long duration = end - start;
-                if (duration > 0 && filesize > 0) {
-                    bytesInWindow = double(filesize / duration) * (double) periodInWindow;
-                } else if (duration <= 0) {
-                    bytesInWindow = (double) filesize;
-                }
-            }
+                "   AND finish_time >= :windowStart") + ") f";
 
-            totalBytes += bytesInWindow;
-            if (filesize > 0) {
-                filesizes.push_back(filesize);
-            }
-        }
+        double activeBytes = 0, activeAvg = 0, activeVariance = 0;
+        double finishedBytes = 0, finishedAvg = 0, finishedVariance = 0;
+        long long activeCount = 0, finishedCount = 0;
 
-        *throughput = totalBytes / static_cast<double>(interval.total_seconds());
-        // Statistics on the file size
-        if (!filesizes.empty()) {
-            for (auto &filesize: filesizes) {
-                *filesizeAvg += (double) filesize;
-            }
-            *filesizeAvg /= (double) filesizes.size();
+        sql << qry,
+            soci::use(pair.source, "sourceSe"), soci::use(pair.destination, "destSe"),
+            soci::use(nowTm, "now"), soci::use(windowStartTm, "windowStart"),
+            soci::into(activeBytes), soci::into(activeCount), soci::into(activeAvg), soci::into(activeVariance),
+            soci::into(finishedBytes), soci::into(finishedCount), soci::into(finishedAvg), soci::into(finishedVariance);
 
-            double deviations = 0.0;
-            for (auto &filesize: filesizes) {
-                deviations += pow(*filesizeAvg - (double) filesize, 2);
+        ThroughputStats stats(activeBytes, static_cast<uint64_t>(activeCount), activeAvg, activeVariance);
+        stats.merge(ThroughputStats(finishedBytes, static_cast<uint64_t>(finishedCount), finishedAvg, finishedVariance));
 
-            }
-            *filesizeStdDev = sqrt(deviations / (double) filesizes.size());
-        }
+        *throughput = stats.getThroughput(interval.total_seconds());
+        *filesizeAvg = stats.getFilesizeAvg();
+        *filesizeStdDev = stats.getFilesizeStdDev();
     }
     catch (std::exception &e) {
         throw UserError(std::string(__func__) + ": Caught mode exception " + e.what());
@@ -497,6 +484,16 @@ int MySqlAPI::getCountInState(const Pair &pair, const std::string &state)
 
         int count = 0;
 
+        // Terminal states are not tracked by t_pair_counters, and SELECTED is counted as SUBMITTED
+        if (sql.get_backend_name() == "mysql" &&
+            state != "FINISHED" && state != "FAILED" && state != "CANCELED") {
+            soci::indicator isNull = soci::i_ok;
+            sql << "SELECT SUM(count) FROM t_pair_counters "
+                   "WHERE source_se = :source AND dest_se = :dest_se AND file_state = :state",
+                    soci::use(pair.source), soci::use(pair.destination), soci::use(state), soci::into(count, isNull);
+            return isNull == soci::i_null ? 0 : count;
+        }
+
         sql << "SELECT count(*) FROM t_file "
                "WHERE source_se = :source AND dest_se = :dest_se AND file_state = :state",
                 soci::use(pair.source), soci::use(pair.destination), soci::use(state), soci::into(count);
@@ -18,6 +18,11 @@
  * limitations under the License.
  */
 
+#include <array>
+#include <map>
+#include <tuple>
+#include <vector>
+
 #include "MySqlAPI.h"
 #include "common/Exceptions.h"
 #include "common/Logger.h"
@@ -413,6 +418,187 @@ void MySqlAPI::recoverStalledArchiving(soci::session &sql)
 }
 
 
+/// Repair the drift between t_pair_counters and the actual content of t_file.
+/// Only the entries found inconsistent are recomputed, each in its own transaction
+/// holding the lock on the counter, so concurrent triggers can not be lost.
+/// As in the triggers, SELECTED transfers are counted as SUBMITTED.
+void MySqlAPI::fixPairCounters(soci::session &sql)
+{
+    if (sql.get_backend_name() != "mysql") {
+        return;
+    }
+
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Sanity check pair counters" << commit;
+
+    typedef std::tuple<std::string, std::string, std::string, std::string> CounterKey;
+    std::map<CounterKey, long long> expected, current;
+
+    soci::rowset<soci::row> actual = (sql.prepare <<
+        "SELECT IFNULL(source_se, '') AS source_se, IFNULL(dest_se, '') AS dest_se, "
+        "       IFNULL(vo_name, '') AS vo_name, "
+        "       IF(file_state = 'SELECTED', 'SUBMITTED', file_state) AS file_state, COUNT(*) AS cnt "
+        "FROM t_file "
+        "WHERE file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') "
+        "GROUP BY IFNULL(source_se, ''), IFNULL(dest_se, ''), IFNULL(vo_name, ''), "
+        "         IF(file_state = 'SELECTED', 'SUBMITTED', file_state) "
+        "ORDER BY null");
+    for (auto i = actual.begin(); i != actual.end(); ++i) {
+        expected[std::make_tuple(i->get<std::string>("source_se"), i->get<std::string>("dest_se"),
+            i->get<std::string>("vo_name"), i->get<std::string>("file_state"))] = i->get<long long>("cnt");
+    }
+
+    soci::rowset<soci::row> counters = (sql.prepare <<
+        "SELECT source_se, dest_se, vo_name, file_state, count FROM t_pair_counters");
+    for (auto i = counters.begin(); i != counters.end(); ++i) {
+        current[std::make_tuple(i->get<std::string>("source_se"), i->get<std::string>("dest_se"),
+            i->get<std::string>("vo_name"), i->get<std::string>("file_state"))] = i->get<long long>("count");
+    }
+
+    std::vector<CounterKey> suspicious;
+    for (auto i = expected.begin(); i != expected.end(); ++i) {
+        auto c = current.find(i->first);
+        if (c == current.end() || c->second != i->second) {
+            suspicious.push_back(i->first);
+        }
+    }
+    for (auto i = current.begin(); i != current.end(); ++i) {
+        if (i->second != 0 && expected.find(i->first) == expected.end()) {
+            suspicious.push_back(i->first);
+        }
+    }
+
+    for (auto i = suspicious.begin(); i != suspicious.end(); ++i) {
+        std::string sourceSe, destSe, voName, state;
+        std::tie(sourceSe, destSe, voName, state) = *i;
+
+        // Empty keys account for NULL columns as well
+        const std::string sourceCol = sourceSe.empty() ? "IFNULL(source_se, '')" : "source_se";
+        const std::string destCol = destSe.empty() ? "IFNULL(dest_se, '')" : "dest_se";
+        const std::string voCol = voName.empty() ? "IFNULL(vo_name, '')" : "vo_name";
+
+        const std::string counted = (state == "SUBMITTED") ? "SELECTED" : state;
+
+        long long stored = 0, count = 0;
+        soci::indicator storedNull = soci::i_ok;
+
+        sql.begin();
+        // Triggers modifying this counter wait for the lock, and their t_file changes
+        // are not yet visible to the count below
+        sql << "SELECT count FROM t_pair_counters "
+               "WHERE source_se = :source AND dest_se = :dest AND vo_name = :vo AND file_state = :state "
+               "FOR UPDATE",
+            soci::use(sourceSe), soci::use(destSe), soci::use(voName), soci::use(state),
+            soci::into(stored, storedNull);
+        if (!sql.got_data() || storedNull == soci::i_null) {
+            stored = 0;
+        }
+
+        sql << "SELECT COUNT(*) FROM t_file "
+               "WHERE " << sourceCol << " = :source AND " << destCol << " = :dest AND "
+               << voCol << " = :vo AND file_state IN (:state, :counted)",
+            soci::use(sourceSe), soci::use(destSe), soci::use(voName), soci::use(state), soci::use(counted),
+            soci::into(count);
+
+        if (stored != count) {
+            sql << "INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count) "
+                   "VALUES (:source, :dest, :vo, :state, :count) "
+                   "ON DUPLICATE KEY UPDATE count = VALUES(count)",
+                soci::use(sourceSe), soci::use(destSe), soci::use(voName), soci::use(state), soci::use(count);
+            FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Fixed pair counter "
+                << sourceSe << " => " << destSe << " " << voName << " " << state
+                << ": " << stored << " -> " << count << commit;
+        }
+        sql.commit();
+    }
+
+    sql << "DELETE FROM t_pair_counters WHERE count = 0";
+}
+
+
+/// Repair the drift between t_job_counters and the files of the jobs still running.
+/// As for the pair counters, each inconsistent job is recomputed in its own transaction
+/// holding the lock on its counters.
+void MySqlAPI::fixJobCounters(soci::session &sql)
+{
+    if (sql.get_backend_name() != "mysql") {
+        return;
+    }
+
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Sanity check job counters" << commit;
+
+    // total, canceled, failed, finished, staging, archiving
+    typedef std::array<long long, 6> JobCounters;
+    std::map<std::string, JobCounters> expected, current;
+
+    static const std::string countColumns =
+        "COUNT(*) AS total, "
+        "CAST(COALESCE(SUM(f.file_state = 'CANCELED'), 0) AS SIGNED) AS canceled, "
+        "CAST(COALESCE(SUM(f.file_state = 'FAILED'), 0) AS SIGNED) AS failed, "
+        "CAST(COALESCE(SUM(f.file_state = 'FINISHED'), 0) AS SIGNED) AS finished, "
+        "CAST(COALESCE(SUM(f.file_state IN ('STAGING', 'STARTED')), 0) AS SIGNED) AS staging, "
+        "CAST(COALESCE(SUM(f.file_state = 'ARCHIVING'), 0) AS SIGNED) AS archiving ";
+
+    auto getCounters = [](const soci::row &row) {
+        return JobCounters{row.get<long long>("total"), row.get<long long>("canceled"),
+            row.get<long long>("failed"), row.get<long long>("finished"),
+            row.get<long long>("staging"), row.get<long long>("archiving")};
+    };
+
+    soci::rowset<soci::row> actual = (sql.prepare <<
+        "SELECT f.job_id, " << countColumns <<
+        "FROM t_file f "
+        "JOIN t_job j ON j.job_id = f.job_id "
+        "WHERE j.job_finished IS NULL "
+        "GROUP BY f.job_id");
+    for (auto i = actual.begin(); i != actual.end(); ++i) {
+        expected[i->get<std::string>("job_id")] = getCounters(*i);
+    }
+
+    soci::rowset<soci::row> counters = (sql.prepare <<
+        "SELECT c.job_id, c.total, c.canceled, c.failed, c.finished, c.staging, c.archiving "
+        "FROM t_job_counters c "
+        "JOIN t_job j ON j.job_id = c.job_id "
+        "WHERE j.job_finished IS NULL");
+    for (auto i = counters.begin(); i != counters.end(); ++i) {
+        current[i->get<std::string>("job_id")] = getCounters(*i);
+    }
+
+    std::vector<std::string> suspicious;
+    for (auto i = expected.begin(); i != expected.end(); ++i) {
+        auto c = current.find(i->first);
+        if (c == current.end() || c->second != i->second) {
+            suspicious.push_back(i->first);
+        }
+    }
+
+    for (auto i = suspicious.begin(); i != suspicious.end(); ++i) {
+        const std::string &jobId = *i;
+        long long stored = 0;
+
+        sql.begin();
+        // Triggers modifying these counters wait for the lock
+        sql << "SELECT total FROM t_job_counters WHERE job_id = :jobId FOR UPDATE",
+            soci::use(jobId), soci::into(stored);
+
+        soci::rowset<soci::row> recount = (sql.prepare <<
+            "SELECT " << countColumns << "FROM t_file f WHERE f.job_id = :jobId", soci::use(jobId));
+        const JobCounters count = getCounters(*recount.begin());
+
+        sql << "INSERT INTO t_job_counters (job_id, total, canceled, failed, finished, staging, archiving) "
+               "VALUES (:jobId, :total, :canceled, :failed, :finished, :staging, :archiving) "
+               "ON DUPLICATE KEY UPDATE "
+               "   total = VALUES(total), canceled = VALUES(canceled), failed = VALUES(failed), "
+               "   finished = VALUES(finished), staging = VALUES(staging), archiving = VALUES(archiving)",
+            soci::use(jobId), soci::use(count[0]), soci::use(count[1]), soci::use(count[2]),
+            soci::use(count[3]), soci::use(count[4]), soci::use(count[5]);
+        sql.commit();
+
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Fixed job counters " << jobId
+            << ": total " << stored << " -> " << count[0] << commit;
+    }
+}
+
+
 void MySqlAPI::checkSanityState()
 {
     if (hashSegment.start != 0) {
@@ -428,6 +614,8 @@ void MySqlAPI::checkSanityState()
         recoverFromDeadHosts(sql);
         recoverStalledStaging(sql);
         recoverStalledArchiving(sql);
+        fixPairCounters(sql);
+        fixJobCounters(sql);
     }
     catch (std::exception &e) {
         sql.rollback();
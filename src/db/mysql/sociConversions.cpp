@@ -58,3 +58,17 @@ unsigned long long get_file_id_from_values(const soci::values &values)
         );
     }
 }
+
+int get_int_from_values(const soci::values &values, const std::string &name)
+{
+    switch (values.get_properties(name).get_data_type()) {
+        case soci::dt_integer:
+            return values.get<int>(name, 0);
+        case soci::dt_long_long:
+            return static_cast<int>(values.get<long long>(name, 0));
+        case soci::dt_unsigned_long_long:
+            return static_cast<int>(values.get<unsigned long long>(name, 0));
+        default:
+            throw std::runtime_error("Invalid " + name + " value: Value has an unknown type");
+    }
+}
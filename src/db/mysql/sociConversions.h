@@ -44,6 +44,9 @@ unsigned long long get_file_id_from_row(const soci::row &row);
 
 unsigned long long get_file_id_from_values(const soci::values &values);
 
+/// Integer column whose type depends on the backend (i.e. computed columns)
+int get_int_from_values(const soci::values &values, const std::string &name);
+
 namespace soci
 {
 
@@ -204,6 +207,15 @@ struct type_conversion<TransferFile>
             // optional
         }
 
+        try {
+            // Only computed by getReadyTransfers
+            file.lastReplica = get_int_from_values(v, "last_replica");
+            file.lastHop = get_int_from_values(v, "last_hop");
+        }
+        catch (...) {
+            // optional
+        }
+
         // filesize and reason are NOT queried by any method that uses this
         // type
         file.filesize = 0;
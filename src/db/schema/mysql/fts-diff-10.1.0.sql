@@ -0,0 +1,81 @@
+--
+-- FTS3 Schema 10.1.0
+-- Per pair/VO/state counters of the non-terminal transfers, kept up to date by triggers on t_file.
+-- The scheduler and the optimizer read these instead of counting over t_file.
+-- Terminal states are not counted.
+--
+
+CREATE TABLE `t_pair_counters` (
+  `source_se` varchar(255) NOT NULL,
+  `dest_se` varchar(255) NOT NULL,
+  `vo_name` varchar(50) NOT NULL,
+  `file_state` varchar(32) NOT NULL,
+  `count` bigint NOT NULL DEFAULT '0',
+  PRIMARY KEY (`source_se`,`dest_se`,`vo_name`,`file_state`),
+  KEY `idx_state` (`file_state`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+
+DELIMITER ;;
+CREATE TRIGGER `trg_pair_counters_insert` AFTER INSERT ON `t_file`
+FOR EACH ROW
+BEGIN
+  IF NEW.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+    INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+    VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), NEW.file_state, 1)
+    ON DUPLICATE KEY UPDATE count = count + 1;
+  END IF;
+END ;;
+
+CREATE TRIGGER `trg_pair_counters_update` AFTER UPDATE ON `t_file`
+FOR EACH ROW
+BEGIN
+  IF NOT (NEW.file_state <=> OLD.file_state AND NEW.source_se <=> OLD.source_se
+          AND NEW.dest_se <=> OLD.dest_se AND NEW.vo_name <=> OLD.vo_name) THEN
+    -- Touch the two counters in primary key order, as the multi-row transactions lock them
+    IF (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), CAST(NEW.file_state AS CHAR))
+       < (IFNULL(OLD.source_se, ''), IFNULL(OLD.dest_se, ''), IFNULL(OLD.vo_name, ''), CAST(OLD.file_state AS CHAR)) THEN
+      IF NEW.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+        VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), NEW.file_state, 1)
+        ON DUPLICATE KEY UPDATE count = count + 1;
+      END IF;
+      IF OLD.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+        WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+          AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = OLD.file_state;
+      END IF;
+    ELSE
+      IF OLD.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+        WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+          AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = OLD.file_state;
+      END IF;
+      IF NEW.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+        VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), NEW.file_state, 1)
+        ON DUPLICATE KEY UPDATE count = count + 1;
+      END IF;
+    END IF;
+  END IF;
+END ;;
+
+CREATE TRIGGER `trg_pair_counters_delete` AFTER DELETE ON `t_file`
+FOR EACH ROW
+BEGIN
+  IF OLD.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+    UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+    WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+      AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = OLD.file_state;
+  END IF;
+END ;;
+DELIMITER ;
+
+-- Initial population. Any drift caused by concurrent writers is repaired by the sanity checks
+INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+SELECT IFNULL(source_se, ''), IFNULL(dest_se, ''), IFNULL(vo_name, ''), file_state, COUNT(*)
+FROM t_file
+WHERE file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED')
+GROUP BY IFNULL(source_se, ''), IFNULL(dest_se, ''), IFNULL(vo_name, ''), file_state;
+
+INSERT INTO t_schema_vers (major, minor, patch, message)
+VALUES (10, 1, 0, 'Per pair state counters');
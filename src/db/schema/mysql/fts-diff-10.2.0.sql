@@ -0,0 +1,85 @@
+--
+-- FTS3 Schema 10.2.0
+-- Per job counters of the files by state, kept up to date by triggers on t_file.
+-- The job state is resolved from a single row instead of counting all the files of the job.
+-- STAGING and STARTED are counted together, as the job state resolution does.
+--
+
+CREATE TABLE `t_job_counters` (
+  `job_id` char(36) NOT NULL,
+  `total` bigint NOT NULL DEFAULT '0',
+  `canceled` bigint NOT NULL DEFAULT '0',
+  `failed` bigint NOT NULL DEFAULT '0',
+  `finished` bigint NOT NULL DEFAULT '0',
+  `staging` bigint NOT NULL DEFAULT '0',
+  `archiving` bigint NOT NULL DEFAULT '0',
+  PRIMARY KEY (`job_id`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+
+DELIMITER ;;
+CREATE TRIGGER `trg_job_counters_insert` AFTER INSERT ON `t_file`
+FOR EACH ROW
+BEGIN
+  INSERT INTO t_job_counters (job_id, total, canceled, failed, finished, staging, archiving)
+  VALUES (NEW.job_id, 1, NEW.file_state = 'CANCELED', NEW.file_state = 'FAILED', NEW.file_state = 'FINISHED',
+          NEW.file_state IN ('STAGING', 'STARTED'), NEW.file_state = 'ARCHIVING')
+  ON DUPLICATE KEY UPDATE
+    total = total + 1,
+    canceled = canceled + (NEW.file_state = 'CANCELED'),
+    failed = failed + (NEW.file_state = 'FAILED'),
+    finished = finished + (NEW.file_state = 'FINISHED'),
+    staging = staging + (NEW.file_state IN ('STAGING', 'STARTED')),
+    archiving = archiving + (NEW.file_state = 'ARCHIVING');
+END ;;
+
+CREATE TRIGGER `trg_job_counters_update` AFTER UPDATE ON `t_file`
+FOR EACH ROW
+BEGIN
+  -- Transitions between states not counted leave the row of the job alone,
+  -- so the transfers of a job can be claimed and started without queueing on it
+  IF NOT (NEW.file_state <=> OLD.file_state) AND
+     (NEW.file_state IN ('CANCELED', 'FAILED', 'FINISHED', 'STAGING', 'STARTED', 'ARCHIVING') OR
+      OLD.file_state IN ('CANCELED', 'FAILED', 'FINISHED', 'STAGING', 'STARTED', 'ARCHIVING')) THEN
+    UPDATE t_job_counters SET
+      canceled = canceled + (NEW.file_state = 'CANCELED') - (OLD.file_state = 'CANCELED'),
+      failed = failed + (NEW.file_state = 'FAILED') - (OLD.file_state = 'FAILED'),
+      finished = finished + (NEW.file_state = 'FINISHED') - (OLD.file_state = 'FINISHED'),
+      staging = staging + (NEW.file_state IN ('STAGING', 'STARTED')) - (OLD.file_state IN ('STAGING', 'STARTED')),
+      archiving = archiving + (NEW.file_state = 'ARCHIVING') - (OLD.file_state = 'ARCHIVING')
+    WHERE job_id = NEW.job_id;
+  END IF;
+END ;;
+
+CREATE TRIGGER `trg_job_counters_delete` AFTER DELETE ON `t_file`
+FOR EACH ROW
+BEGIN
+  UPDATE t_job_counters SET
+    total = total - 1,
+    canceled = canceled - (OLD.file_state = 'CANCELED'),
+    failed = failed - (OLD.file_state = 'FAILED'),
+    finished = finished - (OLD.file_state = 'FINISHED'),
+    staging = staging - (OLD.file_state IN ('STAGING', 'STARTED')),
+    archiving = archiving - (OLD.file_state = 'ARCHIVING')
+  WHERE job_id = OLD.job_id;
+END ;;
+
+CREATE TRIGGER `trg_job_counters_job_delete` AFTER DELETE ON `t_job`
+FOR EACH ROW
+BEGIN
+  DELETE FROM t_job_counters WHERE job_id = OLD.job_id;
+END ;;
+DELIMITER ;
+
+-- Initial population, only for the jobs still running. Any drift caused by concurrent writers
+-- is repaired by the sanity checks
+INSERT INTO t_job_counters (job_id, total, canceled, failed, finished, staging, archiving)
+SELECT f.job_id, COUNT(*),
+       SUM(f.file_state = 'CANCELED'), SUM(f.file_state = 'FAILED'), SUM(f.file_state = 'FINISHED'),
+       SUM(f.file_state IN ('STAGING', 'STARTED')), SUM(f.file_state = 'ARCHIVING')
+FROM t_file f
+JOIN t_job j ON j.job_id = f.job_id
+WHERE j.job_finished IS NULL
+GROUP BY f.job_id;
+
+INSERT INTO t_schema_vers (major, minor, patch, message)
+VALUES (10, 2, 0, 'Per job file counters');
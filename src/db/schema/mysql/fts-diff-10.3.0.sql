@@ -0,0 +1,84 @@
+--
+-- FTS3 Schema 10.3.0
+-- SELECTED file state, for the transfers claimed by a node (ClaimTransfers) and not started yet.
+-- The value is appended at the end of the enumeration, so the change does not rebuild t_file.
+--
+
+ALTER TABLE `t_file`
+    MODIFY COLUMN `file_state` enum('STAGING','ARCHIVING','QOS_TRANSITION','QOS_REQUEST_SUBMITTED','STARTED','SUBMITTED','READY','ACTIVE','FINISHED','FAILED','CANCELED','NOT_USED','ON_HOLD','ON_HOLD_STAGING','FORCE_START','TOKEN_PREP','SELECTED') NOT NULL;
+
+ALTER TABLE `t_file_backup`
+    MODIFY COLUMN `file_state` enum('STAGING','ARCHIVING','QOS_TRANSITION','QOS_REQUEST_SUBMITTED','STARTED','SUBMITTED','READY','ACTIVE','FINISHED','FAILED','CANCELED','NOT_USED','ON_HOLD','ON_HOLD_STAGING','FORCE_START','TOKEN_PREP','SELECTED') NOT NULL;
+
+-- Count SELECTED as SUBMITTED in t_pair_counters: claiming a transfer does not touch the counters,
+-- so the nodes claiming from the same link do not serialize on the same counter rows.
+-- There are no SELECTED transfers yet, so the counters stay consistent.
+-- They are recreated ahead of the job counter triggers, so a row update locks its pair counters
+-- before its job counters, in the same order as the status batches.
+DROP TRIGGER IF EXISTS `trg_pair_counters_insert`;
+DROP TRIGGER IF EXISTS `trg_pair_counters_update`;
+DROP TRIGGER IF EXISTS `trg_pair_counters_delete`;
+
+DELIMITER ;;
+CREATE TRIGGER `trg_pair_counters_insert` AFTER INSERT ON `t_file`
+FOR EACH ROW PRECEDES `trg_job_counters_insert`
+BEGIN
+  IF NEW.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+    INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+    VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''),
+            IF(NEW.file_state = 'SELECTED', 'SUBMITTED', NEW.file_state), 1)
+    ON DUPLICATE KEY UPDATE count = count + 1;
+  END IF;
+END ;;
+
+CREATE TRIGGER `trg_pair_counters_update` AFTER UPDATE ON `t_file`
+FOR EACH ROW PRECEDES `trg_job_counters_update`
+BEGIN
+  DECLARE old_state VARCHAR(32);
+  DECLARE new_state VARCHAR(32);
+  SET old_state = IF(OLD.file_state = 'SELECTED', 'SUBMITTED', OLD.file_state);
+  SET new_state = IF(NEW.file_state = 'SELECTED', 'SUBMITTED', NEW.file_state);
+  IF NOT (new_state <=> old_state AND NEW.source_se <=> OLD.source_se
+          AND NEW.dest_se <=> OLD.dest_se AND NEW.vo_name <=> OLD.vo_name) THEN
+    -- Touch the two counters in primary key order, as the multi-row transactions lock them
+    IF (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), new_state)
+       < (IFNULL(OLD.source_se, ''), IFNULL(OLD.dest_se, ''), IFNULL(OLD.vo_name, ''), old_state) THEN
+      IF new_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+        VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), new_state, 1)
+        ON DUPLICATE KEY UPDATE count = count + 1;
+      END IF;
+      IF old_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+        WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+          AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = old_state;
+      END IF;
+    ELSE
+      IF old_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+        WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+          AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = old_state;
+      END IF;
+      IF new_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+        VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), new_state, 1)
+        ON DUPLICATE KEY UPDATE count = count + 1;
+      END IF;
+    END IF;
+  END IF;
+END ;;
+
+CREATE TRIGGER `trg_pair_counters_delete` AFTER DELETE ON `t_file`
+FOR EACH ROW PRECEDES `trg_job_counters_delete`
+BEGIN
+  IF OLD.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+    UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+    WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+      AND vo_name = IFNULL(OLD.vo_name, '')
+      AND file_state = IF(OLD.file_state = 'SELECTED', 'SUBMITTED', OLD.file_state);
+  END IF;
+END ;;
+DELIMITER ;
+
+INSERT INTO t_schema_vers (major, minor, patch, message)
+VALUES (10, 3, 0, 'SELECTED file state');
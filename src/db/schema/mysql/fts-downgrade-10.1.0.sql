@@ -0,0 +1,13 @@
+--
+-- Script to downgrade from FTS3 Schema 10.1.0 to the previous schema (10.0.1)
+--
+
+DROP TRIGGER IF EXISTS `trg_pair_counters_insert`;
+DROP TRIGGER IF EXISTS `trg_pair_counters_update`;
+DROP TRIGGER IF EXISTS `trg_pair_counters_delete`;
+
+DROP TABLE IF EXISTS `t_pair_counters`;
+
+-- Update schema version number
+DELETE FROM t_schema_vers WHERE major = 10 AND minor = 1 AND patch = 0;
+REPLACE INTO t_schema_vers (major, minor, patch, message) VALUES (10, 0, 1, 'Downgrade from 10.1.0');
@@ -0,0 +1,14 @@
+--
+-- Script to downgrade from FTS3 Schema 10.2.0 to the previous schema (10.1.0)
+--
+
+DROP TRIGGER IF EXISTS `trg_job_counters_insert`;
+DROP TRIGGER IF EXISTS `trg_job_counters_update`;
+DROP TRIGGER IF EXISTS `trg_job_counters_delete`;
+DROP TRIGGER IF EXISTS `trg_job_counters_job_delete`;
+
+DROP TABLE IF EXISTS `t_job_counters`;
+
+-- Update schema version number
+DELETE FROM t_schema_vers WHERE major = 10 AND minor = 2 AND patch = 0;
+REPLACE INTO t_schema_vers (major, minor, patch, message) VALUES (10, 1, 0, 'Downgrade from 10.2.0');
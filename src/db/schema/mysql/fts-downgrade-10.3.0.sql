@@ -0,0 +1,77 @@
+--
+-- Script to downgrade from FTS3 Schema 10.3.0 to the previous schema (10.2.0)
+--
+
+-- Put the claimed transfers back in the queue
+UPDATE `t_file` SET file_state = 'SUBMITTED', transfer_host = NULL, start_time = NULL
+WHERE file_state = 'SELECTED';
+
+-- Triggers of the previous schema
+DROP TRIGGER IF EXISTS `trg_pair_counters_insert`;
+DROP TRIGGER IF EXISTS `trg_pair_counters_update`;
+DROP TRIGGER IF EXISTS `trg_pair_counters_delete`;
+
+DELIMITER ;;
+CREATE TRIGGER `trg_pair_counters_insert` AFTER INSERT ON `t_file`
+FOR EACH ROW PRECEDES `trg_job_counters_insert`
+BEGIN
+  IF NEW.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+    INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+    VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), NEW.file_state, 1)
+    ON DUPLICATE KEY UPDATE count = count + 1;
+  END IF;
+END ;;
+
+CREATE TRIGGER `trg_pair_counters_update` AFTER UPDATE ON `t_file`
+FOR EACH ROW PRECEDES `trg_job_counters_update`
+BEGIN
+  IF NOT (NEW.file_state <=> OLD.file_state AND NEW.source_se <=> OLD.source_se
+          AND NEW.dest_se <=> OLD.dest_se AND NEW.vo_name <=> OLD.vo_name) THEN
+    -- Touch the two counters in primary key order, as the multi-row transactions lock them
+    IF (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), CAST(NEW.file_state AS CHAR))
+       < (IFNULL(OLD.source_se, ''), IFNULL(OLD.dest_se, ''), IFNULL(OLD.vo_name, ''), CAST(OLD.file_state AS CHAR)) THEN
+      IF NEW.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+        VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), NEW.file_state, 1)
+        ON DUPLICATE KEY UPDATE count = count + 1;
+      END IF;
+      IF OLD.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+        WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+          AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = OLD.file_state;
+      END IF;
+    ELSE
+      IF OLD.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+        WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+          AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = OLD.file_state;
+      END IF;
+      IF NEW.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+        INSERT INTO t_pair_counters (source_se, dest_se, vo_name, file_state, count)
+        VALUES (IFNULL(NEW.source_se, ''), IFNULL(NEW.dest_se, ''), IFNULL(NEW.vo_name, ''), NEW.file_state, 1)
+        ON DUPLICATE KEY UPDATE count = count + 1;
+      END IF;
+    END IF;
+  END IF;
+END ;;
+
+CREATE TRIGGER `trg_pair_counters_delete` AFTER DELETE ON `t_file`
+FOR EACH ROW PRECEDES `trg_job_counters_delete`
+BEGIN
+  IF OLD.file_state NOT IN ('FINISHED', 'FAILED', 'CANCELED') THEN
+    UPDATE t_pair_counters SET count = GREATEST(count, 1) - 1
+    WHERE source_se = IFNULL(OLD.source_se, '') AND dest_se = IFNULL(OLD.dest_se, '')
+      AND vo_name = IFNULL(OLD.vo_name, '') AND file_state = OLD.file_state;
+  END IF;
+END ;;
+DELIMITER ;
+
+ALTER TABLE `t_file`
+    MODIFY COLUMN `file_state` enum('STAGING','ARCHIVING','QOS_TRANSITION','QOS_REQUEST_SUBMITTED','STARTED','SUBMITTED','READY','ACTIVE','FINISHED','FAILED','CANCELED','NOT_USED','ON_HOLD','ON_HOLD_STAGING','FORCE_START','TOKEN_PREP') NOT NULL;
+
+ALTER TABLE `t_file_backup`
+    MODIFY COLUMN `file_state` enum('STAGING','ARCHIVING','QOS_TRANSITION','QOS_REQUEST_SUBMITTED','STARTED','SUBMITTED','READY','ACTIVE','FINISHED','FAILED','CANCELED','NOT_USED','ON_HOLD','ON_HOLD_STAGING','FORCE_START','TOKEN_PREP') NOT NULL;
+
+-- Update schema version number
+DELETE FROM t_schema_vers WHERE major = 10 AND minor = 3 AND patch = 0;
+REPLACE INTO t_schema_vers (major, minor, patch, message) VALUES (10, 2, 0, 'Downgrade from 10.3.0');
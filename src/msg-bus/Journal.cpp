@@ -0,0 +1,608 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+
+#include "common/Exceptions.h"
+#include "common/Logger.h"
+#include "Journal.h"
+
+namespace fs = boost::filesystem;
+
+
+static const uint64_t SEGMENT_MAGIC = 0x31304C4E524A5346ULL; // "FSJRNL01"
+static const uint32_t RECORD_COMMITTED = 0x54494D43; // "CMIT"
+static const uint32_t RECORD_SEAL = 0x4C414553; // "SEAL"
+
+/// How long to wait for another producer to create the next segment before doing it
+static const time_t CREATE_TIMEOUT = 5;
+
+static const char SEGMENT_PREFIX[] = "segment-";
+
+
+/// Lives at the beginning of each segment, shared by all the processes mapping it
+struct SegmentHeader {
+    uint64_t magic;
+    uint64_t capacity;
+    /// Offset, relative to the data area, of the next reservation
+    std::atomic<uint64_t> tail;
+    char padding[40];
+};
+
+/// Shared by the producers to agree on which segment comes next
+struct ControlHeader {
+    std::atomic<uint64_t> lastSegment;
+    char padding[56];
+};
+
+/// Precedes each message. The state is set last, once the rest is in place.
+struct RecordHeader {
+    std::atomic<uint32_t> state;
+    uint32_t length;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SegmentHeader) == 64, "Unexpected segment header size");
+static_assert(sizeof(ControlHeader) == 64, "Unexpected control header size");
+static_assert(sizeof(RecordHeader) == 16, "Unexpected record header size");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Segment tail must be lock free to be shared between processes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Record state must be lock free to be shared between processes");
+
+
+static uint64_t alignRecord(uint64_t size)
+{
+    return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+
+static uint32_t crc32(const char *data, size_t size)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+
+/// Sequence numbers of the segments present in the journal directory
+static std::set<uint64_t> listSegments(const std::string &path)
+{
+    std::set<uint64_t> segments;
+    boost::system::error_code ec;
+
+    for (fs::directory_iterator i(path, ec), end; !ec && i != end; i.increment(ec)) {
+        const std::string name = i->path().filename().string();
+        if (name.compare(0, sizeof(SEGMENT_PREFIX) - 1, SEGMENT_PREFIX) != 0) {
+            continue;
+        }
+        char *endPtr = NULL;
+        const uint64_t seq = strtoull(name.c_str() + sizeof(SEGMENT_PREFIX) - 1, &endPtr, 16);
+        if (endPtr && *endPtr == '\0' && seq > 0) {
+            segments.insert(seq);
+        }
+    }
+
+    return segments;
+}
+
+
+Journal::Journal(const std::string &path, uint64_t segmentSize, time_t stallTimeout):
+    path(path), segmentSize(segmentSize), stallTimeout(stallTimeout), cursorSeq(0), cursorOffset(0), stalledSince(0)
+{
+    boost::system::error_code ec;
+    fs::create_directories(path, ec);
+    if (ec) {
+        throw fts3::common::SystemError("Could not create the journal directory " + path + " (" + ec.message() + ")");
+    }
+}
+
+
+Journal::~Journal()
+{
+    closeSegment(writeSegment);
+    closeSegment(readSegment);
+    closeSegment(control);
+}
+
+
+bool Journal::isEnabled(const std::string &path)
+{
+    boost::system::error_code ec;
+    return fs::exists(path + "/enabled", ec);
+}
+
+
+void Journal::setEnabled(const std::string &path, bool enabled)
+{
+    boost::system::error_code ec;
+    if (enabled) {
+        fs::create_directories(path, ec);
+        int fd = open((path + "/enabled").c_str(), O_CREAT | O_WRONLY, 0644);
+        if (fd < 0) {
+            char buffer[128] = {0};
+            throw fts3::common::SystemError("Could not enable the journal " + path + " (" +
+                strerror_r(errno, buffer, sizeof(buffer)) + ")");
+        }
+        close(fd);
+    }
+    else if (fs::exists(path, ec)) {
+        fs::remove(path + "/enabled", ec);
+    }
+}
+
+
+bool Journal::exists(const std::string &path)
+{
+    boost::system::error_code ec;
+    return fs::is_directory(path, ec);
+}
+
+
+std::string Journal::getSegmentPath(uint64_t seq) const
+{
+    char name[sizeof(SEGMENT_PREFIX) + 16];
+    snprintf(name, sizeof(name), "%s%016llx", SEGMENT_PREFIX, static_cast<unsigned long long>(seq));
+    return path + "/" + name;
+}
+
+
+uint64_t Journal::getLastSegment() const
+{
+    auto segments = listSegments(path);
+    return segments.empty() ? 0 : *segments.rbegin();
+}
+
+
+bool Journal::openSegment(Segment &segment, uint64_t seq)
+{
+    closeSegment(segment);
+
+    int fd = open(getSegmentPath(seq).c_str(), O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return false;
+    }
+
+    const SegmentHeader *header = static_cast<const SegmentHeader*>(base);
+    if (header->magic != SEGMENT_MAGIC || header->capacity + sizeof(SegmentHeader) > static_cast<uint64_t>(st.st_size)) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Invalid journal segment " << getSegmentPath(seq) << fts3::common::commit;
+        munmap(base, st.st_size);
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    segment.seq = seq;
+    segment.fd = fd;
+    segment.base = static_cast<char*>(base);
+    segment.size = st.st_size;
+    return true;
+}
+
+
+void Journal::closeSegment(Segment &segment)
+{
+    if (segment.base) {
+        munmap(segment.base, segment.size);
+    }
+    if (segment.fd >= 0) {
+        close(segment.fd);
+    }
+    segment = Segment();
+}
+
+
+/// The segment is fully initialized under a temporary name, and then linked
+/// into place, so nobody can see it half-written. If somebody else created it
+/// first, theirs is kept.
+int Journal::createSegment(uint64_t seq)
+{
+    const std::string finalPath = getSegmentPath(seq);
+    const std::string tmpPath = path + "/." + fs::path(finalPath).filename().string() + "." +
+        std::to_string(getpid()) + ".tmp";
+
+    int fd = open(tmpPath.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+
+    char header[sizeof(SegmentHeader)] = {0};
+    memcpy(header + offsetof(SegmentHeader, magic), &SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    memcpy(header + offsetof(SegmentHeader, capacity), &segmentSize, sizeof(segmentSize));
+
+    int err = 0;
+    if (ftruncate(fd, sizeof(SegmentHeader) + segmentSize) < 0 ||
+        pwrite(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        err = errno;
+    }
+    close(fd);
+
+    if (err == 0 && link(tmpPath.c_str(), finalPath.c_str()) < 0 && errno != EEXIST) {
+        err = errno;
+    }
+    unlink(tmpPath.c_str());
+
+    return err;
+}
+
+
+int Journal::openControl()
+{
+    const std::string controlPath = path + "/control";
+
+    int fd = open(controlPath.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+
+    // Extending to the same size is harmless if several producers get here at the same time
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (static_cast<size_t>(st.st_size) < sizeof(ControlHeader) &&
+                               ftruncate(fd, sizeof(ControlHeader)) < 0)) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+
+    void *base = mmap(NULL, sizeof(ControlHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+
+    control.fd = fd;
+    control.base = static_cast<char*>(base);
+    control.size = sizeof(ControlHeader);
+    return 0;
+}
+
+
+/// Only the producer that bumps the last segment from current creates the next one.
+/// A segment name is never reused, even after the consumer removed it.
+int Journal::switchWriteSegment(uint64_t current)
+{
+    std::atomic<uint64_t> &lastSegment = reinterpret_cast<ControlHeader*>(control.base)->lastSegment;
+
+    uint64_t expected = current;
+    if (lastSegment.compare_exchange_strong(expected, current + 1)) {
+        int err = createSegment(current + 1);
+        if (err) {
+            return err;
+        }
+    }
+
+    const time_t start = time(NULL);
+    while (true) {
+        const uint64_t next = lastSegment.load();
+        if (openSegment(writeSegment, next)) {
+            return 0;
+        }
+        if (errno != ENOENT) {
+            return errno;
+        }
+
+        // Still being created by another producer. If it takes too long, it probably died before it could.
+        if (time(NULL) - start > CREATE_TIMEOUT) {
+            int err = createSegment(next);
+            if (err) {
+                return err;
+            }
+        }
+        else {
+            usleep(1000);
+        }
+    }
+}
+
+
+int Journal::write(const std::string &payload)
+{
+    const uint64_t recordSize = alignRecord(sizeof(RecordHeader) + payload.size());
+    if (recordSize > segmentSize) {
+        return EMSGSIZE;
+    }
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    if (!control.base) {
+        int err = openControl();
+        if (err) {
+            return err;
+        }
+    }
+
+    if (!writeSegment.base) {
+        int err = switchWriteSegment(0);
+        if (err) {
+            return err;
+        }
+    }
+
+    while (true) {
+        SegmentHeader *header = reinterpret_cast<SegmentHeader*>(writeSegment.base);
+        char *data = writeSegment.base + sizeof(SegmentHeader);
+        const uint64_t capacity = header->capacity;
+        const uint64_t offset = header->tail.fetch_add(recordSize);
+
+        if (offset + recordSize <= capacity) {
+            RecordHeader *record = reinterpret_cast<RecordHeader*>(data + offset);
+            memcpy(data + offset + sizeof(RecordHeader), payload.data(), payload.size());
+            record->length = payload.size();
+            record->crc = crc32(payload.data(), payload.size());
+            record->state.store(RECORD_COMMITTED, std::memory_order_release);
+            return 0;
+        }
+
+        // Only the first reservation going past the end can start within the segment,
+        // so it tells the consumer where the data ends
+        if (offset + sizeof(RecordHeader) <= capacity) {
+            reinterpret_cast<RecordHeader*>(data + offset)->state.store(RECORD_SEAL, std::memory_order_release);
+        }
+
+        int err = switchWriteSegment(writeSegment.seq);
+        if (err) {
+            return err;
+        }
+    }
+}
+
+
+bool Journal::loadCursor()
+{
+    FILE *fd = fopen((path + "/cursor").c_str(), "r");
+    if (fd) {
+        unsigned long long seq = 0, offset = 0;
+        int n = fscanf(fd, "%llu %llu", &seq, &offset);
+        fclose(fd);
+        if (n == 2 && seq > 0) {
+            cursorSeq = seq;
+            cursorOffset = offset;
+            return true;
+        }
+    }
+
+    auto segments = listSegments(path);
+    cursorSeq = segments.empty() ? 1 : *segments.begin();
+    cursorOffset = 0;
+    return false;
+}
+
+
+int Journal::saveCursor()
+{
+    const std::string cursorPath = path + "/cursor";
+    const std::string tmpPath = cursorPath + ".tmp";
+
+    FILE *fd = fopen(tmpPath.c_str(), "w");
+    if (!fd) {
+        return errno;
+    }
+    fprintf(fd, "%llu %llu\n", static_cast<unsigned long long>(cursorSeq),
+        static_cast<unsigned long long>(cursorOffset));
+    if (fclose(fd) != 0) {
+        return errno;
+    }
+
+    if (rename(tmpPath.c_str(), cursorPath.c_str()) < 0) {
+        return errno;
+    }
+    return 0;
+}
+
+
+/// Move the cursor to the following segment, if there is one, and drop the consumed segment
+bool Journal::nextReadSegment()
+{
+    auto segments = listSegments(path);
+    auto next = segments.upper_bound(cursorSeq);
+    if (next == segments.end()) {
+        return false;
+    }
+
+    const uint64_t consumed = cursorSeq;
+    cursorSeq = *next;
+    cursorOffset = 0;
+    stalledSince = 0;
+
+    // Persist first, so a crash does not point the cursor to a removed segment
+    if (saveCursor() == 0) {
+        closeSegment(readSegment);
+        unlink(getSegmentPath(consumed).c_str());
+    }
+    return true;
+}
+
+
+/// A record has been reserved, but not committed for too long. Its producer likely died
+/// in between, so look for the next valid record.
+bool Journal::resync(uint64_t tail)
+{
+    const SegmentHeader *header = reinterpret_cast<const SegmentHeader*>(readSegment.base);
+    const char *data = readSegment.base + sizeof(SegmentHeader);
+    const uint64_t end = std::min(tail, header->capacity);
+
+    for (uint64_t offset = cursorOffset + 8; offset + sizeof(RecordHeader) <= end; offset += 8) {
+        const RecordHeader *record = reinterpret_cast<const RecordHeader*>(data + offset);
+        const uint32_t state = record->state.load(std::memory_order_acquire);
+
+        bool valid = (state == RECORD_SEAL);
+        if (state == RECORD_COMMITTED) {
+            valid = offset + alignRecord(sizeof(RecordHeader) + record->length) <= header->capacity &&
+                crc32(data + offset + sizeof(RecordHeader), record->length) == record->crc;
+        }
+
+        if (valid) {
+            FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Skipped " << (offset - cursorOffset)
+                << " bytes of uncommitted data in " << getSegmentPath(cursorSeq) << fts3::common::commit;
+            cursorOffset = offset;
+            stalledSince = 0;
+            return true;
+        }
+    }
+
+    // Nothing after, and no more space: the rest of the segment is lost
+    if (tail >= header->capacity) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Skipped the uncommitted end of " << getSegmentPath(cursorSeq)
+            << fts3::common::commit;
+        return nextReadSegment();
+    }
+
+    return false;
+}
+
+
+int Journal::read(unsigned limit, const std::function<void (const char*, size_t)> &callback)
+{
+    if (cursorSeq == 0) {
+        loadCursor();
+    }
+
+    unsigned count = 0;
+    bool moved = false;
+
+    while (count < limit) {
+        if (readSegment.seq != cursorSeq && !openSegment(readSegment, cursorSeq)) {
+            // Not created yet
+            if (getLastSegment() <= cursorSeq) {
+                break;
+            }
+            // Segments are created in order, so if it is still missing once a later one exists, it was lost
+            if (!openSegment(readSegment, cursorSeq)) {
+                FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Missing journal segment " << getSegmentPath(cursorSeq)
+                    << fts3::common::commit;
+                if (!nextReadSegment()) {
+                    break;
+                }
+                moved = true;
+                continue;
+            }
+        }
+
+        const SegmentHeader *header = reinterpret_cast<const SegmentHeader*>(readSegment.base);
+        const char *data = readSegment.base + sizeof(SegmentHeader);
+        const uint64_t capacity = header->capacity;
+        const uint64_t tail = header->tail.load(std::memory_order_acquire);
+
+        if (cursorOffset + sizeof(RecordHeader) > capacity) {
+            if (!nextReadSegment()) {
+                break;
+            }
+            continue;
+        }
+
+        const RecordHeader *record = reinterpret_cast<const RecordHeader*>(data + cursorOffset);
+        const uint32_t state = record->state.load(std::memory_order_acquire);
+
+        if (state == RECORD_SEAL) {
+            if (!nextReadSegment()) {
+                break;
+            }
+            continue;
+        }
+
+        if (state != RECORD_COMMITTED) {
+            if (cursorOffset >= tail) {
+                break;
+            }
+            // Reserved, but not committed yet. Give the producer some time.
+            const time_t now = time(NULL);
+            if (stalledSince == 0) {
+                stalledSince = now;
+            }
+            if (now - stalledSince < stallTimeout || !resync(tail)) {
+                break;
+            }
+            moved = true;
+            continue;
+        }
+        stalledSince = 0;
+
+        const uint64_t recordSize = alignRecord(sizeof(RecordHeader) + record->length);
+        const char *payload = data + cursorOffset + sizeof(RecordHeader);
+
+        if (cursorOffset + recordSize > capacity) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Corrupted record length in " << getSegmentPath(cursorSeq)
+                << " at " << cursorOffset << fts3::common::commit;
+            if (!resync(tail)) {
+                break;
+            }
+            moved = true;
+            continue;
+        }
+
+        if (crc32(payload, record->length) != record->crc) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Corrupted message in " << getSegmentPath(cursorSeq)
+                << " at " << cursorOffset << fts3::common::commit;
+        }
+        else {
+            callback(payload, record->length);
+            ++count;
+        }
+
+        cursorOffset += recordSize;
+        moved = true;
+    }
+
+    if (moved) {
+        return saveCursor();
+    }
+    return 0;
+}
+
+
+void Journal::purge()
+{
+    boost::system::error_code ec;
+    const time_t now = time(NULL);
+
+    for (fs::directory_iterator i(path, ec), end; !ec && i != end; i.increment(ec)) {
+        const std::string name = i->path().filename().string();
+        if (name.size() > 4 && name[0] == '.' && name.compare(name.size() - 4, 4, ".tmp") == 0) {
+            boost::system::error_code ignore;
+            if (now - fs::last_write_time(i->path(), ignore) > stallTimeout) {
+                fs::remove(i->path(), ignore);
+            }
+        }
+    }
+}
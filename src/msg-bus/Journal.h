@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+
+
+/// Append-only message journal, alternative to a dirq queue.
+///
+/// Messages are appended to fixed size, memory mapped segment files
+/// (segment-<sequence>) as length-prefixed, CRC checked records.
+/// Several processes can write concurrently: space is reserved with an atomic
+/// increment of the segment tail, which lives in the shared mapping, and
+/// the "control" file tells which segment is the last one.
+/// There is a single consumer, whose position is persisted in the "cursor" file,
+/// so messages are not lost nor re-delivered (beyond the last batch) after a crash.
+/// Segments are removed once fully consumed.
+///
+/// Producers only write into a journal when it is enabled (see setEnabled),
+/// while the consumer drains it as long as the directory exists.
+class Journal {
+public:
+    /// Default size of the data area of a segment
+    static const uint64_t DEFAULT_SEGMENT_SIZE = 8 * 1024 * 1024;
+
+    /// Default time given to a producer to commit a reserved record before skipping it
+    static const time_t DEFAULT_STALL_TIMEOUT = 60;
+
+    /// Open (creating if needed) the journal stored in the directory path
+    explicit Journal(const std::string &path, uint64_t segmentSize = DEFAULT_SEGMENT_SIZE,
+        time_t stallTimeout = DEFAULT_STALL_TIMEOUT);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator = (const Journal&) = delete;
+
+    /// True if producers are to write into the journal stored at path
+    static bool isEnabled(const std::string &path);
+
+    /// Enable or disable producers writing into the journal stored at path.
+    /// Messages already written into a disabled journal are still consumed.
+    static void setEnabled(const std::string &path, bool enabled);
+
+    /// True if there is a journal stored at path
+    static bool exists(const std::string &path);
+
+    /// Append a message. Safe to be called from several processes.
+    /// @return 0 on success, an errno value otherwise
+    int write(const std::string &payload);
+
+    /// Pass to the callback up to limit messages following the consumer cursor,
+    /// and persist the new position. Only one consumer must run.
+    /// @return 0 on success, an errno value otherwise
+    int read(unsigned limit, const std::function<void (const char*, size_t)> &callback);
+
+    /// Remove temporary files left behind by dead producers
+    void purge();
+
+    const std::string &getPath(void) const {
+        return path;
+    }
+
+private:
+    struct Segment {
+        Segment(): seq(0), fd(-1), base(nullptr), size(0) {}
+
+        uint64_t seq;
+        int fd;
+        char *base;
+        size_t size;
+    };
+
+    std::string path;
+    uint64_t segmentSize;
+    time_t stallTimeout;
+
+    std::mutex writeMutex;
+    Segment control;
+    Segment writeSegment;
+    Segment readSegment;
+
+    uint64_t cursorSeq;
+    uint64_t cursorOffset;
+    time_t stalledSince;
+
+    std::string getSegmentPath(uint64_t seq) const;
+    uint64_t getLastSegment() const;
+
+    bool openSegment(Segment &segment, uint64_t seq);
+    void closeSegment(Segment &segment);
+    int createSegment(uint64_t seq);
+
+    int openControl();
+    int switchWriteSegment(uint64_t current);
+
+    bool loadCursor();
+    int saveCursor();
+    bool nextReadSegment();
+    bool resync(uint64_t tail);
+};
+
+#endif // JOURNAL_H
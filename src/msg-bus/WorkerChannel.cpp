@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "WorkerChannel.h"
+
+
+static int fillAddress(const std::string &path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr->sun_path)) {
+        return ENAMETOOLONG;
+    }
+    strncpy(addr->sun_path, path.c_str(), sizeof(addr->sun_path) - 1);
+    return 0;
+}
+
+
+std::string WorkerChannel::getSocketPath(const std::string &msgDir)
+{
+    return msgDir + "/url_copy-workers.ipc";
+}
+
+
+int WorkerChannel::listen(const std::string &path)
+{
+    struct sockaddr_un addr;
+    int err = fillAddress(path, &addr);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    unlink(path.c_str());
+
+    // Create the socket already restricted to the owner
+    mode_t oldMask = umask(0077);
+    int ret = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    umask(oldMask);
+
+    if (ret < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+
+int WorkerChannel::connect(const std::string &path)
+{
+    struct sockaddr_un addr;
+    int err = fillAddress(path, &addr);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+
+int WorkerChannel::getPeer(int fd, uid_t *uid, pid_t *pid)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        return errno;
+    }
+    *uid = cred.uid;
+    *pid = cred.pid;
+    return 0;
+}
+
+
+std::string WorkerChannel::encodeArguments(const std::vector<std::string> &args)
+{
+    std::string data;
+    for (const auto &arg: args) {
+        data.append(arg);
+        data.push_back('\0');
+    }
+    return data;
+}
+
+
+std::vector<std::string> WorkerChannel::decodeArguments(const char *data, size_t size)
+{
+    std::vector<std::string> args;
+    const char *end = data + size;
+
+    while (data < end) {
+        const char *sep = static_cast<const char*>(memchr(data, '\0', end - data));
+        if (!sep) {
+            // Unterminated trailing argument
+            args.emplace_back(data, end);
+            break;
+        }
+        args.emplace_back(data, sep);
+        data = sep + 1;
+    }
+
+    return args;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef WORKERCHANNEL_H
+#define WORKERCHANNEL_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+
+/// Local socket between fts_server and the persistent fts_url_copy workers.
+///
+/// Workers connect to a SOCK_SEQPACKET unix socket owned by the server,
+/// and send READY each time they can take a transfer. The server answers with
+/// a transfer descriptor: the fts_url_copy command line arguments, NUL separated,
+/// in a single message. Closing the connection tells the worker to exit.
+class WorkerChannel {
+public:
+    /// Sent by a worker when it is idle
+    static const char READY = 'R';
+
+    /// Maximum size of a transfer descriptor
+    static const size_t MAX_MESSAGE_SIZE = 64 * 1024;
+
+    /// Path of the socket, inside the messaging directory
+    static std::string getSocketPath(const std::string &msgDir);
+
+    /// Create, bind and listen on the socket at path, only accessible by the owner.
+    /// A stale socket left by a previous server is replaced.
+    /// @return the socket descriptor, or -1 with errno set
+    static int listen(const std::string &path);
+
+    /// Connect to the socket at path
+    /// @return the socket descriptor, or -1 with errno set
+    static int connect(const std::string &path);
+
+    /// User and process id on the other side of a connected socket
+    /// @return 0 on success, an errno value otherwise
+    static int getPeer(int fd, uid_t *uid, pid_t *pid);
+
+    /// Serialize the arguments into a descriptor
+    static std::string encodeArguments(const std::vector<std::string> &args);
+
+    /// Parse a descriptor received from the server
+    static std::vector<std::string> decodeArguments(const char *data, size_t size);
+};
+
+#endif // WORKERCHANNEL_H
@@ -19,11 +19,16 @@
  */
 
 #include <dirq.h>
-#include <fstream>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "common/Logger.h"
 #include "consumer.h"
 #include "DirQ.h"
+#include "Journal.h"
 
 
 Consumer::Consumer(const std::string &baseDir, unsigned limit): baseDir(baseDir), limit(limit),
@@ -38,11 +43,89 @@ Consumer::~Consumer()
 }
 
 
+/// Pass to the callback up to limit serialized messages from the journal, if there is one.
+/// The callback returns false if the message could not be parsed.
+/// @return the number of messages consumed, or -1 on error
+static int journalConsumer(const std::string &path, std::unique_ptr<Journal> &journal, unsigned limit,
+    const std::function<bool (const char*, size_t)> &callback)
+{
+    if (!journal) {
+        if (!Journal::exists(path)) {
+            return 0;
+        }
+        journal.reset(new Journal(path));
+    }
+
+    int count = 0;
+    int err = journal->read(limit, [&](const char *data, size_t size) {
+        ++count;
+        if (!callback(data, size)) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not load message from " << path << fts3::common::commit;
+        }
+    });
+
+    if (err) {
+        char buffer[128] = {0};
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Failed to consume messages from " << path << ": "
+                                       << strerror_r(err, buffer, sizeof(buffer)) << fts3::common::commit;
+        return -1;
+    }
+
+    return count;
+}
+
+
+/// Read the whole file into buffer, reusing its storage between messages
+static bool readMessageFile(const char *path, std::string &buffer)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+
+    buffer.resize(st.st_size);
+    size_t total = 0;
+    while (total < buffer.size()) {
+        ssize_t n = read(fd, &buffer[total], buffer.size() - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        total += n;
+    }
+    close(fd);
+
+    buffer.resize(total);
+    return total == static_cast<size_t>(st.st_size);
+}
+
+
+/// Parse the serialized message directly into a new entry at the end of messages
 template <typename MSG>
-static int genericConsumer(std::unique_ptr<DirQ> &dirq, unsigned limit, std::vector<MSG> &messages)
+static bool appendMessage(const char *data, size_t size, std::vector<MSG> &messages)
 {
-    MSG event;
+    messages.emplace_back();
+    if (!messages.back().ParseFromArray(data, size)) {
+        messages.pop_back();
+        return false;
+    }
+    return true;
+}
+
 
+/// Iterate over up to limit messages of the queue, passing their content to the callback,
+/// and removing them afterwards
+static int dirqConsumer(std::unique_ptr<DirQ> &dirq, unsigned limit, std::string &buffer,
+    const std::function<bool (const char*, size_t)> &callback)
+{
     const char *error = NULL;
     dirq_clear_error(*dirq);
 
@@ -51,15 +134,10 @@ static int genericConsumer(std::unique_ptr<DirQ> &dirq, unsigned limit, std::vec
         if (dirq_lock(*dirq, iter, 0) == 0) {
             const char *path = dirq_get_path(*dirq, iter);
 
-            try {
-                std::ifstream fstream(path);
-                event.ParseFromIstream(&fstream);
-            } catch (const std::exception &ex) {
-                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not load message from " << path << " (" << ex.what() << ")"
-                                               << fts3::common::commit;
+            if (!readMessageFile(path, buffer) || !callback(buffer.data(), buffer.size())) {
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not load message from " << path << fts3::common::commit;
             }
 
-            messages.emplace_back(event);
             if (dirq_remove(*dirq, iter) < 0) {
                 error = dirq_get_errstr(*dirq);
                 FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Failed to remove message from queue (" << path << "): "
@@ -79,70 +157,65 @@ static int genericConsumer(std::unique_ptr<DirQ> &dirq, unsigned limit, std::vec
 }
 
 
+template <typename MSG>
+static int genericConsumer(std::unique_ptr<DirQ> &dirq, std::unique_ptr<Journal> &journal, unsigned limit,
+    std::string &buffer, std::vector<MSG> &messages)
+{
+    auto parser = [&messages](const char *data, size_t size) {
+        return appendMessage(data, size, messages);
+    };
+
+    int consumed = journalConsumer(dirq->getPath() + ".journal", journal, limit, parser);
+    if (consumed < 0) {
+        return -1;
+    }
+
+    return dirqConsumer(dirq, limit - consumed, buffer, parser);
+}
+
+
 int Consumer::runConsumerStatus(std::vector<fts3::events::Message> &messages)
 {
-    return genericConsumer<fts3::events::Message>(statusQueue, limit, messages);
+    return genericConsumer<fts3::events::Message>(statusQueue, statusJournal, limit, readBuffer, messages);
 }
 
 
 int Consumer::runConsumerStall(std::vector<fts3::events::MessageUpdater> &messages)
 {
-    return genericConsumer<fts3::events::MessageUpdater>(stalledQueue, limit, messages);
+    std::unique_ptr<Journal> noJournal;
+    return genericConsumer<fts3::events::MessageUpdater>(stalledQueue, noJournal, limit, readBuffer, messages);
 }
 
 
 int Consumer::runConsumerLog(std::map<int, fts3::events::MessageLog> &messages)
 {
-    fts3::events::MessageLog buffer;
-
-    const char *error = NULL;
-    dirq_clear_error(*logQueue);
-
-    unsigned i = 0;
-    for (auto iter = dirq_first(*logQueue); iter != NULL && i < limit; iter = dirq_next(*logQueue), ++i) {
-        if (dirq_lock(*logQueue, iter, 0) == 0) {
-            const char *path = dirq_get_path(*logQueue, iter);
-
-            try {
-                std::ifstream fstream(path);
-                buffer.ParseFromIstream(&fstream);
-            }
-            catch (const std::exception &ex) {
-                FTS3_COMMON_LOGGER_NEWLOG(ERR)
-                << "Could not load message from " << path << " (" << ex.what() << ")"
-                << fts3::common::commit;
-            }
-
-            messages[buffer.file_id()] = buffer;
-            if (dirq_remove(*logQueue, iter) < 0) {
-                error = dirq_get_errstr(*logQueue);
-                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Failed to remove message from queue (" << path << "): "
-                    << error
-                    << fts3::common::commit;
-                dirq_clear_error(*logQueue);
-            }
+    fts3::events::MessageLog event;
+    auto parser = [&messages, &event](const char *data, size_t size) {
+        if (!event.ParseFromArray(data, size)) {
+            return false;
         }
-    }
+        messages[event.file_id()] = std::move(event);
+        return true;
+    };
 
-    error = dirq_get_errstr(*logQueue);
-    if (error) {
-        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Failed to consume messages: " << error << fts3::common::commit;
+    int consumed = journalConsumer(logQueue->getPath() + ".journal", logJournal, limit, parser);
+    if (consumed < 0) {
         return -1;
     }
 
-    return 0;
+    return dirqConsumer(logQueue, limit - consumed, readBuffer, parser);
 }
 
 
 int Consumer::runConsumerDeletions(std::vector<fts3::events::MessageBringonline> &messages)
 {
-    return genericConsumer<fts3::events::MessageBringonline>(deletionQueue, limit, messages);
+    return genericConsumer<fts3::events::MessageBringonline>(deletionQueue, deletionJournal, limit, readBuffer, messages);
 }
 
 
 int Consumer::runConsumerStaging(std::vector<fts3::events::MessageBringonline> &messages)
 {
-    return genericConsumer<fts3::events::MessageBringonline>(stagingQueue, limit, messages);
+    return genericConsumer<fts3::events::MessageBringonline>(stagingQueue, stagingJournal, limit, readBuffer, messages);
 }
 
 
@@ -162,4 +235,11 @@ void Consumer::purgeAll()
     _purge(logQueue.get());
     _purge(stagingQueue.get());
     _purge(deletionQueue.get());
+
+    for (auto dq: {statusQueue.get(), logQueue.get(), stagingQueue.get(), deletionQueue.get()}) {
+        const std::string journalPath = dq->getPath() + ".journal";
+        if (Journal::exists(journalPath)) {
+            Journal(journalPath).purge();
+        }
+    }
 }
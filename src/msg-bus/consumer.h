@@ -27,12 +27,15 @@
 #include "events.h"
 
 struct DirQ;
+class Journal;
 
 class Consumer
 {
 private:
     std::string baseDir;
     unsigned limit;
+    // Reused to read each message from disk
+    std::string readBuffer;
     std::unique_ptr<DirQ> monitoringQueue;
     std::unique_ptr<DirQ> statusQueue;
     std::unique_ptr<DirQ> stalledQueue;
@@ -40,6 +43,12 @@ private:
     std::unique_ptr<DirQ> stagingQueue;
     std::unique_ptr<DirQ> deletionQueue;
 
+    // Opened once their directory shows up
+    std::unique_ptr<Journal> statusJournal;
+    std::unique_ptr<Journal> logJournal;
+    std::unique_ptr<Journal> stagingJournal;
+    std::unique_ptr<Journal> deletionJournal;
+
 public:
 
     Consumer(const std::string &baseDir, unsigned limit = 10000);
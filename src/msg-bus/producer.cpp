@@ -19,49 +19,110 @@
  */
 
 #include "producer.h"
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <boost/filesystem.hpp>
 #include <glib.h>
 #include <boost/thread/tss.hpp>
 #include "DirQ.h"
+#include "Journal.h"
 
 #include "common/Logger.h"
 
-boost::thread_specific_ptr<std::istringstream> msgBuffer;
+/// Message being written by this thread. Serialized on demand from the dirq callback.
+struct PendingMessage {
+    const google::protobuf::Message *msg;
+    const char *data;
+    size_t size;
+    size_t offset;
+    // Storage for messages that do not fit in one dirq buffer, reused between calls
+    std::string serialized;
+
+    PendingMessage(): msg(NULL), data(NULL), size(0), offset(0) {}
+};
+
+static boost::thread_specific_ptr<PendingMessage> pendingMessage;
+
+
+static Journal *openJournal(const std::string &path)
+{
+    if (Journal::isEnabled(path)) {
+        return new Journal(path);
+    }
+    return NULL;
+}
+
 
 Producer::Producer(const std::string &baseDir): baseDir(baseDir),
     monitoringQueue(new DirQ(baseDir + "/monitoring")), statusQueue(new DirQ(baseDir + "/status")),
     stalledQueue(new DirQ(baseDir + "/stalled")), logQueue(new DirQ(baseDir + "/logs")),
-    deletionQueue(new DirQ(baseDir + "/deletion")), stagingQueue(new DirQ(baseDir + "/staging"))
+    deletionQueue(new DirQ(baseDir + "/deletion")), stagingQueue(new DirQ(baseDir + "/staging")),
+    statusJournal(openJournal(baseDir + "/status.journal")), logJournal(openJournal(baseDir + "/logs.journal")),
+    deletionJournal(openJournal(baseDir + "/deletion.journal")), stagingJournal(openJournal(baseDir + "/staging.journal"))
 {
 }
 
 
 Producer::~Producer()
 {
-    msgBuffer.reset();
+    pendingMessage.reset();
 }
 
-static void populateBuffer(const std::string &msg)
+
+static PendingMessage *getPendingMessage()
 {
-    if (msgBuffer.get() == NULL) {
-        msgBuffer.reset(new std::istringstream());
+    if (pendingMessage.get() == NULL) {
+        pendingMessage.reset(new PendingMessage());
     }
-    msgBuffer->clear();
-    msgBuffer->str(msg);
+    return pendingMessage.get();
 }
 
 
 static int producerDirqW(dirq_t, char *buffer, size_t length)
 {
-    return msgBuffer->readsome(buffer, length);
+    PendingMessage *pending = pendingMessage.get();
+
+    // First call: serialize straight into the dirq buffer when possible
+    if (pending->msg) {
+        const size_t size = pending->msg->ByteSizeLong();
+        if (size <= length) {
+            pending->msg->SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer));
+            pending->msg = NULL;
+            pending->data = NULL;
+            pending->size = pending->offset = 0;
+            return size;
+        }
+        pending->msg->SerializeToString(&pending->serialized);
+        pending->msg = NULL;
+        pending->data = pending->serialized.data();
+        pending->size = pending->serialized.size();
+        pending->offset = 0;
+    }
+
+    const size_t chunk = std::min(length, pending->size - pending->offset);
+    memcpy(buffer, pending->data + pending->offset, chunk);
+    pending->offset += chunk;
+    return chunk;
 }
 
 
-static int writeMessage(std::unique_ptr<DirQ> &dirqHandle, const google::protobuf::Message &msg)
+static int writeMessage(std::unique_ptr<DirQ> &dirqHandle, std::unique_ptr<Journal> &journal,
+    const google::protobuf::Message &msg)
 {
-    populateBuffer(msg.SerializeAsString());
-    if (dirq_add(*dirqHandle, producerDirqW) == NULL) {
+    PendingMessage *pending = getPendingMessage();
+
+    if (journal) {
+        msg.SerializeToString(&pending->serialized);
+        return journal->write(pending->serialized);
+    }
+
+    pending->msg = &msg;
+    pending->data = NULL;
+    pending->size = pending->offset = 0;
+
+    const char *added = dirq_add(*dirqHandle, producerDirqW);
+    pending->msg = NULL;
+    if (added == NULL) {
         return dirq_get_errcode(*dirqHandle);
     }
 
@@ -71,31 +132,38 @@ static int writeMessage(std::unique_ptr<DirQ> &dirqHandle, const google::protobu
 
 int Producer::runProducerStatus(const fts3::events::Message &msg)
 {
-    return writeMessage(statusQueue, msg);
+    return writeMessage(statusQueue, statusJournal, msg);
 }
 
 
 int Producer::runProducerLog(const fts3::events::MessageLog &msg)
 {
-    return writeMessage(logQueue, msg);
+    return writeMessage(logQueue, logJournal, msg);
 }
 
 int Producer::runProducerDeletions(const fts3::events::MessageBringonline &msg)
 {
-    return writeMessage(deletionQueue, msg);
+    return writeMessage(deletionQueue, deletionJournal, msg);
 }
 
 
 int Producer::runProducerStaging(const fts3::events::MessageBringonline &msg)
 {
-    return writeMessage(stagingQueue, msg);
+    return writeMessage(stagingQueue, stagingJournal, msg);
 }
 
 
 int Producer::runProducerMonitoring(const std::string &serialized)
 {
-    populateBuffer(serialized);
-    if (dirq_add(*monitoringQueue, producerDirqW) == NULL) {
+    PendingMessage *pending = getPendingMessage();
+    pending->msg = NULL;
+    pending->data = serialized.data();
+    pending->size = serialized.size();
+    pending->offset = 0;
+
+    const char *added = dirq_add(*monitoringQueue, producerDirqW);
+    pending->data = NULL;
+    if (added == NULL) {
         return dirq_get_errcode(*monitoringQueue);
     }
 
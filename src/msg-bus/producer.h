@@ -27,6 +27,7 @@
 #include "events.h"
 
 struct DirQ;
+class Journal;
 
 class Producer {
 private:
@@ -38,6 +39,12 @@ private:
     std::unique_ptr<DirQ> deletionQueue;
     std::unique_ptr<DirQ> stagingQueue;
 
+    // Only set for the queues with the journal enabled
+    std::unique_ptr<Journal> statusJournal;
+    std::unique_ptr<Journal> logJournal;
+    std::unique_ptr<Journal> deletionJournal;
+    std::unique_ptr<Journal> stagingJournal;
+
 public:
     Producer(const std::string &baseDir);
 
@@ -197,21 +197,22 @@ bool OptimizerExecutor::optimizeConnectionsForPair(OptimizerMode optMode)
         setOptimizerDecision(current, decision, decision, rationale.str(), startTime);
 
         current.ema = current.throughput;
-        inMemoryStore[pair] = current;
+        current.connections = decision;
+        inMemoryStore->put(pair, current);
 
         return true;
     }
 
     // There is information, but it is the first time seen since the restart
-    if (inMemoryStore.find(pair) == inMemoryStore.end()) {
+    PairState previous;
+    if (!inMemoryStore->get(pair, &previous)) {
         current.ema = current.throughput;
-        inMemoryStore[pair] = current;
+        previous = current;
+        inMemoryStore->put(pair, current);
         FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Store first feedback from " << pair << commit;
         firstRun = true;
     }
 
-    const PairState previous = inMemoryStore[pair];
-
     // Calculate new Exponential Moving Average
     current.ema = exponentialMovingAverage(current.throughput, emaAlpha, previous.ema);
 
@@ -344,8 +345,9 @@ void OptimizerExecutor::setOptimizerDecision(const PairState& current, const int
         << " decision=" << decision << " running=" << current.activeCount << " diff=" << diff
         << " rationale=\"" << rationale << "\"" << " (" << duration << "ms)" << commit;
 
-    inMemoryStore[pair] = current;
-    inMemoryStore[pair].connections = decision;
+    PairState stored = current;
+    stored.connections = decision;
+    inMemoryStore->put(pair, stored);
     dataSource->storeOptimizerDecision(pair, decision, current, diff, rationale);
 
     if (callbacks) {
@@ -35,6 +35,9 @@ namespace optimizer {
 
     const int DEFAULT_MIN_ACTIVE = 2;
     const int DEFAULT_LAN_ACTIVE = 10;
+
+    // Pair states not updated for this many seconds are forgotten
+    const int PAIR_STATE_EXPIRATION = 24 * 3600;
 }
 }
 
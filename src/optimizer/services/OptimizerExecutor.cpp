@@ -32,7 +32,9 @@ namespace fts3 {
 namespace optimizer {
 
 
-OptimizerExecutor::OptimizerExecutor(std::unique_ptr<OptimizerDataSource> ds, std::unique_ptr<OptimizerCallbacks> callbacks, const Pair& pair):
+OptimizerExecutor::OptimizerExecutor(std::unique_ptr<OptimizerDataSource> ds, std::unique_ptr<OptimizerCallbacks> callbacks, const Pair& pair,
+                                     std::shared_ptr<PairStateStore> stateStore):
+    inMemoryStore(stateStore ? std::move(stateStore) : std::make_shared<PairStateStore>()),
     dataSource(std::move(ds)), callbacks(std::move(callbacks)),
     optimizerSteadyInterval(boost::posix_time::seconds(60)), maxNumberOfStreams(10),
     maxSuccessRate(100), lowSuccessRate(97), baseSuccessRate(96),
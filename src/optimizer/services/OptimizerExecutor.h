@@ -34,13 +34,16 @@
 
 #include "OptimizerDataSource.h"
 #include "OptimizerCallbacks.h"
+#include "PairStateStore.h"
 
 namespace fts3 {
 namespace optimizer {
 
 class OptimizerExecutor {
 public:
-    OptimizerExecutor(std::unique_ptr<OptimizerDataSource> ds, std::unique_ptr<OptimizerCallbacks> callbacks, const Pair& pair);
+    /// If stateStore is null, the executor keeps the pair state to itself
+    OptimizerExecutor(std::unique_ptr<OptimizerDataSource> ds, std::unique_ptr<OptimizerCallbacks> callbacks, const Pair& pair,
+                      std::shared_ptr<PairStateStore> stateStore = nullptr);
     ~OptimizerExecutor() = default;
 
     void run(boost::any &);
@@ -92,7 +95,8 @@ protected:
                               const std::string& rationale,
                               const std::chrono::steady_clock::time_point& start);
 
-    std::map<Pair, PairState> inMemoryStore;
+    // State of the pair from previous runs
+    std::shared_ptr<PairStateStore> inMemoryStore;
     // DB interface
     std::unique_ptr<OptimizerDataSource> dataSource;
     std::unique_ptr<OptimizerCallbacks> callbacks;
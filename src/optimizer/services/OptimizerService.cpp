@@ -19,14 +19,16 @@
  */
 
 #include <chrono>
+#include <cstring>
 #include <sstream>
 
-#include "common/ThreadPool.h"
+#include "common/WorkStealingExecutor.h"
 #include "config/ServerConfig.h"
 #include "db/generic/SingleDbInstance.h"
 
 #include "OptimizerService.h"
 #include "OptimizerExecutor.h"
+#include "OptimizerConstants.h"
 #include "OptimizerDataSource.h"
 #include "DbOptimizerDataSource.h"
 
@@ -69,9 +71,31 @@ public:
 
 OptimizerService::OptimizerService(const std::shared_ptr<HeartBeat>& heartBeat):
     BaseService("OptimizerService"),
-    heartBeat(heartBeat)
+    heartBeat(heartBeat), pairStates(std::make_shared<PairStateStore>())
 {
     optimizerPoolSize = ServerConfig::instance().get<int>("OptimizerThreadPool");
+    stateFile = ServerConfig::instance().get<std::string>("OptimizerStateFile");
+
+    if (!stateFile.empty()) {
+        size_t loaded = pairStates->load(stateFile, time(NULL) - PAIR_STATE_EXPIRATION);
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Optimizer: Loaded the state of " << loaded << " pairs from " << stateFile << commit;
+    }
+}
+
+
+void OptimizerService::saveState()
+{
+    pairStates->expire(time(NULL) - PAIR_STATE_EXPIRATION);
+
+    if (stateFile.empty()) {
+        return;
+    }
+
+    int err = pairStates->save(stateFile);
+    if (err != 0) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Optimizer: Could not save the pair states into " << stateFile
+                                           << ": " << strerror(err) << commit;
+    }
 }
 
 
@@ -108,7 +132,7 @@ void OptimizerService::runService()
 
 void OptimizerService::optimizeAllPairs() {
 
-    ThreadPool<OptimizerExecutor> execPool(optimizerPoolSize); // Run optimizer for each pair in a separate thread
+    TaskGroup execPool(WorkStealingExecutor::instance(), optimizerPoolSize); // Run optimizer for each pair in a separate task
     auto db = db::DBSingleton::instance().getDBObjectInstance();
 
     // Read all Optimizer configurations from the config file
@@ -138,7 +162,7 @@ void OptimizerService::optimizeAllPairs() {
         for (const auto& pair: pairs) {
             auto *exec = new OptimizerExecutor(OptimizerDataSourceFactory::getDataSource(),
                                                OptimizerCallbacksFactory::getOptimizerCallbacks(),
-                                               pair);
+                                               pair, pairStates);
 
             exec->setSteadyInterval(optimizerSteadyInterval);
             exec->setMaxNumberOfStreams(maxNumberOfStreams);
@@ -152,6 +176,7 @@ void OptimizerService::optimizeAllPairs() {
         }
 
         execPool.join();
+        saveState();
 
         const auto now = std::chrono::steady_clock::now();
         const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(now - start).count();
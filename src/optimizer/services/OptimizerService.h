@@ -24,6 +24,7 @@
 
 #include "server/common/BaseService.h"
 #include "server/services/heartbeat/HeartBeat.h"
+#include "PairStateStore.h"
 
 namespace fts3 {
 namespace optimizer {
@@ -39,6 +40,13 @@ public:
 protected:
     const std::shared_ptr<fts3::server::HeartBeat> heartBeat;
     int optimizerPoolSize;
+
+    /// Pair states kept across runs, shared by the executors
+    std::shared_ptr<PairStateStore> pairStates;
+    /// Where to checkpoint pairStates, if not empty
+    std::string stateFile;
+
+    void saveState();
 };
 
 } // end namespace optimizer
@@ -41,7 +41,8 @@ void OptimizerExecutor::optimizeStreamsForPair(OptimizerMode optMode)
         return;
     }
 
-    auto state = inMemoryStore[pair];
+    PairState state;
+    inMemoryStore->get(pair, &state);
 
     int connectionsAvailable = state.connections;
     int availableTransfers = state.activeCount + state.queueSize;
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+
+#include "PairStateStore.h"
+
+namespace fts3 {
+namespace optimizer {
+
+/// First line of a checkpoint file, so incompatible formats are ignored
+static const char CHECKPOINT_HEADER[] = "# fts-optimizer-pair-state 1";
+
+
+PairStateStore::Shard& PairStateStore::getShard(const Pair &pair)
+{
+    size_t hash = std::hash<std::string>()(pair.source) ^ (std::hash<std::string>()(pair.destination) << 1);
+    return shards[hash % N_SHARDS];
+}
+
+
+const PairStateStore::Shard& PairStateStore::getShard(const Pair &pair) const
+{
+    return const_cast<PairStateStore*>(this)->getShard(pair);
+}
+
+
+bool PairStateStore::get(const Pair &pair, PairState *state) const
+{
+    const Shard &shard = getShard(pair);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto i = shard.states.find(pair);
+    if (i == shard.states.end()) {
+        return false;
+    }
+    *state = i->second;
+    return true;
+}
+
+
+void PairStateStore::put(const Pair &pair, const PairState &state)
+{
+    Shard &shard = getShard(pair);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.states[pair] = state;
+}
+
+
+size_t PairStateStore::expire(time_t olderThan)
+{
+    size_t removed = 0;
+
+    for (auto &shard: shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto i = shard.states.begin(); i != shard.states.end();) {
+            if (i->second.timestamp < olderThan) {
+                i = shard.states.erase(i);
+                ++removed;
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    return removed;
+}
+
+
+size_t PairStateStore::size() const
+{
+    size_t total = 0;
+
+    for (auto &shard: shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        total += shard.states.size();
+    }
+
+    return total;
+}
+
+
+int PairStateStore::save(const std::string &path) const
+{
+    const std::string tmpPath = path + ".tmp";
+
+    std::ofstream out(tmpPath, std::ios::trunc);
+    if (!out) {
+        return errno ? errno : EIO;
+    }
+
+    out.precision(std::numeric_limits<double>::max_digits10);
+    out << CHECKPOINT_HEADER << '\n';
+
+    for (auto &shard: shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto &entry: shard.states) {
+            const PairState &state = entry.second;
+            out << entry.first.source << ' ' << entry.first.destination << ' '
+                << state.timestamp << ' ' << state.throughput << ' ' << state.avgDuration << ' '
+                << state.successRate << ' ' << state.retryCount << ' '
+                << state.activeCount << ' ' << state.queueSize << ' ' << state.ema << ' '
+                << state.filesizeAvg << ' ' << state.filesizeStdDev << ' '
+                << state.connections << '\n';
+        }
+    }
+
+    out.close();
+    if (!out) {
+        int err = errno ? errno : EIO;
+        unlink(tmpPath.c_str());
+        return err;
+    }
+
+    if (rename(tmpPath.c_str(), path.c_str()) < 0) {
+        int err = errno;
+        unlink(tmpPath.c_str());
+        return err;
+    }
+
+    return 0;
+}
+
+
+size_t PairStateStore::load(const std::string &path, time_t olderThan)
+{
+    std::ifstream in(path);
+    std::string line;
+
+    if (!std::getline(in, line) || line != CHECKPOINT_HEADER) {
+        return 0;
+    }
+
+    size_t loaded = 0;
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string source, destination;
+        PairState state;
+
+        fields >> source >> destination
+               >> state.timestamp >> state.throughput >> state.avgDuration
+               >> state.successRate >> state.retryCount
+               >> state.activeCount >> state.queueSize >> state.ema
+               >> state.filesizeAvg >> state.filesizeStdDev
+               >> state.connections;
+
+        if (fields.fail() || state.timestamp < olderThan) {
+            continue;
+        }
+
+        Pair pair(source, destination);
+        Shard &shard = getShard(pair);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (shard.states.emplace(pair, state).second) {
+            ++loaded;
+        }
+    }
+
+    // The entries already stored follow the same rule
+    expire(olderThan);
+    return loaded;
+}
+
+}
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef FTS3_PAIRSTATESTORE_H
+#define FTS3_PAIRSTATESTORE_H
+
+#include <array>
+#include <map>
+#include <shared_mutex>
+#include <string>
+
+#include <db/generic/Pair.h>
+
+namespace fts3 {
+namespace optimizer {
+
+/// Last known state of each pair (throughput EMA, previous decision, timestamps...),
+/// shared by all the optimizer executors and kept across optimizer runs.
+/// Pairs are spread over shards so executors running in parallel rarely contend,
+/// and lookups only take a shared lock.
+class PairStateStore {
+public:
+    PairStateStore() = default;
+
+    PairStateStore(const PairStateStore&) = delete;
+    PairStateStore& operator = (const PairStateStore&) = delete;
+
+    /// Copy into state the stored state for the pair
+    /// @return false if there is nothing stored for the pair
+    bool get(const Pair &pair, PairState *state) const;
+
+    /// Store the state of the pair, replacing the previous one
+    void put(const Pair &pair, const PairState &state);
+
+    /// Remove the pairs not updated since the given time
+    /// @return How many pairs were removed
+    size_t expire(time_t olderThan);
+
+    /// Number of pairs stored
+    size_t size() const;
+
+    /// Write all the states into path, atomically replacing any previous checkpoint
+    /// @return 0 on success, an errno value otherwise
+    int save(const std::string &path) const;
+
+    /// Load the states written by save. Entries already stored are kept.
+    /// Malformed lines are skipped. The pairs not updated since olderThan are not loaded,
+    /// and are expired from the store as well.
+    /// @return How many pairs were loaded
+    size_t load(const std::string &path, time_t olderThan);
+
+private:
+    static const size_t N_SHARDS = 16;
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::map<Pair, PairState> states;
+    };
+
+    std::array<Shard, N_SHARDS> shards;
+
+    Shard& getShard(const Pair &pair);
+    const Shard& getShard(const Pair &pair) const;
+};
+
+}
+}
+
+#endif // FTS3_PAIRSTATESTORE_H
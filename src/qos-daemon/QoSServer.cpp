@@ -40,7 +40,9 @@ using namespace fts3::common;
 using namespace fts3::config;
 
 
-QoSServer::QoSServer(): threadpool(10)
+QoSServer::QoSServer(): threadpool(10),
+    waitingRoom("Staging WaitingRoom"), httpWaitingRoom("HTTP staging WaitingRoom"),
+    archivingWaitingRoom("Archiving WaitingRoom")
 {
     FTS3_COMMON_LOGGER_NEWLOG(TRACE) << "QoS server created" << commit;
 }
@@ -120,6 +120,9 @@ static void doServer()
     auto logLevel = Logger::getLogLevel(ServerConfig::instance().get<std::string>("LogLevel"));
     theLogger().setLogLevel(logLevel);
     theLogger().setProfiling(ServerConfig::instance().get<bool>("Profiling"));
+    theLogger().setAsync(ServerConfig::instance().get<bool>("LogAsync"),
+        ServerConfig::instance().get<int>("LogAsyncQueueSize"),
+        Logger::getOverflowPolicy(ServerConfig::instance().get<std::string>("LogAsyncOverflow")));
 
     if (logLevel <= Logger::LogLevel::DEBUG) {
         setenv("XRD_LOGLEVEL", "Debug", 1);
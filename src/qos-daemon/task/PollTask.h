@@ -98,6 +98,14 @@ public:
         return wait_until > now;
     }
 
+    /**
+     * @return : the time the task is due
+     */
+    time_t getWaitUntil() const
+    {
+        return wait_until;
+    }
+
 private:
     /// checks if the bring online task was cancelled and removes those URLs that were from the context
     void handle_canceled();
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef TIMINGWHEEL_H_
+#define TIMINGWHEEL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+
+/**
+ * Hierarchical timing wheel with a resolution of one second, used by the WaitingRoom.
+ *
+ * Adding an item, and collecting it when due, are constant time operations
+ * regardless of how many items are waiting. Not thread safe.
+ */
+template<typename T>
+class TimingWheel
+{
+public:
+    typedef std::vector<std::unique_ptr<T>> Items;
+
+    /// each level has 2^WHEEL_BITS slots, each slot covers 2^(WHEEL_BITS * level) seconds
+    static const unsigned WHEEL_BITS = 8;
+    static const unsigned WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static const unsigned WHEEL_LEVELS = 4;
+
+    /**
+     * @param start : first second to be processed
+     */
+    explicit TimingWheel(time_t start): nextTick(start), count(0) {}
+
+    TimingWheel(TimingWheel const &) = delete;
+    TimingWheel& operator=(TimingWheel const &) = delete;
+
+    /**
+     * Puts an item into the slot matching its due time.
+     * Items already due are returned by the next call to advance.
+     */
+    void add(std::unique_ptr<T> item, time_t due)
+    {
+        insert(Entry{due, std::move(item)});
+        ++count;
+    }
+
+    /**
+     * Moves into due the items due up to now, included
+     *
+     * @return : the largest delay, in seconds, between an item of the wheel being due and now.
+     *           Items that were already due when added do not count.
+     */
+    time_t advance(time_t now, Items &due)
+    {
+        time_t lateness = 0;
+
+        for (auto &entry : ready) {
+            due.emplace_back(std::move(entry.item));
+        }
+        count -= ready.size();
+        ready.clear();
+
+        while (nextTick <= now) {
+            const time_t tick = nextTick;
+            const size_t before = due.size();
+            processTick(tick, due);
+            if (due.size() > before) {
+                lateness = std::max(lateness, now - tick);
+            }
+        }
+
+        return lateness;
+    }
+
+    /**
+     * @return : true if there are items already due
+     */
+    bool hasReady() const
+    {
+        return !ready.empty();
+    }
+
+    /**
+     * @return : first second not processed yet
+     */
+    time_t getNextTick() const
+    {
+        return nextTick;
+    }
+
+    /**
+     * @return : number of items waiting
+     */
+    size_t size() const
+    {
+        return count;
+    }
+
+    /**
+     * Drops all the items
+     */
+    void clear()
+    {
+        for (auto &level : wheel) {
+            for (auto &slot : level) {
+                slot.clear();
+            }
+        }
+        ready.clear();
+        count = 0;
+    }
+
+private:
+
+    struct Entry {
+        time_t due;
+        std::unique_ptr<T> item;
+    };
+
+    typedef std::vector<Entry> Slot;
+
+    void insert(Entry entry)
+    {
+        if (entry.due < nextTick) {
+            ready.emplace_back(std::move(entry));
+            return;
+        }
+
+        // Pick the lowest level that spans far enough. The slot is chosen from the absolute due time,
+        // so the item is moved to a lower level (or collected) when the wheel reaches that slot.
+        uint64_t delta = entry.due - nextTick;
+        unsigned level = 0;
+        while (level < WHEEL_LEVELS - 1 && delta >= (static_cast<uint64_t>(1) << (WHEEL_BITS * (level + 1)))) {
+            ++level;
+        }
+        const unsigned slot = (static_cast<uint64_t>(entry.due) >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+        wheel[level][slot].emplace_back(std::move(entry));
+    }
+
+    /// Collect the items due at tick, and cascade down the higher levels if they wrap around
+    void processTick(time_t tick, Items &due)
+    {
+        nextTick = tick;
+
+        // When the lower levels wrap around, move down the items of the next slot of the higher levels,
+        // starting from the top, so they can cascade down within the same tick
+        for (unsigned level = WHEEL_LEVELS - 1; level > 0; --level) {
+            const uint64_t mask = (static_cast<uint64_t>(1) << (WHEEL_BITS * level)) - 1;
+            if ((static_cast<uint64_t>(tick) & mask) != 0) {
+                continue;
+            }
+            const unsigned slot = (static_cast<uint64_t>(tick) >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+            Slot cascade;
+            cascade.swap(wheel[level][slot]);
+            for (auto &entry : cascade) {
+                insert(std::move(entry));
+            }
+        }
+
+        Slot &current = wheel[0][static_cast<uint64_t>(tick) & (WHEEL_SLOTS - 1)];
+        for (auto &entry : current) {
+            due.emplace_back(std::move(entry.item));
+        }
+        count -= current.size();
+        current.clear();
+
+        nextTick = tick + 1;
+    }
+
+    /// the timing wheel
+    Slot wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+    /// items already due when added
+    Slot ready;
+    /// first second not processed yet
+    time_t nextTick;
+    /// items waiting, ready included
+    size_t count;
+};
+
+#endif // TIMINGWHEEL_H_
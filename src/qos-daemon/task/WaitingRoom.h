@@ -22,27 +22,41 @@
 #ifndef WAITINGROOM_H_
 #define WAITINGROOM_H_
 
-#include <boost/ptr_container/ptr_list.hpp> // think about using a lockfree queue
+#include <algorithm>
+#include <ctime>
+#include <memory>
+#include <string>
 #include <boost/thread.hpp>
 
+#include "common/Logger.h"
 #include "common/ThreadPool.h"
 
 #include "qos-daemon/task/Gfal2Task.h"
+#include "qos-daemon/task/TimingWheel.h"
 
 
 /**
  * A waiting room for task that will be executed in a while
+ *
+ * Tasks are kept in a TimingWheel, so adding a task, and dispatching it when due,
+ * are constant time operations regardless of how many tasks are waiting.
+ * TASK must provide getWaitUntil(), returning when it is due.
  */
 template<typename TASK, typename BASE = Gfal2Task>
 class WaitingRoom
 {
 public:
 
+    /// how often the number of tasks waiting and dispatched is logged, in seconds
+    static const time_t STATS_INTERVAL = 300;
+
     /**
-     * Default constructor
+     * Constructor
+     *
+     * @param name : used in the log messages
      */
-    WaitingRoom(): pool(NULL) {}
-
+    explicit WaitingRoom(const std::string &name = "WaitingRoom"):
+        name(name), pool(NULL), wheel(time(NULL)), dispatched(0), maxLateness(0), lastStats(time(NULL)) {}
 
     /**
      * Puts new task into the waiting room
@@ -51,8 +65,12 @@ public:
      */
     void add(TASK* task)
     {
+        const time_t due = task->getWaitUntil();
         boost::mutex::scoped_lock lock(m);
-        tasks.push_back(task);
+        wheel.add(std::unique_ptr<TASK>(task), due);
+        if (wheel.hasReady()) {
+            wakeUp.notify_one();
+        }
     }
 
     /**
@@ -87,59 +105,97 @@ private:
      */
     WaitingRoom& operator=(WaitingRoom const &) = delete;
 
-    /// the queue with tasks that are waiting
-    boost::ptr_list<TASK> tasks;
+    /**
+     * Log the number of tasks waiting and dispatched, and the lateness, every STATS_INTERVAL.
+     * Must be called with the mutex held.
+     */
+    void logStats(time_t now);
+
+    /// name used in the log messages
+    const std::string name;
     /// the mutex preventing concurrent access
     boost::mutex m;
+    /// wakes up the dispatcher when a task is added already due
+    boost::condition_variable wakeUp;
     /// the threadpool items are waiting for
     ThreadPool<BASE> * pool;
+    /// the tasks waiting
+    TimingWheel<TASK> wheel;
+
+    /// tasks dispatched since the last report
+    uint64_t dispatched;
+    /// the largest delay, in seconds, between a task being due and being dispatched since the last report
+    time_t maxLateness;
+    /// when the stats were last logged
+    time_t lastStats;
 };
 
+
+template <typename TASK, typename BASE>
+void WaitingRoom<TASK, BASE>::logStats(time_t now)
+{
+    if (now - lastStats < STATS_INTERVAL) {
+        return;
+    }
+
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << name << ": " << wheel.size() << " tasks waiting, "
+        << dispatched << " dispatched in the last " << (now - lastStats) << "s, "
+        << "max lateness " << maxLateness << "s" << commit;
+
+    dispatched = 0;
+    maxLateness = 0;
+    lastStats = now;
+}
+
+
 template <typename TASK, typename BASE>
 void WaitingRoom<TASK, BASE>::run()
 {
-    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "WaitingRoom starting" << commit;
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << name << " starting" << commit;
 
     while (!boost::this_thread::interruption_requested()) {
         try {
-            boost::this_thread::sleep(boost::posix_time::seconds(1));
-
-            // lock the mutex
-            boost::mutex::scoped_lock lock(this->m);
-            // get current time
-            time_t now = time(NULL);
-            // iterate over all tasks
-            typename boost::ptr_list<TASK>::iterator it, next = this->tasks.begin();
-            while ((it = next) != this->tasks.end()) {
+            typename TimingWheel<TASK>::Items due;
+            {
+                boost::mutex::scoped_lock lock(this->m);
+
+                // Sleep until the next tick, unless something is already due
+                if (!this->wheel.hasReady()) {
+                    this->wakeUp.timed_wait(lock, boost::posix_time::from_time_t(this->wheel.getNextTick()));
+                }
+
+                const time_t now = time(NULL);
+                this->maxLateness = std::max(this->maxLateness, this->wheel.advance(now, due));
+                this->dispatched += due.size();
+                logStats(now);
+            }
+
+            // Start the tasks without blocking add()
+            for (auto &task : due) {
                 if (boost::this_thread::interruption_requested())
                     return;
-                // next item to check
-                ++next;
-                // if the time has not yet come for the task, simply continue
-                if (it->waiting(now))
-                    continue;
-                // otherwise start the task
-                this->pool->start(this->tasks.release(it).release());
+                this->pool->start(task.release());
             }
         }
         catch (const boost::thread_interrupted&) {
-            FTS3_COMMON_LOGGER_NEWLOG(INFO) << "WaitingRoom interruption requested" << commit;
+            FTS3_COMMON_LOGGER_NEWLOG(INFO) << name << " interruption requested" << commit;
             break;
         }
         catch (const std::exception& e) {
-            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "WaitingRoom error: " << e.what() << commit;
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << name << " error: " << e.what() << commit;
             FTS3_COMMON_LOGGER_NEWLOG(CRIT) << "Aborting daemon!" << commit;
             exit(1);
         }
         catch (...) {
-            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "WaitingRoom unknown exception" << commit;
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << name << " unknown exception" << commit;
             FTS3_COMMON_LOGGER_NEWLOG(CRIT) << "Aborting daemon!" << commit;
             exit(1);
         }
     }
 
-    tasks.clear();
-    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "WaitingRoom exiting" << commit;
+    boost::mutex::scoped_lock lock(this->m);
+    wheel.clear();
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << name << " exiting" << commit;
 }
 
 #endif // WAITINGROOM_H_
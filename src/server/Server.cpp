@@ -30,6 +30,8 @@
 #include "services/heartbeat/HeartBeat.h"
 #include "services/transfers/MessageProcessingService.h"
 #include "services/transfers/SupervisorService.h"
+#include "services/transfers/UrlCopyProcessRegistry.h"
+#include "services/transfers/UrlCopyWorkerPool.h"
 
 
 using namespace fts3::common;
@@ -79,6 +81,17 @@ void Server::start()
         {"SchedulingInterval", "SchedulingGraceTime", 3}
     });
 
+    // Keep counting the url-copy processes left running by a previous instance
+    int adopted = UrlCopyProcessRegistry::get_instance().adoptRunning();
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Tracking " << adopted << " fts_url_copy processes already running" << commit;
+
+    auto urlCopyWorkers = ServerConfig::instance().get<int>("UrlCopyWorkers");
+    if (urlCopyWorkers > 0) {
+        UrlCopyWorkerPool::get_instance().start(
+            ServerConfig::instance().get<std::string>("MessagingDirectory"), urlCopyWorkers,
+            ServerConfig::instance().get<int>("UrlCopyWorkerMaxTransfers"));
+    }
+
     auto heartBeatService = std::make_shared<HeartBeat>(processName);
 
     auto cleanerService = std::make_shared<CleanerService>();
@@ -140,6 +153,7 @@ void Server::stop()
 {
     FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Request to stop the server" << commit;
     systemThreads.interrupt_all();
+    UrlCopyWorkerPool::get_instance().stop();
 }
 
 
@@ -22,6 +22,7 @@
 
 #include <signal.h>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <sstream>
 #include <common/PidTools.h>
@@ -32,6 +33,7 @@
 #include "common/Logger.h"
 #include "common/panic.h"
 #include "db/generic/SingleDbInstance.h"
+#include "msg-bus/Journal.h"
 
 #include "Server.h"
 
@@ -109,6 +111,9 @@ static void doServer(void)
     }
     theLogger().setLogLevel(Logger::getLogLevel(ServerConfig::instance().get<std::string>("LogLevel")));
     theLogger().setProfiling(ServerConfig::instance().get<bool>("Profiling"));
+    theLogger().setAsync(ServerConfig::instance().get<bool>("LogAsync"),
+        ServerConfig::instance().get<int>("LogAsyncQueueSize"),
+        Logger::getOverflowPolicy(ServerConfig::instance().get<std::string>("LogAsyncOverflow")));
 
     FTS3_COMMON_LOGGER_NEWLOG(INFO)<< "Starting server... (process_id=" << getpid() << ")" << commit;
 
@@ -193,6 +198,35 @@ static void runEnvironmentChecks()
 }
 
 
+/// Enable the journal for the messaging queues listed in the configuration, and disable it for the rest.
+/// This needs to happen before any producer is created, since they check only once.
+static void setupMessagingJournals()
+{
+    static const std::vector<std::string> supportedQueues = {"status", "logs", "deletion", "staging"};
+
+    std::string monDir = ServerConfig::instance().get<std::string> ("MessagingDirectory");
+    std::string journalQueuesStr = ServerConfig::instance().get<std::string> ("MessagingJournalQueues");
+
+    std::vector<std::string> journalQueues;
+    boost::split(journalQueues, journalQueuesStr, boost::is_any_of(", "), boost::token_compress_on);
+    journalQueues.erase(std::remove(journalQueues.begin(), journalQueues.end(), ""), journalQueues.end());
+
+    for (const auto &queue: journalQueues) {
+        if (std::find(supportedQueues.begin(), supportedQueues.end(), queue) == supportedQueues.end()) {
+            throw SystemError("MessagingJournalQueues: " + queue + " does not support a journal");
+        }
+    }
+
+    for (const auto &queue: supportedQueues) {
+        bool enabled = std::find(journalQueues.begin(), journalQueues.end(), queue) != journalQueues.end();
+        Journal::setEnabled(monDir + "/" + queue + ".journal", enabled);
+        if (enabled) {
+            FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Using a journal for the " << queue << " queue" << commit;
+        }
+    }
+}
+
+
 /// Prepare, fork and run FTS3
 static void spawnServer()
 {
@@ -205,6 +239,7 @@ static void spawnServer()
     }
 
     runEnvironmentChecks();
+    setupMessagingJournals();
 
     bool isDaemon = !ServerConfig::instance().get<bool> ("no-daemon");
 
@@ -22,6 +22,7 @@
 
 #include <boost/filesystem.hpp>
 #include "config/ServerConfig.h"
+#include "cred/CredentialCache.h"
 #include "db/generic/SingleDbInstance.h"
 #include "msg-bus/consumer.h"
 
@@ -91,6 +92,11 @@ void CleanerService::runService()
             if (multihopSanitySate >0 && counter % multihopSanitySate == 0) {
                 db::DBSingleton::instance().getDBObjectInstance()->multihopSanitySate();
             }
+
+            // Every minute, renew the cached proxies before they expire
+            if (counter % 60 == 0) {
+                CredentialCache::instance().refresh();
+            }
         } catch (const boost::thread_interrupted&) {
             FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Thread interruption requested in CleanerService!" << commit;
             break;
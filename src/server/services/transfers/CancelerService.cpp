@@ -25,8 +25,10 @@
 #include "common/Logger.h"
 #include "config/ServerConfig.h"
 #include "server/common/DrainMode.h"
+#include "SchedulingTrigger.h"
 #include "SingleTrStateInstance.h"
 #include "ThreadSafeList.h"
+#include "UrlCopyWorkerPool.h"
 
 
 using namespace fts3::common;
@@ -71,7 +73,7 @@ void CancelerService::markAsStalled()
                 }
 
                 FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Sending sigkill to process: " << message.process_id() << commit;
-                kill(message.process_id(), SIGKILL);
+                UrlCopyWorkerPool::get_instance().kill(message.process_id(), message.file_id(), SIGKILL);
             }
 
             boost::tuple<bool, std::string> updated =
@@ -89,18 +91,20 @@ void CancelerService::markAsStalled()
             }
         }
         ThreadSafeList::get_instance().deleteMsg(messages);
+        SchedulingTrigger::get_instance().notify();
     }
 }
 
 
 void CancelerService::killCanceledByUser()
 {
-    std::vector<int> requestIDs;
+    std::vector<std::pair<int, uint64_t>> requestIDs;
     DBSingleton::instance().getDBObjectInstance()->getCancelJob(requestIDs);
     if (!requestIDs.empty())
     {
         FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Killing transfers canceled by the user" << commit;
         killRunningJob(requestIDs);
+        SchedulingTrigger::get_instance().notify();
     }
 }
 
@@ -136,7 +140,7 @@ void CancelerService::applyActiveTimeouts()
             FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Killing pid:" << i->pid
                 << ", jobid:" << i->jobId << ", fileid:" << i->fileId
                 << " because it was stalled" << commit;
-            kill(i->pid, SIGKILL);
+            UrlCopyWorkerPool::get_instance().kill(i->pid, i->fileId, SIGKILL);
         }
         else {
             FTS3_COMMON_LOGGER_NEWLOG(WARNING)
@@ -156,6 +160,10 @@ void CancelerService::applyActiveTimeouts()
         messages.emplace_back(msg);
     }
     ThreadSafeList::get_instance().deleteMsg(messages);
+
+    if (!stalled.empty()) {
+        SchedulingTrigger::get_instance().notify();
+    }
 }
 
 
@@ -289,25 +297,25 @@ void CancelerService::runService()
 }
 
 
-void CancelerService::killRunningJob(const std::vector<int>& pids)
+void CancelerService::killRunningJob(const std::vector<std::pair<int, uint64_t>>& pids)
 {
     int sigKillDelay = ServerConfig::instance().get<int>("SigKillDelay");
 
     for (auto iter = pids.begin(); iter != pids.end(); ++iter)
     {
-        int pid = *iter;
+        int pid = iter->first;
         FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Canceling and killing running processes: " << pid << commit;
-        kill(pid, SIGTERM);
+        UrlCopyWorkerPool::get_instance().kill(pid, iter->second, SIGTERM);
     }
 
     FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Giving " << sigKillDelay << "ms for graceful termination" << commit;
     boost::this_thread::sleep(boost::posix_time::milliseconds(sigKillDelay));
 
     for (auto iter = pids.begin(); iter != pids.end(); ++iter) {
-        int pid = *iter;
-        if (kill(pid, 0) == 0) {
+        int pid = iter->first;
+        if (UrlCopyWorkerPool::get_instance().kill(pid, iter->second, 0) == 0) {
             FTS3_COMMON_LOGGER_NEWLOG(INFO) << "SIGKILL pid: " << pid << commit;
-            kill(pid, SIGKILL);
+            UrlCopyWorkerPool::get_instance().kill(pid, iter->second, SIGKILL);
         }
     }
 }
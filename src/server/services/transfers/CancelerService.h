@@ -40,7 +40,7 @@ public:
     virtual void runService();
 
 private:
-    void killRunningJob(const std::vector<int>& pids);
+    void killRunningJob(const std::vector<std::pair<int, uint64_t>>& pids);
     void markAsStalled();
     void killCanceledByUser();
     void applyQueueTimeouts();
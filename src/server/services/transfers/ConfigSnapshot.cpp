@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+
+#include "ConfigSnapshot.h"
+
+
+namespace fts3 {
+namespace server {
+
+
+static std::atomic<uint64_t> snapshotVersion(0);
+
+
+ConfigSnapshot::ConfigSnapshot(GenericDbIfce *db): db(db), version(++snapshotVersion)
+{
+}
+
+
+const ConfigSnapshot::VoSettings& ConfigSnapshot::getVoSettings(const std::string &voName)
+{
+    return lookup(voSettings, voName, [&]() {
+        VoSettings settings;
+        settings.secPerMb = db->getSecPerMb(voName);
+        settings.globalTimeout = db->getGlobalTimeout(voName);
+        settings.disableStreaming = db->getDisableStreamingFlag(voName);
+        settings.publishUserDn = db->publishUserDn(voName);
+        return settings;
+    });
+}
+
+
+const ConfigSnapshot::LinkSettings& ConfigSnapshot::getLinkSettings(const std::string &sourceSe,
+    const std::string &destSe)
+{
+    return lookup(linkSettings, std::make_pair(sourceSe, destSe), [&]() {
+        LinkSettings settings;
+        settings.nostreams = db->getStreamsOptimization(sourceSe, destSe);
+        settings.ipv6 = db->isProtocolIPv6(sourceSe, destSe);
+        settings.udt = db->isProtocolUDT(sourceSe, destSe);
+        settings.debugLevel = db->getDebugLevel(sourceSe, destSe);
+        settings.disableDelegation = db->getDisableDelegationFlag(sourceSe, destSe);
+        settings.thirdPartyTURL = db->getThirdPartyTURL(sourceSe, destSe);
+        settings.copyMode = db->getCopyMode(sourceSe, destSe);
+        return settings;
+    });
+}
+
+
+const StorageConfig& ConfigSnapshot::getStorageConfig(const std::string &storage)
+{
+    return lookup(storageConfigs, storage, [&]() {
+        return db->getStorageConfig(storage);
+    });
+}
+
+
+boost::tribool ConfigSnapshot::getSkipEvictionFlag(const std::string &storage)
+{
+    return lookup(skipEvictionFlags, storage, [&]() {
+        return db->getSkipEvictionFlag(storage);
+    });
+}
+
+
+boost::tribool ConfigSnapshot::getOverwriteDiskEnabledFlag(const std::string &storage)
+{
+    return lookup(overwriteDiskFlags, storage, [&]() {
+        return db->getOverwriteDiskEnabledFlag(storage);
+    });
+}
+
+
+int ConfigSnapshot::getRetry(const std::string &jobId)
+{
+    return lookup(retries, jobId, [&]() {
+        return db->getRetry(jobId);
+    });
+}
+
+} // end namespace server
+} // end namespace fts3
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef CONFIGSNAPSHOT_H_
+#define CONFIGSNAPSHOT_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <boost/logic/tribool.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "db/generic/GenericDbIfce.h"
+
+
+namespace fts3 {
+namespace server {
+
+/// Read-mostly view of the link, storage and VO configuration used to build
+/// the fts_url_copy command line.
+/// A new snapshot is created for every scheduling cycle and shared by all the
+/// FileTransferExecutor of that cycle, so each distinct VO, pair or storage
+/// is resolved against the database only once per cycle.
+/// Entries are loaded lazily and are never modified once inserted.
+class ConfigSnapshot: public boost::noncopyable
+{
+public:
+    /// Configuration bound to a VO (t_server_config)
+    struct VoSettings {
+        VoSettings(): secPerMb(0), globalTimeout(0), disableStreaming(false), publishUserDn(false) {}
+
+        int secPerMb;
+        int globalTimeout;
+        bool disableStreaming;
+        bool publishUserDn;
+    };
+
+    /// Configuration bound to a source/destination pair (t_link_config, t_se, t_optimizer)
+    struct LinkSettings {
+        LinkSettings(): nostreams(0), ipv6(boost::indeterminate), udt(boost::indeterminate),
+            debugLevel(0), disableDelegation(false), copyMode(CopyMode::ANY) {}
+
+        int nostreams;
+        boost::tribool ipv6;
+        boost::tribool udt;
+        unsigned debugLevel;
+        bool disableDelegation;
+        std::string thirdPartyTURL;
+        CopyMode copyMode;
+    };
+
+    /// Create an empty snapshot on top of the given DB interface
+    explicit ConfigSnapshot(GenericDbIfce *db);
+
+    /// Monotonically increasing identifier of this snapshot, for logging
+    uint64_t getVersion() const {
+        return version;
+    }
+
+    /// Configuration for the given VO
+    const VoSettings& getVoSettings(const std::string &voName);
+
+    /// Configuration for the given source/destination pair
+    const LinkSettings& getLinkSettings(const std::string &sourceSe, const std::string &destSe);
+
+    /// Storage configuration, already merged with the '*' entry
+    const StorageConfig& getStorageConfig(const std::string &storage);
+
+    /// Skip eviction flag for the given storage
+    boost::tribool getSkipEvictionFlag(const std::string &storage);
+
+    /// "Overwrite-when-only-on-disk" flag for the given storage
+    boost::tribool getOverwriteDiskEnabledFlag(const std::string &storage);
+
+    /// Maximum number of retries configured for the given job
+    int getRetry(const std::string &jobId);
+
+private:
+    GenericDbIfce *db;
+    uint64_t version;
+
+    std::mutex mutex;
+    std::map<std::string, VoSettings> voSettings;
+    std::map<std::pair<std::string, std::string>, LinkSettings> linkSettings;
+    std::map<std::string, StorageConfig> storageConfigs;
+    std::map<std::string, boost::tribool> skipEvictionFlags;
+    std::map<std::string, boost::tribool> overwriteDiskFlags;
+    std::map<std::string, int> retries;
+
+    /// Return the cached value for key, or load and cache it.
+    /// The loader runs without holding the lock, so concurrent misses on different
+    /// keys do not serialize on the database. std::map references are stable on insert.
+    template <typename K, typename V, typename Loader>
+    const V& lookup(std::map<K, V> &cache, const K &key, Loader loader)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto i = cache.find(key);
+            if (i != cache.end()) {
+                return i->second;
+            }
+        }
+        V value = loader();
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache.emplace(key, std::move(value)).first->second;
+    }
+};
+
+} // end namespace server
+} // end namespace fts3
+
+#endif // CONFIGSNAPSHOT_H_
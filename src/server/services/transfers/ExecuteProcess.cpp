@@ -18,163 +18,85 @@
  * limitations under the License.
  */
 
-#include <list>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <sys/stat.h>
-#include <cassert>
-#include <cstddef>
-#include <cstdlib>
-#include <cstdio>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <vector>
 #include <string>
-#include <fstream>
-#include <sstream>
-#include <iomanip>
-#include <stdio.h>
-#include <signal.h>
 #include <paths.h>
-#include <fcntl.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <sys/wait.h>
-#include <errno.h>
-#include <iostream>
-#include <fstream>
-#include <dirent.h>
-#include <sys/socket.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
-#include "db/generic/SingleDbInstance.h"
 #include "common/Logger.h"
 #include "ExecuteProcess.h"
-#include "common/Exceptions.h"
 
 
 using namespace fts3::common;
-using namespace db;
 
 
 ExecuteProcess::ExecuteProcess(const std::string &app, const std::string &arguments)
+    : pid(0), m_app(app)
+{
+    boost::split(m_arguments, arguments, boost::is_any_of(" "), boost::token_compress_on);
+    m_arguments.erase(std::remove(m_arguments.begin(), m_arguments.end(), std::string()), m_arguments.end());
+}
+
+
+ExecuteProcess::ExecuteProcess(const std::string &app, const std::vector<std::string> &arguments)
     : pid(0), m_app(app), m_arguments(arguments)
 {
 }
 
+
 int ExecuteProcess::executeProcessShell(std::string &forkMessage)
 {
     return execProcessShell(forkMessage);
 }
 
-// argsHolder is used to keep the argument pointers alive
-// for as long as needed
-void ExecuteProcess::getArgv(std::list<std::string> &argsHolder, size_t *argc, char ***argv)
-{
-    boost::split(argsHolder, m_arguments, boost::is_any_of(" "));
-
-    *argc = argsHolder.size() + 2; // Need place for the binary and the NULL
-    *argv = new char *[*argc];
-
-    std::list<std::string>::iterator it;
-    int i = 0;
-    (*argv)[i] = const_cast<char *> (m_app.c_str());
-    for (it = argsHolder.begin(); it != argsHolder.end(); ++it) {
-        ++i;
-        (*argv)[i] = const_cast<char *> (it->c_str());
-    }
-
-    ++i;
-    (*argv)[i] = NULL;
-}
 
 int ExecuteProcess::execProcessShell(std::string &forkMessage)
 {
-    // Open pipe
-    int pipefds[2] = {0, 0};
-    if (pipe(pipefds)) {
-        forkMessage = "Failed to create pipe between parent/child processes";
-        FTS3_COMMON_LOGGER_NEWLOG(ERR) << forkMessage << commit;
-        return -1;
+    // Prepare everything in the parent: the child only execs
+    std::vector<char*> argv;
+    argv.reserve(m_arguments.size() + 2);
+    argv.push_back(const_cast<char*>(m_app.c_str()));
+    for (auto &arg: m_arguments) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
     }
-    if (fcntl(pipefds[1], F_SETFD, fcntl(pipefds[1], F_GETFD) | FD_CLOEXEC)) {
-        close(pipefds[0]);
-        close(pipefds[1]);
+    argv.push_back(NULL);
 
-        forkMessage = "Failed to set fd FD_CLOEXEC";
-        FTS3_COMMON_LOGGER_NEWLOG(ERR) << forkMessage << commit;
-        return -1;
-    }
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_init(&attr);
+    posix_spawn_file_actions_init(&actions);
+
+    // Detach from parent, set the working directory,
+    // and close all open file descriptors except stdin, stdout and stderr
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+    posix_spawn_file_actions_addchdir_np(&actions, _PATH_TMP);
+    posix_spawn_file_actions_addclosefrom_np(&actions, 3);
 
     signal(SIGCLD, SIG_IGN);
     signal(SIGPIPE, SIG_IGN);
 
-    pid = fork();
-    // Error
-    if (pid == -1) {
-        close(pipefds[0]);
-        close(pipefds[1]);
+    // glibc runs the child on the parent memory until it execs (CLONE_VM | CLONE_VFORK),
+    // and reports back if the exec failed
+    pid_t child = 0;
+    int err = posix_spawnp(&child, m_app.c_str(), &actions, &attr, argv.data(), environ);
 
-        forkMessage = "Failed to fork " + std::string(strerror(errno));
-        FTS3_COMMON_LOGGER_NEWLOG(ERR) << forkMessage << commit;
-        return -1;
-    }
-        // Child
-    else if (pid == 0) {
-        // Detach from parent
-        setsid();
-
-        // Set working directory
-        if (chdir(_PATH_TMP) != 0)
-            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Failed to chdir" << commit;
-
-        // Close all open file descriptors except stdin, stdout, stderr and parent pipe
-        if ((unsigned int)pipefds[1] > 3 && (unsigned int)pipefds[1] < ~0U) {
-            close_range(3, (unsigned int)pipefds[1] - 1, CLOSE_RANGE_UNSHARE);
-            close_range((unsigned int)pipefds[1] + 1, ~0U, CLOSE_RANGE_UNSHARE);
-        } else {
-            close_range(3, ~0U, CLOSE_RANGE_UNSHARE);
-        }
-
-        // Redirect stderr (points to the log)
-        //stderr = freopen("/dev/null", "a", stderr);
-
-        // Get parameter array
-        std::list<std::string> argsHolder;
-        size_t argc;
-        char **argv;
-        getArgv(argsHolder, &argc, &argv);
-
-        // Execute the new binary
-        execvp(m_app.c_str(), argv);
-
-        // If we are here, execvp failed, so write the errno to the pipe
-        if (write(pipefds[1], &errno, sizeof(int)) < 0) {
-            fprintf(stderr, "Failed to write to the pipe!");
-        }
-        _exit(EXIT_FAILURE);
-    }
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
 
-    // Parent process
-    // Close writing end of the pipe, and wait and see if we got an error from
-    // the child
-    close(pipefds[1]);
-
-    ssize_t count = 0;
-    int err = 0;
-    while ((count = read(pipefds[0], &err, sizeof(err))) == -1) {
-        if (errno != EAGAIN && errno != EINTR) break;
-    }
-    if (count) {
-        forkMessage = "Child process failed to execute: " + std::string(strerror(errno));
+    if (err != 0) {
+        forkMessage = "Child process failed to execute: " + std::string(strerror(err));
         FTS3_COMMON_LOGGER_NEWLOG(ERR) << forkMessage << commit;
         return -1;
     }
 
-    // Close reading end
-    close(pipefds[0]);
-
+    pid = child;
     return 0;
 }
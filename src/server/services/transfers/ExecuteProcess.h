@@ -21,13 +21,20 @@
 #pragma once
 
 #include <string>
-#include <map>
+#include <vector>
 
 
+/// Spawns a detached process (new session, running from the temporary directory,
+/// and without any inherited descriptor besides stdin, stdout and stderr).
+/// The process is started with posix_spawn, so the (large, multi-threaded) parent
+/// does not need to be forked.
 class ExecuteProcess
 {
 public:
+    /// arguments is split by spaces
     ExecuteProcess(const std::string& app, const std::string& arguments);
+    ExecuteProcess(const std::string& app, const std::vector<std::string>& arguments);
+
     int executeProcessShell(std::string& forkMessage);
 
     inline int getPid()
@@ -37,10 +44,9 @@ public:
 
 protected:
     int execProcessShell(std::string& forkMessage);
-    void getArgv(std::list<std::string>& argsHolder, size_t* argc, char*** argv);
 
 private:
     int pid;
     std::string m_app;
-    std::string m_arguments;
+    std::vector<std::string> m_arguments;
 };
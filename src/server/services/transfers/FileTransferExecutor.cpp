@@ -21,6 +21,7 @@
 #include "FileTransferExecutor.h"
 
 #include "common/Logger.h"
+#include "common/WorkStealingExecutor.h"
 #include "ExecuteProcess.h"
 #include "SingleTrStateInstance.h"
 
@@ -28,6 +29,8 @@
 #include "CloudStorageConfig.h"
 #include "ThreadSafeList.h"
 #include "UrlCopyCmd.h"
+#include "UrlCopyProcessRegistry.h"
+#include "UrlCopyWorkerPool.h"
 #include <iostream>
 
 #define BOOST_SPIRIT_THREADSAFE
@@ -45,14 +48,22 @@ namespace server
 
 FileTransferExecutor::FileTransferExecutor(TransferFile &tf,
     bool monitoringMsg, std::string FTSInstanceAlias,
-    std::string proxy, std::string logDir, std::string msgDir) :
+    std::string proxy, std::string logDir, std::string msgDir,
+    std::shared_ptr<ConfigSnapshot> config) :
     tf(tf),
     monitoringMsg(monitoringMsg),
     FTSInstanceAlias(FTSInstanceAlias),
     proxy(proxy),
     logsDir(logDir),
     msgDir(msgDir),
-    db(DBSingleton::instance().getDBObjectInstance())
+    db(DBSingleton::instance().getDBObjectInstance()),
+    config(config)
+{
+}
+
+
+FileTransferExecutor::FileTransferExecutor(TransferFile &tf) :
+    tf(tf), monitoringMsg(false), db(NULL)
 {
 }
 
@@ -87,237 +98,257 @@ void FileTransferExecutor::run(boost::any & ctx)
 
     int &scheduled = boost::any_cast<int &>(ctx);
 
+    try {
+        if (prepare() && launch()) {
+            scheduled += 1;
+        }
+    }
+    catch (std::exception &e) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception " << e.what() << commit;
+    }
+    catch (...) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception unknown" << commit;
+    }
+}
+
+
+bool FileTransferExecutor::prepare()
+{
     //stop forking when a signal is received to avoid deadlocks
-    if (tf.fileId == 0 || boost::this_thread::interruption_requested()) {
-        return;
+    if (tf.fileId == 0 || common::TaskGroup::interruptionRequested()) {
+        return false;
     }
 
-    try {
-        // if the pair was already checked and not scheduled skip it
-        if (notScheduled.count(make_pair(tf.sourceSe, tf.destSe))) {
-            return;
-        }
+    // if the pair was already checked and not scheduled skip it
+    if (notScheduled.count(make_pair(tf.sourceSe, tf.destSe))) {
+        return false;
+    }
 
-        // check if manual config exist for this pair and vo
-        std::vector< std::shared_ptr<ShareConfig> > cfgs;
+    // Set to READY state when true
+    // Note: only check if allowed for MySQL and not "FORCE_START"
+    if ((db->getDbtype() != "postgresql") &&
+        (tf.fileState != "FORCE_START") &&
+        (!db->isTrAllowed(tf.sourceSe, tf.destSe)))
+    {
+        notScheduled.insert(make_pair(tf.sourceSe, tf.destSe));
+        return false;
+    }
 
-        // Set to READY state when true
-        // Note: only check if allowed for MySQL and not "FORCE_START"
-        if ((db->getDbtype() == "postgresql") ||
-            (tf.fileState == "FORCE_START") ||
-            (db->isTrAllowed(tf.sourceSe, tf.destSe)))
-        {
-            UrlCopyCmd cmdBuilder;
+    const ConfigSnapshot::VoSettings &voSettings = config->getVoSettings(tf.voName);
+    const ConfigSnapshot::LinkSettings &linkSettings = config->getLinkSettings(tf.sourceSe, tf.destSe);
 
-            int secPerMB = db->getSecPerMb(tf.voName);
-            if (secPerMB > 0) {
-                cmdBuilder.setSecondsPerMB(secPerMB);
-            }
+    if (voSettings.secPerMb > 0) {
+        cmdBuilder.setSecondsPerMB(voSettings.secPerMb);
+    }
 
-            TransferFile::ProtocolParameters protocolParams = tf.getProtocolParameters();
+    TransferFile::ProtocolParameters protocolParams = tf.getProtocolParameters();
 
-            if (tf.internalFileParams.empty()) {
-                protocolParams.nostreams = db->getStreamsOptimization(tf.sourceSe, tf.destSe);
-                protocolParams.timeout = db->getGlobalTimeout(tf.voName);
-                protocolParams.ipv6 = db->isProtocolIPv6(tf.sourceSe, tf.destSe);
-                protocolParams.udt = db->isProtocolUDT(tf.sourceSe, tf.destSe);
-            }
+    if (tf.internalFileParams.empty()) {
+        protocolParams.nostreams = linkSettings.nostreams;
+        protocolParams.timeout = voSettings.globalTimeout;
+        protocolParams.ipv6 = linkSettings.ipv6;
+        protocolParams.udt = linkSettings.udt;
+    }
 
-            cmdBuilder.setFromProtocol(protocolParams);
+    cmdBuilder.setFromProtocol(protocolParams);
 
-            // Update from the transfer
-            cmdBuilder.setFromTransfer(tf, false, db->publishUserDn(tf.voName), msgDir);
+    // Update from the transfer
+    cmdBuilder.setFromTransfer(tf, false, voSettings.publishUserDn, msgDir);
 
-            // Set Auth method in the command line options
-            std::string authMethod = FileTransferExecutor::getAuthMethod(tf.jobMetadata);
-            cmdBuilder.setAuthMethod(authMethod);
+    // Set Auth method in the command line options
+    std::string authMethod = FileTransferExecutor::getAuthMethod(tf.jobMetadata);
+    cmdBuilder.setAuthMethod(authMethod);
 
-            // Cloud storage credentials
-            std::string cloudStorageConfig = generateCloudStorageConfigFile(db, tf, authMethod);
-            if (!cloudStorageConfig.empty()) {
-                cmdBuilder.setCloudConfigFile(cloudStorageConfig);
-            }
+    // Cloud storage credentials
+    std::string cloudStorageConfig = generateCloudStorageConfigFile(db, tf, authMethod);
+    if (!cloudStorageConfig.empty()) {
+        cmdBuilder.setCloudConfigFile(cloudStorageConfig);
+    }
 
-            // Transfer using OAuth2 tokens
-            if (authMethod == "oauth2") {
-                auto [src_token, src_unmanaged] = db->findToken(tf.sourceTokenId);
-                auto [dst_token, dst_unmanaged] = db->findToken(tf.destinationTokenId);
-
-                std::string oauthCredentials = generateOAuthConfigFile(src_token, dst_token);
-                if (!oauthCredentials.empty()) {
-                    cmdBuilder.setOAuthFile(oauthCredentials);
-                    // Should be set via the "setFromTransfer()" function, but ATs are not
-                    // Keep these functions grouped together until refactoring
-                    cmdBuilder.setSourceTokenId(tf.sourceTokenId);
-                    cmdBuilder.setDestinationTokenId(tf.destinationTokenId);
-                    cmdBuilder.setSourceTokenUnmanaged(src_unmanaged);
-                    cmdBuilder.setDestinationTokenUnmanaged(dst_unmanaged);
-                    if (!src_unmanaged || !dst_unmanaged) {
-                        cmdBuilder.setTokenRefreshMarginPeriod(fts3::config::ServerConfig::instance().get<int>("TokenRefreshMarginPeriod"));
-                    }
-                }
+    // Transfer using OAuth2 tokens
+    if (authMethod == "oauth2") {
+        auto [src_token, src_unmanaged] = db->findToken(tf.sourceTokenId);
+        auto [dst_token, dst_unmanaged] = db->findToken(tf.destinationTokenId);
+
+        std::string oauthCredentials = generateOAuthConfigFile(src_token, dst_token);
+        if (!oauthCredentials.empty()) {
+            cmdBuilder.setOAuthFile(oauthCredentials);
+            // Should be set via the "setFromTransfer()" function, but ATs are not
+            // Keep these functions grouped together until refactoring
+            cmdBuilder.setSourceTokenId(tf.sourceTokenId);
+            cmdBuilder.setDestinationTokenId(tf.destinationTokenId);
+            cmdBuilder.setSourceTokenUnmanaged(src_unmanaged);
+            cmdBuilder.setDestinationTokenUnmanaged(dst_unmanaged);
+            if (!src_unmanaged || !dst_unmanaged) {
+                cmdBuilder.setTokenRefreshMarginPeriod(fts3::config::ServerConfig::instance().get<int>("TokenRefreshMarginPeriod"));
             }
+        }
+    }
 
-            // Debug level
-            cmdBuilder.setDebugLevel(db->getDebugLevel(tf.sourceSe, tf.destSe));
+    // Debug level
+    cmdBuilder.setDebugLevel(linkSettings.debugLevel);
 
-            // Disable delegation (according to link config)
-            cmdBuilder.setDisableDelegation(db->getDisableDelegationFlag(tf.sourceSe, tf.destSe));
+    // Disable delegation (according to link config)
+    cmdBuilder.setDisableDelegation(linkSettings.disableDelegation);
 
-            // Get SRM 3rd party TURL (according to link config)
-            auto thirdPartyTURL = db->getThirdPartyTURL(tf.sourceSe, tf.destSe);
-            if (!thirdPartyTURL.empty()) {
-                cmdBuilder.setThirdPartyTURL(thirdPartyTURL);
-            }
+    // Get SRM 3rd party TURL (according to link config)
+    if (!linkSettings.thirdPartyTURL.empty()) {
+        cmdBuilder.setThirdPartyTURL(linkSettings.thirdPartyTURL);
+    }
 
-            // Disable streaming via local transfers (according to global config)
-            cmdBuilder.setDisableStreaming(db->getDisableStreamingFlag(tf.voName));
+    // Disable streaming via local transfers (according to global config)
+    cmdBuilder.setDisableStreaming(voSettings.disableStreaming);
 
-            // Enable monitoring
-            cmdBuilder.setMonitoring(monitoringMsg, msgDir);
+    // Enable monitoring
+    cmdBuilder.setMonitoring(monitoringMsg, msgDir);
 
-            // Set UrlCopyProcess ping interval (in seconds)
-            cmdBuilder.setPingInterval(fts3::config::ServerConfig::instance().get<int>("UrlCopyProcessPingInterval"));
+    // Set UrlCopyProcess ping interval (in seconds)
+    cmdBuilder.setPingInterval(fts3::config::ServerConfig::instance().get<int>("UrlCopyProcessPingInterval"));
 
-            // Set proxy path if authentication method is not OAuth2
-            if (!proxy.empty() && authMethod != "oauth2") {
-                cmdBuilder.setProxy(proxy);
-            }
+    // Set proxy path if authentication method is not OAuth2
+    if (!proxy.empty() && authMethod != "oauth2") {
+        cmdBuilder.setProxy(proxy);
+    }
 
-            // UDT and IPv6
-            cmdBuilder.setUDT(db->isProtocolUDT(tf.sourceSe, tf.destSe));
-            if (!cmdBuilder.isIPv6Explicit()) {
-                cmdBuilder.setIPv6(db->isProtocolIPv6(tf.sourceSe, tf.destSe));
-            }
+    // UDT and IPv6
+    cmdBuilder.setUDT(linkSettings.udt);
+    if (!cmdBuilder.isIPv6Explicit()) {
+        cmdBuilder.setIPv6(linkSettings.ipv6);
+    }
 
-            // Disable source file eviction from disk buffer (according to SE config)
-            cmdBuilder.setSkipEvict(db->getSkipEvictionFlag(tf.sourceSe));
+    // Disable source file eviction from disk buffer (according to SE config)
+    cmdBuilder.setSkipEvict(config->getSkipEvictionFlag(tf.sourceSe));
 
-            // Set TPC mode (according to SE config)
-            cmdBuilder.setCopyMode(db->getCopyMode(tf.sourceSe, tf.destSe));
+    // Set TPC mode (according to SE config)
+    cmdBuilder.setCopyMode(linkSettings.copyMode);
 
-            // FTS3 host name
-            cmdBuilder.setFTSName(FTSInstanceAlias);
+    // FTS3 host name
+    cmdBuilder.setFTSName(FTSInstanceAlias);
 
-            // Number of retries and maximum number allowed
-            int retry_times = db->getRetryTimes(tf.jobId, tf.fileId);
-            cmdBuilder.setNumberOfRetries(retry_times < 0 ? 0 : retry_times);
+    // Number of retries and maximum number allowed
+    int retry_times = db->getRetryTimes(tf.jobId, tf.fileId);
+    cmdBuilder.setNumberOfRetries(retry_times < 0 ? 0 : retry_times);
 
-            if ((retry_times > 0) && (tf.overwriteFlag == "R")) {
-                cmdBuilder.setOverwrite(true);
-            }
+    if ((retry_times > 0) && (tf.overwriteFlag == "R")) {
+        cmdBuilder.setOverwrite(true);
+    }
 
-            // If is multihop job, file is not the final destination and overwrite requested => enable overwrite
-            //   - overwriteFlag = "M" (overwrite-hop)
-            //   - overwriteFlag = "Q" (overwrite-hop + overwrite-when-only-on-disk)
-            if (tf.jobType == Job::kTypeMultiHop && !tf.lastHop &&
-                (tf.overwriteFlag == "M" || tf.overwriteFlag == "Q")) {
-                cmdBuilder.setOverwrite(true);
-            }
+    // If is multihop job, file is not the final destination and overwrite requested => enable overwrite
+    //   - overwriteFlag = "M" (overwrite-hop)
+    //   - overwriteFlag = "Q" (overwrite-hop + overwrite-when-only-on-disk)
+    if (tf.jobType == Job::kTypeMultiHop && !tf.lastHop &&
+        (tf.overwriteFlag == "M" || tf.overwriteFlag == "Q")) {
+        cmdBuilder.setOverwrite(true);
+    }
 
-            // If archiving job and overwrite-when-only-on-disk requested => enable overwrite on disk
-            //   - overwriteFlag = "D"
-            //   - multihop job, last hop and overwriteFlag = "Q"
-            if (tf.archiveTimeout > 0) {
-                bool overwriteOnDiskRequested =
-                        (tf.overwriteFlag == "D") ||
-                        (tf.jobType == Job::kTypeMultiHop && tf.lastHop && tf.overwriteFlag == "Q");
-
-                if (overwriteOnDiskRequested) {
-                    cmdBuilder.setOverwriteOnDisk(true);
-                    // Also send "overwrite-disk-enabled" flag (decision delegated to the UrlCopyProcess)
-                    cmdBuilder.setOverwriteDiskEnabled(db->getOverwriteDiskEnabledFlag(tf.destSe));
-                }
-            }
+    // If archiving job and overwrite-when-only-on-disk requested => enable overwrite on disk
+    //   - overwriteFlag = "D"
+    //   - multihop job, last hop and overwriteFlag = "Q"
+    if (tf.archiveTimeout > 0) {
+        bool overwriteOnDiskRequested =
+                (tf.overwriteFlag == "D") ||
+                (tf.jobType == Job::kTypeMultiHop && tf.lastHop && tf.overwriteFlag == "Q");
+
+        if (overwriteOnDiskRequested) {
+            cmdBuilder.setOverwriteOnDisk(true);
+            // Also send "overwrite-disk-enabled" flag (decision delegated to the UrlCopyProcess)
+            cmdBuilder.setOverwriteDiskEnabled(config->getOverwriteDiskEnabledFlag(tf.destSe));
+        }
+    }
 
-            int retry_max = db->getRetry(tf.jobId);
-            cmdBuilder.setMaxNumberOfRetries(retry_max < 0 ? 0 : retry_max);
+    int retry_max = config->getRetry(tf.jobId);
+    cmdBuilder.setMaxNumberOfRetries(retry_max < 0 ? 0 : retry_max);
 
-            // Log directory
-            cmdBuilder.setLogDir(logsDir);
+    // Log directory
+    cmdBuilder.setLogDir(logsDir);
 
-            // Build the parameters
-            std::string params = cmdBuilder.generateParameters();
-            FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Transfer params: " << cmdBuilder << commit;
-            ExecuteProcess pr(UrlCopyCmd::Program, params);
+    // Build the parameters
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Transfer params: " << cmdBuilder << commit;
+    urlCopyArgs = cmdBuilder.generateArguments();
+    return true;
+}
 
-            // check again here if the server has stopped - just in case
-            if(boost::this_thread::interruption_requested()) {
-                return;
-            }
 
-            scheduled += 1;
+bool FileTransferExecutor::launch()
+{
+    // check again here if the server has stopped - just in case
+    if(common::TaskGroup::interruptionRequested()) {
+        return false;
+    }
 
-            boost::tuple<bool, std::string> fileUpdated = db->updateTransferStatus(
-                    tf.jobId, tf.fileId, 0, "READY", "",
-                    0, 0, 0.0, false, "");
-            db->updateJobStatus(tf.jobId, "ACTIVE");
-
-            // If fileUpdated == false, the transfer was *not* updated, which means we got
-            // probably a collision with some other node
-            if (!fileUpdated.get<0>()) {
-                FTS3_COMMON_LOGGER_NEWLOG(WARNING)
-                    << "Transfer " << tf.jobId << " " << tf.fileId
-                    << " not updated. Probably picked by another node" << commit;
-                return;
-            }
+    ExecuteProcess pr(UrlCopyCmd::Program, urlCopyArgs);
 
-            // Update protocol parameters (specially interested on nostreams)
-            events::Message protoMsg;
-            protoMsg.set_transfer_status("UPDATE");
-            protoMsg.set_file_id(tf.fileId);
-            protoMsg.set_buffersize(cmdBuilder.getBuffersize());
-            protoMsg.set_nostreams(cmdBuilder.getNoStreams());
-            protoMsg.set_timeout(cmdBuilder.getTimeout());
-            db->updateProtocol(std::vector<events::Message>{protoMsg});
-
-            // Spawn the fts_url_copy
-            bool failed = false;
-            std::string forkMessage;
-            if (-1 == pr.executeProcessShell(forkMessage)) {
-                failed = true;
-                db->updateTransferStatus(tf.jobId, tf.fileId, pr.getPid(),
-                                         "FAILED", "Transfer failed to fork, check fts3server.log for more details",
-                                         0, 0, 0.0, false, "");
-                db->updateJobStatus(tf.jobId, "FAILED");
-
-                if (forkMessage.empty()) {
-                    FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Transfer failed to fork "
-                        << tf.jobId << "  " << tf.fileId << commit;
-                }
-                else {
-                    FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Transfer failed to fork " << forkMessage << "   " << tf.jobId <<
-                        "  " << tf.fileId << commit;
-                }
-            }
-            else {
-                db->updateTransferStatus(tf.jobId, tf.fileId, pr.getPid(), "READY", "",
-                                         0, 0, 0.0, false, "");
-            }
+    boost::tuple<bool, std::string> fileUpdated = db->updateTransferStatus(
+            tf.jobId, tf.fileId, 0, "READY", "",
+            0, 0, 0.0, false, "");
+    db->updateJobStatus(tf.jobId, "ACTIVE");
 
-            // Send current state
-            SingleTrStateInstance::instance().sendStateMessage(tf.jobId, tf.fileId);
-            fts3::events::MessageUpdater msg;
-            msg.set_job_id(tf.jobId);
-            msg.set_file_id(tf.fileId);
-            msg.set_process_id(pr.getPid());
-            msg.set_timestamp(millisecondsSinceEpoch());
-
-            // Only set watcher when the file has started
-            if(!failed) {
-                ThreadSafeList::get_instance().push_back(msg);
-            }
+    // If fileUpdated == false, the transfer was *not* updated, which means we got
+    // probably a collision with some other node
+    if (!fileUpdated.get<0>()) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING)
+            << "Transfer " << tf.jobId << " " << tf.fileId
+            << " not updated. Probably picked by another node" << commit;
+        return false;
+    }
+
+    // Update protocol parameters (specially interested on nostreams)
+    events::Message protoMsg;
+    protoMsg.set_transfer_status("UPDATE");
+    protoMsg.set_file_id(tf.fileId);
+    protoMsg.set_buffersize(cmdBuilder.getBuffersize());
+    protoMsg.set_nostreams(cmdBuilder.getNoStreams());
+    protoMsg.set_timeout(cmdBuilder.getTimeout());
+    db->updateProtocol(std::vector<events::Message>{protoMsg});
+
+    // Hand the transfer to an idle url copy worker, or spawn the fts_url_copy
+    bool failed = false;
+    std::string forkMessage;
+    pid_t pid = 0;
+    if (UrlCopyWorkerPool::get_instance().dispatch(urlCopyArgs, &pid)) {
+        FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Transfer " << tf.jobId << " " << tf.fileId
+            << " handed to the url copy worker " << pid << commit;
+        db->updateTransferStatus(tf.jobId, tf.fileId, pid, "READY", "",
+                                 0, 0, 0.0, false, "");
+    }
+    else if (-1 == pr.executeProcessShell(forkMessage)) {
+        failed = true;
+        pid = pr.getPid();
+        db->updateTransferStatus(tf.jobId, tf.fileId, pid,
+                                 "FAILED", "Transfer failed to fork, check fts3server.log for more details",
+                                 0, 0, 0.0, false, "");
+        db->updateJobStatus(tf.jobId, "FAILED");
+
+        if (forkMessage.empty()) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Transfer failed to fork "
+                << tf.jobId << "  " << tf.fileId << commit;
         }
         else {
-            notScheduled.insert(make_pair(tf.sourceSe, tf.destSe));
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Transfer failed to fork " << forkMessage << "   " << tf.jobId <<
+                "  " << tf.fileId << commit;
         }
     }
-    catch (std::exception &e) {
-        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception " << e.what() << commit;
+    else {
+        pid = pr.getPid();
+        UrlCopyProcessRegistry::get_instance().add(pid);
+        db->updateTransferStatus(tf.jobId, tf.fileId, pid, "READY", "",
+                                 0, 0, 0.0, false, "");
     }
-    catch (...) {
-        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception unknown" << commit;
+
+    // Send current state
+    SingleTrStateInstance::instance().sendStateMessage(tf.jobId, tf.fileId);
+    fts3::events::MessageUpdater msg;
+    msg.set_job_id(tf.jobId);
+    msg.set_file_id(tf.fileId);
+    msg.set_process_id(pid);
+    msg.set_timestamp(millisecondsSinceEpoch());
+
+    // Only set watcher when the file has started
+    if(!failed) {
+        ThreadSafeList::get_instance().push_back(msg);
     }
+
+    return true;
 }
 
 } /* namespace server */
@@ -28,10 +28,14 @@
 
 #include "db/generic/SingleDbInstance.h"
 
+#include "ConfigSnapshot.h"
 #include "TransferFileHandler.h"
+#include "UrlCopyCmd.h"
 
+#include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 
 namespace fts3
@@ -66,20 +70,49 @@ public:
      * @param proxy - the proxy certificate file
      * @param logDir - location for the transfer log file
      * @param msgDir - location for the monitoring state messages
+     * @param config - configuration snapshot shared by all the executors of the scheduling cycle
      */
     FileTransferExecutor(TransferFile& tf,
         bool monitoringMsg, std::string FTSInstanceAlias,
-        std::string proxy, std::string logDir, std::string msgDir);
+        std::string proxy, std::string logDir, std::string msgDir,
+        std::shared_ptr<ConfigSnapshot> config);
 
     virtual ~FileTransferExecutor();
 
     /**
      * spawns a url_copy
      *
-     * @return 0 if the file was not scheduled, 1 otherwise
+     * Adds 1 to the context (an int) if the file was scheduled
      */
     virtual void run(boost::any &);
 
+    /**
+     * First half of run: check the link is allowed, and build the fts_url_copy command.
+     * Only reads from the database.
+     *
+     * @return false if the transfer must not be scheduled now
+     */
+    virtual bool prepare();
+
+    /**
+     * Second half of run: move the transfer to READY, and spawn the fts_url_copy
+     * (or hand it to an idle worker). prepare must have succeeded.
+     *
+     * @return false if the transfer could not be claimed (i.e. picked by another node)
+     */
+    virtual bool launch();
+
+    /// The transfer handled by this executor
+    const TransferFile& getTransferFile() const
+    {
+        return tf;
+    }
+
+protected:
+
+    /// For executors overriding prepare and launch, without database access
+    explicit FileTransferExecutor(TransferFile &tf);
+
 private:
 
     /// pairs that were already checked and were not scheduled
@@ -96,6 +129,13 @@ private:
     // DB interface
     GenericDbIfce* db;
 
+    // Link, storage and VO configuration for this scheduling cycle
+    std::shared_ptr<ConfigSnapshot> config;
+
+    // Built by prepare, used by launch
+    UrlCopyCmd cmdBuilder;
+    std::vector<std::string> urlCopyArgs;
+
     // method to retrieve auth method used
     std::string getAuthMethod(const std::string& jobMetadata);
 };
@@ -15,17 +15,18 @@
  */
 
 #include "common/Logger.h"
-#include "common/ThreadPool.h"
-#include "common/DaemonTools.h"
+#include "common/WorkStealingExecutor.h"
 
 #include "config/ServerConfig.h"
-#include "cred/DelegCred.h"
+#include "cred/CredentialCache.h"
 
 #include "db/generic/SingleDbInstance.h"
 #include "db/generic/TransferFile.h"
 
 #include "ForceStartTransfersService.h"
+#include "ConfigSnapshot.h"
 #include "FileTransferExecutor.h"
+#include "UrlCopyProcessRegistry.h"
 
 using namespace fts3::config;
 using namespace fts3::common;
@@ -49,7 +50,7 @@ void ForceStartTransfersService::forceRunJobs() {
 
     // Bail out as soon as possible if there are too many fts_url_copy processes
     int maxUrlCopy = config::ServerConfig::instance().get<int>("MaxUrlCopyProcesses");
-    int urlCopyCount = countProcessesWithName("fts_url_copy");
+    int urlCopyCount = UrlCopyProcessRegistry::get_instance().count();
     int availableUrlCopySlots = maxUrlCopy - urlCopyCount;
 
     if (availableUrlCopySlots <= 0) {
@@ -58,7 +59,7 @@ void ForceStartTransfersService::forceRunJobs() {
         return;
     }
 
-    ThreadPool<FileTransferExecutor> execPool(execPoolSize);
+    TaskGroup execPool(WorkStealingExecutor::instance(), execPoolSize, WorkStealingExecutor::High);
 
     try {
         auto tfs = db::DBSingleton::instance().getDBObjectInstance()->getForceStartTransfers();
@@ -67,7 +68,7 @@ void ForceStartTransfersService::forceRunJobs() {
             return;
         }
 
-        std::map<std::pair<std::string, std::string>, std::string> proxies;
+        auto config = std::make_shared<ConfigSnapshot>(db::DBSingleton::instance().getDBObjectInstance());
 
         for (auto& tf: tfs) {
             if (boost::this_thread::interruption_requested()) {
@@ -79,14 +80,10 @@ void ForceStartTransfersService::forceRunJobs() {
                 continue;
             }
 
-            std::pair<std::string, std::string> proxy_key(tf.credId, tf.userDn);
-
-            if (proxies.find(proxy_key) == proxies.end()) {
-                proxies[proxy_key] = DelegCred::getProxyFile(tf.userDn, tf.credId);
-            }
+            const std::string proxy = CredentialCache::instance().getProxyFile(tf.userDn, tf.credId);
 
             FileTransferExecutor *exec = new FileTransferExecutor(tf, monitoringMessages, ftsHostName,
-                                                                  proxies[proxy_key], logDir, msgDir);
+                                                                  proxy, logDir, msgDir, config);
             execPool.start(exec);
 
             if (--availableUrlCopySlots <= 0) {
@@ -29,6 +29,9 @@
 #include "db/generic/SingleDbInstance.h"
 #include "SingleTrStateInstance.h"
 #include "ThreadSafeList.h"
+#include "ProgressUpdateCoalescer.h"
+#include "SchedulingTrigger.h"
+#include "TransferStatusBatch.h"
 
 
 using namespace fts3::common;
@@ -123,11 +126,13 @@ void MessageProcessingService::runService()
                         << "\nTransferred: " << (*iterUpdater).transferred()
                         << commit;
                     ThreadSafeList::get_instance().updateMsg(*iterUpdater);
+                    ProgressUpdateCoalescer::get_instance().add(*iterUpdater);
                 }
 
-                db::DBSingleton::instance().getDBObjectInstance()->updateFileTransferProgressVector(messagesUpdater);
                 messagesUpdater.clear();
             }
+
+            ProgressUpdateCoalescer::get_instance().flush();
         } catch (const boost::thread_interrupted&) {
             FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Thread interruption requested in SupervisorService!" << commit;
             dumpMessages();
@@ -142,6 +147,23 @@ void MessageProcessingService::runService()
 
         boost::this_thread::sleep(msgCheckInterval);
     }
+
+    flushProgressUpdates();
+}
+
+
+void MessageProcessingService::flushProgressUpdates()
+{
+    try {
+        boost::this_thread::disable_interruption disabled;
+        ProgressUpdateCoalescer::get_instance().flush(true);
+    }
+    catch (const std::exception& e) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not write the pending progress updates: " << e.what() << commit;
+    }
+    catch (...) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not write the pending progress updates" << commit;
+    }
 }
 
 
@@ -188,43 +210,56 @@ void MessageProcessingService::performUpdateMessageDbChange(const fts3::events::
 }
 
 
-void MessageProcessingService::performOtherMessageDbChange(const fts3::events::Message& msg)
+void MessageProcessingService::untrackOtherMessage(const fts3::events::Message& msg)
 {
-    try
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Job id: " << msg.job_id()
+                                    << "\nFile id: " << msg.file_id()
+                                    << "\nPid: " << msg.process_id()
+                                    << "\nState: " << msg.transfer_status()
+                                    << "\nSource: " << msg.source_se()
+                                    << "\nDest: " << msg.dest_se() << commit;
+
+    if (msg.transfer_status().compare("FINISHED") == 0) {
+        FTS3_COMMON_LOGGER_NEWLOG(PROF) << "[profiling:transfer]"
+                                        << " file_id=" << msg.file_id()
+                                        << " timestamp=" << msg.gfal_perf_timestamp() / 1000
+                                        << " inst_throughput=" << msg.instantaneous_throughput()
+                                        << " dif_transferred=" << msg.transferred_since_last_ping()
+                                        << " source_se=" << msg.source_se()
+                                        << " dest_se=" << msg.dest_se()
+                                        << commit;
+    }
+
+
+    if (msg.transfer_status().compare("FINISHED") == 0 ||
+        msg.transfer_status().compare("FAILED") == 0 ||
+        msg.transfer_status().compare("CANCELED") == 0)
     {
-        // do not process UPDATE messages
-        if (msg.transfer_status().compare("UPDATE") == 0)
-            return;
+        FTS3_COMMON_LOGGER_NEWLOG(INFO)
+            << "Removing job from monitoring list " << msg.job_id() << " " << msg.file_id()
+            << commit;
+        ThreadSafeList::get_instance().removeFinishedTr(msg.job_id(), msg.file_id());
+        // A late progress ping must not overwrite the final values
+        ProgressUpdateCoalescer::get_instance().drop(msg.file_id());
+    }
+}
 
-        FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Job id: " << msg.job_id()
-                                        << "\nFile id: " << msg.file_id()
-                                        << "\nPid: " << msg.process_id()
-                                        << "\nState: " << msg.transfer_status()
-                                        << "\nSource: " << msg.source_se()
-                                        << "\nDest: " << msg.dest_se() << commit;
-
-        if (msg.transfer_status().compare("FINISHED") == 0) {
-            FTS3_COMMON_LOGGER_NEWLOG(PROF) << "[profiling:transfer]"
-                                            << " file_id=" << msg.file_id()
-                                            << " timestamp=" << msg.gfal_perf_timestamp() / 1000
-                                            << " inst_throughput=" << msg.instantaneous_throughput()
-                                            << " dif_transferred=" << msg.transferred_since_last_ping()
-                                            << " source_se=" << msg.source_se()
-                                            << " dest_se=" << msg.dest_se()
-                                            << commit;
-        }
 
+void MessageProcessingService::performOtherMessageDbChange(const fts3::events::Message& msg)
+{
+    // do not process UPDATE messages
+    if (msg.transfer_status().compare("UPDATE") == 0)
+        return;
+
+    untrackOtherMessage(msg);
+    applyOtherMessageDbChange(msg);
+}
 
-        if (msg.transfer_status().compare("FINISHED") == 0 ||
-            msg.transfer_status().compare("FAILED") == 0 ||
-            msg.transfer_status().compare("CANCELED") == 0)
-        {
-            FTS3_COMMON_LOGGER_NEWLOG(INFO)
-                << "Removing job from monitoring list " << msg.job_id() << " " << msg.file_id()
-                << commit;
-            ThreadSafeList::get_instance().removeFinishedTr(msg.job_id(), msg.file_id());
-        }
 
+void MessageProcessingService::applyOtherMessageDbChange(const fts3::events::Message& msg)
+{
+    try
+    {
         if (msg.transfer_status().compare("FAILED") == 0)
         {
             try
@@ -305,6 +340,40 @@ void MessageProcessingService::performOtherMessageDbChange(const fts3::events::M
 }
 
 
+void MessageProcessingService::applyOtherMessagesDbChange(const std::vector<fts3::events::Message>& batch)
+{
+    TransferStatusBatch statusBatch;
+    statusBatch.bulkUpdate = [](const std::vector<fts3::events::Message>& messages) {
+        return db::DBSingleton::instance().getDBObjectInstance()->updateTransferStatusBatch(messages);
+    };
+    statusBatch.singleUpdate = [this](const fts3::events::Message& msg) {
+        applyOtherMessageDbChange(msg);
+    };
+    statusBatch.jobUpdate = [](const std::string& jobId, const std::string& state) {
+        db::DBSingleton::instance().getDBObjectInstance()->updateJobStatus(jobId, state);
+    };
+
+    std::vector<TransferStatusUpdate> results = statusBatch.apply(batch);
+
+    for (auto result = results.begin(); result != results.end(); ++result)
+    {
+        if (result->retried) {
+            continue;
+        }
+
+        if (!result->updated && result->state != "CANCELED") {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Entry in the database not updated for "
+                << result->jobId << " " << result->fileId
+                << ". Probably already in a different terminal state. Tried to set "
+                << result->state << " over " << result->storedState << commit;
+        }
+        else {
+            SingleTrStateInstance::instance().sendStateMessage(result->states);
+        }
+    }
+}
+
+
 void MessageProcessingService::handleUpdateMessages(const std::vector<fts3::events::Message>& messages)
 {
     for (auto iter = messages.begin(); iter != messages.end(); ++iter)
@@ -341,6 +410,9 @@ void MessageProcessingService::handleUpdateMessages(const std::vector<fts3::even
 void MessageProcessingService::handleOtherMessages(const std::vector<fts3::events::Message>& messages)
 {
     fts3::events::MessageUpdater msgUpdater;
+    std::vector<fts3::events::Message> batch;
+    batch.reserve(STATUS_BATCH_SIZE);
+    bool slotsFreed = false;
 
     for (auto iter = messages.begin(); iter != messages.end(); ++iter)
     {
@@ -361,9 +433,36 @@ void MessageProcessingService::handleOtherMessages(const std::vector<fts3::event
             msgUpdater.set_transferred(0);
             ThreadSafeList::get_instance().updateMsg(msgUpdater);
 
-            if ((*iter).transfer_status().compare("UPDATE") != 0)
+            if ((*iter).transfer_status().compare("UPDATE") == 0)
             {
+                continue;
+            }
+
+            if ((*iter).transfer_status().compare("FINISHED") == 0 ||
+                (*iter).transfer_status().compare("FAILED") == 0 ||
+                (*iter).transfer_status().compare("CANCELED") == 0)
+            {
+                slotsFreed = true;
+            }
+
+            // Messages identifying the transfer by pid, or requiring to terminate a reuse process,
+            // go through the single message path. Flush first to keep the ordering.
+            if ((*iter).job_id().empty() || (*iter).file_id() == 0 ||
+                isUnrecoverableErrorMessage((*iter).transfer_message()))
+            {
+                if (!batch.empty()) {
+                    applyOtherMessagesDbChange(batch);
+                    batch.clear();
+                }
                 performOtherMessageDbChange(*iter);
+                continue;
+            }
+
+            untrackOtherMessage(*iter);
+            batch.push_back(*iter);
+            if (batch.size() >= STATUS_BATCH_SIZE) {
+                applyOtherMessagesDbChange(batch);
+                batch.clear();
             }
         }
         catch (const boost::filesystem::filesystem_error& e)
@@ -379,6 +478,29 @@ void MessageProcessingService::handleOtherMessages(const std::vector<fts3::event
             FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Caught exception " << commit;
         }
     }
+
+    try
+    {
+        if (!batch.empty()) {
+            applyOtherMessagesDbChange(batch);
+        }
+    }
+    catch (const boost::filesystem::filesystem_error& e)
+    {
+        FTS3_COMMON_LOGGER_NEWLOG(CRIT) << "Caught exception related to message dumping: " << e.what() << commit;
+    }
+    catch (const std::exception& e)
+    {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Caught exception " << e.what() << commit;
+    }
+    catch (...)
+    {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Caught exception " << commit;
+    }
+
+    if (slotsFreed) {
+        SchedulingTrigger::get_instance().notify();
+    }
 }
 
 
@@ -35,6 +35,9 @@ namespace server {
 class MessageProcessingService: public BaseService
 {
 public:
+    /// Maximum number of status messages applied with a single bulk database change
+    static const size_t STATUS_BATCH_SIZE = 500;
+
     MessageProcessingService();
     virtual ~MessageProcessingService() = default;
 
@@ -54,9 +57,22 @@ private:
     /// Perform the database change associated with a non-UPDATE type message
     void performOtherMessageDbChange(const fts3::events::Message& msg);
 
+    /// Log a non-UPDATE type message, and stop monitoring the transfer if it is terminal
+    void untrackOtherMessage(const fts3::events::Message& msg);
+
+    /// Apply the file, retry and job changes of a non-UPDATE type message
+    void applyOtherMessageDbChange(const fts3::events::Message& msg);
+
+    /// Apply a set of non-UPDATE type messages with a single bulk database change.
+    /// If the bulk change is rolled back, messages are applied one by one (see TransferStatusBatch).
+    void applyOtherMessagesDbChange(const std::vector<fts3::events::Message>& batch);
+
     /// Dump the messages and messages logs onto disk
     void dumpMessages();
 
+    /// Write the progress updates still queued, on shutdown
+    void flushProgressUpdates();
+
     /// Return whether an error message cannot be recovered from
     bool isUnrecoverableErrorMessage(const std::string& errmsg);
 
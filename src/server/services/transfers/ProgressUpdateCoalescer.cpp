@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/Logger.h"
+#include "db/generic/SingleDbInstance.h"
+
+#include "ProgressUpdateCoalescer.h"
+
+using namespace fts3::common;
+
+namespace fts3 {
+namespace server {
+
+
+ProgressUpdateCoalescer::ProgressUpdateCoalescer():
+    interval(std::chrono::seconds(5)), lastFlush(std::chrono::steady_clock::now()), received(0)
+{
+}
+
+
+void ProgressUpdateCoalescer::setInterval(const boost::posix_time::time_duration &interval)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->interval = std::chrono::milliseconds(interval.total_milliseconds());
+}
+
+
+void ProgressUpdateCoalescer::add(const fts3::events::MessageUpdater &msg)
+{
+    if (msg.file_id() == 0 || msg.transfer_status() != "ACTIVE" || !(msg.throughput() > 0.0)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++received;
+
+    auto i = pending.find(msg.file_id());
+    if (i == pending.end()) {
+        pending.emplace(msg.file_id(), msg);
+    }
+    else if (msg.timestamp() >= i->second.timestamp()) {
+        i->second = msg;
+    }
+}
+
+
+bool ProgressUpdateCoalescer::take(std::vector<fts3::events::MessageUpdater> &updates, bool force)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!force && now - lastFlush < interval) {
+        return false;
+    }
+    lastFlush = now;
+
+    updates.reserve(updates.size() + pending.size());
+    for (auto &entry: pending) {
+        updates.emplace_back(std::move(entry.second));
+    }
+
+    if (!pending.empty()) {
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Progress updates: received=" << received
+                                        << " files=" << pending.size()
+                                        << " coalescing_ratio=" << static_cast<double>(received) / pending.size()
+                                        << commit;
+    }
+
+    pending.clear();
+    received = 0;
+    return true;
+}
+
+
+void ProgressUpdateCoalescer::restore(const std::vector<fts3::events::MessageUpdater> &updates)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const auto &msg: updates) {
+        // emplace does nothing if there is a newer ping already
+        pending.emplace(msg.file_id(), msg);
+    }
+}
+
+
+void ProgressUpdateCoalescer::drop(uint64_t fileId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.erase(fileId);
+}
+
+
+size_t ProgressUpdateCoalescer::flush(bool force)
+{
+    std::unique_lock<std::mutex> flushLock(flushMutex, std::defer_lock);
+    if (force) {
+        flushLock.lock();
+    }
+    else if (!flushLock.try_lock()) {
+        // Someone else is flushing
+        return 0;
+    }
+
+    std::vector<fts3::events::MessageUpdater> updates;
+    if (!take(updates, force) || updates.empty()) {
+        return 0;
+    }
+
+    try {
+        db::DBSingleton::instance().getDBObjectInstance()->updateFileTransferProgressVector(updates);
+    }
+    catch (...) {
+        restore(updates);
+        throw;
+    }
+
+    return updates.size();
+}
+
+
+size_t ProgressUpdateCoalescer::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending.size();
+}
+
+} // end namespace server
+} // end namespace fts3
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef PROGRESSUPDATECOALESCER_H_
+#define PROGRESSUPDATECOALESCER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "msg-bus/events.h"
+
+namespace fts3 {
+namespace server {
+
+/// Collects the transfer progress pings and writes them into the database
+/// once per interval, keeping only the latest ping of each file.
+/// Shared by the services that receive pings (SupervisorService and MessageProcessingService).
+class ProgressUpdateCoalescer
+{
+public:
+    static ProgressUpdateCoalescer& get_instance()
+    {
+        static ProgressUpdateCoalescer instance;
+        return instance;
+    }
+
+    ProgressUpdateCoalescer();
+
+    ProgressUpdateCoalescer(const ProgressUpdateCoalescer&) = delete;
+    ProgressUpdateCoalescer& operator = (const ProgressUpdateCoalescer&) = delete;
+
+    /// Minimum time between two database writes
+    void setInterval(const boost::posix_time::time_duration &interval);
+
+    /// Queue a progress ping. Pings that do not carry progress are ignored.
+    void add(const fts3::events::MessageUpdater &msg);
+
+    /// If the interval passed, or force is true, move the queued updates into updates
+    /// @return false if it is not the time to flush yet
+    bool take(std::vector<fts3::events::MessageUpdater> &updates, bool force = false);
+
+    /// Queue again updates that could not be written, unless a newer ping arrived meanwhile
+    void restore(const std::vector<fts3::events::MessageUpdater> &updates);
+
+    /// Forget the queued update of a file that reached a terminal state
+    void drop(uint64_t fileId);
+
+    /// Write the queued updates into the database when the interval passed.
+    /// If force is true, write them now, waiting for a flush already running.
+    /// @return how many files were updated
+    size_t flush(bool force = false);
+
+    /// Number of files with a queued update
+    size_t size();
+
+private:
+    std::mutex mutex;
+    std::unordered_map<uint64_t, fts3::events::MessageUpdater> pending;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point lastFlush;
+    /// Pings received since the last flush
+    uint64_t received;
+
+    /// Serializes the database writes, so the updates of a file are applied in order
+    std::mutex flushMutex;
+};
+
+} // end namespace server
+} // end namespace fts3
+
+#endif // PROGRESSUPDATECOALESCER_H_
@@ -23,15 +23,16 @@
 #include <fstream>
 #include <random>
 
-#include "common/DaemonTools.h"
 #include "config/ServerConfig.h"
-#include "cred/DelegCred.h"
+#include "cred/CredentialCache.h"
 #include "ExecuteProcess.h"
 #include "server/common/DrainMode.h"
 #include "SingleTrStateInstance.h"
 
 #include "CloudStorageConfig.h"
 #include "ThreadSafeList.h"
+#include "UrlCopyProcessRegistry.h"
+#include "UrlCopyWorkerPool.h"
 #include "VoShares.h"
 
 
@@ -160,16 +161,19 @@ void ReuseTransfersService::getFiles(const std::vector<QueueId>& queues, int ava
     std::map<std::string, std::queue<std::pair<std::string, std::list<TransferFile> > > > voQueues;
     db->getReadySessionReuseTransfers(queues, voQueues);
 
+    // Configuration shared by all the jobs started in this cycle
+    ConfigSnapshot config(db);
+
     std::map<std::string, int> slotsLeftForSource, slotsLeftForDestination;
     for (auto i = queues.begin(); i != queues.end(); ++i) {
         // To reduce queries, fill in one go limits as source and as destination
         if (slotsLeftForDestination.count(i->destSe) == 0) {
-            StorageConfig seConfig = db->getStorageConfig(i->destSe);
+            const StorageConfig &seConfig = config.getStorageConfig(i->destSe);
             slotsLeftForDestination[i->destSe] = seConfig.inboundMaxActive>0?seConfig.inboundMaxActive:60;
             slotsLeftForSource[i->destSe] = seConfig.outboundMaxActive>0?seConfig.outboundMaxActive:60;
         }
         if (slotsLeftForSource.count(i->sourceSe) == 0) {
-            StorageConfig seConfig = db->getStorageConfig(i->sourceSe);
+            const StorageConfig &seConfig = config.getStorageConfig(i->sourceSe);
             slotsLeftForDestination[i->sourceSe] = seConfig.inboundMaxActive>0?seConfig.inboundMaxActive:60;
             slotsLeftForSource[i->sourceSe] = seConfig.outboundMaxActive>0?seConfig.outboundMaxActive:60;
         }
@@ -216,7 +220,7 @@ void ReuseTransfersService::getFiles(const std::vector<QueueId>& queues, int ava
                     << commit;
                     return;
                 } else {
-                    startUrlCopy(job.first, job.second);
+                    startUrlCopy(job.first, job.second, config);
                     --availableUrlCopySlots;
                     --slotsLeftForDestination[job.second.front().destSe];
                     --slotsLeftForSource[job.second.front().sourceSe];
@@ -227,7 +231,8 @@ void ReuseTransfersService::getFiles(const std::vector<QueueId>& queues, int ava
 }
 
 
-void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<TransferFile> const & files)
+void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<TransferFile> const & files,
+    ConfigSnapshot & config)
 {
     GenericDbIfce *db = DBSingleton::instance().getDBObjectInstance();
     UrlCopyCmd cmdBuilder;
@@ -243,7 +248,8 @@ void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<T
     // Set parameters from the "representative", without using the source and destination url, and other data
     // that is per transfer
     TransferFile const & representative = files.front();
-    cmdBuilder.setFromTransfer(representative, true, db->publishUserDn(representative.voName), msgDir);
+    const ConfigSnapshot::VoSettings &voSettings = config.getVoSettings(representative.voName);
+    cmdBuilder.setFromTransfer(representative, true, voSettings.publishUserDn, msgDir);
 
     // Generate the file containing the list of transfers
     std::map<uint64_t, std::string> fileIds = generateJobFile(representative.jobId, files);
@@ -255,24 +261,26 @@ void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<T
     }
 
     // Set parameters
-    int secPerMB = db->getSecPerMb(representative.voName);
-    if (secPerMB > 0) {
-        cmdBuilder.setSecondsPerMB(secPerMB);
+    const ConfigSnapshot::LinkSettings &linkSettings =
+        config.getLinkSettings(representative.sourceSe, representative.destSe);
+
+    if (voSettings.secPerMb > 0) {
+        cmdBuilder.setSecondsPerMB(voSettings.secPerMb);
     }
 
     TransferFile::ProtocolParameters protocolParams = representative.getProtocolParameters();
 
     if (representative.internalFileParams.empty()) {
-        protocolParams.nostreams = db->getStreamsOptimization(representative.sourceSe, representative.destSe);
-        protocolParams.timeout = db->getGlobalTimeout(representative.voName);
-        protocolParams.ipv6 = db->isProtocolIPv6(representative.sourceSe, representative.destSe);
-        protocolParams.udt = db->isProtocolUDT(representative.sourceSe, representative.destSe);
+        protocolParams.nostreams = linkSettings.nostreams;
+        protocolParams.timeout = voSettings.globalTimeout;
+        protocolParams.ipv6 = linkSettings.ipv6;
+        protocolParams.udt = linkSettings.udt;
         //protocolParams.buffersize
     }
 
     cmdBuilder.setFromProtocol(protocolParams);
 
-    std::string proxy_file = DelegCred::getProxyFile(representative.userDn, representative.credId);
+    std::string proxy_file = CredentialCache::instance().getProxyFile(representative.userDn, representative.credId);
     if (!proxy_file.empty())
         cmdBuilder.setProxy(proxy_file);
 
@@ -293,7 +301,7 @@ void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<T
     }
 
     // Debug level
-    unsigned debugLevel = db->getDebugLevel(representative.sourceSe, representative.destSe);
+    unsigned debugLevel = linkSettings.debugLevel;
     if (debugLevel > 0)
     {
         cmdBuilder.setDebugLevel(debugLevel);
@@ -302,21 +310,30 @@ void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<T
     // FTS3 name
     cmdBuilder.setFTSName(ftsHostName);
 
+    // Transfers of the job running at the same time
+    cmdBuilder.setConcurrentTransfers(ServerConfig::instance().get<int>("SessionReuseConcurrentTransfers"));
+
     // Number of retries and maximum number allowed
     int retry_times = db->getRetryTimes(representative.jobId, representative.fileId);
     cmdBuilder.setNumberOfRetries(retry_times < 0 ? 0 : retry_times);
 
-    int retry_max = db->getRetry(representative.jobId);
+    int retry_max = config.getRetry(representative.jobId);
     cmdBuilder.setMaxNumberOfRetries(retry_max < 0 ? 0 : retry_max);
 
     // Log and run
-    std::string params = cmdBuilder.generateParameters();
     FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Transfer params: " << cmdBuilder << commit;
-    ExecuteProcess pr(cmd, params);
+    const std::vector<std::string> urlCopyArgs = cmdBuilder.generateArguments();
+    ExecuteProcess pr(cmd, urlCopyArgs);
 
+    // Hand the transfers to an idle worker, otherwise spawn a new process
     // Check if fork failed , check if execvp failed
     std::string forkMessage;
-    if (-1 == pr.executeProcessShell(forkMessage))
+    pid_t pid = 0;
+    if (UrlCopyWorkerPool::get_instance().dispatch(urlCopyArgs, &pid))
+    {
+        db->setPidForJob(job_id, pid);
+    }
+    else if (-1 == pr.executeProcessShell(forkMessage))
     {
         if (forkMessage.empty())
         {
@@ -334,7 +351,9 @@ void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<T
     }
     else
     {
-        db->setPidForJob(job_id, pr.getPid());
+        pid = pr.getPid();
+        UrlCopyProcessRegistry::get_instance().add(pid);
+        db->setPidForJob(job_id, pid);
     }
 
     std::map<uint64_t, std::string>::const_iterator iterFileIds;
@@ -344,7 +363,7 @@ void ReuseTransfersService::startUrlCopy(std::string const & job_id, std::list<T
         fts3::events::MessageUpdater msg2;
         msg2.set_job_id(job_id);
         msg2.set_file_id(iterFileIds->first);
-        msg2.set_process_id(pr.getPid());
+        msg2.set_process_id(pid);
         msg2.set_timestamp(millisecondsSinceEpoch());
         ThreadSafeList::get_instance().push_back(msg2);
 
@@ -403,7 +422,7 @@ void ReuseTransfersService::executeUrlCopy()
 {
     // Bail out as soon as possible if there are too many url-copy processes
     int maxUrlCopy = config::ServerConfig::instance().get<int>("MaxUrlCopyProcesses");
-    int urlCopyCount = countProcessesWithName("fts_url_copy");
+    int urlCopyCount = UrlCopyProcessRegistry::get_instance().count();
     int availableUrlCopySlots = maxUrlCopy - urlCopyCount;
 
     if (availableUrlCopySlots <= 0) {
@@ -22,6 +22,7 @@
 #ifndef PROCESSSERVICEREUSE_H_
 #define PROCESSSERVICEREUSE_H_
 
+#include "ConfigSnapshot.h"
 #include "TransfersService.h"
 #include "UrlCopyCmd.h"
 
@@ -40,7 +41,7 @@ protected:
     void writeJobFile(const std::string& jobId, const std::vector<std::string>& files);
     std::map<uint64_t, std::string> generateJobFile(const std::string& jobId, const std::list<TransferFile>& files);
     void getFiles(const std::vector<QueueId>& queues, int availableUrlCopySlots);
-    void startUrlCopy(const std::string& jobId, const std::list<TransferFile>& files);
+    void startUrlCopy(const std::string& jobId, const std::list<TransferFile>& files, ConfigSnapshot& config);
     void executeUrlCopy();
 };
 
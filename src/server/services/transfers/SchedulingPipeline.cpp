@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "SchedulingPipeline.h"
+#include "common/Logger.h"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+
+
+namespace fts3 {
+namespace server {
+
+
+void SchedulingPipeline::StageStats::add(const time_duration &elapsed)
+{
+    ++count;
+    total += elapsed;
+    max = std::max(max, elapsed);
+}
+
+
+SchedulingPipeline::SchedulingPipeline(int prepareWorkers, int launchWorkers, size_t capacity):
+    prepareQueue(capacity), launchQueue(capacity), inFlightCount(0)
+{
+    for (int i = 0; i < std::max(prepareWorkers, 1); ++i) {
+        workers.create_thread([this]() { runPrepare(); });
+    }
+    for (int i = 0; i < std::max(launchWorkers, 1); ++i) {
+        workers.create_thread([this]() { runLaunch(); });
+    }
+}
+
+
+SchedulingPipeline::~SchedulingPipeline()
+{
+    // The owner may be being interrupted itself
+    boost::this_thread::disable_interruption disabled;
+    workers.interrupt_all();
+    workers.join_all();
+}
+
+
+void SchedulingPipeline::submit(std::unique_ptr<FileTransferExecutor> exec)
+{
+    const TransferFile &tf = exec->getTransferFile();
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        inFlight.fileIds.insert(tf.fileId);
+        ++inFlight.bySource[tf.sourceSe];
+        ++inFlight.byDestination[tf.destSe];
+        ++inFlightCount;
+    }
+    prepareQueue.push(std::move(exec));
+}
+
+
+void SchedulingPipeline::fetched(const time_duration &elapsed)
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    stats.fetch.add(elapsed);
+}
+
+
+SchedulingPipeline::InFlight SchedulingPipeline::getInFlight()
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    return inFlight;
+}
+
+
+SchedulingPipeline::Stats SchedulingPipeline::collectStats()
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    Stats collected = stats;
+    collected.prepareQueueMax = prepareQueue.collectHighWatermark();
+    collected.launchQueueMax = launchQueue.collectHighWatermark();
+    collected.inFlight = inFlightCount;
+    stats = Stats();
+    return collected;
+}
+
+
+std::vector<uint64_t> SchedulingPipeline::takeNotLaunched()
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    std::vector<uint64_t> taken;
+    taken.swap(notLaunched);
+    return taken;
+}
+
+
+void SchedulingPipeline::runPrepare()
+{
+    try {
+        while (true) {
+            Item exec = prepareQueue.pop();
+
+            const ptime start = microsec_clock::universal_time();
+            bool prepared = false;
+            try {
+                prepared = exec->prepare();
+            }
+            catch (const boost::thread_interrupted&) {
+                throw;
+            }
+            catch (const std::exception &e) {
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception " << e.what() << commit;
+            }
+            catch (...) {
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception unknown" << commit;
+            }
+            {
+                boost::lock_guard<boost::mutex> lock(mutex);
+                stats.prepare.add(microsec_clock::universal_time() - start);
+            }
+
+            if (prepared) {
+                launchQueue.push(std::move(exec));
+            }
+            else {
+                release(exec->getTransferFile(), false);
+            }
+        }
+    }
+    catch (const boost::thread_interrupted&) {
+        FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Scheduling pipeline prepare worker interrupted" << commit;
+    }
+}
+
+
+void SchedulingPipeline::runLaunch()
+{
+    try {
+        while (true) {
+            Item exec = launchQueue.pop();
+
+            const ptime start = microsec_clock::universal_time();
+            bool launched = false;
+            try {
+                launched = exec->launch();
+            }
+            catch (const boost::thread_interrupted&) {
+                throw;
+            }
+            catch (const std::exception &e) {
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception " << e.what() << commit;
+            }
+            catch (...) {
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Process thread exception unknown" << commit;
+            }
+            {
+                boost::lock_guard<boost::mutex> lock(mutex);
+                stats.launch.add(microsec_clock::universal_time() - start);
+            }
+
+            release(exec->getTransferFile(), launched);
+        }
+    }
+    catch (const boost::thread_interrupted&) {
+        FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Scheduling pipeline launch worker interrupted" << commit;
+    }
+}
+
+
+void SchedulingPipeline::release(const TransferFile &tf, bool launched)
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+
+    inFlight.fileIds.erase(tf.fileId);
+    if (--inFlight.bySource[tf.sourceSe] <= 0) {
+        inFlight.bySource.erase(tf.sourceSe);
+    }
+    if (--inFlight.byDestination[tf.destSe] <= 0) {
+        inFlight.byDestination.erase(tf.destSe);
+    }
+    --inFlightCount;
+
+    if (launched) {
+        ++stats.launched;
+    }
+    else {
+        notLaunched.push_back(tf.fileId);
+    }
+}
+
+} // end namespace server
+} // end namespace fts3
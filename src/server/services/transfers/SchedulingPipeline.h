@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef SCHEDULINGPIPELINE_H_
+#define SCHEDULINGPIPELINE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/BoundedQueue.h"
+#include "FileTransferExecutor.h"
+
+namespace fts3 {
+namespace server {
+
+/**
+ * Long lived stages between the scheduler and the fts_url_copy processes.
+ *
+ * The scheduler (fetch stage) hands the selected transfers over with submit, and goes back to the database
+ * without waiting for them. The prepare workers build the commands (FileTransferExecutor::prepare),
+ * and the launch workers move the transfers to READY and spawn them (FileTransferExecutor::launch).
+ * The stages are connected by bounded queues, so the scheduler blocks when the workers can not keep up.
+ *
+ * Until launched, the transfers are still SUBMITTED in the database. The scheduler must take them into
+ * account with getInFlight, so they are not fetched twice and count against the limits.
+ */
+class SchedulingPipeline
+{
+public:
+    /// Transfers submitted and not launched yet
+    struct InFlight {
+        std::set<uint64_t> fileIds;
+        std::map<std::string, int> bySource;
+        std::map<std::string, int> byDestination;
+    };
+
+    /// Time spent by the transfers in a stage
+    struct StageStats {
+        uint64_t count;
+        boost::posix_time::time_duration total;
+        boost::posix_time::time_duration max;
+
+        StageStats(): count(0) {}
+
+        void add(const boost::posix_time::time_duration &elapsed);
+    };
+
+    /// Counters since the previous call to collectStats
+    struct Stats {
+        StageStats fetch, prepare, launch;
+        /// Transfers that reached the fts_url_copy
+        uint64_t launched;
+        /// Highest number of transfers waiting for each stage
+        size_t prepareQueueMax, launchQueueMax;
+        /// Transfers submitted and not launched yet
+        size_t inFlight;
+
+        Stats(): launched(0), prepareQueueMax(0), launchQueueMax(0), inFlight(0) {}
+    };
+
+    /**
+     * Start the workers
+     * @param prepareWorkers    Threads building the commands
+     * @param launchWorkers     Threads claiming and spawning the transfers
+     * @param capacity          Maximum number of transfers waiting for each stage
+     */
+    SchedulingPipeline(int prepareWorkers, int launchWorkers, size_t capacity);
+
+    /// Interrupt the workers. Transfers not launched yet stay SUBMITTED.
+    ~SchedulingPipeline();
+
+    SchedulingPipeline(const SchedulingPipeline&) = delete;
+    SchedulingPipeline& operator = (const SchedulingPipeline&) = delete;
+
+    /// Hand over a transfer. Blocks while the prepare stage is full.
+    void submit(std::unique_ptr<FileTransferExecutor> exec);
+
+    /// Account the time spent by the scheduler selecting a batch of transfers
+    void fetched(const boost::posix_time::time_duration &elapsed);
+
+    /// Transfers submitted and not launched yet
+    InFlight getInFlight();
+
+    /// Return the counters, and reset them
+    Stats collectStats();
+
+    /// Return the transfers that left the pipeline without being launched since the previous call
+    std::vector<uint64_t> takeNotLaunched();
+
+private:
+    typedef std::unique_ptr<FileTransferExecutor> Item;
+
+    common::BoundedQueue<Item> prepareQueue;
+    common::BoundedQueue<Item> launchQueue;
+    boost::thread_group workers;
+
+    boost::mutex mutex;
+    InFlight inFlight;
+    size_t inFlightCount;
+    std::vector<uint64_t> notLaunched;
+    Stats stats;
+
+    void runPrepare();
+    void runLaunch();
+
+    /// The transfer left the pipeline, launched or not
+    void release(const TransferFile &tf, bool launched);
+};
+
+} // end namespace server
+} // end namespace fts3
+
+#endif // SCHEDULINGPIPELINE_H_
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+
+#include "SchedulingTrigger.h"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+
+
+namespace fts3 {
+namespace server {
+
+
+SchedulingTrigger::SchedulingTrigger(): pending(false)
+{
+}
+
+
+void SchedulingTrigger::notify()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        ++stats.notifications;
+        if (!pending) {
+            pending = true;
+            firstPending = microsec_clock::universal_time();
+        }
+    }
+    cond.notify_one();
+}
+
+
+bool SchedulingTrigger::wait(const time_duration &debounce, const time_duration &maxInterval)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+
+    const ptime deadline = microsec_clock::universal_time() + maxInterval;
+    while (!pending) {
+        if (!cond.timed_wait(lock, deadline)) {
+            break;
+        }
+    }
+
+    const bool woken = pending;
+    if (woken) {
+        ptime until = firstPending + debounce;
+        if (!lastCycle.is_not_a_date_time()) {
+            until = std::max(until, lastCycle + debounce);
+        }
+        until = std::min(until, deadline);
+
+        const time_duration remaining = until - microsec_clock::universal_time();
+        if (remaining > boost::posix_time::microseconds(0)) {
+            lock.unlock();
+            boost::this_thread::sleep(remaining);
+            lock.lock();
+        }
+    }
+
+    lastCycle = microsec_clock::universal_time();
+    ++stats.cycles;
+    if (pending) {
+        const time_duration idle = lastCycle - firstPending;
+        stats.idleTotal += idle;
+        stats.idleMax = std::max(stats.idleMax, idle);
+        pending = false;
+    }
+    if (woken) {
+        ++stats.woken;
+    }
+
+    return woken;
+}
+
+
+SchedulingTrigger::Stats SchedulingTrigger::collectStats()
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    Stats collected = stats;
+    stats = Stats();
+    return collected;
+}
+
+} // end namespace server
+} // end namespace fts3
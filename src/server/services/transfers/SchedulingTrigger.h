@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef SCHEDULINGTRIGGER_H_
+#define SCHEDULINGTRIGGER_H_
+
+#include <cstdint>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace fts3 {
+namespace server {
+
+/// Wakes the scheduler up when slots may have been freed (i.e. transfers reached a terminal state),
+/// instead of waiting for the next fixed interval.
+/// Notifications arriving close together are coalesced into a single scheduling cycle.
+class SchedulingTrigger
+{
+public:
+    static SchedulingTrigger& get_instance()
+    {
+        static SchedulingTrigger instance;
+        return instance;
+    }
+
+    /// Counters since the previous call to collectStats
+    struct Stats {
+        /// Scheduling cycles started
+        uint64_t cycles;
+        /// Cycles started by a notification, rather than by the maximum interval
+        uint64_t woken;
+        /// Notifications received
+        uint64_t notifications;
+        /// Time between the first notification and the start of the cycle serving it
+        boost::posix_time::time_duration idleTotal;
+        boost::posix_time::time_duration idleMax;
+
+        Stats(): cycles(0), woken(0), notifications(0) {}
+    };
+
+    SchedulingTrigger();
+
+    SchedulingTrigger(const SchedulingTrigger&) = delete;
+    SchedulingTrigger& operator = (const SchedulingTrigger&) = delete;
+
+    /// Something happened that may allow to schedule more transfers
+    void notify();
+
+    /// Block until notified, or until maxInterval elapses since the call.
+    /// Once notified, wait until debounce has passed since the notification and since the previous
+    /// cycle, so a burst of notifications results in a single cycle.
+    /// This is an interruption point.
+    /// @return true if woken by a notification, false when maxInterval expired
+    bool wait(const boost::posix_time::time_duration &debounce,
+        const boost::posix_time::time_duration &maxInterval);
+
+    /// Return the counters, and reset them
+    Stats collectStats();
+
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+
+    /// Notified since the last cycle started
+    bool pending;
+    boost::posix_time::ptime firstPending;
+    boost::posix_time::ptime lastCycle;
+
+    Stats stats;
+};
+
+} // end namespace server
+} // end namespace fts3
+
+#endif // SCHEDULINGTRIGGER_H_
@@ -80,3 +80,29 @@ void SingleTrStateInstance::sendStateMessage(const std::string& jobId, uint64_t
         FTS3_COMMON_LOGGER_NEWLOG (ERR) << "Failed saving transfer state " << commit;
     }
 }
+
+
+void SingleTrStateInstance::sendStateMessage(const std::vector<TransferState>& files)
+{
+    if (!monitoringMessages)
+        return;
+
+    if (!producer.get()) {
+        producer.reset(new Producer(ServerConfig::instance().get<std::string>("MessagingDirectory")));
+    }
+
+    try {
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            MsgIfce::getInstance()->SendTransferStatusChange(*producer, *it);
+        }
+    }
+    catch (BaseException &e) {
+        FTS3_COMMON_LOGGER_NEWLOG (ERR) << "Failed saving transfer state, " << e.what() << commit;
+    }
+    catch (std::exception &ex) {
+        FTS3_COMMON_LOGGER_NEWLOG (ERR) << "Failed saving transfer state, " << ex.what() << commit;
+    }
+    catch (...) {
+        FTS3_COMMON_LOGGER_NEWLOG (ERR) << "Failed saving transfer state " << commit;
+    }
+}
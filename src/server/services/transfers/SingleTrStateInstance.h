@@ -58,6 +58,9 @@ public:
 
     void sendStateMessage(const std::string& jobId, uint64_t fileId);
 
+    /// Send the state messages for states already retrieved from the database
+    void sendStateMessage(const std::vector<TransferState>& files);
+
 private:
     SingleTrStateInstance(); // Private so that it can  not be called
 
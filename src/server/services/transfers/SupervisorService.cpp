@@ -18,6 +18,7 @@
 #include "config/ServerConfig.h"
 #include "db/generic/SingleDbInstance.h"
 #include "ThreadSafeList.h"
+#include "ProgressUpdateCoalescer.h"
 #include <msg-bus/events.h>
 
 using namespace fts3::common;
@@ -34,6 +35,9 @@ SupervisorService::SupervisorService(): BaseService("SupervisorService"),
     std::string address = std::string("ipc://") + messagingDirectory + "/url_copy-ping.ipc";
     zmqPingSocket.set(zmq::sockopt::subscribe, "");
     zmqPingSocket.bind(address.c_str());
+
+    ProgressUpdateCoalescer::get_instance().setInterval(
+        config::ServerConfig::instance().get<boost::posix_time::time_duration>("ProgressUpdateInterval"));
 }
 
 
@@ -42,7 +46,6 @@ void SupervisorService::runService()
     FTS3_COMMON_LOGGER_NEWLOG(INFO) << "SupervisorService interval: 1s" << commit;
 
     while (!boost::this_thread::interruption_requested()) {
-        std::vector<fts3::events::MessageUpdater> events;
         zmq::message_t message;
 
         try {
@@ -57,7 +60,6 @@ void SupervisorService::runService()
                 if (!event.ParseFromArray(message.data(), static_cast<int>(message.size()))) {
                     continue;
                 }
-                events.emplace_back(event);
 
                 FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Process Updater Monitor"
                                                 << "\nJob id: " << event.job_id()
@@ -78,12 +80,10 @@ void SupervisorService::runService()
                                                 << commit;
 
                 ThreadSafeList::get_instance().updateMsg(event);
+                ProgressUpdateCoalescer::get_instance().add(event);
             }
 
-            if (!events.empty()) {
-                db::DBSingleton::instance().getDBObjectInstance()->updateFileTransferProgressVector(events);
-                events.clear();
-            }
+            ProgressUpdateCoalescer::get_instance().flush();
         } catch (const boost::thread_interrupted&) {
             FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Thread interruption requested in SupervisorService!" << commit;
             break;
@@ -93,6 +93,16 @@ void SupervisorService::runService()
             FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Unknown exception in SupervisorService!" << commit;
         }
     }
+
+    // Do not lose the last progress received
+    try {
+        boost::this_thread::disable_interruption disabled;
+        ProgressUpdateCoalescer::get_instance().flush(true);
+    } catch (const std::exception& e) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not write the pending progress updates: " << e.what() << commit;
+    } catch (...) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not write the pending progress updates" << commit;
+    }
 }
 
 }
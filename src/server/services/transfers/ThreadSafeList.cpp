@@ -18,8 +18,6 @@
  * limitations under the License.
  */
 
-#include <iostream>
-#include <ctime>
 #include <common/Exceptions.h>
 
 #include "common/Logger.h"
@@ -28,6 +26,24 @@
 
 using fts3::common::SystemError;
 
+typedef boost::unique_lock<boost::timed_mutex> ShardLock;
+
+
+static ShardLock lockShard(boost::timed_mutex &mutex, const char *func)
+{
+    ShardLock lock(mutex, boost::posix_time::seconds(10));
+    if (!lock.owns_lock()) {
+        throw SystemError(std::string(func) + ": Mutex timeout expired");
+    }
+    return lock;
+}
+
+
+size_t ThreadSafeList::TransferKeyHash::operator()(const TransferKey &key) const
+{
+    return std::hash<std::string>()(key.first) ^ (std::hash<uint64_t>()(key.second) * 0x9e3779b97f4a7c15ULL);
+}
+
 
 ThreadSafeList::ThreadSafeList()
 {
@@ -39,134 +55,180 @@ ThreadSafeList::~ThreadSafeList()
 }
 
 
+ThreadSafeList::Shard &ThreadSafeList::getShard(const TransferKey &key)
+{
+    return shards[TransferKeyHash()(key) % SHARD_COUNT];
+}
+
+
+ThreadSafeList::PidShard &ThreadSafeList::getPidShard(int pid)
+{
+    return pidShards[static_cast<unsigned>(pid) % SHARD_COUNT];
+}
+
+
+void ThreadSafeList::indexPid(int pid, const TransferKey &key)
+{
+    PidShard &pidShard = getPidShard(pid);
+    auto lock = lockShard(pidShard.mutex, __func__);
+    pidShard.transfers[pid].insert(key);
+}
+
+
+void ThreadSafeList::unindexPid(int pid, const TransferKey &key)
+{
+    PidShard &pidShard = getPidShard(pid);
+    auto lock = lockShard(pidShard.mutex, __func__);
+
+    auto iter = pidShard.transfers.find(pid);
+    if (iter != pidShard.transfers.end()) {
+        iter->second.erase(key);
+        if (iter->second.empty()) {
+            pidShard.transfers.erase(iter);
+        }
+    }
+}
+
+
 void ThreadSafeList::push_back(fts3::events::MessageUpdater &msg)
 {
-    if (!_mutex.timed_lock(boost::posix_time::seconds(10))) {
-        throw SystemError(std::string(__func__) + ": Mutex timeout expired");
+    const TransferKey key(msg.job_id(), msg.file_id());
+    const uint64_t pidStartTime = fts3::common::getPidStartime(msg.process_id());
+
+    Shard &shard = getShard(key);
+    auto lock = lockShard(shard.mutex, __func__);
+
+    auto iter = shard.entries.find(key);
+    if (iter != shard.entries.end()) {
+        shard.byTimestamp.erase(iter->second.timestampIter);
+        if (iter->second.msg.process_id() != msg.process_id()) {
+            unindexPid(iter->second.msg.process_id(), key);
+        }
     }
-    m_list.push_back(msg);
-    _mutex.unlock();
+
+    Entry &entry = shard.entries[key];
+    entry.msg = msg;
+    entry.pidStartTime = pidStartTime;
+    entry.timestampIter = shard.byTimestamp.emplace(msg.timestamp(), key).first;
+
+    // Under the shard lock, so a concurrent remove can not leave the index behind
+    indexPid(msg.process_id(), key);
 }
 
 
 void ThreadSafeList::clear()
 {
-    if (!_mutex.timed_lock(boost::posix_time::seconds(10))) {
-        throw SystemError(std::string(__func__) + ": Mutex timeout expired");
+    for (auto &shard: shards) {
+        auto lock = lockShard(shard.mutex, __func__);
+        shard.entries.clear();
+        shard.byTimestamp.clear();
+    }
+    for (auto &pidShard: pidShards) {
+        auto lock = lockShard(pidShard.mutex, __func__);
+        pidShard.transfers.clear();
     }
-    m_list.clear();
-    _mutex.unlock();
 }
 
 
 void ThreadSafeList::checkExpiredMsg(std::vector<fts3::events::MessageUpdater> &messages,
     boost::posix_time::time_duration timeout)
 {
-    static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
-
-    if (!_mutex.timed_lock(boost::posix_time::seconds(10))) {
-        throw SystemError(std::string(__func__) + ": Mutex timeout expired");
+    const uint64_t now = millisecondsSinceEpoch();
+    const uint64_t timeoutMs = timeout.total_milliseconds();
+    if (now <= timeoutMs) {
+        return;
     }
+    const uint64_t oldest = now - timeoutMs;
 
-    try {
-        for (auto iter = m_list.begin(); iter != m_list.end(); ++iter) {
-            auto nowTime = boost::posix_time::microsec_clock::universal_time();
-            auto lastMsgTime = epoch + boost::posix_time::milliseconds(iter->timestamp());
-            auto age = nowTime - lastMsgTime;
-
-            if (age > timeout) {
-                messages.push_back(*iter);
-            }
+    // Only the expired entries are visited, since they come first
+    for (auto &shard: shards) {
+        auto lock = lockShard(shard.mutex, __func__);
+        for (auto iter = shard.byTimestamp.begin(); iter != shard.byTimestamp.end() && iter->first < oldest; ++iter) {
+            messages.push_back(shard.entries.at(iter->second).msg);
         }
     }
-    catch (...) {
-        _mutex.unlock();
-        throw;
-    }
-    _mutex.unlock();
 }
 
 
 void ThreadSafeList::updateMsg(fts3::events::MessageUpdater &msg)
 {
-    if (!_mutex.timed_lock(boost::posix_time::seconds(10))) {
-        throw SystemError(std::string(__func__) + ": Mutex timeout expired");
+    std::vector<TransferKey> keys;
+    {
+        PidShard &pidShard = getPidShard(msg.process_id());
+        auto lock = lockShard(pidShard.mutex, __func__);
+
+        auto iter = pidShard.transfers.find(msg.process_id());
+        if (iter == pidShard.transfers.end()) {
+            return;
+        }
+        keys.assign(iter->second.begin(), iter->second.end());
     }
 
-    try {
-        std::list<fts3::events::MessageUpdater>::iterator iter;
-        uint64_t pidStartTime = fts3::common::getPidStartime(msg.process_id());
-        for (iter = m_list.begin(); iter != m_list.end(); ++iter) {
-
-            if (msg.process_id() == iter->process_id()) {
-                if (pidStartTime > 0 && msg.timestamp() >= pidStartTime) {
-                    iter->set_timestamp(msg.timestamp());
-                }
-                else if (pidStartTime > 0) {
-                    FTS3_COMMON_LOGGER_NEWLOG(WARNING)
-                        << "Found a matching pid, but start time is more recent than last known message"
-                        << "(" << pidStartTime << " vs " << msg.timestamp() << " for " << msg.process_id() << ")"
-                        << fts3::common::commit;
-                }
-            }
+    for (const auto &key: keys) {
+        Shard &shard = getShard(key);
+        auto lock = lockShard(shard.mutex, __func__);
+
+        auto iter = shard.entries.find(key);
+        if (iter == shard.entries.end() || iter->second.msg.process_id() != msg.process_id()) {
+            continue;
+        }
+
+        Entry &entry = iter->second;
+        // The process was not visible yet when added
+        if (entry.pidStartTime == 0) {
+            entry.pidStartTime = fts3::common::getPidStartime(msg.process_id());
+        }
+
+        if (entry.pidStartTime > 0 && msg.timestamp() >= entry.pidStartTime) {
+            shard.byTimestamp.erase(entry.timestampIter);
+            entry.msg.set_timestamp(msg.timestamp());
+            entry.timestampIter = shard.byTimestamp.emplace(msg.timestamp(), key).first;
+        }
+        else if (entry.pidStartTime > 0) {
+            FTS3_COMMON_LOGGER_NEWLOG(WARNING)
+                << "Found a matching pid, but start time is more recent than last known message"
+                << "(" << entry.pidStartTime << " vs " << msg.timestamp() << " for " << msg.process_id() << ")"
+                << fts3::common::commit;
         }
     }
-    catch (...) {
-        _mutex.unlock();
-        throw;
-    }
-    _mutex.unlock();
 }
 
 
-void ThreadSafeList::deleteMsg(std::vector<fts3::events::MessageUpdater> &messages)
+void ThreadSafeList::remove(const TransferKey &key)
 {
-    if (!_mutex.timed_lock(boost::posix_time::seconds(10))) {
-        throw SystemError(std::string(__func__) + ": Mutex timeout expired");
-    }
+    Shard &shard = getShard(key);
+    auto lock = lockShard(shard.mutex, __func__);
 
-    try {
-        std::list<fts3::events::MessageUpdater>::iterator i = m_list.begin();
-        for (auto iter = messages.begin(); iter != messages.end(); ++iter) {
-            i = m_list.begin();
-            while (i != m_list.end()) {
-                if ((*iter).file_id() == i->file_id() && (*iter).job_id().compare(i->job_id()) == 0) {
-                    m_list.erase(i++);
-                }
-                else {
-                    ++i;
-                }
-            }
-        }
+    auto iter = shard.entries.find(key);
+    if (iter == shard.entries.end()) {
+        return;
     }
-    catch (...) {
-        _mutex.unlock();
-        throw;
+    unindexPid(iter->second.msg.process_id(), key);
+    shard.byTimestamp.erase(iter->second.timestampIter);
+    shard.entries.erase(iter);
+}
+
+
+void ThreadSafeList::deleteMsg(std::vector<fts3::events::MessageUpdater> &messages)
+{
+    for (const auto &msg: messages) {
+        remove(TransferKey(msg.job_id(), msg.file_id()));
     }
-    _mutex.unlock();
 }
 
 
 void ThreadSafeList::removeFinishedTr(std::string job_id, uint64_t file_id)
 {
-    if (!_mutex.timed_lock(boost::posix_time::seconds(10))) {
-        throw SystemError(std::string(__func__) + ": Mutex timeout expired");
-    }
+    remove(TransferKey(job_id, file_id));
+}
 
-    try {
-        std::list<fts3::events::MessageUpdater>::iterator i = m_list.begin();
-        while (i != m_list.end()) {
-            if (file_id == i->file_id() && job_id == i->job_id()) {
-                m_list.erase(i++);
-            }
-            else {
-                ++i;
-            }
-        }
-    }
-    catch (...) {
-        _mutex.unlock();
-        throw;
+
+size_t ThreadSafeList::size()
+{
+    size_t total = 0;
+    for (auto &shard: shards) {
+        auto lock = lockShard(shard.mutex, __func__);
+        total += shard.entries.size();
     }
-    _mutex.unlock();
+    return total;
 }
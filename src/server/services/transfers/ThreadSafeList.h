@@ -21,12 +21,17 @@
 #ifndef THREADSAFELIST_H_
 #define THREADSAFELIST_H_
 
-#include <list>
-#include <vector>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <boost/thread.hpp>
 #include "msg-bus/events.h"
 
+/// Watch list of the running url-copy processes, used to detect stalled transfers.
+/// Entries are indexed by transfer (job id, file id), by pid, and by last update time,
+/// and split into independently locked shards.
 class ThreadSafeList
 {
 public:
@@ -39,17 +44,57 @@ public:
     ThreadSafeList();
     ~ThreadSafeList();
 
+    /// Watch a transfer, replacing the previous entry for the same job and file
     void push_back(fts3::events::MessageUpdater &msg);
     void clear();
+    /// Refresh the timestamp of the transfers run by msg.process_id()
     void updateMsg(fts3::events::MessageUpdater &msg);
+    /// Return the transfers not updated for longer than timeout
     void checkExpiredMsg(std::vector<fts3::events::MessageUpdater>& messages,
         boost::posix_time::time_duration timeout);
     void deleteMsg(std::vector<fts3::events::MessageUpdater>& messages);
     void removeFinishedTr(std::string job_id, uint64_t file_id);
+    size_t size();
 
 private:
-    std::list<fts3::events::MessageUpdater> m_list;
-    mutable boost::recursive_timed_mutex _mutex;
+    typedef std::pair<std::string, uint64_t> TransferKey;
+
+    struct TransferKeyHash {
+        size_t operator()(const TransferKey &key) const;
+    };
+
+    typedef std::set<std::pair<uint64_t, TransferKey>> TimestampIndex;
+
+    struct Entry {
+        fts3::events::MessageUpdater msg;
+        /// Start time of the process, read once when the transfer is added
+        uint64_t pidStartTime;
+        TimestampIndex::iterator timestampIter;
+    };
+
+    struct Shard {
+        boost::timed_mutex mutex;
+        std::unordered_map<TransferKey, Entry, TransferKeyHash> entries;
+        TimestampIndex byTimestamp;
+    };
+
+    struct PidShard {
+        boost::timed_mutex mutex;
+        std::unordered_map<int, std::set<TransferKey>> transfers;
+    };
+
+    static const size_t SHARD_COUNT = 32;
+
+    Shard shards[SHARD_COUNT];
+    PidShard pidShards[SHARD_COUNT];
+
+    Shard &getShard(const TransferKey &key);
+    PidShard &getPidShard(int pid);
+
+    /// Called with the lock of the shard of key held. The pid shard lock is always taken after it.
+    void indexPid(int pid, const TransferKey &key);
+    void unindexPid(int pid, const TransferKey &key);
+    void remove(const TransferKey &key);
 };
 
 #endif /*THREADSAFELIST_H_*/
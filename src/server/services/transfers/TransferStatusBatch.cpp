@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <set>
+
+#include "common/Logger.h"
+#include "TransferStatusBatch.h"
+
+using namespace fts3::common;
+
+namespace fts3 {
+namespace server {
+
+
+std::vector<TransferStatusUpdate> TransferStatusBatch::apply(const std::vector<fts3::events::Message>& batch) const
+{
+    try {
+        return bulkUpdate(batch);
+    }
+    catch (const TransferStatusBatchError& e) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Bulk status update failed after applying the file changes, "
+                                       << "refreshing the job states: " << e.what() << commit;
+
+        std::vector<TransferStatusUpdate> results = e.getResults();
+        std::set<std::pair<std::string, std::string>> jobUpdates;
+        for (auto result = results.begin(); result != results.end(); ++result) {
+            if (result->retried || result->jobId.empty() || result->fileId == 0) {
+                continue;
+            }
+            if (!jobUpdates.insert(std::make_pair(result->jobId, result->state)).second) {
+                continue;
+            }
+            try {
+                jobUpdate(result->jobId, result->state);
+            }
+            catch (const std::exception& e) {
+                FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not update the state of the job " << result->jobId
+                                               << ": " << e.what() << commit;
+            }
+        }
+        return results;
+    }
+    catch (const std::exception& e) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Bulk status update failed, applying the messages one by one: "
+                                           << e.what() << commit;
+        for (auto iter = batch.begin(); iter != batch.end(); ++iter) {
+            singleUpdate(*iter);
+        }
+        return std::vector<TransferStatusUpdate>();
+    }
+}
+
+} // end namespace server
+} // end namespace fts3
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef TRANSFERSTATUSBATCH_H_
+#define TRANSFERSTATUSBATCH_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "db/generic/TransferStatusUpdate.h"
+#include "msg-bus/events.h"
+
+namespace fts3 {
+namespace server {
+
+/// Applies a batch of status messages in bulk, and decides what to do when the bulk change fails
+struct TransferStatusBatch
+{
+    typedef std::function<std::vector<TransferStatusUpdate> (const std::vector<fts3::events::Message>&)> BulkUpdate;
+    typedef std::function<void (const fts3::events::Message&)> SingleUpdate;
+    typedef std::function<void (const std::string& jobId, const std::string& state)> JobUpdate;
+
+    BulkUpdate bulkUpdate;
+    /// Applies a message on its own, when the bulk change was rolled back
+    SingleUpdate singleUpdate;
+    /// Refreshes the state of a job, when the bulk change failed after committing the file changes
+    JobUpdate jobUpdate;
+
+    /**
+     * Apply the messages with bulkUpdate.
+     * If it fails before committing, the messages are applied one by one with singleUpdate, and nothing is returned.
+     * If it fails after committing (TransferStatusBatchError), the messages are not applied again,
+     * only the state of the jobs touched is refreshed, and the committed outcome is returned.
+     */
+    std::vector<TransferStatusUpdate> apply(const std::vector<fts3::events::Message>& batch) const;
+};
+
+} // end namespace server
+} // end namespace fts3
+
+#endif // TRANSFERSTATUSBATCH_H_
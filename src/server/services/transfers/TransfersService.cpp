@@ -20,22 +20,25 @@
 
 #include <ctime>
 #include <random>
+#include <set>
 
 #include "TransfersService.h"
+#include "SchedulingTrigger.h"
 #include "VoShares.h"
 
 #include "config/ServerConfig.h"
-#include "common/DaemonTools.h"
-#include "common/ThreadPool.h"
+#include "common/WorkStealingExecutor.h"
 
-#include "cred/DelegCred.h"
+#include "cred/CredentialCache.h"
 
 #include "db/generic/TransferFile.h"
 
 #include "server/common/DrainMode.h"
 
+#include "ConfigSnapshot.h"
 #include "TransferFileHandler.h"
 #include "FileTransferExecutor.h"
+#include "UrlCopyProcessRegistry.h"
 
 #include "msg-bus/producer.h"
 
@@ -79,12 +82,59 @@ TransfersService::TransfersService(): BaseService("TransfersService")
 
     monitoringMessages = config::ServerConfig::instance().get<bool>("MonitoringMessaging");
     schedulingInterval = config::ServerConfig::instance().get<boost::posix_time::time_duration>("SchedulingInterval");
+    claimTransfers = config::ServerConfig::instance().get<bool>("ClaimTransfers");
+    schedulingDebounce = boost::posix_time::milliseconds(
+        config::ServerConfig::instance().get<int>("SchedulingDebounce"));
+}
+
+
+void TransfersService::logSchedulingStats()
+{
+    const SchedulingTrigger::Stats stats = SchedulingTrigger::get_instance().collectStats();
+    const int64_t woken = static_cast<int64_t>(stats.woken);
+
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Scheduling cycles=" << stats.cycles
+        << " woken=" << stats.woken
+        << " notifications=" << stats.notifications
+        << " slot_idle_avg_ms=" << (woken > 0 ? stats.idleTotal.total_milliseconds() / woken : 0)
+        << " slot_idle_max_ms=" << stats.idleMax.total_milliseconds()
+        << commit;
+
+    if (pipeline) {
+        const SchedulingPipeline::Stats pipelineStats = pipeline->collectStats();
+        auto avgMs = [](const SchedulingPipeline::StageStats &stage) {
+            return stage.count > 0 ? stage.total.total_milliseconds() / static_cast<int64_t>(stage.count) : 0;
+        };
+
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Scheduling pipeline launched=" << pipelineStats.launched
+            << " in_flight=" << pipelineStats.inFlight
+            << " fetch_avg_ms=" << avgMs(pipelineStats.fetch)
+            << " fetch_max_ms=" << pipelineStats.fetch.max.total_milliseconds()
+            << " prepare_avg_ms=" << avgMs(pipelineStats.prepare)
+            << " prepare_max_ms=" << pipelineStats.prepare.max.total_milliseconds()
+            << " prepare_queue_max=" << pipelineStats.prepareQueueMax
+            << " launch_avg_ms=" << avgMs(pipelineStats.launch)
+            << " launch_max_ms=" << pipelineStats.launch.max.total_milliseconds()
+            << " launch_queue_max=" << pipelineStats.launchQueueMax
+            << commit;
+    }
 }
 
 
 void TransfersService::runService()
 {
     FTS3_COMMON_LOGGER_NEWLOG(INFO) << "TransfersService interval: " << schedulingInterval.total_seconds() << "s" << commit;
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "TransfersService debounce: " << schedulingDebounce.total_milliseconds() << "ms" << commit;
+
+    if (config::ServerConfig::instance().get<bool>("PipelinedScheduling") &&
+        config::ServerConfig::instance().get<std::string>("DbType") != "postgresql") {
+        const int capacity = config::ServerConfig::instance().get<int>("SchedulingPipelineCapacity");
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << "TransfersService pipeline: " << execPoolSize << " prepare and "
+            << execPoolSize << " launch workers, capacity " << capacity << commit;
+        pipeline.reset(new SchedulingPipeline(execPoolSize, execPoolSize, capacity));
+    }
+
+    time_t lastStats = time(NULL);
 
     while (!boost::this_thread::interruption_requested())
     {
@@ -96,7 +146,13 @@ void TransfersService::runService()
 
         try
         {
-            boost::this_thread::sleep(schedulingInterval);
+            // Run as soon as slots are freed, or at the latest after the scheduling interval
+            SchedulingTrigger::get_instance().wait(schedulingDebounce, schedulingInterval);
+
+            if (time(NULL) - lastStats >= 60) {
+                logSchedulingStats();
+                lastStats = time(NULL);
+            }
 
             if (DrainMode::instance())
             {
@@ -119,24 +175,35 @@ void TransfersService::runService()
             FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Unknown exception in TransfersService!" << commit;
         }
     }
+
+    pipeline.reset();
 }
 
 
-void TransfersService::getFiles(const std::vector<QueueId>& queues, int availableUrlCopySlots)
+void TransfersService::getFiles(const std::vector<QueueId>& queues, int availableUrlCopySlots,
+    const SchedulingPipeline::InFlight &inFlight)
 {
     auto db = DBSingleton::instance().getDBObjectInstance();
+    const boost::posix_time::ptime fetchStart = boost::posix_time::microsec_clock::universal_time();
+
+    // Configuration shared by all the executors of this cycle
+    auto config = std::make_shared<ConfigSnapshot>(db);
 
-    ThreadPool<FileTransferExecutor> execPool(execPoolSize);
+    // Without the pipeline, the tasks of this cycle are joined before returning
+    std::unique_ptr<TaskGroup> execPool;
+    if (!pipeline) {
+        execPool.reset(new TaskGroup(WorkStealingExecutor::instance(), execPoolSize, WorkStealingExecutor::High));
+    }
     std::map<std::string, int> slotsLeftForSource, slotsLeftForDestination;
     for (auto i = queues.begin(); i != queues.end(); ++i) {
         // To reduce queries, fill in one go limits as source and as destination
         if (slotsLeftForDestination.count(i->destSe) == 0) {
-            StorageConfig seConfig = db->getStorageConfig(i->destSe);
+            const StorageConfig &seConfig = config->getStorageConfig(i->destSe);
             slotsLeftForDestination[i->destSe] = seConfig.inboundMaxActive>0?seConfig.inboundMaxActive:60;
             slotsLeftForSource[i->destSe] = seConfig.outboundMaxActive>0?seConfig.outboundMaxActive:60;
         }
         if (slotsLeftForSource.count(i->sourceSe) == 0) {
-            StorageConfig seConfig = db->getStorageConfig(i->sourceSe);
+            const StorageConfig &seConfig = config->getStorageConfig(i->sourceSe);
             slotsLeftForDestination[i->sourceSe] = seConfig.inboundMaxActive>0?seConfig.inboundMaxActive:60;
             slotsLeftForSource[i->sourceSe] = seConfig.outboundMaxActive>0?seConfig.outboundMaxActive:60;
         }
@@ -144,6 +211,13 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
         slotsLeftForDestination[i->destSe] -= i->activeCount;
         slotsLeftForSource[i->sourceSe] -= i->activeCount;
     }
+    // Transfers still in the pipeline are not active yet in the database
+    for (auto i = inFlight.byDestination.begin(); i != inFlight.byDestination.end(); ++i) {
+        slotsLeftForDestination[i->first] -= i->second;
+    }
+    for (auto i = inFlight.bySource.begin(); i != inFlight.bySource.end(); ++i) {
+        slotsLeftForSource[i->first] -= i->second;
+    }
 
     try
     {
@@ -155,14 +229,23 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
 
 
         time_t start = time(0);
-        db->getReadyTransfers(queues, voQueues);
+        if (claimTransfers) {
+            db->claimReadyTransfers(queues, availableUrlCopySlots, voQueues);
+        }
+        else {
+            db->getReadyTransfers(queues, voQueues);
+        }
         time_t end =time(0);
         FTS3_COMMON_LOGGER_NEWLOG(INFO) << "DBtime=\"TransfersService\" "
                                         << "func=\"getFiles\" "
-                                        << "DBcall=\"getReadyTransfers\" " 
+                                        << "DBcall=\"" << (claimTransfers ? "claimReadyTransfers" : "getReadyTransfers") << "\" " 
                                         << "time=\"" << end - start << "\"" 
                                         << commit;
 
+        if (pipeline) {
+            pipeline->fetched(boost::posix_time::microsec_clock::universal_time() - fetchStart);
+        }
+
         if (voQueues.empty())
             return;
 
@@ -172,7 +255,6 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
         // create transfer-file handler
         TransferFileHandler tfh(voQueues);
 
-        std::map<std::pair<std::string, std::string>, std::string> proxies;
 
         // loop until all files have been served
         int initial_size = tfh.size();
@@ -181,10 +263,13 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
 
         // Count available url-copy slots right before start to fork new url-copy processes
         int maxUrlCopy = config::ServerConfig::instance().get<int>("MaxUrlCopyProcesses");
-        int urlCopyCount = countProcessesWithName("fts_url_copy");
-        availableUrlCopySlots = maxUrlCopy - urlCopyCount;
+        int urlCopyCount = UrlCopyProcessRegistry::get_instance().count();
+        availableUrlCopySlots = maxUrlCopy - urlCopyCount - static_cast<int>(inFlight.fileIds.size());
         FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Number of fts_url_copy process: " << urlCopyCount << commit;
 
+        int submitted = 0;
+        std::set<uint64_t> submittedIds;
+
         while (!tfh.empty() && availableUrlCopySlots > 0)
         {
             // iterate over all VOs
@@ -192,7 +277,9 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
             {
                 if (boost::this_thread::interruption_requested())
                 {
-                    execPool.interrupt();
+                    if (execPool) {
+                        execPool->interrupt();
+                    }
                     return;
                 }
 
@@ -207,17 +294,14 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
                 if (tf.fileId == 0 || tf.userDn.empty() || tf.credId.empty())
                     continue;
 
+                // already on its way
+                if (inFlight.fileIds.count(tf.fileId))
+                    continue;
+
                 if (!scheduledByActivity.count(tf.activity)) {
                     scheduledByActivity[tf.activity] = 0;
                 }
 
-                std::pair<std::string, std::string> proxy_key(tf.credId, tf.userDn);
-
-                if (proxies.find(proxy_key) == proxies.end())
-                {
-                    proxies[proxy_key] = DelegCred::getProxyFile(tf.userDn, tf.credId);
-                }
-
                 if (slotsLeftForDestination[tf.destSe] <= 0) {
                     if (warningPrintedDst.count(tf.destSe) == 0) {
                         FTS3_COMMON_LOGGER_NEWLOG(WARNING)
@@ -239,9 +323,16 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
 
                     FileTransferExecutor *exec = new FileTransferExecutor(tf,
                         monitoringMessages, ftsHostName,
-                        proxies[proxy_key], logDir, msgDir);
+                        CredentialCache::instance().getProxyFile(tf.userDn, tf.credId), logDir, msgDir, config);
 
-                    execPool.start(exec);
+                    if (pipeline) {
+                        submittedIds.insert(tf.fileId);
+                        pipeline->submit(std::unique_ptr<FileTransferExecutor>(exec));
+                        ++submitted;
+                    }
+                    else {
+                        execPool->start(exec);
+                    }
                     --availableUrlCopySlots;
                     --slotsLeftForDestination[tf.destSe];
                     --slotsLeftForSource[tf.sourceSe];
@@ -255,11 +346,39 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
                 << commit;
         }
 
-        // wait for all the workers to finish
-        execPool.join();
-        int scheduled = execPool.reduce(std::plus<int>());
-        FTS3_COMMON_LOGGER_NEWLOG(INFO) <<"Threadpool processed: " << initial_size
-                << " files (" << scheduled << " have been scheduled)" << commit;
+        int scheduled = submitted;
+        if (pipeline) {
+            // Claimed transfers left behind by the limits go back to the queue right away.
+            // The ones handed over are still SELECTED in the pipeline, so they are left alone.
+            if (claimTransfers && submitted < initial_size) {
+                std::vector<uint64_t> leftBehind;
+                for (auto vo = voQueues.begin(); vo != voQueues.end(); ++vo) {
+                    for (auto file = vo->second.begin(); file != vo->second.end(); ++file) {
+                        if (!submittedIds.count(file->fileId) && !inFlight.fileIds.count(file->fileId)) {
+                            leftBehind.push_back(file->fileId);
+                        }
+                    }
+                }
+                db->recoverSelectedTransfers(leftBehind);
+            }
+
+            FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Pipeline accepted: " << submitted << " out of " << initial_size
+                    << " files with configuration snapshot " << config->getVersion() << commit;
+        }
+        else {
+            // wait for all the workers to finish
+            execPool->join();
+            scheduled = execPool->reduce(std::plus<int>());
+
+            // Claimed transfers left behind by the limits go back to the queue
+            if (claimTransfers && scheduled < initial_size) {
+                db->recoverSelectedTransfers();
+            }
+
+            FTS3_COMMON_LOGGER_NEWLOG(INFO) <<"Threadpool processed: " << initial_size
+                    << " files (" << scheduled << " have been scheduled)"
+                    << " with configuration snapshot " << config->getVersion() << commit;
+        }
 
         if (scheduled > 0) {
             std::ostringstream out;
@@ -275,8 +394,10 @@ void TransfersService::getFiles(const std::vector<QueueId>& queues, int availabl
         }
     } catch (const boost::thread_interrupted&) {
         FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Interruption requested in TransfersService::getFiles!" << commit;
-        execPool.interrupt();
-        execPool.join();
+        if (execPool) {
+            execPool->interrupt();
+            execPool->join();
+        }
         throw;
     } catch (std::exception& e) {
         FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Exception in TransfersService::getFiles: " << e.what() << commit;
@@ -324,10 +445,22 @@ void TransfersService::executeUrlCopy()
 {
     std::vector<QueueId> queues, unschedulable;
 
+    // Taken before anything else, so a transfer launched meanwhile is counted
+    // either here or by the database
+    SchedulingPipeline::InFlight inFlight;
+    if (pipeline) {
+        inFlight = pipeline->getInFlight();
+        // Claimed transfers that did not make it through the pipeline go back to the queue
+        std::vector<uint64_t> notLaunched = pipeline->takeNotLaunched();
+        if (claimTransfers && !notLaunched.empty()) {
+            DBSingleton::instance().getDBObjectInstance()->recoverSelectedTransfers(notLaunched);
+        }
+    }
+
     // Bail out as soon as possible if there are too many url-copy processes
     int maxUrlCopy = config::ServerConfig::instance().get<int>("MaxUrlCopyProcesses");
-    int urlCopyCount = countProcessesWithName("fts_url_copy");
-    int availableUrlCopySlots = maxUrlCopy - urlCopyCount;
+    int urlCopyCount = UrlCopyProcessRegistry::get_instance().count();
+    int availableUrlCopySlots = maxUrlCopy - urlCopyCount - static_cast<int>(inFlight.fileIds.size());
 
     if (availableUrlCopySlots <= 0) {
         FTS3_COMMON_LOGGER_NEWLOG(WARNING)
@@ -352,7 +485,7 @@ void TransfersService::executeUrlCopy()
         if (queues.empty()) {
             return;
         }
-        getFiles(queues, availableUrlCopySlots);
+        getFiles(queues, availableUrlCopySlots, inFlight);
         time_t end = time(0); //std::chrono::system_clock::now();
         FTS3_COMMON_LOGGER_NEWLOG(INFO) << "DBtime=\"TransfersService\" "
                                         << "func=\"executeUrlcopy\" "
@@ -374,7 +507,7 @@ void TransfersService::executeUrlCopy()
 
 void TransfersService::postgresExecuteUrlCopy() {
     const int maxUrlCopy = config::ServerConfig::instance().get<int>("MaxUrlCopyProcesses");
-    const int urlCopyCount = countProcessesWithName("fts_url_copy");
+    const int urlCopyCount = UrlCopyProcessRegistry::get_instance().count();
     const int availableUrlCopySlots = maxUrlCopy - urlCopyCount;
 
     // Bail out as soon as possible if there are too many url-copy processes
@@ -401,30 +534,18 @@ void TransfersService::postgresExecuteUrlCopy() {
                                     << "nbScheduledFiles=\"" << scheduledFiles.size() << "\""
                                     << commit;
 
-    ThreadPool<FileTransferExecutor> execPool(execPoolSize);
-    std::map<std::pair<std::string, std::string>, std::string> proxies;
+    TaskGroup execPool(WorkStealingExecutor::instance(), execPoolSize, WorkStealingExecutor::High);
+    auto config = std::make_shared<ConfigSnapshot>(DBSingleton::instance().getDBObjectInstance());
 
     for (TransferFile &scheduledFile: scheduledFiles) {
-        const std::pair<std::string, std::string> proxy_key(
-            scheduledFile.credId,
-            scheduledFile.userDn
-        );
-
-        if (proxies.find(proxy_key) == proxies.end())
-        {
-            proxies[proxy_key] = DelegCred::getProxyFile(
-                scheduledFile.userDn,
-                scheduledFile.credId
-            );
-        }
-
         FileTransferExecutor * const exec = new FileTransferExecutor(
             scheduledFile,
             monitoringMessages,
             ftsHostName,
-            proxies[proxy_key],
+            CredentialCache::instance().getProxyFile(scheduledFile.userDn, scheduledFile.credId),
             logDir,
-            msgDir
+            msgDir,
+            config
         );
         execPool.start(exec);
     }
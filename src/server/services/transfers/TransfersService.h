@@ -22,11 +22,13 @@
 #ifndef PROCESSSERVICE_H_
 #define PROCESSSERVICE_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "db/generic/QueueId.h"
 #include "server/common/BaseService.h"
+#include "SchedulingPipeline.h"
 
 
 namespace fts3 {
@@ -49,8 +51,17 @@ protected:
     std::string logDir;
     std::string msgDir;
     boost::posix_time::time_duration schedulingInterval;
+    /// Claim the transfers instead of reading them (see GenericDbIfce::claimReadyTransfers)
+    bool claimTransfers;
+    /// Minimum time between a notification from SchedulingTrigger and the next run
+    boost::posix_time::time_duration schedulingDebounce;
 
-    void getFiles(const std::vector<QueueId>& queues, int availableUrlCopySlots);
+    /// When set, the transfers are handed over to the pipeline instead of a thread pool per cycle
+    std::unique_ptr<SchedulingPipeline> pipeline;
+
+    void logSchedulingStats();
+    void getFiles(const std::vector<QueueId>& queues, int availableUrlCopySlots,
+        const SchedulingPipeline::InFlight &inFlight);
     void executeUrlCopy();
 
     void postgresExecuteUrlCopy();
@@ -85,6 +85,24 @@ std::string UrlCopyCmd::generateParameters()
 }
 
 
+std::vector<std::string> UrlCopyCmd::generateArguments()
+{
+    std::vector<std::string> args;
+    args.reserve(flags.size() + options.size() * 2);
+
+    for (auto flag = flags.begin(); flag != flags.end(); ++flag) {
+        args.push_back("--" + *flag);
+    }
+
+    for (auto option = options.begin(); option != options.end(); ++option) {
+        args.push_back("--" + option->first);
+        args.push_back(option->second);
+    }
+
+    return args;
+}
+
+
 void UrlCopyCmd::setLogDir(const std::string &path)
 {
     setOption("logDir", path);
@@ -104,6 +122,14 @@ void UrlCopyCmd::setPingInterval(int interval)
 }
 
 
+void UrlCopyCmd::setConcurrentTransfers(int concurrent)
+{
+    if (concurrent > 1) {
+        setOption("concurrent-transfers", concurrent);
+    }
+}
+
+
 void UrlCopyCmd::setOptimizerLevel(int level)
 {
     setOption("level", level);
@@ -24,6 +24,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "db/generic/TransferFile.h"
 
@@ -54,10 +55,13 @@ public:
     UrlCopyCmd();
 
     std::string generateParameters();
+    /// Same as generateParameters, but one argument per entry, so values may contain spaces
+    std::vector<std::string> generateArguments();
 
     void setLogDir(const std::string&);
     void setMonitoring(bool, const std::string&);
     void setPingInterval(int interval);
+    void setConcurrentTransfers(int concurrent);
     void setOptimizerLevel(int);
     void setDebugLevel(int);
     void setProxy(const std::string&);
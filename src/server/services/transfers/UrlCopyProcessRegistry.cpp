@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/DaemonTools.h"
+#include "common/Exceptions.h"
+#include "common/Logger.h"
+
+#include "UrlCopyProcessRegistry.h"
+
+using namespace fts3::common;
+
+namespace fts3 {
+namespace server {
+
+
+static int openPidFd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+UrlCopyProcessRegistry::UrlCopyProcessRegistry(const std::string &name):
+    name(name), supported(true), epollFd(-1), wakeFd(-1), running(0)
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        throw SystemError(std::string("Could not create the process registry epoll: ") + strerror(errno));
+    }
+
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0) {
+        int err = errno;
+        close(epollFd);
+        throw SystemError(std::string("Could not create the process registry eventfd: ") + strerror(err));
+    }
+
+    // pid 0 is never tracked, so it identifies the wake up event
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = 0;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    reaper = std::thread(&UrlCopyProcessRegistry::reap, this);
+}
+
+
+UrlCopyProcessRegistry::~UrlCopyProcessRegistry()
+{
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) != sizeof(one)) {
+        // The reaper can not be woken up, so leave it behind
+        reaper.detach();
+        return;
+    }
+    reaper.join();
+
+    for (auto &process: processes) {
+        close(process.second);
+    }
+    close(wakeFd);
+    close(epollFd);
+}
+
+
+bool UrlCopyProcessRegistry::add(pid_t pid)
+{
+    if (pid <= 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (processes.count(pid) || untracked.count(pid)) {
+        return true;
+    }
+
+    int err = watch(pid);
+    if (err == 0) {
+        ++running;
+        return true;
+    }
+    if (err == ESRCH) {
+        return false;
+    }
+    if (err == ENOSYS) {
+        if (supported) {
+            FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "pidfd not supported, " << name
+                                               << " processes will be counted scanning /proc" << commit;
+        }
+        supported = false;
+        return false;
+    }
+
+    // Still running, but it can not be watched now (i.e. out of file descriptors)
+    FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Could not watch the process " << pid << ": " << strerror(err)
+                                       << ", counting it until it exits" << commit;
+    untracked.insert(pid);
+    ++running;
+    return true;
+}
+
+
+int UrlCopyProcessRegistry::watch(pid_t pid)
+{
+    int pidFd = openPidFd(pid);
+    if (pidFd < 0) {
+        return errno;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(pid);
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pidFd, &event) < 0) {
+        int err = errno;
+        close(pidFd);
+        return err;
+    }
+
+    processes[pid] = pidFd;
+    return 0;
+}
+
+
+void UrlCopyProcessRegistry::checkUntracked()
+{
+    for (auto i = untracked.begin(); i != untracked.end();) {
+        const pid_t pid = *i;
+        int err = watch(pid);
+        if (err == 0) {
+            // From now on the reaper takes care of it
+            i = untracked.erase(i);
+        }
+        else if (err == ESRCH || (kill(pid, 0) < 0 && errno == ESRCH)) {
+            i = untracked.erase(i);
+            --running;
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+
+void UrlCopyProcessRegistry::remove(pid_t pid)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto process = processes.find(pid);
+    if (process != processes.end()) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, process->second, NULL);
+        close(process->second);
+        processes.erase(process);
+        --running;
+    }
+    else if (untracked.erase(pid)) {
+        --running;
+    }
+}
+
+
+int UrlCopyProcessRegistry::adoptRunning()
+{
+    int adopted = 0;
+
+    try {
+        for (auto pid: getProcessesWithName(name)) {
+            if (!contains(pid) && add(pid)) {
+                ++adopted;
+            }
+        }
+    } catch (const std::exception &e) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not list the running " << name << " processes: " << e.what() << commit;
+    }
+
+    return adopted;
+}
+
+
+int UrlCopyProcessRegistry::count()
+{
+    if (supported) {
+        std::lock_guard<std::mutex> lock(mutex);
+        checkUntracked();
+        return running;
+    }
+    return countProcessesWithName(name);
+}
+
+
+bool UrlCopyProcessRegistry::contains(pid_t pid)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return processes.count(pid) > 0 || untracked.count(pid) > 0;
+}
+
+
+void UrlCopyProcessRegistry::reap()
+{
+    struct epoll_event events[64];
+
+    while (true) {
+        int n = epoll_wait(epollFd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            FTS3_COMMON_LOGGER_NEWLOG(CRIT) << "Process registry wait failed: " << strerror(errno) << commit;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (int i = 0; i < n; ++i) {
+            pid_t pid = static_cast<pid_t>(events[i].data.u64);
+            if (pid == 0) {
+                return;
+            }
+
+            // The pidfd is readable once the process exited
+            auto process = processes.find(pid);
+            if (process != processes.end()) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, process->second, NULL);
+                close(process->second);
+                processes.erase(process);
+                --running;
+            }
+        }
+    }
+}
+
+} // end namespace server
+} // end namespace fts3
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef URLCOPYPROCESSREGISTRY_H_
+#define URLCOPYPROCESSREGISTRY_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/types.h>
+
+namespace fts3 {
+namespace server {
+
+/// Keeps track of the running fts_url_copy processes, so they can be counted
+/// without scanning /proc.
+/// Each process is watched through a pidfd, and a background thread forgets the
+/// processes as soon as they exit. Since pidfds work for any process, not only children,
+/// processes left running by a previous fts_server can be adopted on start.
+/// On kernels without pidfd support, count falls back to scanning /proc.
+class UrlCopyProcessRegistry
+{
+public:
+    static UrlCopyProcessRegistry& get_instance()
+    {
+        static UrlCopyProcessRegistry instance("fts_url_copy");
+        return instance;
+    }
+
+    /// @param name Binary name of the tracked processes, used to adopt them and by the fallback
+    explicit UrlCopyProcessRegistry(const std::string &name);
+    ~UrlCopyProcessRegistry();
+
+    UrlCopyProcessRegistry(const UrlCopyProcessRegistry&) = delete;
+    UrlCopyProcessRegistry& operator = (const UrlCopyProcessRegistry&) = delete;
+
+    /// Track a spawned process. If it can not be watched (i.e. out of file descriptors),
+    /// it is counted anyway, and checked on every count until it exits.
+    /// @return false if the process is not running anymore
+    bool add(pid_t pid);
+
+    /// Stop tracking a process that is still running (i.e. an url copy worker going idle)
+    void remove(pid_t pid);
+
+    /// Track the processes with the tracked name that are already running.
+    /// To be called on start.
+    /// @return how many processes were adopted
+    int adoptRunning();
+
+    /// Number of tracked processes still running
+    /// @return < 0 on error
+    int count();
+
+    /// True if pid is being tracked
+    bool contains(pid_t pid);
+
+private:
+    std::string name;
+    std::atomic<bool> supported;
+
+    int epollFd;
+    int wakeFd;
+    std::thread reaper;
+
+    std::mutex mutex;
+    /// pid -> pidfd
+    std::unordered_map<pid_t, int> processes;
+    /// Running processes without a pidfd
+    std::unordered_set<pid_t> untracked;
+    /// processes and untracked
+    std::atomic<int> running;
+
+    /// Open a pidfd for the process and hand it to the reaper. mutex must be held.
+    /// @return 0, or the errno of the failure
+    int watch(pid_t pid);
+
+    /// Watch the untracked processes if possible now, and forget those that exited. mutex must be held.
+    void checkUntracked();
+
+    /// Wait for the tracked processes to exit
+    void reap();
+};
+
+} // end namespace server
+} // end namespace fts3
+
+#endif // URLCOPYPROCESSREGISTRY_H_
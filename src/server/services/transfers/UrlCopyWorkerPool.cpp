@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include "common/Exceptions.h"
+#include "common/Logger.h"
+#include "msg-bus/WorkerChannel.h"
+
+#include "ExecuteProcess.h"
+#include "UrlCopyCmd.h"
+#include "UrlCopyProcessRegistry.h"
+#include "UrlCopyWorkerPool.h"
+
+using namespace fts3::common;
+
+namespace fts3 {
+namespace server {
+
+
+UrlCopyWorkerPool::UrlCopyWorkerPool():
+    idleWorkers(0), maxTransfers(0), listenFd(-1), epollFd(-1), wakeFd(-1)
+{
+}
+
+
+UrlCopyWorkerPool::~UrlCopyWorkerPool()
+{
+    stop();
+}
+
+
+void UrlCopyWorkerPool::start(const std::string &msgDir, unsigned idleWorkers, unsigned maxTransfers)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (listenFd >= 0) {
+        return;
+    }
+
+    this->socketPath = WorkerChannel::getSocketPath(msgDir);
+    this->idleWorkers = idleWorkers;
+    this->maxTransfers = maxTransfers;
+
+    listenFd = WorkerChannel::listen(socketPath);
+    if (listenFd < 0) {
+        throw SystemError(std::string("Could not listen on ") + socketPath + ": " + strerror(errno));
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd < 0 || wakeFd < 0) {
+        int err = errno;
+        close(listenFd);
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+        listenFd = epollFd = wakeFd = -1;
+        throw SystemError(std::string("Could not create the worker pool epoll: ") + strerror(err));
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    thread = std::thread(&UrlCopyWorkerPool::run, this);
+
+    FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Url copy worker pool listening on " << socketPath
+                                    << " (idle workers: " << idleWorkers
+                                    << ", transfers per worker: " << maxTransfers << ")" << commit;
+}
+
+
+void UrlCopyWorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (listenFd < 0) {
+            return;
+        }
+
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) != sizeof(one)) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not wake up the worker pool thread" << commit;
+        }
+    }
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!workers.empty()) {
+        closeWorker(workers.begin()->first);
+    }
+    starting.clear();
+
+    close(listenFd);
+    close(wakeFd);
+    close(epollFd);
+    unlink(socketPath.c_str());
+    listenFd = epollFd = wakeFd = -1;
+}
+
+
+bool UrlCopyWorkerPool::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return listenFd >= 0;
+}
+
+
+bool UrlCopyWorkerPool::dispatch(const std::vector<std::string> &args, pid_t *pid)
+{
+    const std::string owner = getOwnerKey(args);
+    const std::string descriptor = WorkerChannel::encodeArguments(args);
+
+    if (descriptor.size() > WorkerChannel::MAX_MESSAGE_SIZE) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while (true) {
+        // Prefer a worker that already has a context for this user
+        auto chosen = workers.end();
+        for (auto i = workers.begin(); i != workers.end(); ++i) {
+            if (i->second.idle) {
+                if (chosen == workers.end() || i->second.owner == owner) {
+                    chosen = i;
+                }
+                if (i->second.owner == owner) {
+                    break;
+                }
+            }
+        }
+
+        if (chosen == workers.end()) {
+            return false;
+        }
+
+        if (send(chosen->first, descriptor.data(), descriptor.size(), MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {
+            FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Could not send a transfer to the url copy worker "
+                                               << chosen->second.pid << ": " << strerror(errno) << commit;
+            closeWorker(chosen->first);
+            continue;
+        }
+
+        chosen->second.idle = false;
+        chosen->second.owner = owner;
+        chosen->second.fileId = getFileId(args);
+        *pid = chosen->second.pid;
+        UrlCopyProcessRegistry::get_instance().add(*pid);
+        return true;
+    }
+}
+
+
+int UrlCopyWorkerPool::kill(pid_t pid, uint64_t fileId, int sig)
+{
+    // Hold the lock, so the worker is not given another transfer meanwhile
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &worker: workers) {
+        if (worker.second.pid != pid) {
+            continue;
+        }
+        if (worker.second.idle || worker.second.fileId != fileId) {
+            FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Not signaling the url copy worker " << pid
+                                            << ", it is not running the transfer " << fileId << " anymore" << commit;
+            errno = ESRCH;
+            return -1;
+        }
+        break;
+    }
+
+    return ::kill(pid, sig);
+}
+
+
+size_t UrlCopyWorkerPool::getIdleCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t idle = 0;
+    for (auto &worker: workers) {
+        if (worker.second.idle) {
+            ++idle;
+        }
+    }
+    return idle;
+}
+
+
+std::string UrlCopyWorkerPool::getOwnerKey(const std::vector<std::string> &args)
+{
+    std::string userDn, vo, proxy;
+
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == "--user-dn") {
+            userDn = args[++i];
+        }
+        else if (args[i] == "--vo") {
+            vo = args[++i];
+        }
+        else if (args[i] == "--proxy") {
+            proxy = args[++i];
+        }
+    }
+
+    return userDn + '\n' + vo + '\n' + proxy;
+}
+
+
+uint64_t UrlCopyWorkerPool::getFileId(const std::vector<std::string> &args)
+{
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == "--file-id") {
+            try {
+                return boost::lexical_cast<uint64_t>(args[i + 1]);
+            }
+            catch (const boost::bad_lexical_cast&) {
+                return 0;
+            }
+        }
+    }
+    return 0;
+}
+
+
+void UrlCopyWorkerPool::run()
+{
+    struct epoll_event events[64];
+
+    while (true) {
+        int n = epoll_wait(epollFd, events, 64, 1000);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            FTS3_COMMON_LOGGER_NEWLOG(CRIT) << "Url copy worker pool wait failed: " << strerror(errno) << commit;
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                return;
+            }
+            else if (fd == listenFd) {
+                acceptWorker();
+            }
+            else {
+                readWorker(fd);
+            }
+        }
+
+        maintain();
+    }
+}
+
+
+void UrlCopyWorkerPool::acceptWorker()
+{
+    int fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (fd < 0) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Could not accept an url copy worker: " << strerror(errno) << commit;
+        return;
+    }
+
+    uid_t uid;
+    pid_t pid;
+    int err = WorkerChannel::getPeer(fd, &uid, &pid);
+    if (err != 0 || uid != geteuid()) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Rejected an url copy worker connection (pid " << pid << ")" << commit;
+        close(fd);
+        return;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Could not watch the url copy worker " << pid
+                                           << ": " << strerror(errno) << commit;
+        close(fd);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!starting.empty()) {
+        starting.pop_front();
+    }
+
+    Worker worker;
+    worker.pid = pid;
+    worker.idle = false;
+    worker.fileId = 0;
+    worker.idleSince = 0;
+    workers[fd] = worker;
+
+    FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Url copy worker " << pid << " connected" << commit;
+}
+
+
+void UrlCopyWorkerPool::readWorker(int fd)
+{
+    char buffer[16];
+    ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+    if (received < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto i = workers.find(fd);
+    if (i == workers.end()) {
+        return;
+    }
+
+    if (received <= 0) {
+        // Exited, either by itself or killed
+        FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Url copy worker " << i->second.pid << " disconnected" << commit;
+        closeWorker(fd);
+    }
+    else if (received == 1 && buffer[0] == WorkerChannel::READY) {
+        // The previous transfer is over, its pid must not be targeted anymore
+        i->second.idle = true;
+        i->second.fileId = 0;
+        i->second.idleSince = time(NULL);
+        UrlCopyProcessRegistry::get_instance().remove(i->second.pid);
+    }
+    else {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Unexpected message from the url copy worker "
+                                           << i->second.pid << commit;
+        closeWorker(fd);
+    }
+}
+
+
+void UrlCopyWorkerPool::closeWorker(int fd)
+{
+    // Closing the descriptor also removes it from the epoll set
+    close(fd);
+    workers.erase(fd);
+}
+
+
+void UrlCopyWorkerPool::maintain()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const time_t now = time(NULL);
+
+    while (!starting.empty() && starting.front() < now - START_TIMEOUT) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "An url copy worker did not connect in time" << commit;
+        starting.pop_front();
+    }
+
+    std::vector<int> idle;
+    for (auto &worker: workers) {
+        if (worker.second.idle) {
+            idle.push_back(worker.first);
+        }
+    }
+
+    // Stop the workers left idle beyond the configured number
+    for (size_t i = 0; i < idle.size() && idle.size() - i > idleWorkers; ++i) {
+        if (workers[idle[i]].idleSince < now - IDLE_TIMEOUT) {
+            closeWorker(idle[i]);
+        }
+    }
+
+    const std::vector<std::string> args {
+        "--worker", socketPath,
+        "--worker-max-transfers", boost::lexical_cast<std::string>(maxTransfers)
+    };
+
+    for (size_t ready = idle.size() + starting.size(); ready < idleWorkers; ++ready) {
+        ExecuteProcess process(UrlCopyCmd::Program, args);
+        std::string forkMessage;
+        if (process.executeProcessShell(forkMessage) < 0) {
+            FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not spawn an url copy worker: " << forkMessage << commit;
+            break;
+        }
+        starting.push_back(now);
+    }
+}
+
+} // end namespace server
+} // end namespace fts3
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef URLCOPYWORKERPOOL_H_
+#define URLCOPYWORKERPOOL_H_
+
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+namespace fts3 {
+namespace server {
+
+/// Keeps a set of long-lived fts_url_copy workers (fts_url_copy --worker) ready to run transfers,
+/// so a transfer does not pay for spawning a process and creating a new gfal2 context.
+///
+/// Workers connect to the WorkerChannel socket and announce when they are idle.
+/// A transfer is handed to an idle worker, preferably one that last ran a transfer
+/// for the same user, so the sessions it keeps open can be reused.
+/// From then on the worker is handled as any other fts_url_copy process: it reports
+/// through the messaging directory, and CancelerService kills it through kill.
+/// Since the pid recorded for a transfer outlives the transfer, kill only signals a worker
+/// while it is running the transfer the pid was recorded for.
+/// A killed, crashed or canceled worker simply goes away, and a new one is spawned.
+/// Workers exit by themselves after a number of transfers.
+///
+/// Busy workers are tracked by the UrlCopyProcessRegistry, idle ones are not,
+/// so only busy workers count against MaxUrlCopyProcesses.
+class UrlCopyWorkerPool
+{
+public:
+    /// Idle workers beyond the configured number are stopped after this long (in seconds)
+    static const time_t IDLE_TIMEOUT = 60;
+
+    /// Spawned workers not connected after this long (in seconds) are given up
+    static const time_t START_TIMEOUT = 30;
+
+    static UrlCopyWorkerPool& get_instance()
+    {
+        static UrlCopyWorkerPool instance;
+        return instance;
+    }
+
+    UrlCopyWorkerPool();
+    ~UrlCopyWorkerPool();
+
+    UrlCopyWorkerPool(const UrlCopyWorkerPool&) = delete;
+    UrlCopyWorkerPool& operator = (const UrlCopyWorkerPool&) = delete;
+
+    /// Start listening for workers, and keep idleWorkers of them ready
+    /// @param msgDir       Messaging directory, where the socket is created
+    /// @param idleWorkers  Number of idle workers to keep ready
+    /// @param maxTransfers Number of transfers after which a worker exits
+    void start(const std::string &msgDir, unsigned idleWorkers, unsigned maxTransfers);
+
+    /// Disconnect all workers. Idle workers exit, busy ones exit once their transfer is done.
+    void stop();
+
+    /// True if started
+    bool isEnabled();
+
+    /// Hand a transfer to an idle worker
+    /// @param args fts_url_copy arguments of the transfer
+    /// @param pid  Set to the pid of the worker running the transfer
+    /// @return false if there is no idle worker, so the caller has to spawn a process
+    bool dispatch(const std::vector<std::string> &args, pid_t *pid);
+
+    /// Send a signal to the process running a transfer.
+    /// If pid is a worker of the pool, it is only signaled while it runs the transfer fileId,
+    /// since it may have moved on to another transfer. Other processes are signaled as they are.
+    /// @return the result of ::kill, or -1 with errno set to ESRCH if the worker moved on
+    int kill(pid_t pid, uint64_t fileId, int sig);
+
+    /// Number of connected workers waiting for a transfer
+    size_t getIdleCount();
+
+    /// Transfers with the same key can share a gfal2 context
+    static std::string getOwnerKey(const std::vector<std::string> &args);
+
+    /// File id of the transfer, 0 if not given
+    static uint64_t getFileId(const std::vector<std::string> &args);
+
+private:
+    struct Worker {
+        pid_t pid;
+        bool idle;
+        /// Owner key of the last transfer
+        std::string owner;
+        /// Transfer running, 0 if idle
+        uint64_t fileId;
+        time_t idleSince;
+    };
+
+    std::mutex mutex;
+    /// Connected workers, by socket
+    std::map<int, Worker> workers;
+    /// Spawn time of the workers not connected yet
+    std::deque<time_t> starting;
+
+    std::string socketPath;
+    unsigned idleWorkers;
+    unsigned maxTransfers;
+
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    std::thread thread;
+
+    /// Wait for worker connections and messages
+    void run();
+
+    /// Accept a new worker connection
+    void acceptWorker();
+
+    /// Handle a message, or a disconnection, from a worker
+    void readWorker(int fd);
+
+    /// Forget a worker. mutex must be held.
+    void closeWorker(int fd);
+
+    /// Spawn the missing workers, and stop the extra idle ones
+    void maintain();
+};
+
+} // end namespace server
+} // end namespace fts3
+
+#endif // URLCOPYWORKERPOOL_H_
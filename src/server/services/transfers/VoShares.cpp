@@ -14,35 +14,89 @@
  * limitations under the License.
  */
 
+#include <ctime>
+#include <mutex>
+
 #include "VoShares.h"
 #include "db/generic/SingleDbInstance.h"
-#include <boost/random/mersenne_twister.hpp>
-#include <boost/random/discrete_distribution.hpp>
 #include <common/Logger.h>
 
 using namespace db;
 using namespace fts3::common;
 
-boost::mt19937 generator;
+/// Shared by the scheduling threads, so one per thread
+static thread_local std::mt19937 generator(std::random_device{}());
 
 namespace fts3 {
 namespace server {
 
 
+AliasSampler::AliasSampler(const std::vector<double> &weights)
+{
+    double sum = 0;
+    for (auto weight: weights) {
+        if (weight > 0) {
+            sum += weight;
+        }
+    }
+    if (sum <= 0) {
+        return;
+    }
+
+    const size_t n = weights.size();
+    probability.resize(n);
+    alias.resize(n);
+
+    // Scale so the average is 1, and split into the columns under and over the average
+    std::vector<double> scaled(n);
+    std::vector<size_t> small, large;
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i] > 0 ? weights[i] * static_cast<double>(n) / sum : 0;
+        alias[i] = i;
+        if (scaled[i] < 1) {
+            small.push_back(i);
+        }
+        else {
+            large.push_back(i);
+        }
+    }
+
+    // Fill each column under the average with a piece of one over it
+    while (!small.empty() && !large.empty()) {
+        size_t less = small.back();
+        small.pop_back();
+        size_t more = large.back();
+
+        probability[less] = scaled[less];
+        alias[less] = more;
+
+        scaled[more] -= 1 - scaled[less];
+        if (scaled[more] < 1) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+
+    // What is left is full, save for rounding errors
+    for (auto i: large) {
+        probability[i] = 1;
+    }
+    for (auto i: small) {
+        probability[i] = scaled[i] > 0 ? 1 : 0;
+    }
+}
+
+
 /**
- * Given the pair, a list of vos for the pair, and a list of weights for VOs, pick one
- * based on those weights.
+ * Given a list of vos for the pair, and a list of weights for VOs, compute the weight of each one.
  * @note If a VO is not on the map, it will fallback to 'public', if it is there
  * @note If the weight for a VO/public is 0, it will never be picked!
  */
-boost::optional<QueueId> selectQueueForPair(const Pair &pair,
-    const std::vector<std::pair<std::string, unsigned>> &vos,
-    const std::map<std::string, double> &weights,
-    std::vector<QueueId> &unschedulable)
+VoShareSelector::VoShareSelector(const std::vector<std::string> &vos, const std::map<std::string, double> &weights):
+    vos(vos), weights(weights), schedulable(vos.size())
 {
     // Weights per position in vos vector
     std::vector<double> finalWeights(vos.size());
-    unsigned int unschedulableCount = 0;
 
     // Get the public (catchall weight)
     // If there is no config, this is the only weight!
@@ -60,7 +114,7 @@ boost::optional<QueueId> selectQueueForPair(const Pair &pair,
     // Need to calculate how many "public" there are, so we can split
     int publicCount = 0;
     for (auto i = vos.begin(); i != vos.end(); ++i) {
-        if (weights.find(i->first) == weights.end()) {
+        if (weights.find(*i) == weights.end()) {
             ++publicCount;
         }
     }
@@ -71,52 +125,127 @@ boost::optional<QueueId> selectQueueForPair(const Pair &pair,
     // Second pass, fill up the weights
     int pos = 0;
     for (auto i = vos.begin(); i != vos.end(); ++i, ++pos) {
-        auto wIter = weights.find(i->first);
+        auto wIter = weights.find(*i);
         if (wIter == weights.end()) {
             finalWeights[pos] = publicWeight;
         }
         else {
             finalWeights[pos] = wIter->second;
         }
-        if (finalWeights[pos] <= 0) {
-            unschedulable.emplace_back(pair.source, pair.destination, i->first, i->second);
-            ++unschedulableCount;
+        schedulable[pos] = finalWeights[pos] > 0;
+    }
+
+    sampler = AliasSampler(finalWeights);
+}
+
+
+/**
+ * Pick a VO with the selector, and mark as unschedulable those without share
+ */
+static boost::optional<QueueId> selectQueue(const Pair &pair,
+    const std::vector<std::pair<std::string, unsigned>> &vos,
+    const VoShareSelector &selector,
+    std::vector<QueueId> &unschedulable)
+{
+    for (size_t pos = 0; pos < vos.size(); ++pos) {
+        if (!selector.schedulable[pos]) {
+            unschedulable.emplace_back(pair.source, pair.destination, vos[pos].first, vos[pos].second);
         }
     }
 
-    if (unschedulableCount == vos.size()) {
+    if (selector.sampler.empty()) {
         return boost::optional<QueueId>();
     }
 
     // And pick one at random
-    boost::random::discrete_distribution<> dist(finalWeights);
-    int chosen = dist(generator);
+    size_t chosen = selector.sampler(generator);
     return QueueId(pair.source, pair.destination, vos[chosen].first, vos[chosen].second);
 }
 
 
+/**
+ * Given the pair, a list of vos for the pair, and a list of weights for VOs, pick one
+ * based on those weights.
+ */
+boost::optional<QueueId> selectQueueForPair(const Pair &pair,
+    const std::vector<std::pair<std::string, unsigned>> &vos,
+    const std::map<std::string, double> &weights,
+    std::vector<QueueId> &unschedulable)
+{
+    std::vector<std::string> voNames;
+    voNames.reserve(vos.size());
+    for (auto i = vos.begin(); i != vos.end(); ++i) {
+        voNames.push_back(i->first);
+    }
+
+    return selectQueue(pair, vos, VoShareSelector(voNames, weights), unschedulable);
+}
+
+
+std::map<Pair, std::map<std::string, double>> groupShareConfig(const std::vector<ShareConfig> &shares)
+{
+    std::map<Pair, std::map<std::string, double>> weightsPerPair;
+    for (auto k = shares.begin(); k != shares.end(); ++k) {
+        weightsPerPair[Pair(k->source, k->destination)][k->vo] = k->weight;
+    }
+    return weightsPerPair;
+}
+
+
 std::vector<QueueId> applyVoShares(const std::vector<QueueId> queues, std::vector<QueueId> &unschedulable)
 {
+    // Selectors of the previous calls, reused while the VOs and the shares of the pair do not change.
+    // Both the transfers and the session reuse services call this, so the unused ones expire with time.
+    static std::mutex selectorsMutex;
+    static std::map<Pair, std::pair<VoShareSelector, time_t>> selectors;
+    static const time_t SELECTOR_TTL = 600;
+
     // Vo list for each pair
     std::map<Pair, std::vector<std::pair<std::string, unsigned>>> vosPerPair;
+    // Original queue for each pair and vo, so the chosen one keeps the link state
+    std::map<std::pair<Pair, std::string>, const QueueId*> originalQueues;
 
     for (auto i = queues.begin(); i != queues.end(); ++i) {
-        vosPerPair[Pair(i->sourceSe, i->destSe)].push_back(std::make_pair(i->voName, i->activeCount));
+        Pair pair(i->sourceSe, i->destSe);
+        vosPerPair[pair].push_back(std::make_pair(i->voName, i->activeCount));
+        originalQueues[std::make_pair(pair, i->voName)] = &(*i);
     }
 
+    if (vosPerPair.empty()) {
+        return std::vector<QueueId>();
+    }
+
+    // All the share configuration in one go
+    const std::map<Pair, std::map<std::string, double>> weightsPerPair =
+        groupShareConfig(DBSingleton::instance().getDBObjectInstance()->getShareConfig());
+    const std::map<std::string, double> noWeights;
+
+    const time_t now = time(NULL);
+    std::lock_guard<std::mutex> lock(selectorsMutex);
+
     // One VO per pair
     std::vector<QueueId> result;
     for (auto j = vosPerPair.begin(); j != vosPerPair.end(); ++j) {
         const Pair &p = j->first;
         const std::vector<std::pair<std::string, unsigned>> &vos = j->second;
-        std::vector<ShareConfig> shares = DBSingleton::instance().getDBObjectInstance()->getShareConfig(p.source, p.destination);
 
-        std::map<std::string, double> weights;
-        for (auto k = shares.begin(); k != shares.end(); ++k) {
-            weights[k->vo] = k->weight;
+        auto weights = weightsPerPair.find(p);
+        const std::map<std::string, double> &pairWeights = (weights != weightsPerPair.end()) ? weights->second : noWeights;
+
+        std::vector<std::string> voNames;
+        voNames.reserve(vos.size());
+        for (auto i = vos.begin(); i != vos.end(); ++i) {
+            voNames.push_back(i->first);
+        }
+
+        auto &cached = selectors[p];
+        if (cached.first.vos != voNames || cached.first.weights != pairWeights) {
+            cached.first = VoShareSelector(voNames, pairWeights);
         }
+        cached.second = now;
+        const VoShareSelector &selector = cached.first;
 
-        boost::optional<QueueId> chosen = selectQueueForPair(p, vos, weights, unschedulable);
+        boost::optional<QueueId> chosen = selectQueue(p, vos, selector, unschedulable);
 
         if (chosen) {
             FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Chosen " << chosen->voName << " for " << p << commit;
@@ -125,14 +254,31 @@ std::vector<QueueId> applyVoShares(const std::vector<QueueId> queues, std::vecto
                 FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "\t" << i->first << commit;
             }
 
-            result.emplace_back(chosen.get());
+            auto original = originalQueues.find(std::make_pair(p, chosen->voName));
+            if (original != originalQueues.end()) {
+                result.emplace_back(*original->second);
+            }
+            else {
+                result.emplace_back(chosen.get());
+            }
         }
         else {
             FTS3_COMMON_LOGGER_NEWLOG(INFO) << "None chosen for " << p << commit;
         }
     }
+
+    // Forget the pairs without queued transfers
+    for (auto i = selectors.begin(); i != selectors.end();) {
+        if (now - i->second.second > SELECTOR_TTL) {
+            i = selectors.erase(i);
+        }
+        else {
+            ++i;
+        }
+    }
+
     return result;
 }
 
 }
-}
\ No newline at end of file
+}
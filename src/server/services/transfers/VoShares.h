@@ -17,16 +17,71 @@
 #ifndef VOSHARES_H
 #define VOSHARES_H
 
+#include <random>
 #include <vector>
 #include <db/generic/Pair.h>
 #include <map>
 #include <db/generic/QueueId.h>
+#include <db/generic/ShareConfig.h>
 #include <boost/optional.hpp>
 
 
 namespace fts3 {
 namespace server {
 
+/**
+ * Walker's alias method: draws from a discrete distribution in O(1),
+ * after an O(n) construction.
+ */
+class AliasSampler
+{
+public:
+    AliasSampler() {}
+
+    /// @param weights Relative weights. Entries <= 0 are never drawn.
+    explicit AliasSampler(const std::vector<double> &weights);
+
+    /// @return false if there is nothing that can be drawn
+    bool empty() const {
+        return probability.empty();
+    }
+
+    /// @return The index of the chosen weight
+    template <typename Generator>
+    size_t operator () (Generator &generator) const {
+        std::uniform_int_distribution<size_t> column(0, probability.size() - 1);
+        std::uniform_real_distribution<double> coin(0, 1);
+        size_t i = column(generator);
+        return coin(generator) < probability[i] ? i : alias[i];
+    }
+
+private:
+    std::vector<double> probability;
+    std::vector<size_t> alias;
+};
+
+/**
+ * Precomputed choice of a VO for a pair, for a given list of VOs and share configuration
+ */
+struct VoShareSelector
+{
+    /// VOs waiting for the pair, in order
+    std::vector<std::string> vos;
+    /// Configured weights the selector has been built from
+    std::map<std::string, double> weights;
+    /// False for the VOs without share
+    std::vector<bool> schedulable;
+    AliasSampler sampler;
+
+    VoShareSelector() {}
+    VoShareSelector(const std::vector<std::string> &vos, const std::map<std::string, double> &weights);
+};
+
+/**
+ * Configured VO weights indexed by pair
+ */
+std::map<Pair, std::map<std::string, double>> groupShareConfig(const std::vector<ShareConfig> &shares);
+
 /**
  * Apply VO shares if required.
  * @param queues Set of queues with queued transfers
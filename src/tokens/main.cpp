@@ -95,6 +95,9 @@ static void doServer()
 
     theLogger().setLogLevel(Logger::getLogLevel(ServerConfig::instance().get<std::string>("LogLevel")));
     theLogger().setProfiling(ServerConfig::instance().get<bool>("Profiling"));
+    theLogger().setAsync(ServerConfig::instance().get<bool>("LogAsync"),
+        ServerConfig::instance().get<int>("LogAsyncQueueSize"),
+        Logger::getOverflowPolicy(ServerConfig::instance().get<std::string>("LogAsyncOverflow")));
     theLogger().setLogTokenRequests(ServerConfig::instance().get<bool>("LogTokenRequests"));
 
     initializeDatabase();
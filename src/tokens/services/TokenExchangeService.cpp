@@ -16,7 +16,7 @@
 
 #include "common/Logger.h"
 #include "common/DaemonTools.h"
-#include "common/ThreadPool.h"
+#include "common/WorkStealingExecutor.h"
 
 #include "config/ServerConfig.h"
 #include "server/common/DrainMode.h"
@@ -90,7 +90,7 @@ void TokenExchangeService::runService()
 int TokenExchangeService::exchangeTokens()
 {
     auto db = db::DBSingleton::instance().getDBObjectInstance();
-    ThreadPool<TokenExchangeExecutor> execPool(execPoolSize);
+    TaskGroup execPool(WorkStealingExecutor::instance(), execPoolSize);
 
     try {
         auto providers = db->getTokenProviders();
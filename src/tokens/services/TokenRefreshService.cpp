@@ -16,7 +16,7 @@
 
 #include "common/Logger.h"
 #include "common/DaemonTools.h"
-#include "common/ThreadPool.h"
+#include "common/WorkStealingExecutor.h"
 
 #include "config/ServerConfig.h"
 #include "server/common/DrainMode.h"
@@ -82,7 +82,8 @@ void TokenRefreshService::runService()
 int TokenRefreshService::refreshTokens()
 {
     auto db = db::DBSingleton::instance().getDBObjectInstance();
-    ThreadPool<TokenRefreshExecutor> execPool(execPoolSize);
+    // Refreshing tokens about to expire comes before exchanging new ones
+    TaskGroup execPool(WorkStealingExecutor::instance(), execPoolSize, WorkStealingExecutor::High);
 
     try {
         auto providers = db->getTokenProviders();
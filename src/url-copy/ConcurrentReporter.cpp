@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ConcurrentReporter.h"
+
+
+ConcurrentReporter::ConcurrentReporter(Reporter &reporter): reporter(reporter)
+{
+}
+
+
+void ConcurrentReporter::sendTransferStart(const Transfer &transfer, Gfal2TransferParams &params)
+{
+    std::lock_guard<std::mutex> lock(messageMutex);
+    reporter.sendTransferStart(transfer, params);
+}
+
+
+void ConcurrentReporter::sendProtocol(const Transfer &transfer, Gfal2TransferParams &params)
+{
+    std::lock_guard<std::mutex> lock(messageMutex);
+    reporter.sendProtocol(transfer, params);
+}
+
+
+void ConcurrentReporter::sendTransferCompleted(const Transfer &transfer, Gfal2TransferParams &params)
+{
+    std::lock_guard<std::mutex> lock(messageMutex);
+    reporter.sendTransferCompleted(transfer, params);
+}
+
+
+void ConcurrentReporter::sendPing(Transfer &transfer)
+{
+    std::lock_guard<std::mutex> lock(messageMutex);
+    reporter.sendPing(transfer);
+}
+
+
+std::pair<std::string, int64_t> ConcurrentReporter::requestTokenRefresh(const std::string &tokenId,
+                                                                       const Transfer &transfer)
+{
+    std::lock_guard<std::mutex> lock(tokenMutex);
+    return reporter.requestTokenRefresh(tokenId, transfer);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FTS3_CONCURRENTREPORTER_H
+#define FTS3_CONCURRENTREPORTER_H
+
+#include <mutex>
+
+#include "Reporter.h"
+
+
+/// Serializes the calls to another reporter, so it can be shared by the threads
+/// of an UrlCopyProcess running several transfers at the same time.
+/// Token refresh requests have their own lock, so a slow refresh does not delay the
+/// status messages of the other transfers.
+class ConcurrentReporter: public Reporter {
+private:
+    Reporter &reporter;
+    std::mutex messageMutex;
+    std::mutex tokenMutex;
+
+public:
+    explicit ConcurrentReporter(Reporter &reporter);
+
+    virtual void sendTransferStart(const Transfer&, Gfal2TransferParams&);
+
+    virtual void sendProtocol(const Transfer&, Gfal2TransferParams&);
+
+    virtual void sendTransferCompleted(const Transfer&, Gfal2TransferParams&);
+
+    virtual void sendPing(Transfer&);
+
+    virtual std::pair<std::string, int64_t> requestTokenRefresh(const std::string&, const Transfer&);
+};
+
+#endif // FTS3_CONCURRENTREPORTER_H
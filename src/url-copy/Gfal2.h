@@ -17,6 +17,9 @@
 #ifndef GFAL2_CPP_H
 #define GFAL2_CPP_H
 
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <gfal_api.h>
@@ -292,7 +295,7 @@ class Gfal2 {
 public:
 
     /// Constructor
-    Gfal2() {
+    Gfal2(): configFileLoaded(false) {
         GError *error = NULL;
         context = gfal2_context_new(&error);
 
@@ -311,6 +314,7 @@ public:
     /// Load configuration from a file
     void loadConfigFile(const std::string &path) {
         GError *error = NULL;
+        configFileLoaded = true;
         if (gfal2_load_opts_from_file(context, path.c_str(), &error) < 0) {
             throw Gfal2Exception(error);
         }
@@ -358,6 +362,7 @@ public:
     /// Set a boolean config value
     void set(const std::string &group, const std::string &key, bool value) {
         GError *error = NULL;
+        remember(group, key);
         if (gfal2_set_opt_boolean(context, group.c_str(), key.c_str(), value, &error) < 0) {
             throw Gfal2Exception(error);
         }
@@ -366,6 +371,7 @@ public:
     /// Set a string config value
     void set(const std::string &group, const std::string &key, const std::string &value) {
         GError *error = NULL;
+        remember(group, key);
         if (gfal2_set_opt_string(context, group.c_str(), key.c_str(), value.c_str(), &error) < 0) {
             throw Gfal2Exception(error);
         }
@@ -374,6 +380,7 @@ public:
     /// Set a C string config value
     void set(const std::string &group, const std::string &key, const char* value) {
         GError *error = NULL;
+        remember(group, key);
         if (gfal2_set_opt_string(context, group.c_str(), key.c_str(), value, &error) < 0) {
             throw Gfal2Exception(error);
         }
@@ -395,6 +402,37 @@ public:
         }
     }
 
+    /// Undo the configuration changed with set, and forget the credentials and client info,
+    /// so the context can be reused for another transfer.
+    /// @return false if the context can not be restored (a configuration file was loaded)
+    bool reset() {
+        if (configFileLoaded) {
+            return false;
+        }
+
+        GError *error = NULL;
+        for (const auto &option: originals) {
+            const std::string &group = option.first.first;
+            const std::string &key = option.first.second;
+            if (option.second.first) {
+                gfal2_set_opt_string(context, group.c_str(), key.c_str(), option.second.second.c_str(), &error);
+            } else {
+                gfal2_remove_opt(context, group.c_str(), key.c_str(), &error);
+            }
+            g_clear_error(&error);
+        }
+        originals.clear();
+
+        gfal2_cred_clean(context, &error);
+        g_clear_error(&error);
+        gfal2_clear_client_info(context, &error);
+        g_clear_error(&error);
+
+        src_token.clear();
+        dst_token.clear();
+        return true;
+    }
+
     /// Cancel any running operation
     void cancel() {
         gfal2_cancel(context);
@@ -545,6 +583,28 @@ private:
     gfal2_context_t context; ///< Gfal2 context object
     std::string src_token; ///< Source bearer token
     std::string dst_token; ///< Destination bearer token
+
+    /// Value of the options before the first set: (group, key) -> (was set, value)
+    std::map<std::pair<std::string, std::string>, std::pair<bool, std::string>> originals;
+    bool configFileLoaded; ///< Set once loadConfigFile is called
+
+    /// Keep the original value of an option, so reset can restore it
+    void remember(const std::string &group, const std::string &key) {
+        auto option = std::make_pair(group, key);
+        if (originals.count(option)) {
+            return;
+        }
+
+        GError *error = NULL;
+        char *value = gfal2_get_opt_string(context, group.c_str(), key.c_str(), &error);
+        if (error != NULL) {
+            g_error_free(error);
+            originals[option] = std::make_pair(false, std::string());
+        } else {
+            originals[option] = std::make_pair(true, std::string(value ? value : ""));
+            g_free(value);
+        }
+    }
 };
 
 
@@ -97,6 +97,7 @@ const option UrlCopyOpts::long_options[] =
     {"no-streaming",      no_argument,       0, 811},
     {"skip-evict",        no_argument,       0, 812},
     {"overwrite-on-disk", no_argument,       0, 813},
+    {"concurrent-transfers", required_argument, 0, 814},
 
     {"retry",             required_argument, 0, 820},
     {"retry_max-max",     required_argument, 0, 821},
@@ -104,6 +105,9 @@ const option UrlCopyOpts::long_options[] =
     {"logDir",            required_argument, 0, 900},
     {"msgDir",            required_argument, 0, 901},
 
+    {"worker",               required_argument, 0, 910},
+    {"worker-max-transfers", required_argument, 0, 911},
+
     {"help",              no_argument,       0, 0},
     {"debug",             required_argument, 0, 1},
     {"stderr",            no_argument,       0, 2},
@@ -223,9 +227,9 @@ UrlCopyOpts::UrlCopyOpts(): isSessionReuse(false), strictCopy(false), disableCle
                             overwriteOnDisk(false), noDelegation(false), nStreams(0), tcpBuffersize(0),
                             timeout(0), enableUdt(false), enableIpv6(boost::indeterminate), addSecPerMb(0),
                             noStreaming(false), skipEvict(false), enableMonitoring(false),
-                            pingInterval(60), tokenRefreshMargin(300),
+                            pingInterval(60), tokenRefreshMargin(300), concurrentTransfers(1),
                             retry(0), retryMax(0), logDir("/var/log/fts3"), msgDir("/var/lib/fts3"),
-                            debugLevel(0), logToStderr(false)
+                            workerMaxTransfers(100), debugLevel(0), logToStderr(false)
 {
 }
 
@@ -453,6 +457,9 @@ void UrlCopyOpts::parse(int argc, char * const argv[])
                 case 813:
                     overwriteOnDisk = true;
                     break;
+                case 814:
+                    concurrentTransfers = std::max(1u, boost::lexical_cast<unsigned>(optarg));
+                    break;
 
                 case 820:
                     retry = boost::lexical_cast<int>(optarg);
@@ -468,6 +475,13 @@ void UrlCopyOpts::parse(int argc, char * const argv[])
                     msgDir = boost::lexical_cast<std::string>(optarg);
                     break;
 
+                case 910:
+                    workerSocket = boost::lexical_cast<std::string>(optarg);
+                    break;
+                case 911:
+                    workerMaxTransfers = boost::lexical_cast<unsigned>(optarg);
+                    break;
+
                 default:
                     usage(argv[0]);
             }
@@ -478,6 +492,11 @@ void UrlCopyOpts::parse(int argc, char * const argv[])
         exit(-1);
     }
 
+    // Workers receive the transfers later on
+    if (!workerSocket.empty()) {
+        return;
+    }
+
     if (bulkFile.empty() &&
         (!referenceTransfer.source.fullUri.empty() && !referenceTransfer.destination.fullUri.empty())) {
         transfers.push_back(referenceTransfer);
@@ -79,6 +79,8 @@ public:
     bool     enableMonitoring;
     unsigned pingInterval;
     unsigned tokenRefreshMargin;
+    // How many transfers of the bulk file run at the same time
+    unsigned concurrentTransfers;
 
     unsigned retry;
     unsigned retryMax;
@@ -86,6 +88,10 @@ public:
     std::string logDir;
     std::string msgDir;
 
+    // Worker mode: take transfers from the server socket instead of the command line
+    std::string workerSocket;
+    unsigned workerMaxTransfers;
+
     unsigned debugLevel;
     bool     logToStderr;
 
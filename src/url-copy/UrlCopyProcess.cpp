@@ -24,6 +24,7 @@
 #include "LogHelper.h"
 #include "heuristics.h"
 #include "AutoInterruptThread.h"
+#include "ConcurrentReporter.h"
 #include "UrlCopyProcess.h"
 #include "version.h"
 #include "DestFile.h"
@@ -395,13 +396,29 @@ void UrlCopyProcess::cleanupOnFailure(Transfer& transfer)
 
 
 UrlCopyProcess::UrlCopyProcess(const UrlCopyOpts &opts, Reporter &reporter):
-    opts(opts), reporter(reporter), canceled(false), timeoutExpired(false)
+    opts(opts), nextTicket(0), queue(this), reporter(reporter), ownedGfal2(new Gfal2), gfal2(*ownedGfal2),
+    canceled(false), timeoutExpired(false)
 {
     todoTransfers = opts.transfers;
     setupGlobalGfal2Config(opts, gfal2);
 }
 
 
+UrlCopyProcess::UrlCopyProcess(const UrlCopyOpts &opts, Reporter &reporter, Gfal2 &gfal2):
+    opts(opts), nextTicket(0), queue(this), reporter(reporter), gfal2(gfal2), canceled(false), timeoutExpired(false)
+{
+    todoTransfers = opts.transfers;
+    setupGlobalGfal2Config(opts, gfal2);
+}
+
+
+UrlCopyProcess::UrlCopyProcess(UrlCopyProcess &parent, Reporter &reporter, Gfal2 &gfal2):
+    opts(parent.opts), nextTicket(0), queue(&parent), reporter(reporter), gfal2(gfal2), canceled(false), timeoutExpired(false)
+{
+    setupGlobalGfal2Config(opts, gfal2);
+}
+
+
 // Read source and destination bearer tokens form a configuration file and set them
 // in the Gfal2 transfer parameters object to be loaded in the credentials map.
 // The first line contains the bearer token for the source storage endpoint.
@@ -568,8 +585,11 @@ static void setupTransferConfig(const UrlCopyOpts &opts, const Transfer &transfe
 }
 
 
-static void timeoutTask(const boost::posix_time::time_duration& duration, UrlCopyProcess *urlCopyProcess)
+static void timeoutTask(const boost::posix_time::time_duration& duration, UrlCopyProcess *urlCopyProcess,
+                        std::shared_ptr<fts3::common::Logger::ThreadOutput> logOutput)
 {
+    fts3::common::theLogger().setThreadOutput(logOutput);
+
     try {
         boost::this_thread::sleep(duration);
         FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Timeout expired!" << commit;
@@ -582,8 +602,11 @@ static void timeoutTask(const boost::posix_time::time_duration& duration, UrlCop
 }
 
 
-static void pingTask(Transfer *transfer, Reporter *reporter, unsigned pingInterval)
+static void pingTask(Transfer *transfer, Reporter *reporter, unsigned pingInterval,
+                     std::shared_ptr<fts3::common::Logger::ThreadOutput> logOutput)
 {
+    fts3::common::theLogger().setThreadOutput(logOutput);
+
     try {
         while (!boost::this_thread::interruption_requested()) {
             boost::this_thread::sleep(boost::posix_time::seconds(pingInterval));
@@ -648,7 +671,8 @@ void UrlCopyProcess::runTransfer(Transfer &transfer, Gfal2TransferParams &params
                                     << ((!opts.thirdPartyTURL.empty()) ? " (database configuration)" : "") << commit;
 
     // Ping thread
-    AutoInterruptThread pingThread(boost::bind(&pingTask, &transfer, &reporter, opts.pingInterval));
+    AutoInterruptThread pingThread(boost::bind(&pingTask, &transfer, &reporter, opts.pingInterval,
+                                               fts3::common::theLogger().getThreadOutput()));
     FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "Setting ping interval to: " << opts.pingInterval << commit;
 
     ////////////////////////////
@@ -763,7 +787,8 @@ void UrlCopyProcess::runTransfer(Transfer &transfer, Gfal2TransferParams &params
     // Timeout thread
     timeoutExpired = false;
     AutoInterruptThread timeoutThread(
-        boost::bind(&timeoutTask, boost::posix_time::seconds(timeout + 60), this)
+        boost::bind(&timeoutTask, boost::posix_time::seconds(timeout + 60), this,
+                    fts3::common::theLogger().getThreadOutput())
     );
 
     FTS3_COMMON_LOGGER_NEWLOG(INFO) << "IPv6: " << (boost::indeterminate(opts.enableIpv6) ? "indeterminate" :
@@ -839,27 +864,77 @@ void UrlCopyProcess::runTransfer(Transfer &transfer, Gfal2TransferParams &params
 }
 
 
-void UrlCopyProcess::run()
+bool UrlCopyProcess::takeTransfer(Transfer &transfer, uint64_t &ticket)
+{
+    boost::lock_guard<boost::mutex> lock(transfersMutex);
+
+    if (todoTransfers.empty() || canceled) {
+        return false;
+    }
+
+    // Keep it around until completed, so panic can report it
+    ticket = nextTicket++;
+    transfer = runningTransfers[ticket].transfer = todoTransfers.front();
+    todoTransfers.pop_front();
+    return true;
+}
+
+
+void UrlCopyProcess::completeTransfer(uint64_t ticket, Transfer &transfer, Gfal2TransferParams &params,
+                                      Reporter &completionReporter)
+{
+    boost::lock_guard<boost::mutex> lock(transfersMutex);
+
+    // runningTransfers may have been emptied by panic()
+    auto running = runningTransfers.find(ticket);
+    if (running == runningTransfers.end()) {
+        doneTransfers.push_back(transfer);
+        return;
+    }
+    running->second.transfer = transfer;
+    running->second.params.reset(new Gfal2TransferParams(std::move(params)));
+
+    // Report in the order the transfers were taken, as when they run one after the other.
+    // The tickets increase, so the oldest transfer not reported yet comes first.
+    while (!runningTransfers.empty() && runningTransfers.begin()->second.params) {
+        auto oldest = runningTransfers.begin();
+        doneTransfers.push_back(oldest->second.transfer);
+        completionReporter.sendTransferCompleted(oldest->second.transfer, *oldest->second.params);
+        runningTransfers.erase(oldest);
+    }
+}
+
+
+void UrlCopyProcess::runTransfers()
 {
-    while (!todoTransfers.empty() && !canceled) {
+    const bool concurrent = (queue != this);
+
+    while (!canceled) {
         Transfer transfer;
-        {
-            boost::lock_guard<boost::mutex> lock(transfersMutex);
-            transfer = todoTransfers.front();
+        uint64_t ticket;
+        if (!queue->takeTransfer(transfer, ticket)) {
+            break;
         }
 
         // Prepare logging
         transfer.stats.process.start = getTimestampMilliseconds();
         transfer.logFile = generateLogPath(opts.logDir, transfer);
 
-        if (opts.debugLevel) {
+        if (concurrent) {
+            // stderr is shared by the concurrent transfers, so it can not be split per transfer
+            transfer.debugLogFile.clear();
+        } else if (opts.debugLevel) {
             transfer.debugLogFile = transfer.logFile + ".debug";
         } else {
             transfer.debugLogFile = "/dev/null";
         }
 
         if (!opts.logToStderr) {
-            fts3::common::theLogger().redirect(transfer.logFile, transfer.debugLogFile);
+            if (concurrent) {
+                fts3::common::theLogger().redirectThread(transfer.logFile);
+            } else {
+                fts3::common::theLogger().redirect(transfer.logFile, transfer.debugLogFile);
+            }
         }
 
         // Prepare Gfal2 transfer parameters
@@ -899,29 +974,75 @@ void UrlCopyProcess::run()
         }
 
         // Archive log
+        if (concurrent) {
+            fts3::common::theLogger().redirectThread("");
+        }
         archiveLogs(transfer);
 
         // Notify back the final state
         transfer.stats.process.end = getTimestampMilliseconds();
-        {
-            boost::lock_guard<boost::mutex> lock(transfersMutex);
-            doneTransfers.push_back(transfer);
+        queue->completeTransfer(ticket, transfer, params, reporter);
+    }
+}
+
+
+void UrlCopyProcess::run()
+{
+    size_t concurrency = std::min<size_t>(opts.concurrentTransfers, todoTransfers.size());
 
-            // todoTransfers may have been emptied by panic()
-            if (!todoTransfers.empty()) {
-                todoTransfers.pop_front();
-                reporter.sendTransferCompleted(transfer, params);
+    if (concurrency <= 1) {
+        runTransfers();
+    }
+    else {
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Running " << todoTransfers.size() << " transfers, "
+                                        << concurrency << " at a time" << commit;
+
+        // Each slot has its own gfal2 context, since the transfer configuration lives there.
+        // The reporter is shared, so calls are serialized.
+        ConcurrentReporter concurrentReporter(reporter);
+        std::vector<std::unique_ptr<Gfal2>> contexts;
+        std::vector<std::unique_ptr<UrlCopyProcess>> slotProcesses;
+
+        for (size_t i = 0; i < concurrency; ++i) {
+            Gfal2 *context = &gfal2;
+            if (i > 0) {
+                contexts.emplace_back(new Gfal2);
+                context = contexts.back().get();
             }
+            slotProcesses.emplace_back(new UrlCopyProcess(*this, concurrentReporter, *context));
         }
+
+        {
+            boost::lock_guard<boost::mutex> lock(slotsMutex);
+            for (auto &slot: slotProcesses) {
+                slots.push_back(slot.get());
+            }
+        }
+
+        // A cancellation received while the slots were being registered
+        if (canceled) {
+            cancel();
+        }
+
+        boost::thread_group threads;
+        for (auto &slot: slotProcesses) {
+            threads.create_thread(boost::bind(&UrlCopyProcess::runTransfers, slot.get()));
+        }
+        threads.join_all();
+
+        boost::lock_guard<boost::mutex> lock(slotsMutex);
+        slots.clear();
     }
 
     // On cancellation, todoTransfers will not be empty
     // and a termination message must be sent for them
+    boost::lock_guard<boost::mutex> lock(transfersMutex);
     for (auto transfer = todoTransfers.begin(); transfer != todoTransfers.end(); ++transfer) {
         Gfal2TransferParams params;
         transfer->error.reset(new UrlCopyError(TRANSFER, TRANSFER_PREPARATION, ECANCELED, "Transfer canceled"));
         reporter.sendTransferCompleted(*transfer, params);
     }
+    todoTransfers.clear();
 }
 
 
@@ -937,7 +1058,7 @@ void UrlCopyProcess::archiveLogs(Transfer &transfer)
         FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Failed to archive the log: " << e.what() << commit;
     }
 
-    if (opts.debugLevel > 0) {
+    if (opts.debugLevel > 0 && !transfer.debugLogFile.empty()) {
         try {
             std::string archivedDebugLogFile = archivedLogFile + ".debug";
             boost::filesystem::rename(transfer.debugLogFile, archivedDebugLogFile);
@@ -954,6 +1075,14 @@ void UrlCopyProcess::cancel()
 {
     canceled = true;
     gfal2.cancel();
+
+    // Called from the signal handler: if the lock is taken, run() cancels the slots itself
+    boost::unique_lock<boost::mutex> lock(slotsMutex, boost::try_to_lock);
+    if (lock.owns_lock()) {
+        for (auto slot: slots) {
+            slot->cancel();
+        }
+    }
 }
 
 
@@ -964,10 +1093,23 @@ void UrlCopyProcess::timeout()
 }
 
 
+// Uses the reporter directly, not the serialized one of the concurrent slots,
+// since a fatal signal may arrive while a slot holds its lock
 void UrlCopyProcess::panic(const std::string &msg)
 {
     FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "UrlCopyProcess panic... " << msg << commit;
     boost::lock_guard<boost::mutex> lock(transfersMutex);
+    for (auto &running: runningTransfers) {
+        // Completed, but held until those taken before are: send the actual state
+        if (running.second.params) {
+            reporter.sendTransferCompleted(running.second.transfer, *running.second.params);
+            continue;
+        }
+        Gfal2TransferParams params;
+        running.second.transfer.error.reset(new UrlCopyError(AGENT, TRANSFER_SERVICE, EINTR, msg));
+        reporter.sendTransferCompleted(running.second.transfer, params);
+    }
+    runningTransfers.clear();
     for (auto transfer = todoTransfers.begin(); transfer != todoTransfers.end(); ++transfer) {
         Gfal2TransferParams params;
         transfer->error.reset(new UrlCopyError(AGENT, TRANSFER_SERVICE, EINTR, msg));
@@ -17,6 +17,9 @@
 #ifndef URLCOPYPROCESS_H
 #define URLCOPYPROCESS_H
 
+#include <map>
+#include <memory>
+#include <vector>
 #include <boost/thread.hpp>
 #include <gfal_api.h>
 
@@ -40,14 +43,50 @@ private:
 
     UrlCopyOpts opts;
     Transfer::TransferList todoTransfers;
+    /// A transfer taken from todoTransfers, with its parameters once completed
+    struct RunningTransfer {
+        Transfer transfer;
+        std::unique_ptr<Gfal2TransferParams> params;
+    };
+
+    /// Transfers taken from todoTransfers, and not reported yet, by ticket
+    std::map<uint64_t, RunningTransfer> runningTransfers;
+    uint64_t nextTicket;
     Transfer::TransferList doneTransfers;
 
+    /// Process owning the transfer lists: this one, or the parent of a concurrent slot
+    UrlCopyProcess *queue;
+
+    /// Slots running the transfers when opts.concurrentTransfers > 1
+    boost::mutex slotsMutex;
+    std::vector<UrlCopyProcess*> slots;
+
     Reporter &reporter;
 
-    Gfal2 gfal2;
+    /// Set when the process creates its own context
+    std::unique_ptr<Gfal2> ownedGfal2;
+    Gfal2 &gfal2;
     bool canceled;
     bool timeoutExpired;
 
+    /// Constructor of a concurrent slot, taking the transfers from parent
+    UrlCopyProcess(UrlCopyProcess &parent, Reporter &reporter, Gfal2 &gfal2);
+
+    /// Run transfers until the queue is empty, or canceled
+    void runTransfers();
+
+    /// Take the next transfer from the queue
+    /// @param ticket Set to the value to pass to completeTransfer
+    /// @return false if there are no more transfers, or the process was canceled
+    bool takeTransfer(Transfer &transfer, uint64_t &ticket);
+
+    /// Report the final state of a transfer taken with takeTransfer, unless panic already did.
+    /// The reports are sent in the order the transfers were taken, so this one may be held
+    /// until those taken before complete.
+    /// @param params Moved from, since the report may be sent later
+    void completeTransfer(uint64_t ticket, Transfer &transfer, Gfal2TransferParams &params,
+                          Reporter &completionReporter);
+
     /// Run a single transfer
     void runTransfer(Transfer &transfer, Gfal2TransferParams &params);
 
@@ -78,6 +117,9 @@ public:
     /// Constructor. Initialize all internals from the command line options.
     UrlCopyProcess(const UrlCopyOpts &opts, Reporter &reporter);
 
+    /// Constructor. Run the transfers using an existing gfal2 context (i.e. in a worker)
+    UrlCopyProcess(const UrlCopyOpts &opts, Reporter &reporter, Gfal2 &gfal2);
+
     /// Run the UrlCopy process
     void run();
 
@@ -91,6 +133,11 @@ public:
 
     /// Trigger a cancel, mark running transfer as expired.
     void timeout();
+
+    /// True if the transfers were canceled, or timed out
+    bool isCanceled() const {
+        return canceled || timeoutExpired;
+    }
 };
 
 
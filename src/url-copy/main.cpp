@@ -21,8 +21,14 @@
 #include "UrlCopyOpts.h"
 #include "UrlCopyProcess.h"
 #include "LegacyReporter.h"
+#include "msg-bus/WorkerChannel.h"
 
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using fts3::common::commit;
 namespace panic = fts3::common::panic;
@@ -70,6 +76,96 @@ void clearEnvironment()
 }
 
 
+/// Run the transfers of one command line
+static bool runTransfers(const UrlCopyOpts &opts, Gfal2 *gfal2)
+{
+    LegacyReporter reporter(opts);
+    std::unique_ptr<UrlCopyProcess> urlCopyProcess;
+    if (gfal2) {
+        urlCopyProcess.reset(new UrlCopyProcess(opts, reporter, *gfal2));
+    } else {
+        urlCopyProcess.reset(new UrlCopyProcess(opts, reporter));
+    }
+
+    // Re-set signal handler to handle gracefully signals
+    panic::setup_signal_handlers(signalCallback, urlCopyProcess.get());
+
+    // Run the transfer
+    try {
+        urlCopyProcess->run();
+    }
+    catch (const std::exception &e) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Exception while running copy process..." << commit;
+        urlCopyProcess->panic(e.what());
+    }
+
+    // Re-set signal handler to not access urlCopyProcess data on tear-down when data might have already been freed
+    panic::setup_signal_handlers(signalCallback, NULL);
+
+    return !urlCopyProcess->isCanceled();
+}
+
+
+/// Take transfers from the server until told to stop, or workerMaxTransfers are done.
+/// The gfal2 context is kept between transfers of the same user, so connections and sessions are reused.
+/// A canceled transfer ends the worker, so it does not outlive a kill request.
+static int runWorker(const UrlCopyOpts &workerOpts)
+{
+    int fd = WorkerChannel::connect(workerOpts.workerSocket);
+    if (fd < 0) {
+        FTS3_COMMON_LOGGER_NEWLOG(ERR) << "Could not connect to " << workerOpts.workerSocket
+                                       << ": " << strerror(errno) << commit;
+        return 1;
+    }
+
+    std::unique_ptr<Gfal2> gfal2;
+    std::string gfal2Owner;
+    std::vector<char> buffer(WorkerChannel::MAX_MESSAGE_SIZE);
+
+    for (unsigned done = 0; done < workerOpts.workerMaxTransfers; ++done) {
+        const char ready = WorkerChannel::READY;
+        if (send(fd, &ready, sizeof(ready), MSG_NOSIGNAL) != sizeof(ready)) {
+            break;
+        }
+
+        ssize_t received = recv(fd, buffer.data(), buffer.size(), 0);
+        if (received <= 0) {
+            // Server gone, or asked us to exit
+            break;
+        }
+
+        std::vector<std::string> args = WorkerChannel::decodeArguments(buffer.data(), received);
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>("fts_url_copy"));
+        for (auto &arg: args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(NULL);
+
+        clearEnvironment();
+
+        // Reset getopt before parsing a new command line
+        optind = 0;
+        UrlCopyOpts opts;
+        opts.parse(static_cast<int>(argv.size() - 1), argv.data());
+        setupLogging(opts.debugLevel);
+
+        const std::string owner = opts.userDn + '\n' + opts.voName + '\n' + opts.proxy;
+        if (!gfal2 || owner != gfal2Owner || !gfal2->reset()) {
+            gfal2.reset(new Gfal2);
+            gfal2Owner = owner;
+        }
+
+        if (!runTransfers(opts, gfal2.get())) {
+            break;
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+
 int main(int argc, char *argv[])
 {
     if (getuid() == 0 || geteuid() == 0) {
@@ -86,24 +182,13 @@ int main(int argc, char *argv[])
     opts.parse(argc, argv);
     setupLogging(opts.debugLevel);
 
-    // Construct Url Copy Process
-    LegacyReporter reporter(opts);
-    UrlCopyProcess urlCopyProcess(opts, reporter);
-
-    // Re-set signal handler to handle gracefully signals
-    panic::setup_signal_handlers(signalCallback, &urlCopyProcess);
-
-    // Run the transfer
-    try {
-        urlCopyProcess.run();
-    }
-    catch (const std::exception &e) {
-        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "Exception while running copy process..." << commit;
-        urlCopyProcess.panic(e.what());
+    if (!opts.workerSocket.empty()) {
+        int ret = runWorker(opts);
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Finishing url copy worker..." << commit;
+        return ret;
     }
 
-    // Re-set signal handler to not access urlCopyProcess data on tear-down when data might have already been freed
-    panic::setup_signal_handlers(signalCallback, NULL);
+    runTransfers(opts, NULL);
 
     FTS3_COMMON_LOGGER_NEWLOG(INFO) << "Finishing copy process..." << commit;
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <memory>
+
+#include "common/BoundedQueue.h"
+
+using fts3::common::BoundedQueue;
+
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(BoundedQueueTest)
+
+
+BOOST_AUTO_TEST_CASE (order)
+{
+    BoundedQueue<std::unique_ptr<int>> queue(10);
+
+    for (int i = 0; i < 5; ++i) {
+        queue.push(std::make_unique<int>(i));
+    }
+    BOOST_CHECK_EQUAL(queue.size(), 5);
+
+    for (int i = 0; i < 5; ++i) {
+        BOOST_CHECK_EQUAL(*queue.pop(), i);
+    }
+    BOOST_CHECK_EQUAL(queue.size(), 0);
+
+    BOOST_CHECK_EQUAL(queue.collectHighWatermark(), 5);
+    BOOST_CHECK_EQUAL(queue.collectHighWatermark(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE (backpressure)
+{
+    BoundedQueue<int> queue(2);
+    std::atomic<int> pushed(0);
+
+    boost::thread producer([&queue, &pushed]() {
+        for (int i = 0; i < 5; ++i) {
+            queue.push(i);
+            ++pushed;
+        }
+    });
+
+    // The producer can not go beyond the capacity until something is consumed
+    boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+    BOOST_CHECK_EQUAL(pushed, 2);
+    BOOST_CHECK_EQUAL(queue.size(), 2);
+
+    for (int i = 0; i < 5; ++i) {
+        BOOST_CHECK_EQUAL(queue.pop(), i);
+    }
+    producer.join();
+
+    BOOST_CHECK_EQUAL(pushed, 5);
+    BOOST_CHECK_EQUAL(queue.collectHighWatermark(), 2);
+}
+
+
+BOOST_AUTO_TEST_CASE (interrupt)
+{
+    BoundedQueue<int> queue(1);
+    bool interrupted = false;
+
+    boost::thread consumer([&queue, &interrupted]() {
+        try {
+            queue.pop();
+        }
+        catch (const boost::thread_interrupted&) {
+            interrupted = true;
+        }
+    });
+
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    consumer.interrupt();
+    consumer.join();
+
+    BOOST_CHECK(interrupted);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
 #include <boost/test/test_tools.hpp>
 #include <boost/filesystem.hpp>
 #include <fstream>
+#include <thread>
 
 #include "common/Logger.h"
 
@@ -123,5 +124,190 @@ BOOST_AUTO_TEST_CASE(redirect)
 }
 
 
+BOOST_AUTO_TEST_CASE(async)
+{
+    const std::string logPath("/tmp/fts3tests-async.log");
+
+    try {
+        boost::filesystem::remove(logPath);
+    }
+    catch (...) {
+        // Ignore
+    }
+
+    int oldOut = dup(STDOUT_FILENO);
+    int oldErr = dup(STDERR_FILENO);
+    BOOST_CHECK_GT(oldOut, -1);
+    BOOST_CHECK_GT(oldErr, -1);
+
+    fts3::common::Logger &logger = fts3::common::theLogger();
+    BOOST_CHECK_EQUAL(logger.redirect(logPath, logPath), 0);
+
+    logger.setLogLevel(fts3::common::Logger::WARNING);
+    logger.setAsync(true, 16, fts3::common::Logger::BLOCK);
+
+    // More lines than the queue can hold, so the producer has to wait
+    for (int i = 0; i < 100; ++i) {
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "ASYNC " << i << fts3::common::commit;
+    }
+    FTS3_COMMON_LOGGER_NEWLOG(DEBUG) << "DOES NOT" << fts3::common::commit;
+    logger.drain();
+    logger.setAsync(false);
+
+    std::ifstream read(logPath);
+
+    int count = 0;
+    bool doesNot = false;
+    std::string line;
+
+    while (std::getline(read, line)) {
+        if (line.find("ASYNC ") != std::string::npos) {
+            ++count;
+        }
+        if (line.find("DOES NOT") != std::string::npos) {
+            doesNot = true;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(count, 100);
+    BOOST_CHECK(!doesNot);
+
+    BOOST_CHECK_EQUAL(fts3::common::Logger::getOverflowPolicy("drop"), fts3::common::Logger::DROP);
+    BOOST_CHECK_EQUAL(fts3::common::Logger::getOverflowPolicy("block"), fts3::common::Logger::BLOCK);
+
+    close(STDOUT_FILENO);
+    close(STDERR_FILENO);
+
+    dup2(oldOut, STDOUT_FILENO);
+    dup2(oldErr, STDERR_FILENO);
+    close(oldOut);
+    close(oldErr);
+
+    BOOST_CHECK_NO_THROW(boost::filesystem::remove(logPath));
+}
+
+
+BOOST_AUTO_TEST_CASE(asyncToggle)
+{
+    const std::string logPath("/tmp/fts3tests-async-toggle.log");
+
+    try {
+        boost::filesystem::remove(logPath);
+    }
+    catch (...) {
+        // Ignore
+    }
+
+    auto countThreads = []() {
+        return std::distance(boost::filesystem::directory_iterator("/proc/self/task"),
+            boost::filesystem::directory_iterator());
+    };
+
+    int oldOut = dup(STDOUT_FILENO);
+    int oldErr = dup(STDERR_FILENO);
+    BOOST_CHECK_GT(oldOut, -1);
+    BOOST_CHECK_GT(oldErr, -1);
+
+    fts3::common::Logger &logger = fts3::common::theLogger();
+    BOOST_CHECK_EQUAL(logger.redirect(logPath, logPath), 0);
+    logger.setLogLevel(fts3::common::Logger::WARNING);
+
+    const auto threads = countThreads();
+
+    // Synchronous and asynchronous lines go into the same stream, so they stay in order
+    int sequence = 0;
+    for (int round = 0; round < 5; ++round) {
+        logger.setAsync(true, 4, fts3::common::Logger::BLOCK);
+        for (int i = 0; i < 10; ++i) {
+            FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "TOGGLE " << sequence++ << fts3::common::commit;
+        }
+        logger.setAsync(false);
+        FTS3_COMMON_LOGGER_NEWLOG(WARNING) << "TOGGLE " << sequence++ << fts3::common::commit;
+    }
+
+    // The writers are joined when disabled
+    BOOST_CHECK_EQUAL(countThreads(), threads);
+
+    std::ifstream read(logPath);
+    std::string line;
+    int expected = 0;
+    while (std::getline(read, line)) {
+        const size_t pos = line.find("TOGGLE ");
+        if (pos != std::string::npos) {
+            BOOST_CHECK_EQUAL(std::stoi(line.substr(pos + 7)), expected);
+            ++expected;
+        }
+    }
+    BOOST_CHECK_EQUAL(expected, sequence);
+
+    close(STDOUT_FILENO);
+    close(STDERR_FILENO);
+
+    dup2(oldOut, STDOUT_FILENO);
+    dup2(oldErr, STDERR_FILENO);
+    close(oldOut);
+    close(oldErr);
+
+    BOOST_CHECK_NO_THROW(boost::filesystem::remove(logPath));
+}
+
+
+BOOST_AUTO_TEST_CASE(redirectThread)
+{
+    const std::string firstPath("/tmp/fts3tests-thread-1.log");
+    const std::string secondPath("/tmp/fts3tests-thread-2.log");
+
+    try {
+        boost::filesystem::remove(firstPath);
+        boost::filesystem::remove(secondPath);
+    }
+    catch (...) {
+        // Ignore
+    }
+
+    fts3::common::Logger &logger = fts3::common::theLogger();
+    logger.setLogLevel(fts3::common::Logger::INFO);
+
+    auto logInto = [&logger](const std::string &path, const std::string &tag) {
+        BOOST_CHECK_EQUAL(logger.redirectThread(path), 0);
+        FTS3_COMMON_LOGGER_NEWLOG(INFO) << tag << fts3::common::commit;
+
+        // Threads started from here can share the output
+        std::thread child([&tag](std::shared_ptr<fts3::common::Logger::ThreadOutput> output) {
+            fts3::common::theLogger().setThreadOutput(output);
+            FTS3_COMMON_LOGGER_NEWLOG(INFO) << tag << " CHILD" << fts3::common::commit;
+        }, logger.getThreadOutput());
+        child.join();
+
+        BOOST_CHECK_EQUAL(logger.redirectThread(""), 0);
+        BOOST_CHECK(!logger.getThreadOutput());
+    };
+
+    std::thread first(logInto, firstPath, "FIRST");
+    std::thread second(logInto, secondPath, "SECOND");
+    first.join();
+    second.join();
+
+    auto readLog = [](const std::string &path) {
+        std::ifstream read(path);
+        std::stringstream content;
+        content << read.rdbuf();
+        return content.str();
+    };
+
+    const std::string firstLog = readLog(firstPath);
+    const std::string secondLog = readLog(secondPath);
+
+    BOOST_CHECK(firstLog.find("FIRST") != std::string::npos);
+    BOOST_CHECK(firstLog.find("FIRST CHILD") != std::string::npos);
+    BOOST_CHECK(firstLog.find("SECOND") == std::string::npos);
+    BOOST_CHECK(secondLog.find("SECOND CHILD") != std::string::npos);
+    BOOST_CHECK(secondLog.find("FIRST") == std::string::npos);
+
+    BOOST_CHECK_NO_THROW(boost::filesystem::remove(firstPath));
+    BOOST_CHECK_NO_THROW(boost::filesystem::remove(secondPath));
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "common/ThreadPool.h"
+#include "common/WorkStealingExecutor.h"
+
+using fts3::common::TaskGroup;
+using fts3::common::ThreadPool;
+using fts3::common::WorkStealingExecutor;
+
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(WorkStealingExecutorTest)
+
+
+BOOST_AUTO_TEST_CASE (runAndJoin)
+{
+    WorkStealingExecutor executor(4);
+    std::atomic<int> count(0);
+
+    TaskGroup group(executor);
+    for (int i = 0; i < 1000; ++i) {
+        group.run([&count]() { ++count; });
+    }
+    group.join();
+
+    BOOST_CHECK_EQUAL(count, 1000);
+    BOOST_CHECK_EQUAL(group.pending(), 0);
+}
+
+
+struct CountTask
+{
+    void run(boost::any &ctx)
+    {
+        if (ctx.empty()) {
+            ctx = 0;
+        }
+        boost::any_cast<int &>(ctx) += 1;
+    }
+};
+
+
+BOOST_AUTO_TEST_CASE (reduce)
+{
+    WorkStealingExecutor executor(2);
+
+    TaskGroup group(executor);
+    for (int i = 0; i < 50; ++i) {
+        group.start(new CountTask);
+    }
+    group.join();
+
+    BOOST_CHECK_EQUAL(group.reduce(std::plus<int>()), 50);
+}
+
+
+BOOST_AUTO_TEST_CASE (quota)
+{
+    WorkStealingExecutor executor(8);
+    std::atomic<int> running(0), maxRunning(0);
+
+    TaskGroup group(executor, 2);
+    for (int i = 0; i < 20; ++i) {
+        group.run([&running, &maxRunning]() {
+            int now = ++running;
+            int seen = maxRunning;
+            while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {}
+            boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+            --running;
+        });
+    }
+    group.join();
+
+    BOOST_CHECK_LE(maxRunning, 2);
+    BOOST_CHECK_GE(maxRunning, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE (reserve)
+{
+    WorkStealingExecutor executor(1);
+    BOOST_CHECK_EQUAL(executor.size(), 1);
+
+    TaskGroup group(executor, 4);
+    BOOST_CHECK_EQUAL(executor.size(), 4);
+
+    executor.reserve(2);
+    BOOST_CHECK_EQUAL(executor.size(), 4);
+
+    // Each live group gets its own workers
+    {
+        TaskGroup other(executor, 4);
+        BOOST_CHECK_EQUAL(executor.size(), 8);
+    }
+
+    // The quota of the finished group is reused
+    TaskGroup another(executor, 2);
+    BOOST_CHECK_EQUAL(executor.size(), 8);
+}
+
+
+BOOST_AUTO_TEST_CASE (groupsDoNotStarve)
+{
+    WorkStealingExecutor executor(1);
+
+    boost::mutex gate;
+    boost::unique_lock<boost::mutex> closed(gate);
+
+    // Keep all the slots of the first group busy
+    std::atomic<int> blocked(0);
+    TaskGroup busy(executor, 2);
+    for (int i = 0; i < 2; ++i) {
+        busy.run([&gate, &blocked]() {
+            ++blocked;
+            boost::lock_guard<boost::mutex> wait(gate);
+        });
+    }
+    while (blocked < 2) {
+        boost::this_thread::yield();
+    }
+
+    // The second group still has workers for its tasks
+    std::atomic<int> count(0);
+    TaskGroup group(executor, 2, WorkStealingExecutor::High);
+    for (int i = 0; i < 10; ++i) {
+        group.run([&count]() { ++count; });
+    }
+    group.join();
+    BOOST_CHECK_EQUAL(count, 10);
+
+    closed.unlock();
+    busy.join();
+}
+
+
+BOOST_AUTO_TEST_CASE (priority)
+{
+    WorkStealingExecutor executor(1);
+    std::vector<int> order;
+    boost::mutex orderMutex;
+
+    // Keep the only worker busy while queueing
+    boost::mutex gate;
+    boost::unique_lock<boost::mutex> closed(gate);
+
+    TaskGroup blocker(executor);
+    blocker.run([&gate]() { boost::lock_guard<boost::mutex> wait(gate); });
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+
+    TaskGroup low(executor, 0, WorkStealingExecutor::Low);
+    TaskGroup high(executor, 0, WorkStealingExecutor::High);
+    low.run([&]() { boost::lock_guard<boost::mutex> lock(orderMutex); order.push_back(2); });
+    high.run([&]() { boost::lock_guard<boost::mutex> lock(orderMutex); order.push_back(1); });
+
+    closed.unlock();
+    blocker.join();
+    low.join();
+    high.join();
+
+    BOOST_REQUIRE_EQUAL(order.size(), 2);
+    BOOST_CHECK_EQUAL(order[0], 1);
+    BOOST_CHECK_EQUAL(order[1], 2);
+}
+
+
+BOOST_AUTO_TEST_CASE (interrupt)
+{
+    WorkStealingExecutor executor(1);
+    std::atomic<int> count(0);
+
+    boost::mutex gate;
+    boost::unique_lock<boost::mutex> closed(gate);
+
+    std::atomic<bool> started(false);
+
+    TaskGroup group(executor, 1);
+    group.run([&gate, &count, &started]() {
+        started = true;
+        boost::lock_guard<boost::mutex> wait(gate);
+        ++count;
+    });
+    for (int i = 0; i < 10; ++i) {
+        group.run([&count]() { ++count; });
+    }
+    while (!started) {
+        boost::this_thread::yield();
+    }
+
+    // The running task finishes, the rest are dropped
+    group.interrupt();
+    closed.unlock();
+    group.join();
+
+    BOOST_CHECK_EQUAL(count, 1);
+
+    // Nothing runs after being interrupted
+    group.run([&count]() { ++count; });
+    group.join();
+    BOOST_CHECK_EQUAL(count, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE (interruptRunning)
+{
+    WorkStealingExecutor executor(1);
+    std::atomic<bool> started(false), stopped(false);
+
+    BOOST_CHECK(!TaskGroup::interruptionRequested());
+
+    TaskGroup group(executor);
+    group.run([&started, &stopped]() {
+        started = true;
+        while (!TaskGroup::interruptionRequested()) {
+            boost::this_thread::yield();
+        }
+        stopped = true;
+    });
+    while (!started) {
+        boost::this_thread::yield();
+    }
+
+    // The running task sees the interruption of its group
+    group.interrupt();
+    group.join();
+    BOOST_CHECK(stopped);
+
+    // Other groups are not affected
+    std::atomic<bool> requested(true);
+    TaskGroup other(executor);
+    other.run([&requested]() { requested = TaskGroup::interruptionRequested(); });
+    other.join();
+    BOOST_CHECK(!requested);
+}
+
+
+BOOST_AUTO_TEST_CASE (exceptions)
+{
+    WorkStealingExecutor executor(2);
+    std::atomic<int> count(0);
+
+    TaskGroup group(executor);
+    group.run([]() { throw std::runtime_error("expected"); });
+    group.run([&count]() { ++count; });
+    group.join();
+
+    BOOST_CHECK_EQUAL(count, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE (nested)
+{
+    WorkStealingExecutor executor(4);
+    std::atomic<int> count(0);
+
+    TaskGroup outer(executor);
+    TaskGroup inner(executor);
+    for (int i = 0; i < 10; ++i) {
+        outer.run([&inner, &count]() {
+            for (int j = 0; j < 10; ++j) {
+                inner.run([&count]() { ++count; });
+            }
+        });
+    }
+    outer.join();
+    inner.join();
+
+    BOOST_CHECK_EQUAL(count, 100);
+}
+
+
+/// Task for the microbenchmark: record when it started
+struct TimedTask
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point queued;
+    std::atomic<int64_t> &latencyNs;
+
+    TimedTask(std::atomic<int64_t> &latencyNs): queued(Clock::now()), latencyNs(latencyNs) {}
+
+    void run(boost::any &)
+    {
+        latencyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - queued).count();
+    }
+};
+
+
+/// Compare a service cycle run with a new ThreadPool (as the services used to),
+/// against the same cycle run by a TaskGroup on a long lived executor.
+/// The figures are only reported, since they depend on the machine.
+BOOST_AUTO_TEST_CASE (benchmark)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int cycles = 200;
+    const int tasksPerCycle = 64;
+    const int poolSize = 4;
+    const int total = cycles * tasksPerCycle;
+
+    std::atomic<int64_t> poolLatency(0);
+    auto start = Clock::now();
+    for (int i = 0; i < cycles; ++i) {
+        ThreadPool<TimedTask> pool(poolSize);
+        for (int j = 0; j < tasksPerCycle; ++j) {
+            pool.start(new TimedTask(poolLatency));
+        }
+        pool.join();
+    }
+    const double poolSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    WorkStealingExecutor executor(poolSize);
+    std::atomic<int64_t> executorLatency(0);
+    start = Clock::now();
+    for (int i = 0; i < cycles; ++i) {
+        TaskGroup group(executor, poolSize);
+        for (int j = 0; j < tasksPerCycle; ++j) {
+            group.start(new TimedTask(executorLatency));
+        }
+        group.join();
+    }
+    const double executorSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    BOOST_TEST_MESSAGE("ThreadPool per cycle: " << total / poolSeconds << " tasks/s, "
+        << poolLatency / total / 1000 << " us average dispatch latency");
+    BOOST_TEST_MESSAGE("WorkStealingExecutor: " << total / executorSeconds << " tasks/s, "
+        << executorLatency / total / 1000 << " us average dispatch latency");
+
+    BOOST_CHECK_GT(poolLatency, 0);
+    BOOST_CHECK_GT(executorLatency, 0);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "cred/CredentialCache.h"
+
+
+BOOST_AUTO_TEST_SUITE(cred)
+BOOST_AUTO_TEST_SUITE(CredentialCacheTestSuite)
+
+
+/// Resolves "/tmp/x509up_<dlg id>", valid for the given number of seconds.
+/// The file is created if it does not exist.
+struct FakeResolver {
+    std::atomic<int> calls;
+    time_t lifetime;
+    unsigned long lastExtraValidity;
+
+    std::mutex filesMutex;
+    std::set<std::string> files;
+
+    FakeResolver(time_t lifetime): calls(0), lifetime(lifetime), lastExtraValidity(0) {}
+
+    ~FakeResolver() {
+        for (auto &path: files) {
+            unlink(path.c_str());
+        }
+    }
+
+    CredentialCache::Resolver get() {
+        return [this](const std::string &userDn, const std::string &credId,
+                      unsigned long extraValidity, time_t *validUntil) {
+            ++calls;
+            lastExtraValidity = extraValidity;
+            if (userDn.empty()) {
+                *validUntil = 0;
+                return std::string();
+            }
+            *validUntil = time(NULL) + lifetime;
+
+            const std::string path = "/tmp/x509up_" + credId;
+            std::lock_guard<std::mutex> lock(filesMutex);
+            if (access(path.c_str(), F_OK) != 0) {
+                std::ofstream(path) << "proxy";
+            }
+            files.insert(path);
+            return path;
+        };
+    }
+};
+
+
+BOOST_AUTO_TEST_CASE(Hit)
+{
+    FakeResolver resolver(7200);
+    CredentialCache cache(resolver.get());
+
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "def"), "/tmp/x509up_def");
+    BOOST_CHECK_EQUAL(resolver.calls, 2);
+    BOOST_CHECK_EQUAL(cache.size(), 2);
+
+    cache.invalidate("/DC=ch/CN=user", "abc");
+    BOOST_CHECK_EQUAL(cache.size(), 1);
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(resolver.calls, 3);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(FailureNotCached)
+{
+    FakeResolver resolver(7200);
+    CredentialCache cache(resolver.get());
+
+    BOOST_CHECK(cache.getProxyFile("", "abc").empty());
+    BOOST_CHECK(cache.getProxyFile("", "abc").empty());
+    BOOST_CHECK_EQUAL(resolver.calls, 2);
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(Expired)
+{
+    FakeResolver resolver(1);
+    CredentialCache cache(resolver.get());
+
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    // Not valid anymore, so it is resolved again
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(resolver.calls, 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(FileChanged)
+{
+    FakeResolver resolver(7200);
+    CredentialCache cache(resolver.get());
+
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(resolver.calls, 1);
+
+    // Removed behind the cache, so it is resolved again
+    unlink("/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(resolver.calls, 2);
+    BOOST_CHECK_EQUAL(access("/tmp/x509up_abc", F_OK), 0);
+
+    // Replaced behind the cache
+    std::ofstream("/tmp/x509up_abc") << "another proxy";
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(resolver.calls, 3);
+
+    BOOST_CHECK_EQUAL(cache.getProxyFile("/DC=ch/CN=user", "abc"), "/tmp/x509up_abc");
+    BOOST_CHECK_EQUAL(resolver.calls, 3);
+}
+
+
+BOOST_AUTO_TEST_CASE(Refresh)
+{
+    FakeResolver resolver(CredentialCache::REFRESH_MARGIN / 2);
+    CredentialCache cache(resolver.get());
+
+    cache.getProxyFile("/DC=ch/CN=user", "abc");
+    BOOST_CHECK_EQUAL(resolver.lastExtraValidity, 0);
+
+    // Far from expiring, nothing to do
+    resolver.lifetime = CredentialCache::REFRESH_MARGIN * 2;
+    cache.getProxyFile("/DC=ch/CN=user", "def");
+    BOOST_CHECK_EQUAL(resolver.calls, 2);
+
+    // abc expires within the margin, so it is renewed asking for the extra validity
+    BOOST_CHECK_EQUAL(cache.refresh(), 1);
+    BOOST_CHECK_EQUAL(resolver.calls, 3);
+    BOOST_CHECK_EQUAL(resolver.lastExtraValidity, CredentialCache::REFRESH_MARGIN);
+
+    // Both far from expiring now
+    BOOST_CHECK_EQUAL(cache.refresh(), 0);
+    BOOST_CHECK_EQUAL(resolver.calls, 3);
+
+    cache.getProxyFile("/DC=ch/CN=user", "abc");
+    BOOST_CHECK_EQUAL(resolver.calls, 3);
+}
+
+
+BOOST_AUTO_TEST_CASE(ConcurrentReaders)
+{
+    FakeResolver resolver(7200);
+    CredentialCache cache(resolver.get());
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&cache, i]() {
+            for (int j = 0; j < 10000; ++j) {
+                std::string credId = std::to_string((i + j) % 8);
+                BOOST_REQUIRE_EQUAL(cache.getProxyFile("/DC=ch/CN=user", credId), "/tmp/x509up_" + credId);
+            }
+        });
+    }
+    for (auto &reader: readers) {
+        reader.join();
+    }
+
+    BOOST_CHECK_EQUAL(cache.size(), 8);
+    // Concurrent misses of the same credential may resolve it more than once, but not much more
+    BOOST_CHECK_LE(resolver.calls, 8 * 4);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
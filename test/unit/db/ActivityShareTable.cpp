@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include "db/generic/ActivityShareTable.h"
+
+BOOST_AUTO_TEST_SUITE(db)
+BOOST_AUTO_TEST_SUITE(ActivityShareTableTest)
+
+
+BOOST_AUTO_TEST_CASE (parse)
+{
+    ActivityShareTable table("[{\"Express\": 0.7}, { \"default\" : 0.3 }]");
+
+    BOOST_CHECK(!table.empty());
+    BOOST_CHECK_EQUAL(0.7, table.getShare("express"));
+    BOOST_CHECK_EQUAL(0.3, table.getShare("default"));
+    BOOST_CHECK_EQUAL(0, table.getShare("Express"));
+    BOOST_CHECK_EQUAL(0, table.getShare("other"));
+
+    BOOST_CHECK(ActivityShareTable("").empty());
+    BOOST_CHECK(ActivityShareTable("[]").empty());
+}
+
+
+BOOST_AUTO_TEST_CASE (allocateProportional)
+{
+    ActivityShareTable table("[{\"express\": 0.8}, {\"default\": 0.2}]");
+    std::mt19937 generator(42);
+
+    std::map<std::string, long long> queued = {{"express", 100000}, {"default", 100000}};
+    std::set<std::string> defaultActivities;
+
+    auto assigned = table.allocate(queued, 10000, defaultActivities, generator);
+
+    BOOST_CHECK_EQUAL(10000, assigned["express"] + assigned["default"]);
+    BOOST_CHECK_CLOSE(8000.0, assigned["express"], 5);
+    BOOST_CHECK_CLOSE(2000.0, assigned["default"], 5);
+    BOOST_CHECK_EQUAL(1, defaultActivities.size());
+    BOOST_CHECK_EQUAL(1, defaultActivities.count("default"));
+}
+
+
+BOOST_AUTO_TEST_CASE (allocateCapped)
+{
+    ActivityShareTable table("[{\"express\": 0.9}, {\"default\": 0.1}]");
+    std::mt19937 generator(42);
+
+    // The slots express can not use go to the rest
+    std::map<std::string, long long> queued = {{"express", 3}, {"default", 1000}};
+    std::set<std::string> defaultActivities;
+
+    auto assigned = table.allocate(queued, 100, defaultActivities, generator);
+
+    BOOST_CHECK_EQUAL(3, assigned["express"]);
+    BOOST_CHECK_EQUAL(97, assigned["default"]);
+
+    // Not enough files for all the slots
+    queued = {{"express", 3}, {"default", 5}};
+    assigned = table.allocate(queued, 100, defaultActivities, generator);
+
+    BOOST_CHECK_EQUAL(3, assigned["express"]);
+    BOOST_CHECK_EQUAL(5, assigned["default"]);
+}
+
+
+BOOST_AUTO_TEST_CASE (allocateDefault)
+{
+    ActivityShareTable table("[{\"express\": 0.5}, {\"default\": 0.5}]");
+    std::mt19937 generator(42);
+
+    // Activities without a share compete as default
+    std::map<std::string, long long> queued = {{"user", 10}, {"production", 10}};
+    std::set<std::string> defaultActivities;
+
+    auto assigned = table.allocate(queued, 15, defaultActivities, generator);
+
+    BOOST_CHECK_EQUAL(1, assigned.size());
+    BOOST_CHECK_EQUAL(15, assigned["default"]);
+    BOOST_CHECK_EQUAL(2, defaultActivities.size());
+    BOOST_CHECK_EQUAL(1, defaultActivities.count("user"));
+    BOOST_CHECK_EQUAL(1, defaultActivities.count("production"));
+}
+
+
+BOOST_AUTO_TEST_CASE (allocateNoShare)
+{
+    // No default share, so unknown activities get nothing
+    ActivityShareTable table("[{\"express\": 1}]");
+    std::mt19937 generator(42);
+
+    std::map<std::string, long long> queued = {{"express", 2}, {"user", 10}};
+    std::set<std::string> defaultActivities;
+
+    auto assigned = table.allocate(queued, 10, defaultActivities, generator);
+
+    BOOST_CHECK_EQUAL(1, assigned.size());
+    BOOST_CHECK_EQUAL(2, assigned["express"]);
+    BOOST_CHECK_EQUAL(1, defaultActivities.count("user"));
+
+    assigned = table.allocate(queued, 0, defaultActivities, generator);
+    BOOST_CHECK(assigned.empty());
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <random>
+#include <vector>
+#include "db/generic/ThroughputStats.h"
+
+BOOST_AUTO_TEST_SUITE(db)
+BOOST_AUTO_TEST_SUITE(ThroughputStatsTest)
+
+
+/// Average and standard deviation as getThroughputInfo used to compute them,
+/// with all the file sizes on the client
+static void twoPass(const std::vector<int64_t> &filesizes, double *avg, double *stddev)
+{
+    *avg = *stddev = 0;
+    if (filesizes.empty()) {
+        return;
+    }
+    for (auto &filesize: filesizes) {
+        *avg += (double) filesize;
+    }
+    *avg /= (double) filesizes.size();
+
+    double deviations = 0.0;
+    for (auto &filesize: filesizes) {
+        deviations += pow(*avg - (double) filesize, 2);
+    }
+    *stddev = sqrt(deviations / (double) filesizes.size());
+}
+
+
+/// Partial aggregate, as AVG and VAR_POP would return it
+static ThroughputStats aggregate(double bytes, const std::vector<int64_t> &filesizes)
+{
+    double avg, stddev;
+    twoPass(filesizes, &avg, &stddev);
+    return ThroughputStats(bytes, filesizes.size(), avg, stddev * stddev);
+}
+
+
+static void checkEquivalent(const std::vector<int64_t> &filesizes, size_t split)
+{
+    double expectedAvg, expectedStdDev;
+    twoPass(filesizes, &expectedAvg, &expectedStdDev);
+
+    std::vector<int64_t> active(filesizes.begin(), filesizes.begin() + split);
+    std::vector<int64_t> finished(filesizes.begin() + split, filesizes.end());
+
+    ThroughputStats stats = aggregate(100, active);
+    stats.merge(aggregate(500, finished));
+
+    BOOST_CHECK_EQUAL(filesizes.size(), stats.getFilesizeCount());
+    BOOST_CHECK_CLOSE(expectedAvg, stats.getFilesizeAvg(), 1e-9);
+    BOOST_CHECK_CLOSE(expectedStdDev, stats.getFilesizeStdDev(), 1e-6);
+    BOOST_CHECK_EQUAL(10.0, stats.getThroughput(60));
+}
+
+
+BOOST_AUTO_TEST_CASE (empty)
+{
+    ThroughputStats stats;
+    stats.merge(ThroughputStats(0, 0, 0, 0));
+
+    BOOST_CHECK_EQUAL(0, stats.getFilesizeCount());
+    BOOST_CHECK_EQUAL(0, stats.getFilesizeAvg());
+    BOOST_CHECK_EQUAL(0, stats.getFilesizeStdDev());
+    BOOST_CHECK_EQUAL(0, stats.getThroughput(60));
+    BOOST_CHECK_EQUAL(0, stats.getThroughput(0));
+
+    // Only one of the parts has transfers
+    checkEquivalent({1024, 2048, 4096}, 0);
+    checkEquivalent({1024, 2048, 4096}, 3);
+}
+
+
+BOOST_AUTO_TEST_CASE (mergeEquivalent)
+{
+    std::mt19937 generator(42);
+    std::lognormal_distribution<double> filesize(20, 2);
+
+    std::vector<int64_t> filesizes;
+    for (int i = 0; i < 10000; ++i) {
+        filesizes.push_back(static_cast<int64_t>(filesize(generator)) + 1);
+    }
+
+    checkEquivalent(filesizes, 1);
+    checkEquivalent(filesizes, 137);
+    checkEquivalent(filesizes, 5000);
+    checkEquivalent(filesizes, 9999);
+}
+
+
+BOOST_AUTO_TEST_CASE (mergeLargeSimilar)
+{
+    // Large files of about the same size, where E[x^2] - E[x]^2 would lose all precision
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int64_t> offset(0, 1000);
+
+    std::vector<int64_t> filesizes;
+    for (int i = 0; i < 1000; ++i) {
+        filesizes.push_back(1000000000000LL + offset(generator));
+    }
+
+    checkEquivalent(filesizes, 300);
+}
+
+
+/// A row of t_file, as seen by getThroughputInfo. Negative values stand for NULL.
+struct TransferRow {
+    time_t start;
+    time_t finish;
+    long long transferred;
+    long long filesize;
+};
+
+
+/// Bytes within the window of a transfer, as getThroughputInfo used to compute them on the client
+static double previousBytesInWindow(const TransferRow &row, time_t now, time_t windowStart)
+{
+    long long transferred = row.transferred < 0 ? 0 : row.transferred;
+    long long filesize = row.filesize < 0 ? 0 : row.filesize;
+    time_t start = row.start;
+    time_t periodInWindow = 0;
+    double bytesInWindow = 0;
+
+    if (row.finish < 0) {
+        periodInWindow = now - std::max(start, windowStart);
+        long duration = now - start;
+        if (duration > 0) {
+            bytesInWindow = double(transferred / duration) * (double) periodInWindow;
+        }
+    }
+    else {
+        time_t end = row.finish;
+        periodInWindow = end - std::max(start, windowStart);
+        long duration = end - start;
+        if (duration > 0 && filesize > 0) {
+            bytesInWindow = double(filesize / duration) * (double) periodInWindow;
+        } else if (duration <= 0) {
+            bytesInWindow = (double) filesize;
+        }
+    }
+    return bytesInWindow;
+}
+
+
+/// Transcription of the bytes_in_window expression of throughputAggregate (db/mysql/Optimizer.cpp),
+/// with DIV as the integer division, and the timestamps already truncated to the second
+static long long sqlBytesInWindow(const TransferRow &row, time_t now, time_t windowStart)
+{
+    const bool finishNull = row.finish < 0;
+    const long long end = finishNull ? now : row.finish;                    // COALESCE(finish_time, :now)
+    const long long duration = end - row.start;                            // TIMESTAMPDIFF(SECOND, start_time, end)
+    const long long period = end - std::max<long long>(row.start, windowStart);
+    const long long transferred = row.transferred < 0 ? 0 : row.transferred; // COALESCE(transferred, 0)
+
+    if (finishNull && duration > 0) {
+        return (transferred / duration) * period;
+    }
+    else if (finishNull) {
+        return 0;
+    }
+    else if (duration <= 0) {
+        return row.filesize < 0 ? 0 : row.filesize;                          // COALESCE(filesize, 0)
+    }
+    else if (row.filesize > 0) {
+        return (row.filesize / duration) * period;
+    }
+    return 0;
+}
+
+
+BOOST_AUTO_TEST_CASE (bytesInWindowEquivalent)
+{
+    const time_t now = 1700000000;
+    const time_t window = 3600;
+    const time_t windowStart = now - window;
+
+    std::vector<TransferRow> rows = {
+        // Active, started within and before the window, and not started yet
+        {now - 100, -1, 123456789, 987654321},
+        {now - 2 * window, -1, 5000000000LL, 9000000000LL},
+        {now, -1, 1000, 1000},
+        {now + 5, -1, 1000, 1000},
+        // Active without the transferred bytes
+        {now - 10, -1, -1, 1000},
+        // Finished, within and started before the window
+        {now - 600, now - 60, 0, 1073741824},
+        {now - 2 * window, now - 10, 0, 1073741824},
+        // Zero and negative duration
+        {now - 30, now - 30, 0, 4096},
+        {now - 30, now - 40, 0, 4096},
+        {now - 30, now - 30, 0, -1},
+        // Finished, without a file size
+        {now - 300, now - 20, 100, 0},
+        {now - 300, now - 20, 100, -1},
+        // Rate not a whole number of bytes per second
+        {now - 7, now - 1, 0, 1000003},
+    };
+
+    // And plenty of random ones, finished within the window or still active
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<time_t> startOffset(0, 3 * window);
+    std::uniform_int_distribution<time_t> durationDist(-5, 2 * window);
+    std::uniform_int_distribution<long long> bytes(-1, 50000000000LL);
+    std::bernoulli_distribution active(0.3);
+    for (int i = 0; i < 10000; ++i) {
+        TransferRow row;
+        row.start = now - startOffset(generator);
+        row.finish = active(generator) ? -1 : std::min(now, std::max(windowStart, row.start + durationDist(generator)));
+        row.transferred = bytes(generator);
+        row.filesize = bytes(generator);
+        rows.push_back(row);
+    }
+
+    double previousTotal = 0, sqlTotal = 0;
+    for (auto i = rows.begin(); i != rows.end(); ++i) {
+        const double previous = previousBytesInWindow(*i, now, windowStart);
+        const long long sql = sqlBytesInWindow(*i, now, windowStart);
+        BOOST_CHECK_EQUAL(previous, static_cast<double>(sql));
+        previousTotal += previous;
+        sqlTotal += static_cast<double>(sql);
+    }
+
+    ThroughputStats stats(sqlTotal, 0, 0, 0);
+    BOOST_CHECK_EQUAL(previousTotal / window, stats.getThroughput(window));
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <fcntl.h>
+#include <map>
+#include <unistd.h>
+#include <vector>
+
+#include "msg-bus/Journal.h"
+
+
+BOOST_AUTO_TEST_SUITE(MsgBusTest)
+BOOST_AUTO_TEST_SUITE(JournalTest)
+
+
+/// Layout of the segment files, as written by Journal
+static const off_t SEGMENT_HEADER_SIZE = 64;
+static const off_t SEGMENT_TAIL_OFFSET = 16;
+static const size_t RECORD_HEADER_SIZE = 16;
+static const uint32_t RECORD_SEAL = 0x4C414553;
+
+
+class JournalFixture {
+protected:
+    static const std::string TEST_PATH;
+
+public:
+    JournalFixture() {
+        boost::filesystem::remove_all(TEST_PATH);
+    }
+
+    ~JournalFixture() {
+        boost::filesystem::remove_all(TEST_PATH);
+    }
+
+    /// Path of the segment seq
+    static std::string segmentPath(uint64_t seq) {
+        char name[32];
+        snprintf(name, sizeof(name), "/segment-%016llx", static_cast<unsigned long long>(seq));
+        return TEST_PATH + name;
+    }
+
+    /// Size taken by a record with the given payload
+    static uint64_t recordSize(size_t payloadSize) {
+        return (RECORD_HEADER_SIZE + payloadSize + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    /// Consume everything available
+    static std::vector<std::string> readAll(Journal &journal) {
+        std::vector<std::string> messages;
+        size_t before;
+        do {
+            before = messages.size();
+            BOOST_REQUIRE_EQUAL(journal.read(10, [&messages](const char *data, size_t size) {
+                messages.emplace_back(data, size);
+            }), 0);
+        } while (messages.size() > before);
+        return messages;
+    }
+
+    /// Overwrite bytes of a segment file, behind the back of the journal
+    static void patch(uint64_t seq, off_t offset, const void *data, size_t size) {
+        int fd = open(segmentPath(seq).c_str(), O_RDWR);
+        BOOST_REQUIRE(fd >= 0);
+        BOOST_REQUIRE_EQUAL(pwrite(fd, data, size, offset), static_cast<ssize_t>(size));
+        close(fd);
+    }
+
+    static uint64_t readTail(uint64_t seq) {
+        uint64_t tail = 0;
+        int fd = open(segmentPath(seq).c_str(), O_RDONLY);
+        BOOST_REQUIRE(fd >= 0);
+        BOOST_REQUIRE_EQUAL(pread(fd, &tail, sizeof(tail), SEGMENT_TAIL_OFFSET), static_cast<ssize_t>(sizeof(tail)));
+        close(fd);
+        return tail;
+    }
+};
+
+const std::string JournalFixture::TEST_PATH("/tmp/JournalTest");
+
+
+BOOST_FIXTURE_TEST_CASE (writeAndRead, JournalFixture)
+{
+    Journal producer(TEST_PATH);
+    Journal consumer(TEST_PATH);
+
+    BOOST_CHECK_EQUAL(producer.write("first"), 0);
+    BOOST_CHECK_EQUAL(producer.write("second"), 0);
+
+    auto messages = readAll(consumer);
+    BOOST_REQUIRE_EQUAL(messages.size(), 2);
+    BOOST_CHECK_EQUAL(messages[0], "first");
+    BOOST_CHECK_EQUAL(messages[1], "second");
+
+    // The position survives the consumer
+    BOOST_CHECK_EQUAL(producer.write("third"), 0);
+    Journal restarted(TEST_PATH);
+    messages = readAll(restarted);
+    BOOST_REQUIRE_EQUAL(messages.size(), 1);
+    BOOST_CHECK_EQUAL(messages[0], "third");
+}
+
+
+BOOST_FIXTURE_TEST_CASE (rollover, JournalFixture)
+{
+    // Five records of 48 bytes fit in a segment, the sixth one seals it
+    const std::string payload(30, 'x');
+    const uint64_t size = recordSize(payload.size());
+    const uint64_t capacity = 5 * size + 16;
+
+    Journal producer(TEST_PATH, capacity);
+    Journal consumer(TEST_PATH, capacity);
+
+    for (int i = 0; i < 12; ++i) {
+        BOOST_REQUIRE_EQUAL(producer.write(payload.substr(0, 28) + std::to_string(i % 10) + "."), 0);
+    }
+
+    BOOST_CHECK(boost::filesystem::exists(segmentPath(1)));
+    BOOST_CHECK(boost::filesystem::exists(segmentPath(2)));
+    BOOST_CHECK(boost::filesystem::exists(segmentPath(3)));
+    BOOST_CHECK(!boost::filesystem::exists(segmentPath(4)));
+
+    // The first reservation past the end left a SEAL behind the last record
+    uint32_t state = 0;
+    int fd = open(segmentPath(1).c_str(), O_RDONLY);
+    BOOST_REQUIRE(fd >= 0);
+    BOOST_REQUIRE_EQUAL(pread(fd, &state, sizeof(state), SEGMENT_HEADER_SIZE + 5 * size), 4);
+    close(fd);
+    BOOST_CHECK_EQUAL(state, RECORD_SEAL);
+
+    auto messages = readAll(consumer);
+    BOOST_REQUIRE_EQUAL(messages.size(), 12);
+    for (int i = 0; i < 12; ++i) {
+        BOOST_CHECK_EQUAL(messages[i], payload.substr(0, 28) + std::to_string(i % 10) + ".");
+    }
+
+    // Consumed segments are removed, the one being written is kept
+    BOOST_CHECK(!boost::filesystem::exists(segmentPath(1)));
+    BOOST_CHECK(!boost::filesystem::exists(segmentPath(2)));
+    BOOST_CHECK(boost::filesystem::exists(segmentPath(3)));
+}
+
+
+BOOST_FIXTURE_TEST_CASE (tooBig, JournalFixture)
+{
+    Journal producer(TEST_PATH, 64);
+    BOOST_CHECK_EQUAL(producer.write(std::string(64, 'x')), EMSGSIZE);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (concurrentProducers, JournalFixture)
+{
+    const int producers = 8;
+    const int perProducer = 500;
+    // Small segments, so the producers race on the rollover too
+    const uint64_t capacity = 4096;
+
+    std::atomic<int> failures(0), finished(0);
+    boost::thread_group threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.create_thread([p, capacity, &failures, &finished]() {
+            // One instance per producer, as separate processes would have
+            Journal producer(TEST_PATH, capacity);
+            for (int i = 0; i < perProducer; ++i) {
+                if (producer.write(std::to_string(p) + ":" + std::to_string(i)) != 0) {
+                    ++failures;
+                }
+            }
+            ++finished;
+        });
+    }
+
+    // Consume while they write
+    Journal consumer(TEST_PATH, capacity);
+    std::vector<std::string> messages;
+    auto callback = [&messages](const char *data, size_t size) {
+        messages.emplace_back(data, size);
+    };
+    while (messages.size() < static_cast<size_t>(producers * perProducer)) {
+        size_t before = messages.size();
+        BOOST_REQUIRE_EQUAL(consumer.read(100, callback), 0);
+        if (messages.size() == before) {
+            if (finished == producers) {
+                break;
+            }
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+        }
+    }
+    threads.join_all();
+    BOOST_CHECK_EQUAL(failures, 0);
+
+    auto rest = readAll(consumer);
+    messages.insert(messages.end(), rest.begin(), rest.end());
+
+    // Each one exactly once, and in order for the same producer
+    BOOST_REQUIRE_EQUAL(messages.size(), producers * perProducer);
+    std::map<int, int> next;
+    for (auto i = messages.begin(); i != messages.end(); ++i) {
+        const size_t colon = i->find(':');
+        BOOST_REQUIRE(colon != std::string::npos);
+        const int p = std::stoi(i->substr(0, colon));
+        const int n = std::stoi(i->substr(colon + 1));
+        BOOST_CHECK_EQUAL(n, next[p]);
+        next[p] = n + 1;
+    }
+    for (int p = 0; p < producers; ++p) {
+        BOOST_CHECK_EQUAL(next[p], perProducer);
+    }
+}
+
+
+BOOST_FIXTURE_TEST_CASE (resyncAfterStall, JournalFixture)
+{
+    Journal producer(TEST_PATH);
+    Journal consumer(TEST_PATH, Journal::DEFAULT_SEGMENT_SIZE, 1);
+
+    BOOST_REQUIRE_EQUAL(producer.write("before"), 0);
+
+    // A producer reserved a record, and died before committing it
+    const uint64_t tail = readTail(1) + recordSize(100);
+    patch(1, SEGMENT_TAIL_OFFSET, &tail, sizeof(tail));
+
+    BOOST_REQUIRE_EQUAL(producer.write("after"), 0);
+
+    // Nothing is skipped before the timeout
+    auto messages = readAll(consumer);
+    BOOST_REQUIRE_EQUAL(messages.size(), 1);
+    BOOST_CHECK_EQUAL(messages[0], "before");
+
+    sleep(2);
+
+    messages = readAll(consumer);
+    BOOST_REQUIRE_EQUAL(messages.size(), 1);
+    BOOST_CHECK_EQUAL(messages[0], "after");
+}
+
+
+BOOST_FIXTURE_TEST_CASE (corruptedRecord, JournalFixture)
+{
+    Journal producer(TEST_PATH);
+    Journal consumer(TEST_PATH);
+
+    BOOST_REQUIRE_EQUAL(producer.write("first"), 0);
+    BOOST_REQUIRE_EQUAL(producer.write("second"), 0);
+    BOOST_REQUIRE_EQUAL(producer.write("third"), 0);
+
+    // Flip a byte of the second payload, so its CRC does not match
+    const char garbage = 'X';
+    patch(1, SEGMENT_HEADER_SIZE + recordSize(5) + RECORD_HEADER_SIZE, &garbage, 1);
+
+    auto messages = readAll(consumer);
+    BOOST_REQUIRE_EQUAL(messages.size(), 2);
+    BOOST_CHECK_EQUAL(messages[0], "first");
+    BOOST_CHECK_EQUAL(messages[1], "third");
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,6 +23,7 @@
 #include <glib.h>
 
 #include "msg-bus/consumer.h"
+#include "msg-bus/Journal.h"
 #include "msg-bus/producer.h"
 
 using namespace fts3::events;
@@ -213,4 +214,46 @@ BOOST_FIXTURE_TEST_CASE (simpleStaging, MsgBusFixture)
 }
 
 
+BOOST_FIXTURE_TEST_CASE (journalStatus, MsgBusFixture)
+{
+    Journal::setEnabled(TEST_PATH + "/status.journal", true);
+
+    Producer producer(TEST_PATH);
+
+    Message original;
+    original.set_job_id("1906cc40-b915-11e5-9a03-02163e006dd0");
+    original.set_transfer_status("ACTIVE");
+    original.set_file_id(42);
+
+    for (int i = 0; i < 3; ++i) {
+        original.set_process_id(1000 + i);
+        BOOST_CHECK_EQUAL(0, producer.runProducerStatus(original));
+    }
+
+    {
+        Consumer consumer(TEST_PATH, 2);
+
+        // The limit applies, and the order is kept
+        std::vector<Message> statuses;
+        BOOST_CHECK_EQUAL(0, consumer.runConsumerStatus(statuses));
+        BOOST_CHECK_EQUAL(2, statuses.size());
+        BOOST_CHECK_EQUAL(1000, statuses[0].process_id());
+        BOOST_CHECK_EQUAL(1001, statuses[1].process_id());
+    }
+
+    // A new consumer resumes from the persisted position
+    Consumer consumer(TEST_PATH);
+
+    std::vector<Message> statuses;
+    BOOST_CHECK_EQUAL(0, consumer.runConsumerStatus(statuses));
+    BOOST_CHECK_EQUAL(1, statuses.size());
+    BOOST_CHECK_EQUAL(true, google::protobuf::util::MessageDifferencer::Equals(statuses[0], original));
+
+    // Second attempt must return empty (already consumed)
+    statuses.clear();
+    BOOST_CHECK_EQUAL(0, consumer.runConsumerStatus(statuses));
+    BOOST_CHECK_EQUAL(0, statuses.size());
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
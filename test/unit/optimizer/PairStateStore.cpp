@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "optimizer/services/PairStateStore.h"
+
+using fts3::optimizer::PairStateStore;
+
+
+BOOST_AUTO_TEST_SUITE(optimizer)
+BOOST_AUTO_TEST_SUITE(PairStateStoreTestSuite)
+
+
+struct PairStateStoreFixture {
+    static const std::string TEST_PATH;
+    time_t now;
+
+    PairStateStoreFixture(): now(time(NULL)) {
+        unlink(TEST_PATH.c_str());
+    }
+
+    ~PairStateStoreFixture() {
+        unlink(TEST_PATH.c_str());
+        unlink((TEST_PATH + ".tmp").c_str());
+    }
+
+    /// Write a checkpoint by hand
+    void write(const std::string &content) {
+        std::ofstream out(TEST_PATH, std::ios::trunc);
+        out << content;
+    }
+};
+
+const std::string PairStateStoreFixture::TEST_PATH("/tmp/PairStateStoreTest");
+
+
+BOOST_FIXTURE_TEST_CASE (roundTrip, PairStateStoreFixture)
+{
+    PairStateStore store;
+    PairState state(now, 123.456789012345, 30, 98.5, 2, 10, 200, 120.123456789, 12);
+    state.filesizeAvg = 1048576.5;
+    state.filesizeStdDev = 1024.25;
+
+    store.put(Pair("gsiftp://source", "root://dest"), state);
+    store.put(Pair("gsiftp://source", "davs://other"), PairState(now - 10, 1, 2, 3, 4, 5, 6, 7, 8));
+    BOOST_REQUIRE_EQUAL(store.save(TEST_PATH), 0);
+    BOOST_CHECK_NE(access((TEST_PATH + ".tmp").c_str(), F_OK), 0);
+
+    PairStateStore loaded;
+    BOOST_CHECK_EQUAL(loaded.load(TEST_PATH, 0), 2);
+    BOOST_CHECK_EQUAL(loaded.size(), 2);
+
+    PairState read;
+    BOOST_REQUIRE(loaded.get(Pair("gsiftp://source", "root://dest"), &read));
+    BOOST_CHECK_EQUAL(read.timestamp, state.timestamp);
+    BOOST_CHECK_EQUAL(read.throughput, state.throughput);
+    BOOST_CHECK_EQUAL(read.avgDuration, state.avgDuration);
+    BOOST_CHECK_EQUAL(read.successRate, state.successRate);
+    BOOST_CHECK_EQUAL(read.retryCount, state.retryCount);
+    BOOST_CHECK_EQUAL(read.activeCount, state.activeCount);
+    BOOST_CHECK_EQUAL(read.queueSize, state.queueSize);
+    BOOST_CHECK_EQUAL(read.ema, state.ema);
+    BOOST_CHECK_EQUAL(read.filesizeAvg, state.filesizeAvg);
+    BOOST_CHECK_EQUAL(read.filesizeStdDev, state.filesizeStdDev);
+    BOOST_CHECK_EQUAL(read.connections, state.connections);
+
+    BOOST_REQUIRE(loaded.get(Pair("gsiftp://source", "davs://other"), &read));
+    BOOST_CHECK_EQUAL(read.connections, 8);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (keepStored, PairStateStoreFixture)
+{
+    PairStateStore store;
+    store.put(Pair("a", "b"), PairState(now, 1, 1, 1, 1, 1, 1, 1, 1));
+    BOOST_REQUIRE_EQUAL(store.save(TEST_PATH), 0);
+
+    // What is in memory is newer than the checkpoint
+    PairStateStore loaded;
+    loaded.put(Pair("a", "b"), PairState(now, 2, 2, 2, 2, 2, 2, 2, 2));
+    BOOST_CHECK_EQUAL(loaded.load(TEST_PATH, 0), 0);
+
+    PairState read;
+    BOOST_REQUIRE(loaded.get(Pair("a", "b"), &read));
+    BOOST_CHECK_EQUAL(read.connections, 2);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (missing, PairStateStoreFixture)
+{
+    PairStateStore store;
+    BOOST_CHECK_EQUAL(store.load(TEST_PATH, 0), 0);
+    BOOST_CHECK_EQUAL(store.size(), 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (wrongHeader, PairStateStoreFixture)
+{
+    write("# fts-optimizer-pair-state 0\n"
+          "a b 100 1 1 1 1 1 1 1 1 1 1\n");
+
+    PairStateStore store;
+    BOOST_CHECK_EQUAL(store.load(TEST_PATH, 0), 0);
+    BOOST_CHECK_EQUAL(store.size(), 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (corrupted, PairStateStoreFixture)
+{
+    std::ostringstream content;
+    content << "# fts-optimizer-pair-state 1\n"
+            << "a b " << now << " 1 1 1 1 1 1 1 1 1 4\n"
+            << "c d " << now << " garbage 1 1 1 1 1 1 1 1 1\n"
+            << "\n"
+            << "e f " << now << " 1 1 1 1 1 1 1 1 1 6\n"
+            // Truncated while being written
+            << "g h " << now << " 1 1 1";
+    write(content.str());
+
+    PairStateStore store;
+    BOOST_CHECK_EQUAL(store.load(TEST_PATH, 0), 2);
+    BOOST_CHECK_EQUAL(store.size(), 2);
+
+    PairState read;
+    BOOST_CHECK(store.get(Pair("a", "b"), &read));
+    BOOST_CHECK_EQUAL(read.connections, 4);
+    BOOST_CHECK(store.get(Pair("e", "f"), &read));
+    BOOST_CHECK_EQUAL(read.connections, 6);
+    BOOST_CHECK(!store.get(Pair("c", "d"), &read));
+    BOOST_CHECK(!store.get(Pair("g", "h"), &read));
+}
+
+
+BOOST_FIXTURE_TEST_CASE (expire, PairStateStoreFixture)
+{
+    PairStateStore store;
+    store.put(Pair("old", "pair"), PairState(now - 3600, 1, 1, 1, 1, 1, 1, 1, 1));
+    store.put(Pair("new", "pair"), PairState(now, 1, 1, 1, 1, 1, 1, 1, 1));
+
+    BOOST_CHECK_EQUAL(store.expire(now - 60), 1);
+    BOOST_CHECK_EQUAL(store.size(), 1);
+
+    PairState read;
+    BOOST_CHECK(!store.get(Pair("old", "pair"), &read));
+    BOOST_CHECK(store.get(Pair("new", "pair"), &read));
+}
+
+
+BOOST_FIXTURE_TEST_CASE (expireOnLoad, PairStateStoreFixture)
+{
+    PairStateStore saved;
+    saved.put(Pair("old", "pair"), PairState(now - 3600, 1, 1, 1, 1, 1, 1, 1, 1));
+    saved.put(Pair("new", "pair"), PairState(now, 1, 1, 1, 1, 1, 1, 1, 1));
+    BOOST_REQUIRE_EQUAL(saved.save(TEST_PATH), 0);
+
+    // Stale entries are dropped, whether they come from the checkpoint or were already there
+    PairStateStore store;
+    store.put(Pair("stale", "pair"), PairState(now - 7200, 1, 1, 1, 1, 1, 1, 1, 1));
+    BOOST_CHECK_EQUAL(store.load(TEST_PATH, now - 60), 1);
+    BOOST_CHECK_EQUAL(store.size(), 1);
+
+    PairState read;
+    BOOST_CHECK(store.get(Pair("new", "pair"), &read));
+    BOOST_CHECK(!store.get(Pair("old", "pair"), &read));
+    BOOST_CHECK(!store.get(Pair("stale", "pair"), &read));
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
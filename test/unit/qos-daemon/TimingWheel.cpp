@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <random>
+
+#include "qos-daemon/task/TimingWheel.h"
+
+
+BOOST_AUTO_TEST_SUITE(qos)
+BOOST_AUTO_TEST_SUITE(TimingWheelTest)
+
+
+struct Item {
+    time_t due;
+    explicit Item(time_t due): due(due) {}
+};
+
+typedef TimingWheel<Item> Wheel;
+
+
+/// Advance one second at a time up to end, and check each item comes out exactly when due
+static void checkOnTime(Wheel &wheel, time_t end)
+{
+    for (time_t now = wheel.getNextTick(); now <= end; ++now) {
+        Wheel::Items due;
+        BOOST_CHECK_EQUAL(wheel.advance(now, due), 0);
+        for (auto &item : due) {
+            BOOST_CHECK_EQUAL(item->due, now);
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE (slotPlacement)
+{
+    const time_t start = 1000;
+    Wheel wheel(start);
+
+    // One per level, and the edges of the first two
+    const time_t offsets[] = {0, 1, 255, 256, 257, 65535, 65536, 65537, 1 << 24, (1 << 24) + 1};
+    for (auto offset : offsets) {
+        wheel.add(std::unique_ptr<Item>(new Item(start + offset)), start + offset);
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), sizeof(offsets) / sizeof(offsets[0]));
+
+    size_t collected = 0;
+    for (time_t now = start; now <= start + (1 << 24) + 1; ++now) {
+        Wheel::Items due;
+        wheel.advance(now, due);
+        for (auto &item : due) {
+            BOOST_CHECK_EQUAL(item->due, now);
+            ++collected;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(collected, sizeof(offsets) / sizeof(offsets[0]));
+    BOOST_CHECK_EQUAL(wheel.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE (notBeforeDue)
+{
+    Wheel wheel(100);
+    wheel.add(std::unique_ptr<Item>(new Item(110)), 110);
+
+    Wheel::Items due;
+    wheel.advance(109, due);
+    BOOST_CHECK(due.empty());
+    BOOST_CHECK_EQUAL(wheel.size(), 1);
+    BOOST_CHECK_EQUAL(wheel.getNextTick(), 110);
+
+    wheel.advance(110, due);
+    BOOST_REQUIRE_EQUAL(due.size(), 1);
+    BOOST_CHECK_EQUAL(due[0]->due, 110);
+}
+
+
+BOOST_AUTO_TEST_CASE (wrapAround)
+{
+    // Start right before the first and second levels wrap around, and with items
+    // landing in slots already passed in the current rotation
+    const time_t starts[] = {300, 65536 * 3 - 10, (1LL << 24) * 2 - 3};
+
+    for (auto start : starts) {
+        Wheel wheel(start);
+        const time_t offsets[] = {0, 5, 20, 255, 256, 300, 1000, 65535, 70000};
+        for (auto offset : offsets) {
+            wheel.add(std::unique_ptr<Item>(new Item(start + offset)), start + offset);
+        }
+        checkOnTime(wheel, start + 70000);
+        BOOST_CHECK_EQUAL(wheel.size(), 0);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE (addWhileRunning)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<time_t> delay(0, 70000);
+
+    const time_t start = 65536 - 100;
+    Wheel wheel(start);
+    size_t added = 0, collected = 0;
+
+    for (time_t now = start; now <= start + 140000; ++now) {
+        if (now < start + 70000 && now % 7 == 0) {
+            const time_t due = now + delay(random);
+            wheel.add(std::unique_ptr<Item>(new Item(due)), due);
+            ++added;
+        }
+        Wheel::Items due;
+        wheel.advance(now, due);
+        for (auto &item : due) {
+            BOOST_CHECK_EQUAL(item->due, now);
+            ++collected;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(added, collected);
+    BOOST_CHECK_EQUAL(wheel.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE (lateItems)
+{
+    const time_t start = 1000;
+    Wheel wheel(start);
+    wheel.add(std::unique_ptr<Item>(new Item(start + 5)), start + 5);
+    wheel.add(std::unique_ptr<Item>(new Item(start + 10)), start + 10);
+    wheel.add(std::unique_ptr<Item>(new Item(start + 500)), start + 500);
+
+    // The dispatcher was held up: everything due by then comes out at once
+    Wheel::Items due;
+    BOOST_CHECK_EQUAL(wheel.advance(start + 50, due), 45);
+    BOOST_REQUIRE_EQUAL(due.size(), 2);
+    BOOST_CHECK_EQUAL(due[0]->due, start + 5);
+    BOOST_CHECK_EQUAL(due[1]->due, start + 10);
+    BOOST_CHECK_EQUAL(wheel.size(), 1);
+    BOOST_CHECK_EQUAL(wheel.getNextTick(), start + 51);
+
+    // Added when already due: ready right away, without counting as late
+    wheel.add(std::unique_ptr<Item>(new Item(start)), start);
+    BOOST_CHECK(wheel.hasReady());
+    due.clear();
+    BOOST_CHECK_EQUAL(wheel.advance(start + 50, due), 0);
+    BOOST_REQUIRE_EQUAL(due.size(), 1);
+    BOOST_CHECK_EQUAL(due[0]->due, start);
+    BOOST_CHECK(!wheel.hasReady());
+    BOOST_CHECK_EQUAL(wheel.size(), 1);
+
+    due.clear();
+    wheel.advance(start + 1000, due);
+    BOOST_REQUIRE_EQUAL(due.size(), 1);
+    BOOST_CHECK_EQUAL(due[0]->due, start + 500);
+}
+
+
+BOOST_AUTO_TEST_CASE (clear)
+{
+    Wheel wheel(0);
+    wheel.add(std::unique_ptr<Item>(new Item(0)), 0);
+    wheel.add(std::unique_ptr<Item>(new Item(100000)), 100000);
+    wheel.clear();
+    BOOST_CHECK_EQUAL(wheel.size(), 0);
+    BOOST_CHECK(!wheel.hasReady());
+
+    Wheel::Items due;
+    wheel.advance(200000, due);
+    BOOST_CHECK(due.empty());
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
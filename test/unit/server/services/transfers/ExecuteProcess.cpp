@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <paths.h>
+#include <signal.h>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "server/services/transfers/ExecuteProcess.h"
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(ExecuteProcessTestSuite)
+
+
+/// ExecuteProcess ignores SIGCHLD and SIGPIPE, which would leak into the tests that run later
+/// (i.e. waitpid does not work anymore), so restore them afterwards
+struct SignalsFixture {
+    struct sigaction previousChld, previousPipe;
+
+    SignalsFixture() {
+        sigaction(SIGCHLD, NULL, &previousChld);
+        sigaction(SIGPIPE, NULL, &previousPipe);
+    }
+
+    ~SignalsFixture() {
+        sigaction(SIGCHLD, &previousChld, NULL);
+        sigaction(SIGPIPE, &previousPipe, NULL);
+    }
+};
+
+
+BOOST_FIXTURE_TEST_CASE (spawnArguments, SignalsFixture)
+{
+    const std::string outPath("/tmp/fts3tests-execute-process.out");
+    boost::filesystem::remove(outPath);
+
+    // Arguments with spaces are passed unmodified
+    ExecuteProcess pr("sh", std::vector<std::string>{"-c", "echo \"$0|$1\" > " + outPath, "with space", "last"});
+    std::string forkMessage;
+    BOOST_REQUIRE_EQUAL(0, pr.executeProcessShell(forkMessage));
+    BOOST_CHECK_GT(pr.getPid(), 0);
+
+    std::string line;
+    for (int i = 0; i < 500 && line.empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::ifstream out(outPath);
+        std::getline(out, line);
+    }
+    BOOST_CHECK_EQUAL("with space|last", line);
+
+    boost::filesystem::remove(outPath);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (spawnFailure, SignalsFixture)
+{
+    ExecuteProcess pr("/this/does/not/exist", "--some args");
+    std::string forkMessage;
+    BOOST_CHECK_EQUAL(-1, pr.executeProcessShell(forkMessage));
+    BOOST_CHECK(!forkMessage.empty());
+}
+
+
+/// Previous implementation: fork, and wait on a close-on-exec pipe until the child execs
+static pid_t forkAndExec(const char *app)
+{
+    int pipefds[2];
+    if (pipe2(pipefds, O_CLOEXEC) < 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+        if (chdir(_PATH_TMP) != 0) {
+            _exit(1);
+        }
+        char *argv[] = {const_cast<char*>(app), NULL};
+        execvp(app, argv);
+        int err = errno;
+        if (write(pipefds[1], &err, sizeof(err)) < 0) {
+            _exit(2);
+        }
+        _exit(1);
+    }
+
+    close(pipefds[1]);
+    int err = 0;
+    while (read(pipefds[0], &err, sizeof(err)) < 0 && errno == EINTR);
+    close(pipefds[0]);
+    return pid;
+}
+
+
+/// Microbenchmark: latency of spawning a process, with fork and with ExecuteProcess,
+/// depending on the resident memory of the parent
+BOOST_FIXTURE_TEST_CASE (spawnLatency, SignalsFixture)
+{
+    const int iterations = 20;
+    std::vector<char> ballast;
+
+    for (size_t rssMb: {0, 64, 256}) {
+        // Touch the memory so it is resident
+        ballast.assign(rssMb * 1024 * 1024, 1);
+
+        double forkTotal = 0, spawnTotal = 0;
+        for (int i = 0; i < iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            pid_t pid = forkAndExec("true");
+            forkTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            BOOST_REQUIRE_GT(pid, 0);
+            waitpid(pid, NULL, 0);
+
+            ExecuteProcess pr("true", std::vector<std::string>());
+            std::string forkMessage;
+            start = std::chrono::steady_clock::now();
+            BOOST_REQUIRE_EQUAL(0, pr.executeProcessShell(forkMessage));
+            spawnTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            waitpid(pr.getPid(), NULL, 0);
+        }
+
+        std::ostringstream msg;
+        msg << "RSS +" << rssMb << "MB: fork " << forkTotal / iterations << "ms, "
+            << "posix_spawn " << spawnTotal / iterations << "ms";
+        BOOST_TEST_MESSAGE(msg.str());
+    }
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
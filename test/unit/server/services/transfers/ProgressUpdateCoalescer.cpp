@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include "server/services/transfers/ProgressUpdateCoalescer.h"
+
+using fts3::server::ProgressUpdateCoalescer;
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(ProgressUpdateCoalescerTestSuite)
+
+
+static fts3::events::MessageUpdater makePing(uint64_t fileId, uint64_t timestamp, uint64_t transferred)
+{
+    fts3::events::MessageUpdater msg;
+    msg.set_job_id("job-a");
+    msg.set_file_id(fileId);
+    msg.set_transfer_status("ACTIVE");
+    msg.set_timestamp(timestamp);
+    msg.set_throughput(10.0);
+    msg.set_transferred(transferred);
+    return msg;
+}
+
+
+BOOST_AUTO_TEST_CASE (keepLatest)
+{
+    ProgressUpdateCoalescer coalescer;
+    coalescer.setInterval(boost::posix_time::hours(1));
+
+    coalescer.add(makePing(1, 100, 1000));
+    coalescer.add(makePing(1, 300, 3000));
+    // Out of order, older than the one already queued
+    coalescer.add(makePing(1, 200, 2000));
+    coalescer.add(makePing(2, 100, 500));
+
+    // Without progress
+    auto noThroughput = makePing(3, 100, 0);
+    noThroughput.set_throughput(0);
+    coalescer.add(noThroughput);
+    auto notActive = makePing(4, 100, 100);
+    notActive.set_transfer_status("FINISHED");
+    coalescer.add(notActive);
+
+    BOOST_CHECK_EQUAL(2, coalescer.size());
+
+    std::vector<fts3::events::MessageUpdater> updates;
+    BOOST_CHECK(!coalescer.take(updates));
+    BOOST_CHECK(updates.empty());
+
+    BOOST_CHECK(coalescer.take(updates, true));
+    BOOST_REQUIRE_EQUAL(2, updates.size());
+    BOOST_CHECK_EQUAL(0, coalescer.size());
+
+    for (const auto &msg: updates) {
+        if (msg.file_id() == 1) {
+            BOOST_CHECK_EQUAL(3000, msg.transferred());
+        } else {
+            BOOST_CHECK_EQUAL(500, msg.transferred());
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE (restore)
+{
+    ProgressUpdateCoalescer coalescer;
+    coalescer.setInterval(boost::posix_time::seconds(0));
+
+    coalescer.add(makePing(1, 100, 1000));
+    coalescer.add(makePing(2, 100, 1000));
+
+    std::vector<fts3::events::MessageUpdater> updates;
+    BOOST_CHECK(coalescer.take(updates));
+    BOOST_CHECK_EQUAL(2, updates.size());
+
+    // A newer ping arrives while the write fails
+    coalescer.add(makePing(1, 200, 2000));
+    coalescer.restore(updates);
+    BOOST_CHECK_EQUAL(2, coalescer.size());
+
+    updates.clear();
+    BOOST_CHECK(coalescer.take(updates));
+    BOOST_REQUIRE_EQUAL(2, updates.size());
+
+    for (const auto &msg: updates) {
+        if (msg.file_id() == 1) {
+            BOOST_CHECK_EQUAL(2000, msg.transferred());
+        } else {
+            BOOST_CHECK_EQUAL(1000, msg.transferred());
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE (drop)
+{
+    ProgressUpdateCoalescer coalescer;
+    coalescer.setInterval(boost::posix_time::hours(1));
+
+    coalescer.add(makePing(1, 100, 1000));
+    coalescer.add(makePing(2, 100, 1000));
+
+    // File 1 finished before the flush
+    coalescer.drop(1);
+    coalescer.drop(3);
+    BOOST_CHECK_EQUAL(1, coalescer.size());
+
+    std::vector<fts3::events::MessageUpdater> updates;
+    BOOST_CHECK(coalescer.take(updates, true));
+    BOOST_REQUIRE_EQUAL(1, updates.size());
+    BOOST_CHECK_EQUAL(2, updates[0].file_id());
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
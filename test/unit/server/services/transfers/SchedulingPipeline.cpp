@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+#include "server/services/transfers/SchedulingPipeline.h"
+
+using namespace fts3::server;
+using boost::posix_time::microsec_clock;
+using boost::posix_time::milliseconds;
+using boost::posix_time::seconds;
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(SchedulingPipelineTestSuite)
+
+
+/// Stands for the real executor: each stage runs the given function instead of going to the database
+class FakeExecutor: public FileTransferExecutor
+{
+public:
+    typedef std::function<bool (const TransferFile&)> Stage;
+
+    FakeExecutor(TransferFile &tf, Stage prepareStage, Stage launchStage):
+        FileTransferExecutor(tf), prepareStage(prepareStage), launchStage(launchStage)
+    {
+    }
+
+    bool prepare() override
+    {
+        return prepareStage(getTransferFile());
+    }
+
+    bool launch() override
+    {
+        return launchStage(getTransferFile());
+    }
+
+private:
+    Stage prepareStage, launchStage;
+};
+
+
+static bool succeed(const TransferFile&)
+{
+    return true;
+}
+
+
+static std::unique_ptr<FileTransferExecutor> makeExecutor(uint64_t fileId,
+    const std::string &source, const std::string &destination,
+    FakeExecutor::Stage prepareStage = succeed, FakeExecutor::Stage launchStage = succeed)
+{
+    TransferFile tf;
+    tf.fileId = fileId;
+    tf.sourceSe = source;
+    tf.destSe = destination;
+    return std::unique_ptr<FileTransferExecutor>(new FakeExecutor(tf, prepareStage, launchStage));
+}
+
+
+/// Wait until all the transfers submitted left the pipeline
+static bool drain(SchedulingPipeline &pipeline)
+{
+    auto deadline = microsec_clock::universal_time() + seconds(30);
+    while (microsec_clock::universal_time() < deadline) {
+        if (pipeline.getInFlight().fileIds.empty()) {
+            return true;
+        }
+        boost::this_thread::sleep(milliseconds(1));
+    }
+    return false;
+}
+
+
+BOOST_AUTO_TEST_CASE(Launched)
+{
+    SchedulingPipeline pipeline(2, 2, 4);
+
+    for (uint64_t fileId = 1; fileId <= 20; ++fileId) {
+        pipeline.submit(makeExecutor(fileId, "source" + std::to_string(fileId % 3),
+            "destination" + std::to_string(fileId % 5)));
+    }
+    BOOST_REQUIRE(drain(pipeline));
+
+    // Nothing left behind in the counters
+    SchedulingPipeline::InFlight inFlight = pipeline.getInFlight();
+    BOOST_CHECK(inFlight.bySource.empty());
+    BOOST_CHECK(inFlight.byDestination.empty());
+    BOOST_CHECK(pipeline.takeNotLaunched().empty());
+
+    SchedulingPipeline::Stats stats = pipeline.collectStats();
+    BOOST_CHECK_EQUAL(stats.launched, 20);
+    BOOST_CHECK_EQUAL(stats.inFlight, 0);
+    BOOST_CHECK_EQUAL(stats.prepare.count, 20);
+    BOOST_CHECK_EQUAL(stats.launch.count, 20);
+}
+
+
+BOOST_AUTO_TEST_CASE(PrepareFailure)
+{
+    SchedulingPipeline pipeline(1, 1, 4);
+
+    std::atomic<int> launches(0);
+    auto launchStage = [&launches](const TransferFile&) {
+        ++launches;
+        return true;
+    };
+    auto refuse = [](const TransferFile&) {
+        return false;
+    };
+    auto fail = [](const TransferFile&) -> bool {
+        throw std::runtime_error("prepare failed");
+    };
+    auto failUnknown = [](const TransferFile&) -> bool {
+        throw 42;
+    };
+
+    pipeline.submit(makeExecutor(1, "source", "destination", refuse, launchStage));
+    pipeline.submit(makeExecutor(2, "source", "destination", fail, launchStage));
+    pipeline.submit(makeExecutor(3, "source", "other", failUnknown, launchStage));
+    pipeline.submit(makeExecutor(4, "source", "destination", succeed, launchStage));
+    BOOST_REQUIRE(drain(pipeline));
+
+    // Released without going through the launch stage
+    BOOST_CHECK_EQUAL(launches, 1);
+    std::vector<uint64_t> notLaunched = pipeline.takeNotLaunched();
+    std::sort(notLaunched.begin(), notLaunched.end());
+    BOOST_CHECK_EQUAL(notLaunched.size(), 3);
+    BOOST_CHECK(notLaunched == std::vector<uint64_t>({1, 2, 3}));
+
+    SchedulingPipeline::InFlight inFlight = pipeline.getInFlight();
+    BOOST_CHECK(inFlight.bySource.empty());
+    BOOST_CHECK(inFlight.byDestination.empty());
+
+    SchedulingPipeline::Stats stats = pipeline.collectStats();
+    BOOST_CHECK_EQUAL(stats.launched, 1);
+    BOOST_CHECK_EQUAL(stats.inFlight, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(LaunchFailure)
+{
+    SchedulingPipeline pipeline(1, 1, 4);
+
+    auto refuse = [](const TransferFile&) {
+        return false;
+    };
+    auto fail = [](const TransferFile&) -> bool {
+        throw std::runtime_error("launch failed");
+    };
+    auto failUnknown = [](const TransferFile&) -> bool {
+        throw 42;
+    };
+
+    pipeline.submit(makeExecutor(1, "source", "destination", succeed, refuse));
+    pipeline.submit(makeExecutor(2, "source", "destination", succeed, fail));
+    pipeline.submit(makeExecutor(3, "other", "destination", succeed, failUnknown));
+    pipeline.submit(makeExecutor(4, "source", "destination"));
+    BOOST_REQUIRE(drain(pipeline));
+
+    std::vector<uint64_t> notLaunched = pipeline.takeNotLaunched();
+    std::sort(notLaunched.begin(), notLaunched.end());
+    BOOST_CHECK(notLaunched == std::vector<uint64_t>({1, 2, 3}));
+    // Taken only once
+    BOOST_CHECK(pipeline.takeNotLaunched().empty());
+
+    SchedulingPipeline::InFlight inFlight = pipeline.getInFlight();
+    BOOST_CHECK(inFlight.bySource.empty());
+    BOOST_CHECK(inFlight.byDestination.empty());
+
+    SchedulingPipeline::Stats stats = pipeline.collectStats();
+    BOOST_CHECK_EQUAL(stats.launched, 1);
+    BOOST_CHECK_EQUAL(stats.launch.count, 4);
+}
+
+
+BOOST_AUTO_TEST_CASE(InFlight)
+{
+    SchedulingPipeline pipeline(1, 1, 4);
+
+    boost::mutex gate;
+    boost::unique_lock<boost::mutex> closed(gate);
+    auto blocked = [&gate](const TransferFile&) {
+        boost::lock_guard<boost::mutex> wait(gate);
+        return true;
+    };
+
+    pipeline.submit(makeExecutor(1, "source", "destination", succeed, blocked));
+    pipeline.submit(makeExecutor(2, "source", "other", succeed, blocked));
+    pipeline.submit(makeExecutor(3, "another", "destination", succeed, blocked));
+
+    // Counted until launched
+    SchedulingPipeline::InFlight inFlight = pipeline.getInFlight();
+    BOOST_CHECK_EQUAL(inFlight.fileIds.size(), 3);
+    BOOST_CHECK_EQUAL(inFlight.bySource["source"], 2);
+    BOOST_CHECK_EQUAL(inFlight.bySource["another"], 1);
+    BOOST_CHECK_EQUAL(inFlight.byDestination["destination"], 2);
+    BOOST_CHECK_EQUAL(inFlight.byDestination["other"], 1);
+
+    closed.unlock();
+    BOOST_REQUIRE(drain(pipeline));
+
+    inFlight = pipeline.getInFlight();
+    BOOST_CHECK(inFlight.bySource.empty());
+    BOOST_CHECK(inFlight.byDestination.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE(DestroyWithFullQueues)
+{
+    std::atomic<int> launching(0);
+    auto stuck = [&launching](const TransferFile&) {
+        ++launching;
+        boost::this_thread::sleep(seconds(3600));
+        return true;
+    };
+
+    auto start = microsec_clock::universal_time();
+    {
+        SchedulingPipeline pipeline(1, 1, 1);
+
+        // One in each worker, one in each queue
+        for (uint64_t fileId = 1; fileId <= 4; ++fileId) {
+            pipeline.submit(makeExecutor(fileId, "source", "destination", succeed, stuck));
+        }
+        while (launching == 0) {
+            boost::this_thread::yield();
+        }
+        BOOST_CHECK_EQUAL(pipeline.getInFlight().fileIds.size(), 4);
+    }
+    BOOST_CHECK_LT((microsec_clock::universal_time() - start).total_seconds(), 30);
+    BOOST_CHECK_EQUAL(launching, 1);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
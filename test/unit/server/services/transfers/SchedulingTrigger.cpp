@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "server/services/transfers/SchedulingTrigger.h"
+
+using namespace fts3::server;
+using boost::posix_time::microsec_clock;
+using boost::posix_time::milliseconds;
+using boost::posix_time::seconds;
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(SchedulingTriggerTestSuite)
+
+
+BOOST_AUTO_TEST_CASE(Timeout)
+{
+    SchedulingTrigger trigger;
+
+    auto start = microsec_clock::universal_time();
+    BOOST_CHECK(!trigger.wait(milliseconds(10), milliseconds(100)));
+    BOOST_CHECK_GE((microsec_clock::universal_time() - start).total_milliseconds(), 100);
+
+    auto stats = trigger.collectStats();
+    BOOST_CHECK_EQUAL(stats.cycles, 1);
+    BOOST_CHECK_EQUAL(stats.woken, 0);
+    BOOST_CHECK_EQUAL(stats.notifications, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(Notified)
+{
+    SchedulingTrigger trigger;
+
+    boost::thread notifier([&trigger]() {
+        boost::this_thread::sleep(milliseconds(50));
+        trigger.notify();
+    });
+
+    auto start = microsec_clock::universal_time();
+    BOOST_CHECK(trigger.wait(milliseconds(10), seconds(30)));
+    BOOST_CHECK_LT((microsec_clock::universal_time() - start).total_milliseconds(), 5000);
+    notifier.join();
+
+    auto stats = trigger.collectStats();
+    BOOST_CHECK_EQUAL(stats.cycles, 1);
+    BOOST_CHECK_EQUAL(stats.woken, 1);
+    BOOST_CHECK_EQUAL(stats.notifications, 1);
+    BOOST_CHECK_GE(stats.idleMax.total_milliseconds(), 10);
+
+    // Reset by collectStats
+    stats = trigger.collectStats();
+    BOOST_CHECK_EQUAL(stats.cycles, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(Coalesce)
+{
+    SchedulingTrigger trigger;
+
+    // A burst of notifications before the wait is served by a single cycle
+    for (int i = 0; i < 100; ++i) {
+        trigger.notify();
+    }
+    BOOST_CHECK(trigger.wait(milliseconds(50), seconds(30)));
+    BOOST_CHECK(!trigger.wait(milliseconds(10), milliseconds(50)));
+
+    auto stats = trigger.collectStats();
+    BOOST_CHECK_EQUAL(stats.cycles, 2);
+    BOOST_CHECK_EQUAL(stats.woken, 1);
+    BOOST_CHECK_EQUAL(stats.notifications, 100);
+}
+
+
+BOOST_AUTO_TEST_CASE(Debounce)
+{
+    SchedulingTrigger trigger;
+
+    trigger.notify();
+    BOOST_CHECK(trigger.wait(milliseconds(0), seconds(30)));
+
+    // The next cycle does not start before debounce since the previous one
+    trigger.notify();
+    auto start = microsec_clock::universal_time();
+    BOOST_CHECK(trigger.wait(milliseconds(200), seconds(30)));
+    BOOST_CHECK_GE((microsec_clock::universal_time() - start).total_milliseconds(), 150);
+
+    // But never beyond the maximum interval
+    trigger.notify();
+    start = microsec_clock::universal_time();
+    BOOST_CHECK(trigger.wait(seconds(30), milliseconds(100)));
+    BOOST_CHECK_LT((microsec_clock::universal_time() - start).total_milliseconds(), 5000);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/thread.hpp>
+#include <unistd.h>
+
+#include "server/services/transfers/ThreadSafeList.h"
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(ThreadSafeListTestSuite)
+
+
+static fts3::events::MessageUpdater makeMsg(const std::string &jobId, uint64_t fileId, int pid, uint64_t timestamp)
+{
+    fts3::events::MessageUpdater msg;
+    msg.set_job_id(jobId);
+    msg.set_file_id(fileId);
+    msg.set_process_id(pid);
+    msg.set_timestamp(timestamp);
+    return msg;
+}
+
+
+BOOST_AUTO_TEST_CASE (expireAndUpdate)
+{
+    ThreadSafeList list;
+    const uint64_t now = millisecondsSinceEpoch();
+    const boost::posix_time::seconds timeout(60);
+
+    // Same process running two transfers, plus one fresh transfer
+    auto stale1 = makeMsg("job-a", 1, getpid(), now - 120000);
+    auto stale2 = makeMsg("job-a", 2, getpid(), now - 90000);
+    auto fresh = makeMsg("job-b", 3, getpid() + 1, now);
+    list.push_back(stale1);
+    list.push_back(stale2);
+    list.push_back(fresh);
+    BOOST_CHECK_EQUAL(3, list.size());
+
+    std::vector<fts3::events::MessageUpdater> expired;
+    list.checkExpiredMsg(expired, timeout);
+    BOOST_CHECK_EQUAL(2, expired.size());
+
+    // A ping from the process refreshes all its transfers
+    auto ping = makeMsg("job-a", 2, getpid(), now);
+    list.updateMsg(ping);
+
+    expired.clear();
+    list.checkExpiredMsg(expired, timeout);
+    BOOST_CHECK_EQUAL(0, expired.size());
+}
+
+
+BOOST_AUTO_TEST_CASE (removeEntries)
+{
+    ThreadSafeList list;
+    const uint64_t old = millisecondsSinceEpoch() - 120000;
+
+    auto first = makeMsg("job-a", 1, getpid(), old);
+    auto second = makeMsg("job-a", 2, getpid(), old);
+    list.push_back(first);
+    list.push_back(second);
+
+    // Adding again the same transfer replaces it
+    list.push_back(first);
+    BOOST_CHECK_EQUAL(2, list.size());
+
+    list.removeFinishedTr("job-a", 1);
+    BOOST_CHECK_EQUAL(1, list.size());
+
+    std::vector<fts3::events::MessageUpdater> expired;
+    list.checkExpiredMsg(expired, boost::posix_time::seconds(60));
+    BOOST_REQUIRE_EQUAL(1, expired.size());
+    BOOST_CHECK_EQUAL(2, expired[0].file_id());
+
+    list.deleteMsg(expired);
+    BOOST_CHECK_EQUAL(0, list.size());
+
+    // Pings for unknown processes are ignored
+    auto ping = makeMsg("job-a", 2, getpid(), millisecondsSinceEpoch());
+    list.updateMsg(ping);
+    BOOST_CHECK_EQUAL(0, list.size());
+}
+
+
+BOOST_AUTO_TEST_CASE (concurrentReplaceAndRemove)
+{
+    ThreadSafeList list;
+    const uint64_t old = millisecondsSinceEpoch() - 120000;
+
+    // The same transfers added and removed from several threads, as the url-copy
+    // messages and the finished transfers are handled concurrently
+    boost::thread_group threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.create_thread([&list, old]() {
+            for (int i = 0; i < 2000; ++i) {
+                auto msg = makeMsg("job-a", i % 8, getpid(), old);
+                list.push_back(msg);
+                list.removeFinishedTr("job-a", (i + 3) % 8);
+            }
+        });
+    }
+    threads.join_all();
+
+    // Whatever is left is still reachable from its process
+    auto ping = makeMsg("job-a", 0, getpid(), millisecondsSinceEpoch());
+    list.updateMsg(ping);
+
+    std::vector<fts3::events::MessageUpdater> expired;
+    list.checkExpiredMsg(expired, boost::posix_time::seconds(60));
+    BOOST_CHECK_EQUAL(0, expired.size());
+
+    for (uint64_t fileId = 0; fileId < 8; ++fileId) {
+        list.removeFinishedTr("job-a", fileId);
+    }
+    BOOST_CHECK_EQUAL(0, list.size());
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
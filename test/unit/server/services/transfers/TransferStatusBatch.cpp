@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <map>
+
+#include "server/services/transfers/TransferStatusBatch.h"
+
+using fts3::server::TransferStatusBatch;
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(TransferStatusBatchTestSuite)
+
+
+static fts3::events::Message makeMessage(const std::string &jobId, uint64_t fileId, const std::string &state)
+{
+    fts3::events::Message msg;
+    msg.set_job_id(jobId);
+    msg.set_file_id(fileId);
+    msg.set_transfer_status(state);
+    msg.set_retry(state == "FAILED");
+    return msg;
+}
+
+
+/// Stands for the database: counts how many times each message was applied
+struct FakeDb
+{
+    std::map<uint64_t, int> applied;
+    /// Rows that would be written into t_file_retry_errors
+    int retryErrors = 0;
+    std::map<std::string, int> jobUpdates;
+    int singleUpdates = 0;
+
+    TransferStatusUpdate apply(const fts3::events::Message &msg)
+    {
+        TransferStatusUpdate result(msg.job_id(), msg.file_id(), msg.transfer_status());
+        ++applied[msg.file_id()];
+        if (msg.transfer_status() == "FAILED") {
+            ++retryErrors;
+            result.retried = true;
+        }
+        else {
+            result.updated = true;
+        }
+        return result;
+    }
+
+    TransferStatusBatch makeBatch(bool committed)
+    {
+        TransferStatusBatch batch;
+        batch.bulkUpdate = [this, committed](const std::vector<fts3::events::Message> &messages)
+            -> std::vector<TransferStatusUpdate> {
+            if (!committed) {
+                throw fts3::common::UserError("Lock wait timeout exceeded");
+            }
+            std::vector<TransferStatusUpdate> results;
+            for (auto &msg: messages) {
+                results.push_back(apply(msg));
+            }
+            throw TransferStatusBatchError("Job state update failed after commit", results);
+        };
+        batch.singleUpdate = [this](const fts3::events::Message &msg) {
+            ++singleUpdates;
+            apply(msg);
+        };
+        batch.jobUpdate = [this](const std::string &jobId, const std::string &) {
+            ++jobUpdates[jobId];
+        };
+        return batch;
+    }
+};
+
+
+static std::vector<fts3::events::Message> makeMessages()
+{
+    return {
+        makeMessage("job-a", 1, "FINISHED"),
+        makeMessage("job-a", 2, "FINISHED"),
+        makeMessage("job-a", 3, "FAILED"),
+        makeMessage("job-b", 4, "FINISHED")
+    };
+}
+
+
+BOOST_AUTO_TEST_CASE (failedAfterCommit)
+{
+    FakeDb db;
+    auto results = db.makeBatch(true).apply(makeMessages());
+
+    // Nothing applied twice
+    BOOST_CHECK_EQUAL(0, db.singleUpdates);
+    BOOST_CHECK_EQUAL(1, db.retryErrors);
+    BOOST_REQUIRE_EQUAL(4, db.applied.size());
+    for (auto &entry: db.applied) {
+        BOOST_CHECK_EQUAL(1, entry.second);
+    }
+
+    // The committed outcome is returned, and the jobs refreshed once
+    BOOST_REQUIRE_EQUAL(4, results.size());
+    BOOST_CHECK(results[0].updated);
+    BOOST_CHECK(results[2].retried);
+    BOOST_REQUIRE_EQUAL(2, db.jobUpdates.size());
+    BOOST_CHECK_EQUAL(1, db.jobUpdates["job-a"]);
+    BOOST_CHECK_EQUAL(1, db.jobUpdates["job-b"]);
+}
+
+
+BOOST_AUTO_TEST_CASE (failedBeforeCommit)
+{
+    FakeDb db;
+    auto results = db.makeBatch(false).apply(makeMessages());
+
+    // Rolled back, so applied one by one, once
+    BOOST_CHECK(results.empty());
+    BOOST_CHECK_EQUAL(4, db.singleUpdates);
+    BOOST_CHECK_EQUAL(1, db.retryErrors);
+    BOOST_REQUIRE_EQUAL(4, db.applied.size());
+    for (auto &entry: db.applied) {
+        BOOST_CHECK_EQUAL(1, entry.second);
+    }
+    BOOST_CHECK(db.jobUpdates.empty());
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -16,6 +16,7 @@
 
 #include <boost/test/unit_test_suite.hpp>
 #include <boost/test/test_tools.hpp>
+#include <algorithm>
 
 #include "server/services/transfers/UrlCopyCmd.h"
 
@@ -49,5 +50,42 @@ BOOST_AUTO_TEST_CASE (TestIpFlags)
     BOOST_CHECK_EQUAL(params.find("ipv6"), std::string::npos);
 }
 
+/**
+ * Test that each argument is kept whole
+ */
+BOOST_AUTO_TEST_CASE (TestArguments)
+{
+    UrlCopyCmd cmd;
+    cmd.setIPv6(true);
+    cmd.setLogDir("/var/log/with space");
+
+    auto args = cmd.generateArguments();
+    auto ipv6 = std::find(args.begin(), args.end(), "--ipv6");
+    BOOST_CHECK(ipv6 != args.end());
+
+    auto logDir = std::find(args.begin(), args.end(), "--logDir");
+    BOOST_REQUIRE(logDir != args.end());
+    BOOST_REQUIRE(logDir + 1 != args.end());
+    BOOST_CHECK_EQUAL(*(logDir + 1), "/var/log/with space");
+}
+
+/**
+ * Test that the concurrency is only passed when transfers run at the same time
+ */
+BOOST_AUTO_TEST_CASE (TestConcurrentTransfers)
+{
+    UrlCopyCmd cmd;
+    cmd.setConcurrentTransfers(1);
+    auto args = cmd.generateArguments();
+    BOOST_CHECK(std::find(args.begin(), args.end(), "--concurrent-transfers") == args.end());
+
+    cmd.setConcurrentTransfers(4);
+    args = cmd.generateArguments();
+    auto concurrent = std::find(args.begin(), args.end(), "--concurrent-transfers");
+    BOOST_REQUIRE(concurrent != args.end());
+    BOOST_REQUIRE(concurrent + 1 != args.end());
+    BOOST_CHECK_EQUAL(*(concurrent + 1), "4");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <chrono>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "server/services/transfers/UrlCopyProcessRegistry.h"
+
+using fts3::server::UrlCopyProcessRegistry;
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(UrlCopyProcessRegistryTestSuite)
+
+
+static pid_t spawnSleep()
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        execlp("sleep", "sleep", "30", NULL);
+        _exit(1);
+    }
+    return pid;
+}
+
+
+/// Wait until the registry count reaches the expected value
+static bool waitForCount(UrlCopyProcessRegistry &registry, int expected)
+{
+    for (int i = 0; i < 500; ++i) {
+        if (registry.count() == expected) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+
+BOOST_AUTO_TEST_CASE (trackAndReap)
+{
+    UrlCopyProcessRegistry registry("fts-test-no-such-process");
+    BOOST_CHECK_EQUAL(0, registry.count());
+
+    pid_t first = spawnSleep();
+    pid_t second = spawnSleep();
+    BOOST_REQUIRE_GT(first, 0);
+    BOOST_REQUIRE_GT(second, 0);
+
+    BOOST_CHECK(registry.add(first));
+    BOOST_CHECK(registry.add(second));
+    // Adding twice does not count twice
+    BOOST_CHECK(registry.add(second));
+    BOOST_CHECK_EQUAL(2, registry.count());
+
+    kill(first, SIGKILL);
+    waitpid(first, NULL, 0);
+    BOOST_CHECK(waitForCount(registry, 1));
+    BOOST_CHECK(!registry.contains(first));
+    BOOST_CHECK(registry.contains(second));
+
+    kill(second, SIGKILL);
+    waitpid(second, NULL, 0);
+    BOOST_CHECK(waitForCount(registry, 0));
+
+    // Not running anymore
+    BOOST_CHECK(!registry.add(first));
+    BOOST_CHECK_EQUAL(0, registry.count());
+}
+
+
+BOOST_AUTO_TEST_CASE (adoptRunning)
+{
+    UrlCopyProcessRegistry registry("sleep");
+
+    pid_t pid = spawnSleep();
+    BOOST_REQUIRE_GT(pid, 0);
+
+    // Give the child time to exec
+    for (int i = 0; i < 500 && registry.adoptRunning() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK(registry.contains(pid));
+    BOOST_CHECK_GE(registry.count(), 1);
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE (outOfDescriptors)
+{
+    UrlCopyProcessRegistry registry("fts-test-no-such-process");
+
+    pid_t pid = spawnSleep();
+    BOOST_REQUIRE_GT(pid, 0);
+
+    // Use up all the file descriptors, so the pidfd can not be opened
+    struct rlimit previous;
+    BOOST_REQUIRE_EQUAL(0, getrlimit(RLIMIT_NOFILE, &previous));
+    struct rlimit lowered = previous;
+    lowered.rlim_cur = 256;
+    BOOST_REQUIRE_EQUAL(0, setrlimit(RLIMIT_NOFILE, &lowered));
+
+    std::vector<int> fds;
+    int fd;
+    while ((fd = open("/dev/null", O_RDONLY)) >= 0) {
+        fds.push_back(fd);
+    }
+
+    // Counted anyway
+    BOOST_CHECK(registry.add(pid));
+    BOOST_CHECK(registry.contains(pid));
+    BOOST_CHECK_EQUAL(1, registry.count());
+
+    for (auto i = fds.begin(); i != fds.end(); ++i) {
+        close(*i);
+    }
+    setrlimit(RLIMIT_NOFILE, &previous);
+
+    // Watched once there is room again, and forgotten when it exits
+    BOOST_CHECK_EQUAL(1, registry.count());
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    BOOST_CHECK(waitForCount(registry, 0));
+    BOOST_CHECK(!registry.contains(pid));
+
+    // Also forgotten if it exits before there is room
+    pid = spawnSleep();
+    BOOST_REQUIRE_GT(pid, 0);
+    BOOST_REQUIRE_EQUAL(0, setrlimit(RLIMIT_NOFILE, &lowered));
+    fds.clear();
+    while ((fd = open("/dev/null", O_RDONLY)) >= 0) {
+        fds.push_back(fd);
+    }
+    BOOST_CHECK(registry.add(pid));
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    BOOST_CHECK_EQUAL(0, registry.count());
+
+    for (auto i = fds.begin(); i != fds.end(); ++i) {
+        close(*i);
+    }
+    setrlimit(RLIMIT_NOFILE, &previous);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
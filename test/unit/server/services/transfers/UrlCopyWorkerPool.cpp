@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) CERN 2025
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "msg-bus/WorkerChannel.h"
+#include "server/services/transfers/UrlCopyWorkerPool.h"
+
+using fts3::server::UrlCopyWorkerPool;
+
+
+BOOST_AUTO_TEST_SUITE(server)
+BOOST_AUTO_TEST_SUITE(UrlCopyWorkerPoolTestSuite)
+
+
+class UrlCopyWorkerPoolFixture {
+protected:
+    static const std::string TEST_PATH;
+    UrlCopyWorkerPool pool;
+
+public:
+    UrlCopyWorkerPoolFixture() {
+        boost::filesystem::create_directories(TEST_PATH);
+        // No worker is spawned, the test plays the workers
+        pool.start(TEST_PATH, 0, 10);
+    }
+
+    ~UrlCopyWorkerPoolFixture() {
+        pool.stop();
+        boost::filesystem::remove_all(TEST_PATH);
+    }
+
+    /// Connect a fake worker and announce it as idle
+    int connectWorker() {
+        int fd = WorkerChannel::connect(WorkerChannel::getSocketPath(TEST_PATH));
+        BOOST_REQUIRE_GE(fd, 0);
+        setReady(fd);
+        return fd;
+    }
+
+    void setReady(int fd) {
+        const char ready = WorkerChannel::READY;
+        BOOST_REQUIRE_EQUAL(1, send(fd, &ready, 1, MSG_NOSIGNAL));
+    }
+
+    bool waitForIdle(size_t expected) {
+        for (int i = 0; i < 500; ++i) {
+            if (pool.getIdleCount() == expected) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    std::vector<std::string> receive(int fd) {
+        std::vector<char> buffer(WorkerChannel::MAX_MESSAGE_SIZE);
+        ssize_t received = recv(fd, buffer.data(), buffer.size(), 0);
+        BOOST_REQUIRE_GT(received, 0);
+        return WorkerChannel::decodeArguments(buffer.data(), received);
+    }
+};
+
+const std::string UrlCopyWorkerPoolFixture::TEST_PATH("/tmp/UrlCopyWorkerPoolTest");
+
+
+BOOST_AUTO_TEST_CASE (encodeArguments)
+{
+    std::vector<std::string> args {"--job-id", "1234", "--file-metadata", "", "--monitoring"};
+    std::string encoded = WorkerChannel::encodeArguments(args);
+    BOOST_CHECK(args == WorkerChannel::decodeArguments(encoded.data(), encoded.size()));
+}
+
+
+BOOST_FIXTURE_TEST_CASE (dispatch, UrlCopyWorkerPoolFixture)
+{
+    std::vector<std::string> args {"--user-dn", "/DC=ch/CN=Test", "--source", "mock://a", "--destination", "mock://b"};
+    pid_t pid = 0;
+
+    BOOST_CHECK(pool.isEnabled());
+    // Nobody is waiting
+    BOOST_CHECK(!pool.dispatch(args, &pid));
+
+    int worker = connectWorker();
+    BOOST_REQUIRE(waitForIdle(1));
+
+    BOOST_CHECK(pool.dispatch(args, &pid));
+    BOOST_CHECK_EQUAL(getpid(), pid);
+    BOOST_CHECK(args == receive(worker));
+    BOOST_CHECK_EQUAL(0, pool.getIdleCount());
+
+    // Busy
+    BOOST_CHECK(!pool.dispatch(args, &pid));
+
+    // Stopping the pool tells the worker to go away
+    pool.stop();
+    char buffer[16];
+    BOOST_CHECK_EQUAL(0, recv(worker, buffer, sizeof(buffer), 0));
+    BOOST_CHECK(!pool.isEnabled());
+
+    close(worker);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (ownerAffinity, UrlCopyWorkerPoolFixture)
+{
+    std::vector<std::string> alice {"--user-dn", "/CN=Alice", "--vo", "dteam"};
+    std::vector<std::string> bob {"--user-dn", "/CN=Bob", "--vo", "dteam"};
+    pid_t pid = 0;
+
+    int first = connectWorker();
+    int second = connectWorker();
+    BOOST_REQUIRE(waitForIdle(2));
+
+    BOOST_REQUIRE(pool.dispatch(alice, &pid));
+    BOOST_REQUIRE(pool.dispatch(bob, &pid));
+
+    // Find out who got what
+    int aliceWorker = first;
+    if (receive(first) == bob) {
+        aliceWorker = second;
+    }
+    receive(second);
+    int bobWorker = (aliceWorker == first) ? second : first;
+
+    setReady(aliceWorker);
+    setReady(bobWorker);
+    BOOST_REQUIRE(waitForIdle(2));
+
+    // Alice goes back to the worker she used before
+    BOOST_REQUIRE(pool.dispatch(alice, &pid));
+    BOOST_CHECK(alice == receive(aliceWorker));
+
+    close(first);
+    close(second);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (killOnlyRunningTransfer, UrlCopyWorkerPoolFixture)
+{
+    std::vector<std::string> first {"--file-id", "1", "--user-dn", "/CN=Alice"};
+    std::vector<std::string> second {"--file-id", "2", "--user-dn", "/CN=Alice"};
+    pid_t pid = 0;
+
+    BOOST_CHECK_EQUAL(1, UrlCopyWorkerPool::getFileId(first));
+    BOOST_CHECK_EQUAL(0, UrlCopyWorkerPool::getFileId({"--job-id", "1234"}));
+
+    int worker = connectWorker();
+    BOOST_REQUIRE(waitForIdle(1));
+
+    // The fake worker is this process, so only probe it
+    BOOST_REQUIRE(pool.dispatch(first, &pid));
+    receive(worker);
+    BOOST_CHECK_EQUAL(0, pool.kill(pid, 1, 0));
+
+    // The first transfer is over, and the worker runs the second one
+    setReady(worker);
+    BOOST_REQUIRE(waitForIdle(1));
+    BOOST_CHECK_EQUAL(-1, pool.kill(pid, 1, 0));
+    BOOST_CHECK_EQUAL(ESRCH, errno);
+
+    BOOST_REQUIRE(pool.dispatch(second, &pid));
+    receive(worker);
+    BOOST_CHECK_EQUAL(-1, pool.kill(pid, 1, 0));
+    BOOST_CHECK_EQUAL(0, pool.kill(pid, 2, 0));
+
+    close(worker);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
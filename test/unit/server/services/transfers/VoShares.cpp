@@ -178,5 +178,50 @@ BOOST_AUTO_TEST_CASE (TestShareRespected)
     BOOST_CHECK_GT(count["cms"], count["dteam"]);
 }
 
+/**
+ * The alias table draws with the given probabilities, and never picks a weight <= 0
+ */
+BOOST_AUTO_TEST_CASE (TestAliasSampler)
+{
+    const unsigned NRuns = 100000;
+
+    AliasSampler sampler(std::vector<double>{50, 0, 30, 20, -1});
+    BOOST_CHECK(!sampler.empty());
+
+    std::mt19937 generator(42);
+    std::vector<unsigned> count(5);
+    for (unsigned i = 0; i < NRuns; ++i) {
+        count[sampler(generator)]++;
+    }
+
+    BOOST_CHECK_CLOSE(0.5, count[0] / static_cast<double>(NRuns), 3);
+    BOOST_CHECK_EQUAL(0, count[1]);
+    BOOST_CHECK_CLOSE(0.3, count[2] / static_cast<double>(NRuns), 3);
+    BOOST_CHECK_CLOSE(0.2, count[3] / static_cast<double>(NRuns), 3);
+    BOOST_CHECK_EQUAL(0, count[4]);
+
+    BOOST_CHECK(AliasSampler(std::vector<double>{0, 0}).empty());
+    BOOST_CHECK(AliasSampler(std::vector<double>()).empty());
+}
+
+/**
+ * The share configuration of all the links is split per pair
+ */
+BOOST_AUTO_TEST_CASE (TestGroupShareConfig)
+{
+    std::vector<ShareConfig> shares(3);
+    shares[0].source = pair.source; shares[0].destination = pair.destination; shares[0].vo = "atlas"; shares[0].weight = 80;
+    shares[1].source = pair.source; shares[1].destination = pair.destination; shares[1].vo = "public"; shares[1].weight = 20;
+    shares[2].source = pair.source; shares[2].destination = "mock://c"; shares[2].vo = "cms"; shares[2].weight = 10;
+
+    auto weightsPerPair = groupShareConfig(shares);
+
+    BOOST_CHECK_EQUAL(2, weightsPerPair.size());
+    BOOST_CHECK_EQUAL(2, weightsPerPair[pair].size());
+    BOOST_CHECK_EQUAL(80, weightsPerPair[pair]["atlas"]);
+    BOOST_CHECK_EQUAL(20, weightsPerPair[pair]["public"]);
+    BOOST_CHECK_EQUAL(10, (weightsPerPair[Pair(pair.source, "mock://c")]["cms"]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
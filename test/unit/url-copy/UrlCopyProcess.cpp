@@ -464,4 +464,112 @@ BOOST_FIXTURE_TEST_CASE (multiplePanic, UrlCopyFixture)
 }
 
 
+BOOST_FIXTURE_TEST_CASE (multipleConcurrent, UrlCopyFixture)
+{
+    Transfer original, original2;
+    original.fileId       = 1;
+    original.source       = Uri::parse("mock://host/path?size=10");
+    original.destination  = Uri::parse("mock://host/path?size_post=10&time=10");
+    original2.fileId      = 2;
+    original2.source      = Uri::parse("mock://host/path2?size=42");
+    original2.destination = Uri::parse("mock://host/path2?size_post=42&time=2");
+    opts.transfers.push_back(original);
+    opts.transfers.push_back(original2);
+    opts.concurrentTransfers = 2;
+
+    UrlCopyProcess proc(opts, *this);
+    time_t start = time(NULL);
+    proc.run();
+
+    // Run at the same time
+    BOOST_CHECK_LT(time(NULL) - start, 12);
+
+    BOOST_CHECK_EQUAL(startMsgs.size(), 2);
+    BOOST_CHECK_EQUAL(completedMsgs.size(), 2);
+
+    // The second transfer is shorter, but it is reported after the first one
+    Transfer c = completedMsgs.front();
+    BOOST_CHECK_EQUAL(c.fileId, 1);
+    BOOST_CHECK_EQUAL(c.error.get(), (void*)NULL);
+    BOOST_CHECK_EQUAL(c.fileSize, 10);
+
+    completedMsgs.pop_front();
+    c = completedMsgs.front();
+    BOOST_CHECK_EQUAL(c.fileId, 2);
+    BOOST_CHECK_EQUAL(c.error.get(), (void*)NULL);
+    BOOST_CHECK_EQUAL(c.fileSize, 42);
+}
+
+
+BOOST_FIXTURE_TEST_CASE (multipleConcurrentPanic, UrlCopyFixture)
+{
+    Transfer original, original2;
+    original.fileId       = 1;
+    original.source       = Uri::parse("mock://host/path?size=10");
+    original.destination  = Uri::parse("mock://host/path?size_post=10&time=10");
+    original2.fileId      = 2;
+    original2.source      = Uri::parse("mock://host/path2?size=42");
+    original2.destination = Uri::parse("mock://host/path2?size_post=42&time=2");
+    opts.transfers.push_back(original);
+    opts.transfers.push_back(original2);
+    opts.concurrentTransfers = 2;
+
+    UrlCopyProcess proc(opts, *this);
+    boost::thread thread(boost::bind(&UrlCopyProcess::run, &proc));
+    boost::this_thread::sleep(boost::posix_time::seconds(4));
+    proc.panic("Signal 385");
+
+    // The second transfer completed, but was held until the first one was
+    BOOST_CHECK_EQUAL(startMsgs.size(), 2);
+    BOOST_CHECK_EQUAL(completedMsgs.size(), 2);
+
+    Transfer c = completedMsgs.front();
+    BOOST_CHECK_EQUAL(c.fileId, 1);
+    BOOST_CHECK_NE(c.error.get(), (void*)NULL);
+    BOOST_CHECK_EQUAL(c.error->code(), EINTR);
+
+    completedMsgs.pop_front();
+    c = completedMsgs.front();
+    BOOST_CHECK_EQUAL(c.fileId, 2);
+    BOOST_CHECK_EQUAL(c.error.get(), (void*)NULL);
+    BOOST_CHECK_EQUAL(c.fileSize, 42);
+
+    thread.join();
+}
+
+
+BOOST_FIXTURE_TEST_CASE (multipleConcurrentCancel, UrlCopyFixture)
+{
+    Transfer original, original2, original3;
+    original.fileId       = 1;
+    original.source       = Uri::parse("mock://host/path?size=10");
+    original.destination  = Uri::parse("mock://host/path?size_post=10&time=10");
+    original2.fileId      = 2;
+    original2.source      = Uri::parse("mock://host/path2?size=42");
+    original2.destination = Uri::parse("mock://host/path2?size_post=42&time=10");
+    original3.fileId      = 3;
+    original3.source      = Uri::parse("mock://host/path3?size=5");
+    original3.destination = Uri::parse("mock://host/path3?size_post=5");
+    opts.transfers.push_back(original);
+    opts.transfers.push_back(original2);
+    opts.transfers.push_back(original3);
+    opts.concurrentTransfers = 2;
+
+    UrlCopyProcess proc(opts, *this);
+    boost::thread thread(boost::bind(&UrlCopyProcess::run, &proc));
+    boost::this_thread::sleep(boost::posix_time::seconds(4));
+    proc.cancel();
+    thread.join();
+
+    // The third transfer never started, but it is reported as canceled too
+    BOOST_CHECK_EQUAL(startMsgs.size(), 2);
+    BOOST_CHECK_EQUAL(completedMsgs.size(), 3);
+
+    for (auto c = completedMsgs.begin(); c != completedMsgs.end(); ++c) {
+        BOOST_CHECK_NE(c->error.get(), (void*)NULL);
+        BOOST_CHECK_EQUAL(c->error->code(), ECANCELED);
+    }
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()